@@ -5,6 +5,20 @@ layout(location = 1) in vec4 color;
 layout(location = 2) in vec2 tex_coord;
 layout(location = 3) in vec3 normal;
 
+// A mesh with compact vertices quantizes the positions in its bounding box and encodes the normals as octahedral normals
+// (the mesh sets these uniforms before it is drawn, and the defaults read the float vertices as they are)
+uniform vec3 position_scale = vec3(1.0);
+uniform vec3 position_offset = vec3(0.0);
+uniform bool octahedral_normal = false;
+
+vec3 decode_normal(vec3 normal){
+    if(!octahedral_normal) return normal;
+    vec3 decoded = vec3(normal.xy, 1.0 - abs(normal.x) - abs(normal.y));
+    float fold = max(-decoded.z, 0.0);
+    decoded.xy += vec2(decoded.x >= 0.0 ? -fold : fold, decoded.y >= 0.0 ? -fold : fold);
+    return normalize(decoded);
+}
+
 out Varyings {
     vec2 tex_coord;
     vec3 world;
@@ -20,11 +34,13 @@ uniform vec3 eye;
 
 
 void main(){
+    vec3 object_position = position_offset + position * position_scale;
+    vec3 object_normal = decode_normal(normal);
     
-    vec3 world = (M * vec4(position, 1.0)).xyz;
+    vec3 world = (M * vec4(object_position, 1.0)).xyz;
     gl_Position = vp * vec4(world, 1.0);
     
-    vs_out.normal = normalize(M_IT * vec4(normal, 0.0)).xyz;
+    vs_out.normal = normalize(M_IT * vec4(object_normal, 0.0)).xyz;
     vs_out.view = eye-world;
     vs_out.world = world;
     vs_out.tex_coord = tex_coord;
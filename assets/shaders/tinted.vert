@@ -3,6 +3,11 @@
 layout(location = 0) in vec3 position;
 layout(location = 1) in vec4 color;
 
+// A mesh with compact vertices quantizes the positions in its bounding box
+// (the mesh sets these uniforms before it is drawn, and the defaults read the float vertices as they are)
+uniform vec3 position_scale = vec3(1.0);
+uniform vec3 position_offset = vec3(0.0);
+
 out Varyings {
     vec4 color;
 } vs_out;
@@ -10,6 +15,7 @@ out Varyings {
 uniform mat4 transform;
 
 void main(){
-    gl_Position = transform * vec4(position, 1.0);
+    vec3 object_position = position_offset + position * position_scale;
+    gl_Position = transform * vec4(object_position, 1.0);
     vs_out.color = color;
 }
\ No newline at end of file
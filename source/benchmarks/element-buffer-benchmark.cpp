@@ -0,0 +1,134 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <algorithm>
+#include <array>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <flags/flags.h>
+
+#include <jobs/job-system.hpp>
+#include <mesh/mesh-utils.hpp>
+#include <mesh/mesh-optimizer.hpp>
+#include <mesh/element-buffer.hpp>
+
+// This benchmark packs the element buffers of the models (see "mesh/element-buffer.hpp") and reports the number of draw calls (ranges),
+// the share of the triangles that stay 32-bit and the size of the element buffer with 32-bit elements and with the packed elements.
+// Since the models have fewer than 65536 vertices, it also packs grids with more vertices (in their original order and in the order
+// of the mesh optimization) to exercise the split into ranges.
+// Usage: ELEMENT_BUFFER_BENCHMARK [obj files...] (default: every model in assets/models)
+// It checks that the packed ranges draw the same triangles as the original elements, and returns a non-zero exit code if they do not.
+
+struct Model
+{
+    std::string name;
+    std::vector<GLuint> elements;
+    size_t vertexCount;
+};
+
+// Returns a grid of "size" x "size" vertices with 2 triangles per cell
+Model createGrid(size_t size)
+{
+    Model model = {"grid " + std::to_string(size) + "x" + std::to_string(size), {}, size * size};
+    for (size_t row = 0; row + 1 < size; ++row)
+    {
+        for (size_t column = 0; column + 1 < size; ++column)
+        {
+            GLuint corner = GLuint(row * size + column);
+            model.elements.insert(model.elements.end(), {corner, corner + 1, corner + GLuint(size), corner + 1, corner + GLuint(size) + 1, corner + GLuint(size)});
+        }
+    }
+    return model;
+}
+
+int main(int argc, char **argv)
+{
+    flags::args args(argc, argv);
+    std::vector<std::string> paths(args.positional().begin(), args.positional().end());
+    if (paths.empty())
+    {
+        for (const auto &entry : std::filesystem::directory_iterator("assets/models"))
+            if (entry.path().extension() == ".obj")
+                paths.push_back(entry.path().generic_string());
+        std::sort(paths.begin(), paths.end());
+    }
+
+    // The OBJ parser runs on the job system
+    our::JobSystem::get();
+
+    std::vector<Model> models;
+    for (const std::string &path : paths)
+    {
+        our::mesh_utils::MeshData data;
+        if (!our::mesh_utils::parseOBJ(path.c_str(), data))
+            return -1;
+        models.push_back({path, std::move(data.elements), data.vertices.size()});
+    }
+    for (size_t size : {300, 1000})
+    {
+        models.push_back(createGrid(size));
+        // The grid is reordered like the loaded meshes when the mesh optimization is enabled (the vertices only matter for their order)
+        Model grid = createGrid(size);
+        grid.name += " optimized";
+        std::vector<our::Vertex> vertices(grid.vertexCount);
+        our::mesh_utils::optimizeVertexCache(grid.elements, grid.vertexCount);
+        our::mesh_utils::optimizeVertexFetch(vertices, grid.elements);
+        models.push_back(std::move(grid));
+    }
+
+    std::cout << std::left << std::setw(28) << "file" << std::right << std::setw(10) << "vertices" << std::setw(10) << "ranges"
+              << std::setw(12) << "32-bit %" << std::setw(14) << "32-bit KB" << std::setw(14) << "packed KB" << std::setw(10) << "ms" << std::endl;
+
+    bool valid = true;
+    size_t totalIntegers = 0, totalPacked = 0;
+    for (const Model &model : models)
+    {
+        our::PackedElements packed;
+        auto start = std::chrono::high_resolution_clock::now();
+        our::packElements(model.elements.data(), model.elements.size(), model.vertexCount, packed);
+        auto end = std::chrono::high_resolution_clock::now();
+        double milliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+
+        size_t integerBytes = model.elements.size() * sizeof(GLuint);
+        size_t packedBytes = packed.getByteCount();
+        totalIntegers += integerBytes;
+        totalPacked += packedBytes;
+        std::cout << std::left << std::setw(28) << model.name << std::right << std::setw(10) << model.vertexCount << std::setw(10) << packed.ranges.size()
+                  << std::setw(12) << std::fixed << std::setprecision(2) << 100.0 * packed.integers.size() / std::max<size_t>(model.elements.size(), 1)
+                  << std::setw(14) << std::setprecision(1) << integerBytes / 1024.0 << std::setw(14) << packedBytes / 1024.0
+                  << std::setw(10) << std::setprecision(3) << milliseconds << std::endl;
+
+        // The ranges read from the buffer as the GPU would (the element plus the base vertex of its range) must give the same triangles
+        // (the triangles may move between the ranges, so they are compared as sorted lists)
+        std::vector<std::array<GLuint, 3>> original, drawn;
+        for (size_t element = 0; element + 2 < model.elements.size(); element += 3)
+            original.push_back({model.elements[element], model.elements[element + 1], model.elements[element + 2]});
+        for (const our::ElementRange &range : packed.ranges)
+        {
+            for (GLsizei element = 0; element + 2 < range.count; element += 3)
+            {
+                std::array<GLuint, 3> triangle;
+                for (int corner = 0; corner < 3; ++corner)
+                {
+                    if (range.type == GL_UNSIGNED_SHORT)
+                        triangle[corner] = GLuint(packed.shorts[range.offset / sizeof(std::uint16_t) + element + corner]) + GLuint(range.baseVertex);
+                    else
+                        triangle[corner] = packed.integers[(range.offset - packed.getIntegerOffset()) / sizeof(GLuint) + element + corner] + GLuint(range.baseVertex);
+                }
+                drawn.push_back(triangle);
+            }
+        }
+        std::sort(original.begin(), original.end());
+        std::sort(drawn.begin(), drawn.end());
+        if (original != drawn)
+            valid = false;
+        if (!valid)
+        {
+            std::cout << "  the packed elements do not draw the same triangles" << std::endl;
+            break;
+        }
+    }
+    std::cout << "total: " << std::fixed << std::setprecision(1) << totalIntegers / 1024.0 << " KB -> " << totalPacked / 1024.0 << " KB" << std::endl;
+    return valid ? 0 : 1;
+}
@@ -0,0 +1,127 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <flags/flags.h>
+
+#include <ecs/world.hpp>
+
+// This benchmark compares the entity storage of the world against the storage it replaced:
+// - "legacy": every entity is allocated with "new" and the entities are kept in an unordered_set
+// - "pooled": the entities are allocated from the world's chunked entity pool and kept in a dense array
+// For each storage, it spawns N entities, iterates over them, destroys them, then spawns and destroys them once more
+// (to show that the pool recycles its slots) and reports the time and the number of heap allocations of each step.
+
+// We count the heap allocations by replacing the global operator new
+static std::size_t allocationCount = 0;
+
+void *operator new(std::size_t size)
+{
+    ++allocationCount;
+    if (void *pointer = std::malloc(size))
+        return pointer;
+    throw std::bad_alloc();
+}
+void operator delete(void *pointer) noexcept { std::free(pointer); }
+void operator delete(void *pointer, std::size_t) noexcept { std::free(pointer); }
+
+// This is a replica of the entity and the world as they were before the entity pool
+struct LegacyEntity
+{
+    std::unordered_map<std::string, our::Component *> components;
+    std::string name;
+    LegacyEntity *parent = nullptr;
+    our::Transform localTransform;
+    our::Transform lastNonCollidedLocalTransform;
+};
+
+struct LegacyWorld
+{
+    std::unordered_set<LegacyEntity *> entities;
+    LegacyEntity *add()
+    {
+        auto entity = new LegacyEntity();
+        entities.insert(entity);
+        return entity;
+    }
+    void clear()
+    {
+        for (auto entity : entities)
+            delete entity;
+        entities.clear();
+    }
+};
+
+// Measures the time (in milliseconds) and the number of allocations done by the given function
+struct Measurement
+{
+    double milliseconds;
+    std::size_t allocations;
+};
+
+template <typename Function>
+Measurement measure(Function function)
+{
+    std::size_t allocationsBefore = allocationCount;
+    auto start = std::chrono::high_resolution_clock::now();
+    function();
+    auto end = std::chrono::high_resolution_clock::now();
+    return {std::chrono::duration<double, std::milli>(end - start).count(), allocationCount - allocationsBefore};
+}
+
+void report(const char *storage, const char *step, const Measurement &measurement)
+{
+    std::cout << std::left << std::setw(8) << storage << std::setw(12) << step
+              << std::right << std::setw(12) << std::fixed << std::setprecision(2) << measurement.milliseconds << " ms"
+              << std::setw(12) << measurement.allocations << " allocations" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    flags::args args(argc, argv);
+    // The number of entities to spawn and destroy (default: one million)
+    int count = args.get<int>("n", 1000000);
+    // The number of times we iterate over all the entities
+    int iterations = args.get<int>("i", 10);
+
+    std::cout << "Spawning and destroying " << count << " entities (iterating " << iterations << " times)" << std::endl;
+
+    float sum = 0; // We accumulate the positions so that the compiler doesn't optimize away the iteration
+
+    {
+        LegacyWorld world;
+        report("legacy", "spawn", measure([&]()
+                                          { for (int i = 0; i < count; ++i) world.add()->localTransform.position.x = float(i); }));
+        report("legacy", "iterate", measure([&]()
+                                            { for (int it = 0; it < iterations; ++it) for (auto entity : world.entities) sum += entity->localTransform.position.x; }));
+        report("legacy", "destroy", measure([&]()
+                                            { world.clear(); }));
+        report("legacy", "respawn", measure([&]()
+                                            { for (int i = 0; i < count; ++i) world.add(); }));
+        report("legacy", "destroy", measure([&]()
+                                            { world.clear(); }));
+    }
+
+    {
+        our::World world;
+        report("pooled", "spawn", measure([&]()
+                                          { for (int i = 0; i < count; ++i) world.add()->modifyLocalTransform().position.x = float(i); }));
+        report("pooled", "iterate", measure([&]()
+                                            { for (int it = 0; it < iterations; ++it) for (auto entity : world.getEntities()) sum += entity->getLocalTransform().position.x; }));
+        report("pooled", "destroy", measure([&]()
+                                            {
+            for (auto entity : world.getEntities()) world.markForRemoval(entity);
+            world.deleteMarkedEntities(); }));
+        report("pooled", "respawn", measure([&]()
+                                            { for (int i = 0; i < count; ++i) world.add(); }));
+        report("pooled", "destroy", measure([&]()
+                                            { world.clear(); }));
+    }
+
+    std::cout << "(checksum: " << sum << ")" << std::endl;
+    return 0;
+}
@@ -0,0 +1,171 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <cmath>
+#include <flags/flags.h>
+
+#include <jobs/job-system.hpp>
+
+// This benchmark compares the work-stealing job system against a naive thread pool where all the threads share
+// a single queue protected by a mutex. For each thread count, it measures:
+// - "empty": the scheduling overhead per job (N empty jobs are submitted then waited for)
+// - "small": the throughput of N small jobs (each job does a little arithmetic)
+// - "nested": the throughput of jobs that submit more jobs (each of the N/64 root jobs submits 64 small jobs)
+
+// This is the naive pool: a single shared queue and a condition variable
+class NaiveQueue
+{
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    bool stopping = false;
+
+public:
+    explicit NaiveQueue(unsigned workerCount)
+    {
+        for (unsigned index = 0; index < workerCount; ++index)
+            workers.emplace_back([this]()
+                                 {
+                while (true)
+                {
+                    std::function<void()> task;
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        wakeUp.wait(lock, [this]() { return stopping || !tasks.empty(); });
+                        if (tasks.empty()) return;
+                        task = std::move(tasks.front());
+                        tasks.pop_front();
+                    }
+                    task();
+                } });
+    }
+    ~NaiveQueue()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeUp.notify_all();
+        for (auto &worker : workers)
+            worker.join();
+    }
+    void submit(std::function<void()> task, std::atomic<int> *counter)
+    {
+        counter->fetch_add(1, std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back([task = std::move(task), counter]()
+                            { task(); counter->fetch_sub(1, std::memory_order_release); });
+        }
+        wakeUp.notify_one();
+    }
+    bool tryRunOne()
+    {
+        std::function<void()> task;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (tasks.empty())
+                return false;
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+        return true;
+    }
+    void wait(const std::atomic<int> &counter)
+    {
+        while (counter.load(std::memory_order_acquire) != 0)
+            if (!tryRunOne())
+                std::this_thread::yield();
+    }
+};
+
+// A little arithmetic so that the small jobs are not free
+static std::atomic<double> sink{0};
+static void smallWork()
+{
+    double value = 0;
+    for (int i = 1; i <= 200; ++i)
+        value += std::sqrt(double(i));
+    sink.store(value, std::memory_order_relaxed);
+}
+
+template <typename Function>
+double measure(Function function)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    function();
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+void report(int threads, const char *pool, const char *test, double nanoseconds, int jobCount)
+{
+    std::cout << std::setw(4) << threads << " threads  " << std::left << std::setw(10) << pool << std::setw(8) << test << std::right
+              << std::fixed << std::setprecision(1) << std::setw(10) << nanoseconds / jobCount << " ns/job"
+              << std::setw(12) << std::setprecision(2) << jobCount / (nanoseconds * 1e-9) / 1e6 << " M jobs/s" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    flags::args args(argc, argv);
+    // The number of jobs in each test
+    int count = args.get<int>("n", 200000);
+    // The maximum number of threads (default: the number of hardware threads)
+    int maxThreads = args.get<int>("t", int(our::JobSystem::getDefaultWorkerCount() + 1));
+
+    std::cout << "Running " << count << " jobs per test" << std::endl;
+
+    for (int threads = 1; threads <= maxThreads; threads = (threads * 2 > maxThreads && threads != maxThreads) ? maxThreads : threads * 2)
+    {
+        {
+            our::JobSystem jobs(threads - 1);
+            our::JobCounter counter;
+            report(threads, "stealing", "empty", measure([&]()
+                                                         {
+                for (int i = 0; i < count; ++i) jobs.submit([]() {}, &counter);
+                jobs.wait(counter); }),
+                   count);
+            report(threads, "stealing", "small", measure([&]()
+                                                         {
+                for (int i = 0; i < count; ++i) jobs.submit(smallWork, &counter);
+                jobs.wait(counter); }),
+                   count);
+            report(threads, "stealing", "nested", measure([&]()
+                                                          {
+                for (int i = 0; i < count / 64; ++i)
+                    jobs.submit([&]() { for (int j = 0; j < 64; ++j) jobs.submit(smallWork, &counter); }, &counter);
+                jobs.wait(counter); }),
+                   count / 64 * 65);
+        }
+        {
+            NaiveQueue queue(threads - 1);
+            std::atomic<int> counter{0};
+            report(threads, "naive", "empty", measure([&]()
+                                                      {
+                for (int i = 0; i < count; ++i) queue.submit([]() {}, &counter);
+                queue.wait(counter); }),
+                   count);
+            report(threads, "naive", "small", measure([&]()
+                                                      {
+                for (int i = 0; i < count; ++i) queue.submit(smallWork, &counter);
+                queue.wait(counter); }),
+                   count);
+            report(threads, "naive", "nested", measure([&]()
+                                                       {
+                for (int i = 0; i < count / 64; ++i)
+                    queue.submit([&]() { for (int j = 0; j < 64; ++j) queue.submit(smallWork, &counter); }, &counter);
+                queue.wait(counter); }),
+                   count / 64 * 65);
+        }
+    }
+    return 0;
+}
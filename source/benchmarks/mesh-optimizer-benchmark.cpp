@@ -0,0 +1,101 @@
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+#include <array>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <flags/flags.h>
+
+#include <jobs/job-system.hpp>
+#include <mesh/mesh-utils.hpp>
+#include <mesh/mesh-optimizer.hpp>
+
+// This benchmark runs the mesh optimizer (see "mesh/mesh-optimizer.hpp") on the models and reports the vertex cache efficiency
+// (ACMR & ATVR with a FIFO cache of VERTEX_CACHE_SIZE vertices) of their triangles:
+// - "loaded": in the order of the file (which is the order the mesh loader gives when the optimization is disabled)
+// - "cache": after reordering the triangles for the vertex cache
+// - "overdraw": after reordering the clusters of triangles for the overdraw (which costs a little of the vertex cache efficiency)
+// The vertex fetch optimization does not change these numbers, since it only renames the vertices.
+// Usage: MESH_OPTIMIZER_BENCHMARK [obj files...] (default: every model in assets/models)
+// It also checks that the optimized meshes draw the same triangles, and returns a non-zero exit code if they do not.
+
+// Returns the triangles as the vertices of their corners, sorted (so two meshes draw the same triangles if they give the same list)
+std::vector<std::array<our::Vertex, 3>> getSortedTriangles(const our::mesh_utils::MeshData &data)
+{
+    std::vector<std::array<our::Vertex, 3>> triangles;
+    for (size_t element = 0; element + 2 < data.elements.size(); element += 3)
+        triangles.push_back({data.vertices[data.elements[element]], data.vertices[data.elements[element + 1]], data.vertices[data.elements[element + 2]]});
+    std::sort(triangles.begin(), triangles.end(), [](const std::array<our::Vertex, 3> &first, const std::array<our::Vertex, 3> &second)
+              { return std::memcmp(first.data(), second.data(), sizeof(first)) < 0; });
+    return triangles;
+}
+
+int main(int argc, char **argv)
+{
+    flags::args args(argc, argv);
+    std::vector<std::string> paths(args.positional().begin(), args.positional().end());
+    if (paths.empty())
+    {
+        for (const auto &entry : std::filesystem::directory_iterator("assets/models"))
+            if (entry.path().extension() == ".obj")
+                paths.push_back(entry.path().generic_string());
+        std::sort(paths.begin(), paths.end());
+    }
+
+    // The OBJ parser runs on the job system
+    our::JobSystem::get();
+
+    std::cout << "ACMR (transformed vertices per triangle) & ATVR (transformed vertices per vertex) with a FIFO cache of "
+              << our::mesh_utils::VERTEX_CACHE_SIZE << " vertices" << std::endl;
+    std::cout << std::left << std::setw(28) << "file" << std::right << std::setw(10) << "triangles"
+              << std::setw(24) << "ACMR loaded/cache/ovr" << std::setw(24) << "ATVR loaded/cache/ovr" << std::setw(10) << "ms" << std::endl;
+
+    bool valid = true;
+    for (const std::string &path : paths)
+    {
+        our::mesh_utils::MeshData data;
+        if (!our::mesh_utils::parseOBJ(path.c_str(), data))
+            return -1;
+        auto originalTriangles = getSortedTriangles(data);
+
+        size_t vertexCount = data.vertices.size();
+        auto measure = [&](float results[2])
+        {
+            results[0] = our::mesh_utils::computeACMR(data.elements.data(), data.elements.size(), vertexCount);
+            results[1] = our::mesh_utils::computeATVR(data.elements.data(), data.elements.size(), vertexCount);
+        };
+        float loaded[2], cache[2], overdraw[2];
+        measure(loaded);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        our::mesh_utils::optimizeVertexCache(data.elements, vertexCount);
+        auto afterCache = std::chrono::high_resolution_clock::now();
+        measure(cache);
+        auto beforeOverdraw = std::chrono::high_resolution_clock::now();
+        our::mesh_utils::optimizeOverdraw(data.elements, data.vertices);
+        auto afterOverdraw = std::chrono::high_resolution_clock::now();
+        measure(overdraw);
+        auto beforeFetch = std::chrono::high_resolution_clock::now();
+        our::mesh_utils::optimizeVertexFetch(data.vertices, data.elements);
+        auto end = std::chrono::high_resolution_clock::now();
+        double milliseconds = std::chrono::duration<double, std::milli>((afterCache - start) + (afterOverdraw - beforeOverdraw) + (end - beforeFetch)).count();
+
+        std::ostringstream acmr, atvr;
+        acmr << std::fixed << std::setprecision(3) << loaded[0] << "/" << cache[0] << "/" << overdraw[0];
+        atvr << std::fixed << std::setprecision(3) << loaded[1] << "/" << cache[1] << "/" << overdraw[1];
+        std::cout << std::left << std::setw(28) << path << std::right << std::setw(10) << data.elements.size() / 3
+                  << std::setw(24) << acmr.str() << std::setw(24) << atvr.str()
+                  << std::setw(10) << std::fixed << std::setprecision(2) << milliseconds << std::endl;
+
+        if (getSortedTriangles(data) != originalTriangles || data.vertices.size() != vertexCount)
+        {
+            std::cout << "  the optimized mesh does not draw the same triangles" << std::endl;
+            valid = false;
+        }
+    }
+    return valid ? 0 : 1;
+}
@@ -0,0 +1,190 @@
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <streambuf>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
+#include <flags/flags.h>
+
+// The benchmark keeps its own copy of Tiny OBJ Loader, which the engine used before it got its own OBJ parser
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <tinyobj/tiny_obj_loader.h>
+
+#include <jobs/job-system.hpp>
+#include <io/asset-pack.hpp>
+#include <mesh/obj-parser.hpp>
+#include <mesh/mesh-utils.hpp>
+
+// This benchmark compares the OBJ parser of the engine (see "mesh/obj-parser.hpp") against the previous loader (Tiny OBJ Loader)
+// Usage: OBJ_PARSER_BENCHMARK [-i iterations] [obj files...] (default: assets/models/tree.obj)
+// For each file, it measures the throughput (in MB of the file per second) of:
+// - "parse": reading the attributes & the faces (LoadObj for Tiny OBJ Loader, "parseObj" for the engine)
+// - "load": parsing then removing the duplicated vertices (which gives the buffers that are sent to the GPU)
+// It also checks that both loaders give the same buffers (if the file has a normal for every corner, since the old loader required them),
+// and returns a non-zero exit code if they differ, so it can be used as a correctness test.
+
+// A read only stream buffer over bytes in memory
+class MemoryBuffer : public std::streambuf
+{
+public:
+    MemoryBuffer(const std::byte *data, size_t size)
+    {
+        char *begin = const_cast<char *>(reinterpret_cast<const char *>(data));
+        setg(begin, begin, begin + size);
+    }
+};
+
+struct TinyObjResult
+{
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+};
+
+// Parses the file with Tiny OBJ Loader
+bool parseWithTinyObj(const our::AssetFile &file, TinyObjResult &result)
+{
+    MemoryBuffer buffer(file.data(), file.size());
+    std::istream stream(&buffer);
+    std::vector<tinyobj::material_t> materials;
+    std::string warn, err;
+    tinyobj::MaterialFileReader materialReader("");
+    result = TinyObjResult();
+    return tinyobj::LoadObj(&result.attrib, &result.shapes, &materials, &warn, &err, &stream, &materialReader);
+}
+
+// Removes the duplicated vertices the way the previous loader did (the missing attributes are read as zeros instead of out of bounds)
+void weldTinyObj(const TinyObjResult &result, our::mesh_utils::MeshData &data)
+{
+    const tinyobj::attrib_t &attrib = result.attrib;
+    data.vertices.clear();
+    data.elements.clear();
+    std::unordered_map<our::Vertex, GLuint> vertex_map;
+    for (const auto &shape : result.shapes)
+    {
+        for (const auto &index : shape.mesh.indices)
+        {
+            our::Vertex vertex = {};
+            vertex.position = {attrib.vertices[3 * index.vertex_index + 0], attrib.vertices[3 * index.vertex_index + 1], attrib.vertices[3 * index.vertex_index + 2]};
+            if (index.normal_index >= 0)
+                vertex.normal = {attrib.normals[3 * index.normal_index + 0], attrib.normals[3 * index.normal_index + 1], attrib.normals[3 * index.normal_index + 2]};
+            if (index.texcoord_index >= 0)
+                vertex.tex_coord = {attrib.texcoords[2 * index.texcoord_index + 0], attrib.texcoords[2 * index.texcoord_index + 1]};
+            vertex.color = {attrib.colors[3 * index.vertex_index + 0] * 255, attrib.colors[3 * index.vertex_index + 1] * 255, attrib.colors[3 * index.vertex_index + 2] * 255, 255};
+            auto it = vertex_map.find(vertex);
+            if (it == vertex_map.end())
+            {
+                auto new_vertex_index = static_cast<GLuint>(data.vertices.size());
+                vertex_map[vertex] = new_vertex_index;
+                data.elements.push_back(new_vertex_index);
+                data.vertices.push_back(vertex);
+            }
+            else
+            {
+                data.elements.push_back(it->second);
+            }
+        }
+    }
+}
+
+// Returns true if every corner of every face has a normal
+bool hasAllNormals(const TinyObjResult &result)
+{
+    for (const auto &shape : result.shapes)
+        for (const auto &index : shape.mesh.indices)
+            if (index.normal_index < 0)
+                return false;
+    return true;
+}
+
+// Returns the maximum difference between the attributes of the two meshes (or infinity if their buffers have different sizes or elements)
+float compareMeshes(const our::mesh_utils::MeshData &a, const our::mesh_utils::MeshData &b)
+{
+    if (a.vertices.size() != b.vertices.size() || a.elements != b.elements)
+        return INFINITY;
+    float maximum = 0;
+    for (size_t index = 0; index < a.vertices.size(); ++index)
+    {
+        const our::Vertex &first = a.vertices[index], &second = b.vertices[index];
+        maximum = std::max({maximum, glm::length(first.position - second.position), glm::length(first.normal - second.normal),
+                            glm::length(first.tex_coord - second.tex_coord), glm::length(glm::vec4(first.color) - glm::vec4(second.color))});
+    }
+    return maximum;
+}
+
+int main(int argc, char **argv)
+{
+    flags::args args(argc, argv);
+    // The number of times each file is parsed by each loader (the best time is kept)
+    int iterations = args.get<int>("i", 10);
+    std::vector<std::string> paths(args.positional().begin(), args.positional().end());
+    if (paths.empty())
+        paths.push_back("assets/models/tree.obj");
+
+    our::JobSystem &jobs = our::JobSystem::get();
+    std::cout << "Parsing with " << jobs.getThreadCount() << " threads (the best of " << iterations << " iterations)" << std::endl;
+    std::cout << std::left << std::setw(28) << "file" << std::right << std::setw(10) << "MB"
+              << std::setw(16) << "tinyobj parse" << std::setw(14) << "tinyobj load" << std::setw(14) << "engine parse" << std::setw(14) << "engine load"
+              << std::setw(10) << "speedup" << "  (MB/s)" << std::endl;
+
+    // Runs the function "iterations" times and returns the best time in seconds
+    auto measure = [&](auto function)
+    {
+        double best = INFINITY;
+        for (int iteration = 0; iteration < iterations; ++iteration)
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+            function();
+            best = std::min(best, std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count());
+        }
+        return best;
+    };
+
+    bool identical = true;
+    for (const std::string &path : paths)
+    {
+        our::AssetFile file;
+        if (!file.open(path))
+        {
+            std::cerr << "Couldn't open file: " << path << std::endl;
+            return -1;
+        }
+        double megabytes = double(file.size()) / (1024.0 * 1024.0);
+
+        TinyObjResult tinyResult;
+        our::mesh_utils::MeshData tinyData, engineData;
+        our::ObjData obj;
+        std::string error;
+        double tinyParse = measure([&]()
+                                   { parseWithTinyObj(file, tinyResult); });
+        double tinyLoad = measure([&]()
+                                  { parseWithTinyObj(file, tinyResult); weldTinyObj(tinyResult, tinyData); });
+        double engineParse = measure([&]()
+                                     { our::parseObj(reinterpret_cast<const char *>(file.data()), file.size(), obj, error); });
+        double engineLoad = measure([&]()
+                                    { our::mesh_utils::parseOBJ(file, path.c_str(), engineData); });
+
+        std::cout << std::left << std::setw(28) << path << std::right << std::fixed << std::setprecision(2) << std::setw(10) << megabytes
+                  << std::setprecision(1) << std::setw(16) << megabytes / tinyParse << std::setw(14) << megabytes / tinyLoad
+                  << std::setw(14) << megabytes / engineParse << std::setw(14) << megabytes / engineLoad
+                  << std::setw(9) << tinyLoad / engineLoad << "x" << std::endl;
+
+        if (hasAllNormals(tinyResult))
+        {
+            float difference = compareMeshes(tinyData, engineData);
+            if (difference > 1e-5f)
+            {
+                std::cout << "  the buffers differ from the previous loader (max difference: " << difference << ")" << std::endl;
+                identical = false;
+            }
+        }
+        else
+        {
+            std::cout << "  some faces have no normals, so the buffers are not compared (the engine shades them flat)" << std::endl;
+        }
+    }
+    return identical ? 0 : 1;
+}
@@ -0,0 +1,82 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <flags/flags.h>
+
+#include <ecs/world.hpp>
+#include <ecs/scheduler.hpp>
+#include <jobs/job-system.hpp>
+#include <systems/movement.hpp>
+#include <systems/random-movement.hpp>
+
+// This benchmark is a stress scene for the system scheduler.
+// It fills a world with N moving entities (half of them have a MovementComponent and the other half have a RandomMovementComponent)
+// then runs the movement and random movement systems through the scheduler for a number of frames.
+// The scene is run once for each thread count (1, 2, 4, ... up to the number of hardware threads)
+// and the time per frame and the speedup relative to a single thread are reported.
+
+// Fills the world with the moving entities of the stress scene
+void populate(our::World &world, int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        our::Entity *entity = world.add();
+        entity->modifyLocalTransform().position = glm::vec3(float(i % 200) - 100.0f, 0.0f, float((i / 200) % 200) - 100.0f);
+        if (i % 2 == 0)
+        {
+            auto movement = entity->addComponent<our::MovementComponent>();
+            movement->linearVelocity = glm::vec3(1.0f, 0.0f, 0.5f);
+            movement->angularVelocity = glm::vec3(0.0f, 1.0f, 0.0f);
+        }
+        else
+        {
+            auto movement = entity->addComponent<our::RandomMovementComponent>();
+            movement->linearVelocity = glm::vec3(3.0f, 0.0f, 3.0f);
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    flags::args args(argc, argv);
+    // The number of moving entities (default: 100k)
+    int count = args.get<int>("n", 100000);
+    // The number of frames to simulate for each thread count
+    int frames = args.get<int>("f", 200);
+    // The maximum number of threads (default: the number of hardware threads)
+    int maxThreads = args.get<int>("t", int(our::JobSystem::getDefaultWorkerCount() + 1));
+
+    std::cout << "Simulating " << count << " moving entities for " << frames << " frames" << std::endl;
+    if (maxThreads <= 1)
+        std::cout << "(only 1 hardware thread is available so the scaling can not be measured on this machine, use -t to force more threads)" << std::endl;
+
+    double baseline = 0;
+    for (int threads = 1; threads <= maxThreads; threads = (threads * 2 > maxThreads && threads != maxThreads) ? maxThreads : threads * 2)
+    {
+        our::World world;
+        populate(world, count);
+        our::MovementSystem movementSystem;
+        our::RandomMovementSystem randomMovementSystem;
+        // The calling thread takes part in the work so the job system needs one worker less than the thread count
+        our::JobSystem jobs(threads - 1);
+        our::SystemScheduler scheduler(&jobs);
+        scheduler.add("movement", our::MovementSystem::getAccess(), [&](float deltaTime)
+                      { movementSystem.update(&world, deltaTime, &jobs); });
+        scheduler.add("random movement", our::RandomMovementSystem::getAccess(), [&](float deltaTime)
+                      { randomMovementSystem.update(&world, deltaTime, &jobs); });
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int frame = 0; frame < frames; ++frame)
+            scheduler.run(&world, 1.0f / 60.0f);
+        auto end = std::chrono::high_resolution_clock::now();
+
+        double milliseconds = std::chrono::duration<double, std::milli>(end - start).count() / frames;
+        if (threads == 1)
+            baseline = milliseconds;
+        std::cout << std::setw(4) << threads << " threads" << std::fixed << std::setprecision(3)
+                  << std::setw(12) << milliseconds << " ms/frame"
+                  << std::setw(10) << std::setprecision(2) << baseline / milliseconds << "x speedup" << std::endl;
+    }
+    return 0;
+}
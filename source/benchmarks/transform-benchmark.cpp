@@ -0,0 +1,111 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <random>
+#include <cmath>
+#include <algorithm>
+#include <flags/flags.h>
+
+#include <ecs/transform-batch.hpp>
+
+// This benchmark compares the batched transform kernel against the reference ("Transform::toMat4" for every transform).
+// It first checks the precision of every kernel level against the reference, then measures the time per transform of each of them.
+// The program returns a non-zero exit code if the error of any level exceeds the tolerance, so it can be used as a precision test.
+
+// The error of the rotation & scale part is measured relative to the scale of each column (so large scales are not penalized)
+// and the error of the translation is measured relative to the position.
+static constexpr float TOLERANCE = 4e-6f;
+
+// Returns the maximum relative error between the matrices and the reference matrices
+float measureError(const std::vector<glm::mat4> &matrices, const std::vector<glm::mat4> &reference, const our::TransformBatch &batch)
+{
+    float maximum = 0;
+    for (size_t index = 0; index < matrices.size(); ++index)
+    {
+        const float scales[3] = {batch.scaleX[index], batch.scaleY[index], batch.scaleZ[index]};
+        for (int column = 0; column < 4; ++column)
+        {
+            for (int row = 0; row < 4; ++row)
+            {
+                float magnitude = column < 3 ? std::abs(scales[column]) : std::max(1.0f, std::abs(reference[index][column][row]));
+                maximum = std::max(maximum, std::abs(matrices[index][column][row] - reference[index][column][row]) / magnitude);
+            }
+        }
+    }
+    return maximum;
+}
+
+int main(int argc, char **argv)
+{
+    flags::args args(argc, argv);
+    // The number of transforms (default: one million)
+    int count = args.get<int>("n", 1000000);
+    // The number of times each kernel is run
+    int iterations = args.get<int>("i", 20);
+
+    // We fill the batch with random transforms (the angles cover several turns in both directions)
+    our::TransformBatch batch;
+    batch.reserve(count);
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<float> position(-1000.0f, 1000.0f), angle(-20.0f, 20.0f), scale(0.1f, 10.0f);
+    for (int index = 0; index < count; ++index)
+    {
+        our::Transform transform;
+        transform.position = glm::vec3(position(generator), position(generator), position(generator));
+        transform.rotation = glm::vec3(angle(generator), angle(generator), angle(generator));
+        transform.scale = glm::vec3(scale(generator), scale(generator), scale(generator));
+        batch.push(transform);
+    }
+
+    std::vector<glm::mat4> reference(count), matrices(count);
+    our::computeMatricesReference(batch, reference.data());
+
+    struct Level
+    {
+        const char *name;
+        our::SimdLevel level;
+    };
+    std::vector<Level> levels = {{"scalar", our::SimdLevel::SCALAR}, {"sse2", our::SimdLevel::SSE2}, {"avx2", our::SimdLevel::AVX2}};
+    our::SimdLevel best = our::getBestSimdLevel();
+
+    std::cout << "Computing " << count << " matrices (" << iterations << " iterations)" << std::endl;
+    bool precise = true;
+    for (auto &level : levels)
+    {
+        if (level.level > best)
+        {
+            std::cout << std::left << std::setw(12) << level.name << "not supported on this machine" << std::endl;
+            continue;
+        }
+        our::computeMatrices(batch, matrices.data(), level.level);
+        float error = measureError(matrices, reference, batch);
+        precise = precise && error <= TOLERANCE;
+        std::cout << std::left << std::setw(12) << level.name << "max relative error: " << std::scientific << std::setprecision(3) << error
+                  << (error <= TOLERANCE ? " (ok)" : " (FAILED)") << std::endl;
+    }
+
+    auto measure = [&](auto function)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int iteration = 0; iteration < iterations; ++iteration)
+            function();
+        auto end = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration<double, std::nano>(end - start).count() / (double(count) * iterations);
+    };
+
+    double referenceTime = measure([&]()
+                                   { our::computeMatricesReference(batch, reference.data()); });
+    std::cout << std::left << std::setw(12) << "reference" << std::right << std::fixed << std::setprecision(2)
+              << std::setw(8) << referenceTime << " ns/transform" << std::endl;
+    for (auto &level : levels)
+    {
+        if (level.level > best)
+            continue;
+        double time = measure([&]()
+                              { our::computeMatrices(batch, matrices.data(), level.level); });
+        std::cout << std::left << std::setw(12) << level.name << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(8) << time << " ns/transform" << std::setw(8) << referenceTime / time << "x faster" << std::endl;
+    }
+    return precise ? 0 : 1;
+}
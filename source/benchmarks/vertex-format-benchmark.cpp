@@ -0,0 +1,96 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <flags/flags.h>
+
+#include <jobs/job-system.hpp>
+#include <mesh/mesh-utils.hpp>
+#include <mesh/compact-vertex.hpp>
+
+// This benchmark converts the models to compact vertices (see "mesh/compact-vertex.hpp") and reports:
+// - the bytes per vertex and the VRAM that the vertex & element buffers of every model use with the float and the compact vertices
+// - the largest error of the positions (relative to the size of the bounding box), the normals (in degrees) and the texture coordinates
+//   after converting the compact vertices back to floats
+// Usage: VERTEX_FORMAT_BENCHMARK [obj files...] (default: every model in assets/models)
+// It returns a non-zero exit code if an error is larger than the precision that the format should give.
+
+int main(int argc, char **argv)
+{
+    flags::args args(argc, argv);
+    std::vector<std::string> paths(args.positional().begin(), args.positional().end());
+    if (paths.empty())
+    {
+        for (const auto &entry : std::filesystem::directory_iterator("assets/models"))
+            if (entry.path().extension() == ".obj")
+                paths.push_back(entry.path().generic_string());
+        std::sort(paths.begin(), paths.end());
+    }
+
+    // The OBJ parser runs on the job system
+    our::JobSystem::get();
+
+    std::cout << std::left << std::setw(28) << "file" << std::right << std::setw(10) << "vertices"
+              << std::setw(14) << "bytes/vertex" << std::setw(14) << "float KB" << std::setw(14) << "compact KB"
+              << std::setw(14) << "position" << std::setw(12) << "normal" << std::setw(12) << "uv" << std::endl;
+
+    bool valid = true;
+    size_t totalFloat = 0, totalCompact = 0;
+    for (const std::string &path : paths)
+    {
+        our::mesh_utils::MeshData data;
+        if (!our::mesh_utils::parseOBJ(path.c_str(), data))
+            return -1;
+        std::vector<our::Vertex> vertices = data.vertices;
+        size_t floatBytes = data.getByteCount();
+        our::mesh_utils::compactMesh(data);
+        size_t compactBytes = data.getByteCount();
+        totalFloat += floatBytes;
+        totalCompact += compactBytes;
+
+        // The position error is relative to the largest axis of the bounding box (a unit of the quantization is 1/65535 of the axis)
+        float extent = std::max(glm::max(data.max.x - data.min.x, data.max.y - data.min.y), std::max(data.max.z - data.min.z, 1e-20f));
+        float positionError = 0, normalError = 0, uvError = 0;
+        for (size_t index = 0; index < vertices.size(); ++index)
+        {
+            our::Color color = data.colors.empty() ? our::Color(255) : data.colors[index];
+            our::Vertex expanded = our::expandVertex(data.compactVertices[index], color, data.min, data.max);
+            const our::Vertex &vertex = vertices[index];
+            glm::vec3 positionDelta = glm::abs(expanded.position - vertex.position);
+            positionError = std::max(positionError, glm::max(positionDelta.x, glm::max(positionDelta.y, positionDelta.z)) / extent);
+            float normalLength = glm::length(vertex.normal);
+            if (normalLength > 0)
+            {
+                // The angle is computed from the sine and the cosine, since "acos" is imprecise for small angles
+                glm::vec3 normal = vertex.normal / normalLength;
+                float angle = std::atan2(glm::length(glm::cross(expanded.normal, normal)), glm::dot(expanded.normal, normal));
+                normalError = std::max(normalError, glm::degrees(angle));
+            }
+            // The half floats keep 11 significant bits, so the error of the texture coordinates is relative to their magnitude
+            glm::vec2 uvDelta = glm::abs(expanded.tex_coord - vertex.tex_coord) / glm::max(glm::abs(vertex.tex_coord), 1.0f);
+            uvError = std::max(uvError, std::max(uvDelta.x, uvDelta.y));
+            if (color != vertex.color)
+                valid = false;
+        }
+
+        double bytesPerVertex = sizeof(our::CompactVertex) + (data.colors.empty() ? 0 : sizeof(our::Color));
+        std::cout << std::left << std::setw(28) << path << std::right << std::setw(10) << vertices.size()
+                  << std::setw(14) << std::fixed << std::setprecision(0) << bytesPerVertex
+                  << std::setw(14) << std::setprecision(1) << floatBytes / 1024.0 << std::setw(14) << compactBytes / 1024.0
+                  << std::setw(14) << std::scientific << std::setprecision(2) << positionError
+                  << std::setw(12) << std::fixed << std::setprecision(4) << normalError
+                  << std::setw(12) << std::scientific << std::setprecision(2) << uvError << std::defaultfloat << std::endl;
+
+        // The expected precision: half of a quantization step for the positions, a small angle for the snorm16 octahedral normals
+        // and half of a unit in the last place for the half floats
+        if (positionError > 1.0f / 65535.0f || normalError > 0.01f || uvError > 1.0f / 2048.0f)
+            valid = false;
+    }
+    std::cout << "total: " << std::fixed << std::setprecision(1) << totalFloat / 1024.0 << " KB -> " << totalCompact / 1024.0 << " KB ("
+              << 100.0 * totalCompact / std::max<size_t>(totalFloat, 1) << "%)" << std::endl;
+    if (!valid)
+        std::cout << "a compact vertex is less precise than expected" << std::endl;
+    return valid ? 0 : 1;
+}
@@ -0,0 +1,213 @@
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <atomic>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <flags/flags.h>
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
+
+#include <jobs/job-system.hpp>
+#include <mesh/mesh-utils.hpp>
+#include <mesh/vertex-welder.hpp>
+
+// This benchmark compares the ways of removing the duplicated vertices of a mesh (which the mesh loader does after parsing an OBJ file):
+// - "map (old hash)": an unordered_map keyed by the hash that the vertex had before (which combined the hashes of the attributes with "h1 ^ (h2 << 1)")
+// - "map (new hash)": an unordered_map keyed by the current hash of the vertex (see "hashVertex" in "mesh/vertex.hpp")
+// - "welder": the flat open addressing table that the mesh loader uses (see "mesh/vertex-welder.hpp")
+// Usage: VERTEX_WELD_BENCHMARK [-i iterations] [-e epsilon] [obj files...] (default: the 1-3 MB models in assets/models)
+// For each file, it reports the best time of each way and the peak of the heap memory it allocated (including the output buffers).
+// If an epsilon is given, it also welds the vertices within that epsilon and reports how many vertices remain.
+// It returns a non-zero exit code if the ways give different buffers, so it can be used as a correctness test.
+
+// We measure the heap memory by replacing the global operators new & delete (every block starts with its size)
+// All the forms (single & array, sized & nothrow) are replaced together, so every block is freed by the same functions that allocated it
+// (the over-aligned forms are left to the standard library since none of the measured types are over-aligned)
+static std::atomic<std::size_t> currentBytes{0}, peakBytes{0};
+constexpr std::size_t BLOCK_HEADER_SIZE = 16;
+
+// Returns a block of "size" bytes after its header (or nullptr if the allocation failed)
+static void *allocateCounted(std::size_t size) noexcept
+{
+    auto block = static_cast<std::size_t *>(std::malloc(size + BLOCK_HEADER_SIZE));
+    if (!block)
+        return nullptr;
+    *block = size;
+    std::size_t current = currentBytes += size;
+    std::size_t peak = peakBytes.load();
+    while (current > peak && !peakBytes.compare_exchange_weak(peak, current))
+        ;
+    return reinterpret_cast<char *>(block) + BLOCK_HEADER_SIZE;
+}
+// Frees a block returned by "allocateCounted"
+static void releaseCounted(void *pointer) noexcept
+{
+    if (!pointer)
+        return;
+    auto block = reinterpret_cast<std::size_t *>(static_cast<char *>(pointer) - BLOCK_HEADER_SIZE);
+    currentBytes -= *block;
+    std::free(block);
+}
+
+void *operator new(std::size_t size)
+{
+    if (void *pointer = allocateCounted(size))
+        return pointer;
+    throw std::bad_alloc();
+}
+void *operator new[](std::size_t size)
+{
+    if (void *pointer = allocateCounted(size))
+        return pointer;
+    throw std::bad_alloc();
+}
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept { return allocateCounted(size); }
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept { return allocateCounted(size); }
+void operator delete(void *pointer) noexcept { releaseCounted(pointer); }
+void operator delete[](void *pointer) noexcept { releaseCounted(pointer); }
+void operator delete(void *pointer, std::size_t) noexcept { releaseCounted(pointer); }
+void operator delete[](void *pointer, std::size_t) noexcept { releaseCounted(pointer); }
+void operator delete(void *pointer, const std::nothrow_t &) noexcept { releaseCounted(pointer); }
+void operator delete[](void *pointer, const std::nothrow_t &) noexcept { releaseCounted(pointer); }
+
+// This is a replica of the hash that the vertex had before
+struct LegacyVertexHash
+{
+    static size_t combine(size_t h1, size_t h2) { return h1 ^ (h2 << 1); }
+    size_t operator()(const our::Vertex &vertex) const
+    {
+        size_t combined = std::hash<glm::vec3>()(vertex.position);
+        combined = combine(combined, std::hash<our::Color>()(vertex.color));
+        combined = combine(combined, std::hash<glm::vec2>()(vertex.tex_coord));
+        combined = combine(combined, std::hash<glm::vec3>()(vertex.normal));
+        return combined;
+    }
+};
+
+// The buffers that a way of welding gives
+struct WeldResult
+{
+    std::vector<our::Vertex> vertices;
+    std::vector<GLuint> elements;
+};
+
+// Welds the corners with an unordered_map (the way the mesh loader did before the welder)
+template <typename Hash>
+void weldWithMap(const std::vector<our::Vertex> &corners, WeldResult &result)
+{
+    std::unordered_map<our::Vertex, GLuint, Hash> vertex_map;
+    for (const our::Vertex &vertex : corners)
+    {
+        auto it = vertex_map.find(vertex);
+        if (it == vertex_map.end())
+        {
+            auto new_vertex_index = static_cast<GLuint>(result.vertices.size());
+            vertex_map[vertex] = new_vertex_index;
+            result.elements.push_back(new_vertex_index);
+            result.vertices.push_back(vertex);
+        }
+        else
+        {
+            result.elements.push_back(it->second);
+        }
+    }
+}
+
+// Welds the corners with the vertex welder
+void weldWithWelder(const std::vector<our::Vertex> &corners, WeldResult &result, float epsilon)
+{
+    our::VertexWelder welder(result.vertices, corners.size(), epsilon);
+    result.elements.reserve(corners.size());
+    for (const our::Vertex &vertex : corners)
+        result.elements.push_back(welder.add(vertex));
+}
+
+// The best time (in milliseconds) and the peak of the heap memory (in bytes) of a way of welding
+struct Measurement
+{
+    double milliseconds = 1e30;
+    std::size_t peakBytes = 0;
+};
+
+int main(int argc, char **argv)
+{
+    flags::args args(argc, argv);
+    // The number of times each way welds each file (the best time is kept)
+    int iterations = args.get<int>("i", 10);
+    // The epsilon of the extra weld (0 means that it is skipped)
+    float epsilon = args.get<float>("e", 0.0f);
+    std::vector<std::string> paths(args.positional().begin(), args.positional().end());
+    if (paths.empty())
+        paths = {"assets/models/bell.obj", "assets/models/pumpkin.obj", "assets/models/santa.obj", "assets/models/snowman.obj", "assets/models/tree.obj"};
+
+    // The OBJ parser runs on the job system
+    our::JobSystem::get();
+
+    std::cout << "The best time of " << iterations << " iterations and the peak of the heap memory of every way of welding" << std::endl;
+    std::cout << std::left << std::setw(28) << "file" << std::right << std::setw(10) << "corners" << std::setw(10) << "vertices"
+              << std::setw(24) << "map (old hash)" << std::setw(24) << "map (new hash)" << std::setw(24) << "welder" << std::endl;
+
+    bool identical = true;
+    for (const std::string &path : paths)
+    {
+        // The loaded mesh is expanded back to one vertex per corner, which is what the loader welds
+        our::mesh_utils::MeshData data;
+        if (!our::mesh_utils::parseOBJ(path.c_str(), data))
+            return -1;
+        std::vector<our::Vertex> corners;
+        corners.reserve(data.elements.size());
+        for (GLuint element : data.elements)
+            corners.push_back(data.vertices[element]);
+
+        // Runs a way of welding "iterations" times and checks that it gives the same buffers as the loader
+        auto measure = [&](auto weld)
+        {
+            Measurement measurement;
+            for (int iteration = 0; iteration < iterations; ++iteration)
+            {
+                WeldResult result;
+                std::size_t before = currentBytes.load();
+                peakBytes = before;
+                auto start = std::chrono::high_resolution_clock::now();
+                weld(result);
+                auto end = std::chrono::high_resolution_clock::now();
+                measurement.milliseconds = std::min(measurement.milliseconds, std::chrono::duration<double, std::milli>(end - start).count());
+                measurement.peakBytes = std::max(measurement.peakBytes, peakBytes.load() - before);
+                if (result.elements != data.elements || result.vertices.size() != data.vertices.size())
+                    identical = false;
+            }
+            return measurement;
+        };
+        Measurement oldMap = measure([&](WeldResult &result)
+                                     { weldWithMap<LegacyVertexHash>(corners, result); });
+        Measurement newMap = measure([&](WeldResult &result)
+                                     { weldWithMap<std::hash<our::Vertex>>(corners, result); });
+        Measurement welder = measure([&](WeldResult &result)
+                                     { weldWithWelder(corners, result, 0.0f); });
+
+        auto print = [](const Measurement &measurement)
+        {
+            std::ostringstream text;
+            text << std::fixed << std::setprecision(2) << measurement.milliseconds << " ms " << std::setprecision(1) << measurement.peakBytes / (1024.0 * 1024.0) << " MB";
+            return text.str();
+        };
+        std::cout << std::left << std::setw(28) << path << std::right << std::setw(10) << corners.size() << std::setw(10) << data.vertices.size()
+                  << std::setw(24) << print(oldMap) << std::setw(24) << print(newMap) << std::setw(24) << print(welder) << std::endl;
+
+        if (epsilon > 0.0f)
+        {
+            WeldResult result;
+            weldWithWelder(corners, result, epsilon);
+            std::cout << "  welding within " << epsilon << " leaves " << result.vertices.size() << " vertices" << std::endl;
+        }
+    }
+    if (!identical)
+        std::cout << "The ways of welding gave different buffers" << std::endl;
+    return identical ? 0 : 1;
+}
@@ -23,6 +23,13 @@
 #endif
 
 #include "texture/screenshot.hpp"
+#include "jobs/job-system.hpp"
+#include "asset-streamer.hpp"
+#include "asset-loader.hpp"
+#include "io/asset-pack.hpp"
+#include "trace/trace.hpp"
+#include "mesh/mesh-optimizer.hpp"
+#include "mesh/compact-vertex.hpp"
 
 std::string default_screenshot_filepath() {
     std::stringstream stream;
@@ -150,10 +157,37 @@ our::WindowConfiguration our::Application::getWindowConfiguration() {
 // if run_for_frames == 0, the application runs indefinitely till manually closed.
 int our::Application::run(int run_for_frames) {
 
+    // Create the engine's job system now, so that this thread (which will own the OpenGL context) becomes its main thread
+    our::JobSystem& jobs = our::JobSystem::get();
+    // The asset streamer uploads the streamed assets at the start of each frame
+    // The number of bytes it uploads per frame can be set by the option "upload-budget" (in bytes) in the "streaming" config
+    our::AssetStreamer& streamer = our::AssetStreamer::get();
+    if(auto it = app_config.find("streaming"); it != app_config.end() && it->is_object())
+        streamer.setUploadBudget(it->value("upload-budget", streamer.getUploadBudget()));
+    // The memory budgets of the asset types (in bytes) can be set by the "asset-budgets" config (see "setAssetBudgets")
+    // The unused assets are evicted at the start of each frame while a type is over its budget
+    if(auto it = app_config.find("asset-budgets"); it != app_config.end())
+        our::setAssetBudgets(*it);
+    // If the option "optimize-meshes" is true, the loaded meshes are reordered for the vertex cache, the overdraw & the vertex fetch
+    // before they are stored in the mesh cache (see "mesh/mesh-optimizer.hpp")
+    our::mesh_utils::setMeshOptimization(app_config.value("optimize-meshes", false));
+    // If the option "compact-vertices" is true, the loaded meshes use 16-byte vertices instead of 36-byte vertices (see "mesh/compact-vertex.hpp")
+    our::mesh_utils::setCompactVertices(app_config.value("compact-vertices", false));
+    // If the "asset-pack" option names an asset pack (built by the ASSET_PACKER tool), the asset files are read from it first
+    // Otherwise (or if the pack was not built), the asset files are read from the file system
+    if(std::string packPath = app_config.value("asset-pack", ""); !packPath.empty()) {
+        OUR_TRACE_SCOPE("mount asset pack");
+        if(our::mountAssetPack(packPath))
+            std::cout << "Mounted the asset pack \"" << packPath << "\" (" << our::AssetPack::get().getEntryCount() << " files)" << std::endl;
+        else
+            std::cout << "The asset pack \"" << packPath << "\" was not found, so the assets are read from the file system" << std::endl;
+    }
+
     // Set the function to call when an error occurs.
     glfwSetErrorCallback(glfw_error_callback);
 
     // Initialize GLFW and exit if it failed
+    our::trace::Scope glfwScope("initialize glfw");
     if(!glfwInit()){
         std::cerr << "Failed to Initialize GLFW" << std::endl;
         return -1;
@@ -176,6 +210,7 @@ int our::Application::run(int run_for_frames) {
     glfwMakeContextCurrent(window);         // Tell GLFW to make the context of our window the main context on the current thread.
 
     gladLoadGL(glfwGetProcAddress);         // Load the OpenGL functions from the driver
+    glfwScope.end();
 
     // Print information about the OpenGL context
     std::cout << "VENDOR          : " << glGetString(GL_VENDOR) << std::endl;
@@ -199,6 +234,7 @@ int our::Application::run(int run_for_frames) {
     mouse.enable(window);
 
     // Start the ImGui context and set dark style (just my preference :D)
+    our::trace::Scope imguiScope("initialize imgui");
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
     ImGuiIO& io = ImGui::GetIO();
@@ -207,6 +243,7 @@ int our::Application::run(int run_for_frames) {
     // Initialize ImGui for GLFW and OpenGL
     ImGui_ImplGlfw_InitForOpenGL(window, true);
     ImGui_ImplOpenGL3_Init("#version 330 core");
+    imguiScope.end();
 
     // This part of the code extracts the list of requested screenshots and puts them into a priority queue
     using ScreenshotRequest = std::pair<int, std::string>;
@@ -231,7 +268,10 @@ int our::Application::run(int run_for_frames) {
         nextState = nullptr;
     }
     // Call onInitialize if the scene needs to do some custom initialization (such as file loading, object creation, etc).
-    if(currentState) currentState->onInitialize();
+    if(currentState) {
+        OUR_TRACE_SCOPE("initialize state");
+        currentState->onInitialize();
+    }
 
     // The time at which the last frame started. But there was no frames yet, so we'll just pick the current time.
     double last_frame_time = glfwGetTime();
@@ -240,7 +280,12 @@ int our::Application::run(int run_for_frames) {
     //Game loop
     while(!glfwWindowShouldClose(window)){
         if(run_for_frames != 0 && current_frame >= run_for_frames) break;
+        // Only the first frame is traced (it ends the startup), so the frames never push the startup out of the trace buffers
+        our::trace::Scope frameScope(current_frame == 0 ? "first frame" : nullptr);
         glfwPollEvents(); // Read all the user events and call relevant callbacks.
+        jobs.runMainThreadJobs(); // Run the jobs that other threads sent to the main thread (e.g. OpenGL calls).
+        streamer.update(); // Upload the streamed assets that finished decoding (within the upload budget).
+        our::collectAllAssets(); // Evict the unused assets of the types that are over their budgets.
 
         // Start a new ImGui frame
         ImGui_ImplOpenGL3_NewFrame();
@@ -312,6 +357,7 @@ int our::Application::run(int run_for_frames) {
 
         // If a scene change was requested, apply it
         while(nextState){
+            OUR_TRACE_SCOPE("change state");
             // If a scene was already running, destroy it (not delete since we can go back to it later)
             if(currentState) currentState->onDestroy();
             // Switch scenes
@@ -326,6 +372,11 @@ int our::Application::run(int run_for_frames) {
 
     // Call for cleaning up
     if(currentState) currentState->onDestroy();
+    // The assets outlive the states, so they are deleted here while the OpenGL context still exists
+    {
+        OUR_TRACE_SCOPE("clear assets");
+        our::clearAllAssets();
+    }
 
     // Shutdown ImGui & destroy the context
     ImGui_ImplOpenGL3_Shutdown();
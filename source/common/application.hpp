@@ -58,6 +58,7 @@ namespace our {
         Mouse mouse;                        // Instance of "our" mouse class that handles mouse functionalities.
 
         nlohmann::json app_config;           // A Json file that contains all application configuration
+        std::string config_path;             // The path of the file from which the configuration was read (empty if unknown)
 
         std::unordered_map<std::string, State*> states;   // This will store all the states that the application can run
         State * currentState = nullptr;         // This will store the current scene that is being run
@@ -73,7 +74,8 @@ namespace our {
     public:
 
         // Create an application with following configuration
-        Application(const nlohmann::json& app_config) : app_config(app_config) {}
+        // The config path is used to find the files compiled from the configuration (e.g. the compiled scene)
+        Application(const nlohmann::json& app_config, const std::string& config_path = "") : app_config(app_config), config_path(config_path) {}
         // On destruction, delete all the states
         ~Application(){ for (auto &it : states) delete it.second; }
 
@@ -113,6 +115,7 @@ namespace our {
         [[nodiscard]] const Mouse& getMouse() const { return mouse; }
 
         [[nodiscard]] const nlohmann::json& getConfig() const { return app_config; }
+        [[nodiscard]] const std::string& getConfigPath() const { return config_path; }
 
         // Get the size of the frame buffer of the window in pixels.
         glm::ivec2 getFrameBufferSize() {
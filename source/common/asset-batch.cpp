@@ -0,0 +1,275 @@
+#include "asset-batch.hpp"
+
+#include "asset-loader.hpp"
+#include "asset-streamer.hpp"
+#include "shader/shader.hpp"
+#include "texture/texture2d.hpp"
+#include "texture/texture-utils.hpp"
+#include "mesh/mesh.hpp"
+#include "mesh/mesh-utils.hpp"
+#include "trace/trace.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace our
+{
+
+    typedef std::chrono::high_resolution_clock Clock;
+
+    // Returns the milliseconds elapsed since the given time point
+    static double millisecondsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    // These functions return the functions that create an asset again after it was evicted (see "AssetLoader<T>::collect")
+    // Shaders are small, so they are compiled again right away. Textures & meshes are streamed back behind a placeholder.
+    static std::function<ShaderProgram *()> shaderReloader(const std::string &vsPath, const std::string &fsPath)
+    {
+        return [vsPath, fsPath]()
+        {
+            auto shader = new ShaderProgram();
+            shader->attach(vsPath, GL_VERTEX_SHADER);
+            shader->attach(fsPath, GL_FRAGMENT_SHADER);
+            shader->link();
+            return shader;
+        };
+    }
+
+    static std::function<Texture2D *()> textureReloader(const std::string &path, texture_utils::ColorSpace colorSpace)
+    {
+        return [path, colorSpace]()
+        { return AssetStreamer::get().streamTexture(path, colorSpace); };
+    }
+
+    static std::function<Mesh *()> meshReloader(const std::string &path)
+    {
+        return [path]()
+        { return AssetStreamer::get().streamMesh(path); };
+    }
+
+    // These functions return the source of an asset, which identifies the files & settings it is created from (see "AssetLoader<T>::find")
+    static std::string shaderSource(const std::string &vsPath, const std::string &fsPath)
+    {
+        return vsPath + "|" + fsPath;
+    }
+
+    static std::string textureSource(const std::string &path, texture_utils::ColorSpace colorSpace)
+    {
+        return path + (colorSpace == texture_utils::ColorSpace::LINEAR ? "|linear" : "|srgb");
+    }
+
+    AssetBatch::AssetBatch(bool streaming, JobSystem &jobs) : jobs(jobs), streaming(streaming), start(Clock::now()) {}
+
+    void AssetBatch::addShader(const std::string &name, const std::string &vsPath, const std::string &fsPath, std::function<void(ShaderProgram *)> onCreated)
+    {
+        Timing *timing = &timings.emplace_back(Timing{"shader", name, vsPath + " + " + fsPath});
+        if (ShaderProgram *shader = AssetLoader<ShaderProgram>::find(name, shaderSource(vsPath, fsPath)))
+        {
+            timing->reused = true;
+            if (onCreated)
+                onCreated(shader);
+            return;
+        }
+        // The shader needs two files, so it is decoded once the second one arrives (the files may be read by different I/O threads)
+        struct ShaderFiles
+        {
+            std::shared_ptr<AssetFile> vs, fs;
+            std::atomic<int> remaining{2};
+        };
+        auto files = std::make_shared<ShaderFiles>();
+        auto decode = [this, timing, files, vsPath, fsPath, onCreated]()
+        {
+            OUR_TRACE_SCOPE_DETAIL("decode shader", timing->name);
+            auto decodeStart = Clock::now();
+            // The sources are shared between the two stages (a std::function must be copyable)
+            auto sources = std::make_shared<std::pair<std::string, std::string>>();
+            ShaderProgram::readSource(*files->vs, vsPath, sources->first);
+            ShaderProgram::readSource(*files->fs, fsPath, sources->second);
+            files->vs.reset();
+            files->fs.reset();
+            timing->decodeMilliseconds = millisecondsSince(decodeStart);
+            jobs.submitToMainThread([timing, sources, vsPath, fsPath, onCreated]()
+                                    {
+                OUR_TRACE_SCOPE_DETAIL("create shader", timing->name);
+                auto createStart = Clock::now();
+                auto shader = new ShaderProgram();
+                shader->attachSource(sources->first, GL_VERTEX_SHADER, vsPath);
+                shader->attachSource(sources->second, GL_FRAGMENT_SHADER, fsPath);
+                shader->link();
+                AssetLoader<ShaderProgram>::add(timing->name, shader, shaderReloader(vsPath, fsPath), shaderSource(vsPath, fsPath));
+                if (onCreated)
+                    onCreated(shader);
+                timing->createMilliseconds = millisecondsSince(createStart); },
+                                    &counter);
+        };
+        readFile(vsPath, [this, files, decode](std::shared_ptr<AssetFile> file)
+                 {
+            files->vs = std::move(file);
+            if (files->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                jobs.submit(decode, &counter); });
+        readFile(fsPath, [this, files, decode](std::shared_ptr<AssetFile> file)
+                 {
+            files->fs = std::move(file);
+            if (files->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                jobs.submit(decode, &counter); });
+    }
+
+    void AssetBatch::addTexture(const std::string &name, const std::string &path, texture_utils::ColorSpace colorSpace, std::function<void(Texture2D *)> onCreated)
+    {
+        Timing *timing = &timings.emplace_back(Timing{"texture", name, path});
+        if (Texture2D *texture = AssetLoader<Texture2D>::find(name, textureSource(path, colorSpace)))
+        {
+            timing->reused = true;
+            if (onCreated)
+                onCreated(texture);
+            return;
+        }
+        if (streaming)
+        {
+            auto createStart = Clock::now();
+            Texture2D *texture = AssetStreamer::get().streamTexture(path, colorSpace);
+            AssetLoader<Texture2D>::add(name, texture, textureReloader(path, colorSpace), textureSource(path, colorSpace));
+            if (onCreated)
+                onCreated(texture);
+            timing->createMilliseconds = millisecondsSince(createStart);
+            timing->streamed = true;
+            return;
+        }
+        readFile(path, [this, timing, colorSpace, onCreated](std::shared_ptr<AssetFile> file)
+                 { jobs.submit([this, timing, file, colorSpace, onCreated]()
+                               {
+            OUR_TRACE_SCOPE_DETAIL("decode texture", timing->name);
+            auto decodeStart = Clock::now();
+            auto image = std::make_shared<texture_utils::Image>();
+            texture_utils::loadImageData(*image, *file, timing->path.c_str(), colorSpace);
+            file->close();
+            timing->decodeMilliseconds = millisecondsSince(decodeStart);
+            jobs.submitToMainThread([timing, image, colorSpace, onCreated]()
+                                    {
+                OUR_TRACE_SCOPE_DETAIL("create texture", timing->name);
+                auto createStart = Clock::now();
+                auto texture = new Texture2D();
+                if (image->pixels)
+                    texture_utils::uploadImage(*texture, *image);
+                AssetLoader<Texture2D>::add(timing->name, texture, textureReloader(timing->path, colorSpace), textureSource(timing->path, colorSpace));
+                if (onCreated)
+                    onCreated(texture);
+                timing->createMilliseconds = millisecondsSince(createStart); },
+                                    &counter); },
+                               &counter); });
+    }
+
+    void AssetBatch::addMesh(const std::string &name, const std::string &path, std::function<void(Mesh *)> onCreated)
+    {
+        Timing *timing = &timings.emplace_back(Timing{"mesh", name, path});
+        if (Mesh *mesh = AssetLoader<Mesh>::find(name, path))
+        {
+            timing->reused = true;
+            if (onCreated)
+                onCreated(mesh);
+            return;
+        }
+        if (streaming)
+        {
+            auto createStart = Clock::now();
+            Mesh *mesh = AssetStreamer::get().streamMesh(path);
+            AssetLoader<Mesh>::add(name, mesh, meshReloader(path), path);
+            if (onCreated)
+                onCreated(mesh);
+            timing->createMilliseconds = millisecondsSince(createStart);
+            timing->streamed = true;
+            return;
+        }
+        readFile(path, [this, timing, onCreated](std::shared_ptr<AssetFile> file)
+                 { jobs.submit([this, timing, file, onCreated]()
+                               {
+            OUR_TRACE_SCOPE_DETAIL("decode mesh", timing->name);
+            auto decodeStart = Clock::now();
+            auto data = std::make_shared<mesh_utils::MeshData>();
+            bool parsed = mesh_utils::loadMeshData(*file, timing->path.c_str(), *data);
+            file->close();
+            timing->decodeMilliseconds = millisecondsSince(decodeStart);
+            jobs.submitToMainThread([timing, data, parsed, onCreated]()
+                                    {
+                OUR_TRACE_SCOPE_DETAIL("create mesh", timing->name);
+                auto createStart = Clock::now();
+                // Like "loadOBJ", a mesh that could not be parsed is stored as a nullptr
+                Mesh *mesh = parsed ? mesh_utils::createMesh(*data) : nullptr;
+                AssetLoader<Mesh>::add(timing->name, mesh, mesh ? meshReloader(timing->path) : nullptr, mesh ? timing->path : "");
+                if (onCreated)
+                    onCreated(mesh);
+                timing->createMilliseconds = millisecondsSince(createStart); },
+                                    &counter); },
+                               &counter); });
+    }
+
+    void AssetBatch::readFile(const std::string &path, std::function<void(std::shared_ptr<AssetFile>)> onRead)
+    {
+        readPaths.push_back(path);
+        readCallbacks.push_back(std::move(onRead));
+    }
+
+    void AssetBatch::finish()
+    {
+        OUR_TRACE_SCOPE("finish asset batch");
+        if (!readPaths.empty())
+        {
+            // The callbacks run on the I/O threads, so they only submit the decoding jobs
+            auto readStart = Clock::now();
+            reader.start(std::move(readPaths), [this](std::size_t index, AssetFile &&file)
+                         { readCallbacks[index](std::make_shared<AssetFile>(std::move(file))); });
+            readPaths.clear();
+            // The counter may reach zero between two files, so the main thread helps with the jobs until every file was read
+            while (!reader.isDone())
+                if (!jobs.tryRunOne())
+                    std::this_thread::yield();
+            readMilliseconds = millisecondsSince(readStart);
+            reader.wait();
+            readCallbacks.clear();
+        }
+        jobs.wait(counter);
+        totalMilliseconds = millisecondsSince(start);
+    }
+
+    void AssetBatch::printReport(std::ostream &stream) const
+    {
+        // The report is formatted into a local stream, so the formatting flags (e.g. std::fixed) never leak into the caller's stream
+        std::ostringstream text;
+        // The reused assets are only counted, since no time was spent on them
+        std::vector<const Timing *> sorted;
+        for (const Timing &timing : timings)
+            if (!timing.reused)
+                sorted.push_back(&timing);
+        std::stable_sort(sorted.begin(), sorted.end(), [](const Timing *a, const Timing *b)
+                         { return a->decodeMilliseconds + a->createMilliseconds > b->decodeMilliseconds + b->createMilliseconds; });
+        double decodeSum = 0, createSum = 0;
+        text << "Loaded " << sorted.size() << " assets (and reused " << timings.size() - sorted.size() << " resident assets) in "
+             << std::fixed << std::setprecision(1) << totalMilliseconds << " ms using " << jobs.getThreadCount() << " threads" << std::endl;
+        text << "  " << std::left << std::setw(9) << "type" << std::setw(20) << "name"
+             << std::right << std::setw(12) << "decode ms" << std::setw(12) << "create ms" << "  path" << std::endl;
+        for (const Timing *timing : sorted)
+        {
+            text << "  " << std::left << std::setw(9) << timing->type << std::setw(20) << timing->name << std::right << std::setw(12);
+            if (timing->streamed)
+                text << "streaming";
+            else
+                text << timing->decodeMilliseconds;
+            text << std::setw(12) << timing->createMilliseconds << "  " << timing->path << std::endl;
+            decodeSum += timing->decodeMilliseconds;
+            createSum += timing->createMilliseconds;
+        }
+        text << "  " << std::left << std::setw(29) << "sum" << std::right << std::setw(12) << decodeSum << std::setw(12) << createSum << std::endl;
+        if (readMilliseconds > 0)
+            text << "  read " << reader.getBytesRead() / (1024.0 * 1024.0) << " MB from the disk in " << readMilliseconds
+                 << " ms using " << reader.getBackendName() << std::endl;
+        stream << text.str();
+    }
+
+}
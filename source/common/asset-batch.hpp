@@ -0,0 +1,89 @@
+#pragma once
+
+#include <string>
+#include <deque>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <ostream>
+
+#include "jobs/job-system.hpp"
+#include "io/async-file-reader.hpp"
+#include "texture/texture-utils.hpp"
+
+namespace our
+{
+
+    class ShaderProgram;
+    class Texture2D;
+    class Mesh;
+
+    // An asset batch loads a set of assets in three stages:
+    // 1- The files of all the queued assets are read at once by the asynchronous file reader (see "io/async-file-reader.hpp").
+    // 2- As soon as the files of an asset are read, the CPU work (decoding the images, parsing the OBJ files) runs on the job system,
+    //    so the assets are decoded while the files of the other assets are still being read.
+    // 3- Once an asset is decoded, a job that creates its OpenGL objects is sent to the main thread
+    //    (since the OpenGL context is only current on the main thread).
+    // The created assets are added to the asset loaders (see "asset-loader.hpp") on the main thread, so they can be found by their names.
+    // If the batch is streaming, textures and meshes are not waited for. They are created right away with a placeholder content
+    // and streamed in the background by the asset streamer (see "asset-streamer.hpp"). Shaders are always loaded by the batch.
+    // An asset that is already resident with the same name & source (e.g. the same file with the same settings) is reused instead of being loaded again,
+    // so loading a set of assets again only loads the assets that changed or were evicted.
+    // The functions of this class must be called from the main thread.
+    class AssetBatch
+    {
+        // The time spent on each asset (for the report)
+        struct Timing
+        {
+            const char *type;
+            std::string name;
+            std::string path;
+            double decodeMilliseconds = 0; // The time spent decoding the files on a worker (after they were read)
+            double createMilliseconds = 0; // The time spent creating the OpenGL objects on the main thread
+            bool streamed = false;         // Streamed assets are decoded in the background after the batch is done
+            bool reused = false;           // The asset was already resident (from an earlier batch), so it was not loaded again
+        };
+
+        JobSystem &jobs;
+        JobCounter counter;
+        bool streaming;
+        // A deque is used since adding timings never moves the existing ones (which are written by the jobs)
+        std::deque<Timing> timings;
+        std::chrono::high_resolution_clock::time_point start;
+        double totalMilliseconds = 0;
+
+        // The files of the queued assets are read when the batch finishes, so all the reads are submitted together
+        // Each callback receives the content of its file (which is not open if the file could not be read)
+        std::vector<std::string> readPaths;
+        std::vector<std::function<void(std::shared_ptr<AssetFile>)>> readCallbacks;
+        AsyncFileReader reader;
+        double readMilliseconds = 0; // The time from the start of the reads until the last file was read
+
+        // Queues the read of a file
+        void readFile(const std::string &path, std::function<void(std::shared_ptr<AssetFile>)> onRead);
+
+    public:
+        explicit AssetBatch(bool streaming = false, JobSystem &jobs = JobSystem::get());
+        // The batch waits for its jobs, since they refer to it
+        ~AssetBatch() { jobs.wait(counter); }
+
+        // Each of these functions queues an asset. "onCreated" (if given) is called on the main thread once the asset is created.
+        void addShader(const std::string &name, const std::string &vsPath, const std::string &fsPath, std::function<void(ShaderProgram *)> onCreated = nullptr);
+        // The color space of a texture decides how its mip levels are computed (see "texture/texture-utils.hpp")
+        void addTexture(const std::string &name, const std::string &path, texture_utils::ColorSpace colorSpace = texture_utils::ColorSpace::SRGB,
+                        std::function<void(Texture2D *)> onCreated = nullptr);
+        void addMesh(const std::string &name, const std::string &path, std::function<void(Mesh *)> onCreated = nullptr);
+
+        // Reads the files of all the queued assets then waits until the assets are created.
+        // While it waits, the main thread decodes assets too and creates the decoded ones.
+        void finish();
+
+        // Prints the time spent on each asset (the slowest first), the time spent reading the files and the total time of the batch
+        void printReport(std::ostream &stream) const;
+
+        AssetBatch(const AssetBatch &) = delete;
+        AssetBatch &operator=(const AssetBatch &) = delete;
+    };
+
+}
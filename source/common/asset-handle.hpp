@@ -0,0 +1,93 @@
+#pragma once
+
+#include <string>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+
+namespace our {
+
+    namespace internal {
+        // A logical clock that orders the uses of the assets (used to find the least recently used asset)
+        inline std::atomic<std::uint64_t> assetUseClock{0};
+        inline std::uint64_t nextAssetUseTick() { return assetUseClock.fetch_add(1, std::memory_order_relaxed) + 1; }
+    }
+
+    // The record of a named asset in the asset loader (see "asset-loader.hpp")
+    // The entry outlives its asset: when an unreferenced asset is evicted, the entry stays with "asset" set to nullptr,
+    // so the asset can be created again (using "reload") the next time it is requested.
+    template<typename T>
+    struct AssetEntry {
+        std::string name;
+        std::string source;                       // What the asset was created from (e.g. its file path & settings), so a request for the same asset can reuse it
+        T* asset = nullptr;
+        std::atomic<std::uint32_t> references{0}; // The number of handles that refer to this entry
+        std::atomic<std::uint64_t> lastUsed{0};   // The tick of the last time a handle was acquired or released (handles are copied & released on the workers too)
+        std::function<T*()> reload;               // Creates the asset again after it is evicted (assets without it are never evicted)
+    };
+
+    // A reference counted handle to an asset owned by the asset loader
+    // While a handle refers to an asset, the asset can not be evicted, so the pointer of the asset stays valid.
+    // The handle converts to a raw pointer, so it can be used like one (e.g. "material->shader->use()").
+    template<typename T>
+    class AssetHandle {
+        AssetEntry<T>* entry = nullptr;
+
+        void acquire() {
+            if(entry) {
+                entry->references.fetch_add(1, std::memory_order_relaxed);
+                entry->lastUsed.store(internal::nextAssetUseTick(), std::memory_order_relaxed);
+            }
+        }
+        void release() {
+            if(entry) {
+                entry->lastUsed.store(internal::nextAssetUseTick(), std::memory_order_relaxed);
+                entry->references.fetch_sub(1, std::memory_order_acq_rel);
+                entry = nullptr;
+            }
+        }
+
+    public:
+        AssetHandle() = default;
+        AssetHandle(std::nullptr_t) {}
+        // Use "AssetLoader<T>::acquire" to get a handle instead of calling this constructor directly
+        explicit AssetHandle(AssetEntry<T>* entry) : entry(entry) { acquire(); }
+        ~AssetHandle() { release(); }
+
+        AssetHandle(const AssetHandle& other) : entry(other.entry) { acquire(); }
+        AssetHandle(AssetHandle&& other) noexcept : entry(other.entry) { other.entry = nullptr; }
+        AssetHandle& operator=(const AssetHandle& other) {
+            if(entry != other.entry) {
+                release();
+                entry = other.entry;
+                acquire();
+            }
+            return *this;
+        }
+        AssetHandle& operator=(AssetHandle&& other) noexcept {
+            if(this != &other) {
+                release();
+                entry = other.entry;
+                other.entry = nullptr;
+            }
+            return *this;
+        }
+        AssetHandle& operator=(std::nullptr_t) { release(); return *this; }
+
+        // Releases the asset (it becomes a candidate for eviction once no other handle refers to it)
+        void reset() { release(); }
+
+        T* get() const { return entry ? entry->asset : nullptr; }
+        T* operator->() const { return get(); }
+        T& operator*() const { return *get(); }
+        operator T*() const { return get(); }
+
+        // Returns the name of the asset (or an empty string if the handle is empty)
+        const std::string& getName() const {
+            static const std::string empty;
+            return entry ? entry->name : empty;
+        }
+    };
+
+}
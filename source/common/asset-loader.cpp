@@ -8,59 +8,124 @@
 #include "mesh/mesh-utils.hpp"
 #include "material/material.hpp"
 #include "deserialize-utils.hpp"
+#include "asset-batch.hpp"
+#include "trace/trace.hpp"
+
+#include <iostream>
+#include <iomanip>
 
 namespace our
 {
 
-    // Where we define all the asset maps since static member variables must be defined in a source file
+    // Where we define all the asset registries since static member variables must be defined in a source file
+    // (The braces are needed, otherwise an explicit specialization of a static member is only a declaration)
+    template <>
+    AssetLoader<ShaderProgram>::Registry AssetLoader<ShaderProgram>::registry{};
+    template <>
+    AssetLoader<Texture2D>::Registry AssetLoader<Texture2D>::registry{};
+    template <>
+    AssetLoader<Sampler>::Registry AssetLoader<Sampler>::registry{};
+    template <>
+    AssetLoader<Mesh>::Registry AssetLoader<Mesh>::registry{};
+    template <>
+    AssetLoader<Material>::Registry AssetLoader<Material>::registry{};
+
+    // The memory used by each asset type
+    // The OpenGL objects of shaders, samplers & materials are tiny, so only their objects on the RAM are counted
     template <>
-    std::unordered_map<std::string, ShaderProgram *> AssetLoader<ShaderProgram>::assets;
+    AssetMemory AssetLoader<ShaderProgram>::measure(const ShaderProgram *)
+    {
+        return {sizeof(ShaderProgram), 0};
+    }
+
     template <>
-    std::unordered_map<std::string, Texture2D *> AssetLoader<Texture2D>::assets;
+    AssetMemory AssetLoader<Texture2D>::measure(const Texture2D *texture)
+    {
+        return {sizeof(Texture2D), texture->getByteCount()};
+    }
+
     template <>
-    std::unordered_map<std::string, Sampler *> AssetLoader<Sampler>::assets;
+    AssetMemory AssetLoader<Sampler>::measure(const Sampler *)
+    {
+        return {sizeof(Sampler), 0};
+    }
+
     template <>
-    std::unordered_map<std::string, Mesh *> AssetLoader<Mesh>::assets;
+    AssetMemory AssetLoader<Mesh>::measure(const Mesh *mesh)
+    {
+        return {sizeof(Mesh), mesh->getByteCount()};
+    }
+
     template <>
-    std::unordered_map<std::string, Material *> AssetLoader<Material>::assets;
+    AssetMemory AssetLoader<Material>::measure(const Material *)
+    {
+        return {sizeof(Material), 0};
+    }
+
+    // Shaders, textures and meshes are loaded by an asset batch (see "asset-batch.hpp"),
+    // so their files are read and decoded in parallel while the OpenGL objects are created on the main thread.
 
-    // This will load all the shaders defined in "data"
+    // This will queue all the shaders defined in "data"
     // data must be in the form:
     //    { shader_name : { "vs" : "path/to/vertex-shader", "fs" : "path/to/fragment-shader" }, ... }
-    template <>
-    void AssetLoader<ShaderProgram>::deserialize(const nlohmann::json &data)
+    static void queueShaders(const nlohmann::json &data, AssetBatch &batch)
     {
         if (data.is_object())
         {
             for (auto &[name, desc] : data.items())
             {
-                std::string vsPath = desc.value("vs", "");
-                std::string fsPath = desc.value("fs", "");
-                auto shader = new ShaderProgram();
-                shader->attach(vsPath, GL_VERTEX_SHADER);
-                shader->attach(fsPath, GL_FRAGMENT_SHADER);
-                shader->link();
-                assets[name] = shader;
+                batch.addShader(name, desc.value("vs", ""), desc.value("fs", ""));
             }
         }
-    };
+    }
 
-    // This will load all the textures defined in "data"
+    // This will queue all the textures defined in "data"
     // data must be in the form:
-    //    { texture_name : "path/to/image", ... }
-    template <>
-    void AssetLoader<Texture2D>::deserialize(const nlohmann::json &data)
+    //    { texture_name : "path/to/image" or { "path": "path/to/image", "color-space": "linear" }, ... }
+    static void queueTextures(const nlohmann::json &data, AssetBatch &batch)
+    {
+        if (data.is_object())
+        {
+            for (auto &[name, desc] : data.items())
+            {
+                std::string path;
+                texture_utils::ColorSpace colorSpace;
+                if (texture_utils::readTextureDescription(desc, path, colorSpace))
+                    batch.addTexture(name, path, colorSpace);
+            }
+        }
+    }
+
+    // This will queue all the meshes defined in "data"
+    // data must be in the form:
+    //    { mesh_name : "path/to/3d-model-file", ... }
+    static void queueMeshes(const nlohmann::json &data, AssetBatch &batch)
     {
         if (data.is_object())
         {
             for (auto &[name, desc] : data.items())
             {
-                std::string path = desc.get<std::string>();
-                auto texture = new Texture2D();
-                texture_utils::loadImage(*texture, path.c_str());
-                assets[name] = texture;
+                batch.addMesh(name, desc.get<std::string>());
             }
         }
+    }
+
+    // This will load all the shaders defined in "data" (see "queueShaders")
+    template <>
+    void AssetLoader<ShaderProgram>::deserialize(const nlohmann::json &data)
+    {
+        AssetBatch batch;
+        queueShaders(data, batch);
+        batch.finish();
+    };
+
+    // This will load all the textures defined in "data" (see "queueTextures")
+    template <>
+    void AssetLoader<Texture2D>::deserialize(const nlohmann::json &data)
+    {
+        AssetBatch batch;
+        queueTextures(data, batch);
+        batch.finish();
     };
 
     // This will load all the samplers defined in "data"
@@ -79,26 +144,18 @@ namespace our
             {
                 auto sampler = new Sampler();
                 sampler->deserialize(desc);
-                assets[name] = sampler;
+                add(name, sampler);
             }
         }
     };
 
-    // This will load all the meshes defined in "data"
-    // data must be in the form:
-    //    { mesh_name : "path/to/3d-model-file", ... }
+    // This will load all the meshes defined in "data" (see "queueMeshes")
     template <>
     void AssetLoader<Mesh>::deserialize(const nlohmann::json &data)
     {
-        if (data.is_object())
-        {
-            for (auto &[name, desc] : data.items())
-            {
-                std::string path = desc.get<std::string>();
-                auto mesh = mesh_utils::loadOBJ(path.c_str());
-                assets[name] = mesh;
-            }
-        }
+        AssetBatch batch;
+        queueMeshes(data, batch);
+        batch.finish();
     };
 
     // This will load all the materials defined in "data"
@@ -123,34 +180,109 @@ namespace our
                 std::string type = desc.value("type", "");
                 auto material = createMaterialFromType(type);
                 material->deserialize(desc);
-                assets[name] = material;
+                add(name, material);
             }
         }
     };
 
-    void deserializeAllAssets(const nlohmann::json &assetData)
+    void deserializeAllAssets(const nlohmann::json &assetData, bool streaming)
     {
+        OUR_TRACE_SCOPE("deserialize assets");
         if (!assetData.is_object())
             return;
+        // The shaders, textures and meshes of all types are queued in a single batch so they are all decoded concurrently
+        AssetBatch batch(streaming);
         if (assetData.contains("shaders"))
-            AssetLoader<ShaderProgram>::deserialize(assetData["shaders"]);
+            queueShaders(assetData["shaders"], batch);
         if (assetData.contains("textures"))
-            AssetLoader<Texture2D>::deserialize(assetData["textures"]);
+            queueTextures(assetData["textures"], batch);
+        if (assetData.contains("meshes"))
+            queueMeshes(assetData["meshes"], batch);
+        // The samplers are created on the main thread while the workers decode the other assets
         if (assetData.contains("samplers"))
             AssetLoader<Sampler>::deserialize(assetData["samplers"]);
-        if (assetData.contains("meshes"))
-            AssetLoader<Mesh>::deserialize(assetData["meshes"]);
+        batch.finish();
+        batch.printReport(std::cout);
+        // Materials refer to shaders, textures and samplers by name, so they are loaded after the batch is done
         if (assetData.contains("materials"))
             AssetLoader<Material>::deserialize(assetData["materials"]);
     }
 
     void clearAllAssets()
     {
+        // The materials hold handles to the shaders, textures & samplers, so they are cleared first
+        AssetLoader<Material>::clear();
         AssetLoader<ShaderProgram>::clear();
         AssetLoader<Texture2D>::clear();
         AssetLoader<Sampler>::clear();
         AssetLoader<Mesh>::clear();
-        AssetLoader<Material>::clear();
+    }
+
+    // Reads the budget of an asset type in the form { "ram": bytes, "vram": bytes } (a missing value is unlimited)
+    template <typename T>
+    static void setAssetBudget(const nlohmann::json &budgets, const char *type)
+    {
+        AssetBudget budget;
+        if (auto it = budgets.find(type); it != budgets.end() && it->is_object())
+        {
+            budget.cpuBytes = it->value("ram", budget.cpuBytes);
+            budget.gpuBytes = it->value("vram", budget.gpuBytes);
+        }
+        AssetLoader<T>::setBudget(budget);
+    }
+
+    void setAssetBudgets(const nlohmann::json &budgets)
+    {
+        if (!budgets.is_object())
+            return;
+        setAssetBudget<ShaderProgram>(budgets, "shaders");
+        setAssetBudget<Texture2D>(budgets, "textures");
+        setAssetBudget<Sampler>(budgets, "samplers");
+        setAssetBudget<Mesh>(budgets, "meshes");
+        setAssetBudget<Material>(budgets, "materials");
+    }
+
+    void collectAllAssets()
+    {
+        AssetLoader<Material>::collect();
+        AssetLoader<ShaderProgram>::collect();
+        AssetLoader<Texture2D>::collect();
+        AssetLoader<Sampler>::collect();
+        AssetLoader<Mesh>::collect();
+    }
+
+    // Prints a line of the asset statistics
+    template <typename T>
+    static void printAssetStat(std::ostream &stream, const char *type)
+    {
+        // Writes a byte count in KB (or "-" if the budget is unlimited)
+        auto kilobytes = [&stream](size_t bytes)
+        {
+            if (bytes == SIZE_MAX)
+                stream << std::setw(12) << "-";
+            else
+                stream << std::setw(12) << bytes / 1024;
+        };
+        AssetStats stats = AssetLoader<T>::getStats();
+        stream << "  " << std::left << std::setw(11) << type << std::right << std::setw(7) << stats.count << std::setw(10) << stats.residentCount
+               << std::setw(12) << stats.referencedCount;
+        kilobytes(stats.resident.cpuBytes);
+        kilobytes(stats.budget.cpuBytes);
+        kilobytes(stats.resident.gpuBytes);
+        kilobytes(stats.budget.gpuBytes);
+        stream << std::setw(11) << stats.evictionCount << std::endl;
+    }
+
+    void printAssetStats(std::ostream &stream)
+    {
+        stream << "  " << std::left << std::setw(11) << "type" << std::right << std::setw(7) << "count" << std::setw(10) << "resident"
+               << std::setw(12) << "referenced" << std::setw(12) << "ram KB" << std::setw(12) << "ram budget" << std::setw(12) << "vram KB"
+               << std::setw(12) << "vram budget" << std::setw(11) << "evictions" << std::endl;
+        printAssetStat<ShaderProgram>(stream, "shaders");
+        printAssetStat<Texture2D>(stream, "textures");
+        printAssetStat<Sampler>(stream, "samplers");
+        printAssetStat<Mesh>(stream, "meshes");
+        printAssetStat<Material>(stream, "materials");
     }
 
 }
\ No newline at end of file
@@ -1,43 +1,217 @@
 #pragma once
 
 #include <unordered_map>
+#include <memory>
+#include <vector>
+#include <algorithm>
 #include <string>
+#include <cstdint>
+#include <ostream>
+#include <iostream>
 #include <json/json.hpp>
 
+#include "asset-handle.hpp"
+#include "asset-streamer.hpp"
+
 namespace our {
 
+    // The memory used by an asset (or by all the assets of a type)
+    struct AssetMemory {
+        size_t cpuBytes = 0; // The bytes kept in the RAM
+        size_t gpuBytes = 0; // The bytes kept in the VRAM (e.g. texture levels, vertex & element buffers)
+    };
+
+    // The maximum memory that the resident assets of a type should use
+    // When a budget is exceeded, the unreferenced assets are evicted (least recently used first) until the type fits in its budget again.
+    // The referenced assets are never evicted, so the budget can still be exceeded if the referenced assets alone do not fit.
+    struct AssetBudget {
+        size_t cpuBytes = SIZE_MAX;
+        size_t gpuBytes = SIZE_MAX;
+    };
+
+    // The statistics of the assets of a type
+    struct AssetStats {
+        size_t count = 0;           // The number of known assets (resident or evicted)
+        size_t residentCount = 0;   // The number of assets that are currently in memory
+        size_t referencedCount = 0; // The number of resident assets with at least one handle
+        AssetMemory resident;       // The memory used by the resident assets
+        AssetBudget budget;
+        size_t evictionCount = 0;   // The number of evictions since the start
+    };
+
     // This static template class will hold the loaded assets
     // and can be called from anywhere to get an asset by its name.
     // Since we have different types of assets, this declared as a template class
     // and for each asset type, we define a specialization in "asset-loader.cpp"
+    // The assets are reference counted: an object that keeps using an asset (e.g. a material using a texture) should hold an "AssetHandle".
+    // An asset that can be created again (it has a "reload" function) is evicted by "collect" when its type is over budget and no handle refers to it.
+    // An evicted asset keeps its entry, so requesting it by name creates it again.
+    // All the functions must be called from the main thread.
     template<typename T>
     class AssetLoader {
-        // This map stores a pointer to each asset identified by its name
-        // All assets in this map are owned by the asset loader so it should not be deleted outside of this class
-        static std::unordered_map<std::string, T*> assets;
+        struct Registry {
+            // This map stores the entry of each asset identified by its name
+            // All assets in this map are owned by the asset loader so it should not be deleted outside of this class
+            std::unordered_map<std::string, std::unique_ptr<AssetEntry<T>>> entries;
+            std::unordered_map<const T*, AssetEntry<T>*> byAsset; // Finds the entry of a resident asset from its pointer
+            AssetBudget budget;
+            size_t evictionCount = 0;
+        };
+        static Registry registry;
+
+        // Deletes the asset of the entry (the entry itself is kept)
+        static void unload(AssetEntry<T>& entry) {
+            if(!entry.asset) return;
+            // A streaming asset must stop receiving data before it is deleted
+            AssetStreamer::get().cancel(entry.asset);
+            registry.byAsset.erase(entry.asset);
+            delete entry.asset;
+            entry.asset = nullptr;
+        }
+        // Makes sure the asset of the entry is in memory (creating it again if it was evicted)
+        static T* load(AssetEntry<T>& entry) {
+            if(!entry.asset && entry.reload) {
+                entry.asset = entry.reload();
+                if(entry.asset) registry.byAsset[entry.asset] = &entry;
+            }
+            return entry.asset;
+        }
+
     public:
         // This function loads the assets defined by the given json object
         // The json object should be defined in the form: {asset_name: asset_description}
         // For example: {"white": "textures/white.png", "polka": "textures/polka.png"} defines 2 textures
         // where the key will be asset name and the description holds the path to the texture file
         static void deserialize(const nlohmann::json&);
+        // This function returns the memory used by an asset of this type (it is specialized for each type in "asset-loader.cpp")
+        static AssetMemory measure(const T* asset);
+
         // This function find an asset by its name and returns a pointer to it
         // If no asset with the given name was found, the function returns a nullptr
+        // If the asset was evicted, it is created again.
         // WARNING: never delete the asset returned by the function.
         // The asset could be shared with another object and
         // all the assets will be automatically cleared when the function "clear" is called
+        // Since the returned pointer does not keep the asset alive, use "acquire" to keep using the asset after the current frame.
         static T* get(const std::string& name) {
-            if(auto it = assets.find(name); it != assets.end()){
-                return it->second;
+            if(auto it = registry.entries.find(name); it != registry.entries.end()){
+                return load(*it->second);
             }
             return nullptr;
         };
-        // This function deletes all the assets held by this class and clear the assets map 
+        // Returns the asset with the given name only if it was created from the given source (see "add"), otherwise it returns a nullptr
+        // It is used to skip loading the assets that are already resident (e.g. when a state is entered again with the same assets)
+        // If the asset was evicted, it is created again.
+        static T* find(const std::string& name, const std::string& source) {
+            if(auto it = registry.entries.find(name); it != registry.entries.end() && it->second->source == source){
+                it->second->lastUsed.store(internal::nextAssetUseTick(), std::memory_order_relaxed);
+                return load(*it->second);
+            }
+            return nullptr;
+        }
+        // Returns a handle to the asset with the given name (or an empty handle if no asset with the given name was found)
+        static AssetHandle<T> acquire(const std::string& name) {
+            if(auto it = registry.entries.find(name); it != registry.entries.end() && load(*it->second)){
+                return AssetHandle<T>(it->second.get());
+            }
+            return AssetHandle<T>();
+        }
+        // Returns a handle to the given asset (or an empty handle if the asset is not owned by the asset loader)
+        static AssetHandle<T> acquire(const T* asset) {
+            if(auto it = registry.byAsset.find(asset); asset && it != registry.byAsset.end()){
+                return AssetHandle<T>(it->second);
+            }
+            return AssetHandle<T>();
+        }
+        // This function adds an asset that was created outside of "deserialize" (e.g. from a compiled scene)
+        // The asset loader takes the ownership of the asset. If the name is already used, the old asset is deleted.
+        // If "reload" is given, the asset can be evicted when it is not used, since "reload" can create it again.
+        // If "source" is given, later requests for the same source can reuse the asset (see "find").
+        static void add(const std::string& name, T* asset, std::function<T*()> reload = nullptr, std::string source = "") {
+            auto& entry = registry.entries[name];
+            if(!entry) {
+                entry = std::make_unique<AssetEntry<T>>();
+                entry->name = name;
+            }
+            if(entry->asset != asset) {
+                unload(*entry);
+                entry->asset = asset;
+                if(asset) registry.byAsset[asset] = entry.get();
+            }
+            entry->reload = std::move(reload);
+            entry->source = std::move(source);
+            entry->lastUsed.store(internal::nextAssetUseTick(), std::memory_order_relaxed);
+        }
+        // This function deletes all the assets held by this class and clear the assets map
+        // All the handles to these assets must be released before calling it
+        // The assets are kept between states (so a state that is entered again reuses them), so this is only needed to free all the memory at once
+        // An asset that still has handles is kept (with its entry) and reported, since deleting it would leave the handles dangling.
         static void clear(){
-            for(auto& [name, asset] : assets){
-                delete asset;
+            for(auto it = registry.entries.begin(); it != registry.entries.end();){
+                AssetEntry<T>& entry = *it->second;
+                if(std::uint32_t references = entry.references.load(std::memory_order_acquire); references > 0){
+                    std::cerr << "WARNING: The asset \"" << entry.name << "\" is still referenced by " << references << " handle(s), so it is not cleared" << std::endl;
+                    ++it;
+                    continue;
+                }
+                unload(entry);
+                it = registry.entries.erase(it);
             }
-            assets.clear();
+        }
+
+        // Sets the memory budget of this asset type (then evicts the assets that do not fit)
+        static void setBudget(const AssetBudget& budget) {
+            registry.budget = budget;
+            collect();
+        }
+        static AssetBudget getBudget() { return registry.budget; }
+
+        // Evicts the unreferenced assets (least recently used first) while this asset type is over its budget
+        // Returns the number of evicted assets
+        static size_t collect() {
+            const AssetBudget& budget = registry.budget;
+            if(budget.cpuBytes == SIZE_MAX && budget.gpuBytes == SIZE_MAX) return 0; // Nothing to do if the budget is unlimited
+            AssetMemory resident;
+            std::vector<std::pair<AssetEntry<T>*, AssetMemory>> candidates;
+            for(auto& [name, entry] : registry.entries){
+                if(!entry->asset) continue;
+                AssetMemory memory = measure(entry->asset);
+                resident.cpuBytes += memory.cpuBytes;
+                resident.gpuBytes += memory.gpuBytes;
+                if(entry->reload && entry->references.load(std::memory_order_acquire) == 0)
+                    candidates.emplace_back(entry.get(), memory);
+            }
+            if(resident.cpuBytes <= budget.cpuBytes && resident.gpuBytes <= budget.gpuBytes) return 0;
+            std::sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b){
+                return a.first->lastUsed.load(std::memory_order_relaxed) < b.first->lastUsed.load(std::memory_order_relaxed);
+            });
+            size_t evicted = 0;
+            for(auto& [entry, memory] : candidates){
+                if(resident.cpuBytes <= budget.cpuBytes && resident.gpuBytes <= budget.gpuBytes) break;
+                unload(*entry);
+                resident.cpuBytes -= memory.cpuBytes;
+                resident.gpuBytes -= memory.gpuBytes;
+                ++evicted;
+            }
+            registry.evictionCount += evicted;
+            return evicted;
+        }
+
+        // Returns the number of assets of this type and the memory they use
+        static AssetStats getStats() {
+            AssetStats stats;
+            stats.count = registry.entries.size();
+            stats.budget = registry.budget;
+            stats.evictionCount = registry.evictionCount;
+            for(auto& [name, entry] : registry.entries){
+                if(!entry->asset) continue;
+                AssetMemory memory = measure(entry->asset);
+                stats.resident.cpuBytes += memory.cpuBytes;
+                stats.resident.gpuBytes += memory.gpuBytes;
+                ++stats.residentCount;
+                if(entry->references.load(std::memory_order_acquire) > 0) ++stats.referencedCount;
+            }
+            return stats;
         }
     };
 
@@ -45,7 +219,20 @@ namespace our {
     // This function will call "AssetLoader<T>::deserialize" for all the different asset types T
     // For example, a json in the form {"shaders": ... , "textures": ... } will call "deserialize" for:
     // AssetLoader<ShaderProgram> and AssetLoader<Texture2D>
-    void deserializeAllAssets(const nlohmann::json& assetData);
+    // If "streaming" is true, the textures and meshes are streamed in the background (see "asset-streamer.hpp")
+    // so the function returns without waiting for them to be decoded
+    void deserializeAllAssets(const nlohmann::json& assetData, bool streaming = false);
     // This will call "AssetLoader<T>::clear" for all the different asset types T
+    // The application calls it before it exits. The states do not need to call it, since the unused assets are evicted when they exceed their budgets.
     void clearAllAssets();
-}
\ No newline at end of file
+
+    // Sets the budgets of the asset types from a json object in the form:
+    //    { "textures": { "ram": bytes, "vram": bytes }, "meshes": { "vram": bytes }, ... }
+    // The keys are the same as the asset types in the scene config ("shaders", "textures", "samplers", "meshes" & "materials")
+    // A missing budget is unlimited.
+    void setAssetBudgets(const nlohmann::json& budgets);
+    // This will call "AssetLoader<T>::collect" for all the different asset types T (the application calls it once per frame)
+    void collectAllAssets();
+    // Prints the statistics of all the asset types (see "AssetLoader<T>::getStats")
+    void printAssetStats(std::ostream& stream);
+}
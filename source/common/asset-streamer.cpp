@@ -0,0 +1,220 @@
+#include "asset-streamer.hpp"
+
+#include "texture/texture2d.hpp"
+#include "texture/texture-utils.hpp"
+#include "mesh/mesh.hpp"
+#include "mesh/mesh-utils.hpp"
+#include "trace/trace.hpp"
+
+#include <memory>
+#include <algorithm>
+
+namespace our
+{
+
+    AssetStreamer &AssetStreamer::get()
+    {
+        // The job system is created first, so it is destroyed after the streamer (whose decodes may use it)
+        JobSystem::get();
+        static AssetStreamer streamer;
+        return streamer;
+    }
+
+    AssetStreamer::AssetStreamer(unsigned decoderCount)
+    {
+        for (unsigned index = 0; index < std::max(decoderCount, 1u); ++index)
+            decoders.emplace_back(&AssetStreamer::decoderLoop, this);
+    }
+
+    AssetStreamer::~AssetStreamer()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+            decoding -= decodes.size();
+            decodes.clear();
+        }
+        decodeQueued.notify_all();
+        for (std::thread &decoder : decoders)
+            decoder.join();
+    }
+
+    void AssetStreamer::decode(std::function<void()> job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            decodes.push_back(std::move(job));
+            ++decoding;
+        }
+        decodeQueued.notify_one();
+    }
+
+    void AssetStreamer::decoderLoop()
+    {
+        while (true)
+        {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                decodeQueued.wait(lock, [this]()
+                                  { return stopping || !decodes.empty(); });
+                if (stopping)
+                    return;
+                job = std::move(decodes.front());
+                decodes.pop_front();
+            }
+            job();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                --decoding;
+            }
+            decodeDone.notify_all();
+        }
+    }
+
+    std::uint64_t AssetStreamer::begin(const void *target)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::uint64_t ticket = nextTicket++;
+        active[target] = ticket;
+        return ticket;
+    }
+
+    void AssetStreamer::enqueue(PendingUpload upload)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (auto it = active.find(upload.target); it != active.end() && it->second == upload.ticket)
+            ready.push_back(std::move(upload));
+    }
+
+    void AssetStreamer::end(const void *target, std::uint64_t ticket)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (auto it = active.find(target); it != active.end() && it->second == ticket)
+            active.erase(it);
+    }
+
+    Texture2D *AssetStreamer::streamTexture(const std::string &path, texture_utils::ColorSpace colorSpace)
+    {
+        // The placeholder is a single white texel, so tinted materials still show their tint while the texture streams
+        Texture2D *texture = new Texture2D();
+        const unsigned char white[4] = {255, 255, 255, 255};
+        texture->bind();
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        texture->setByteCount(sizeof(white));
+
+        std::uint64_t ticket = begin(texture);
+        decode([this, texture, ticket, path, colorSpace]()
+               {
+            OUR_TRACE_SCOPE_DETAIL("stream texture", path);
+            auto image = std::make_shared<texture_utils::Image>();
+            if (!texture_utils::loadImageData(*image, path.c_str(), colorSpace))
+            {
+                // The placeholder stays in place if the file could not be decoded
+                end(texture, ticket);
+                return;
+            }
+            size_t bytes = image->getByteCount();
+            enqueue({texture, ticket, bytes, [texture, image]()
+                     {
+                         // The real texture is uploaded to a new OpenGL texture, then swapped with the placeholder (which is deleted)
+                         Texture2D loaded;
+                         texture_utils::uploadImage(loaded, *image);
+                         texture->swap(loaded);
+                     }}); });
+        return texture;
+    }
+
+    Mesh *AssetStreamer::streamMesh(const std::string &path)
+    {
+        Mesh *mesh = mesh_utils::createMesh(mesh_utils::makeUnitCube());
+
+        std::uint64_t ticket = begin(mesh);
+        decode([this, mesh, ticket, path]()
+               {
+            OUR_TRACE_SCOPE_DETAIL("stream mesh", path);
+            auto data = std::make_shared<mesh_utils::MeshData>();
+            if (!mesh_utils::loadMeshData(path.c_str(), *data))
+            {
+                end(mesh, ticket);
+                return;
+            }
+            size_t bytes = data->getByteCount();
+            enqueue({mesh, ticket, bytes, [mesh, data]()
+                     {
+                         std::unique_ptr<Mesh> loaded(mesh_utils::createMesh(*data));
+                         mesh->swap(*loaded);
+                     }}); });
+        return mesh;
+    }
+
+    void AssetStreamer::update()
+    {
+        size_t spent = 0;
+        while (true)
+        {
+            PendingUpload upload;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                // At least one asset is uploaded per frame, so an asset bigger than the budget is not stuck forever
+                if (ready.empty() || (spent > 0 && spent + ready.front().bytes > uploadBudget))
+                    return;
+                upload = std::move(ready.front());
+                ready.pop_front();
+                // The upload is skipped if a newer request for the same asset was made after this one was decoded
+                auto it = active.find(upload.target);
+                if (it == active.end() || it->second != upload.ticket)
+                    continue;
+                // The request is done, so the asset is no longer streaming
+                active.erase(it);
+            }
+            {
+                OUR_TRACE_SCOPE("upload streamed asset");
+                upload.upload();
+            }
+            spent += upload.bytes;
+        }
+    }
+
+    void AssetStreamer::cancel(const void *target)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        active.erase(target);
+        for (auto it = ready.begin(); it != ready.end();)
+            it = it->target == target ? ready.erase(it) : it + 1;
+    }
+
+    void AssetStreamer::cancelAll()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        active.clear();
+        ready.clear();
+    }
+
+    size_t AssetStreamer::getPendingCount()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return active.size();
+    }
+
+    bool AssetStreamer::isStreaming(const void *target)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return active.count(target) != 0;
+    }
+
+    void AssetStreamer::finish()
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            decodeDone.wait(lock, [this]()
+                            { return decoding == 0; });
+        }
+        size_t budget = uploadBudget;
+        uploadBudget = SIZE_MAX;
+        update();
+        uploadBudget = budget;
+    }
+
+}
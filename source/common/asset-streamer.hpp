@@ -0,0 +1,113 @@
+#pragma once
+
+#include <string>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+#include "jobs/job-system.hpp"
+#include "texture/texture-utils.hpp"
+
+namespace our
+{
+
+    class Texture2D;
+    class Mesh;
+
+    // The asset streamer loads textures and meshes in the background while the assets are already in use.
+    // An asset object is created right away with a placeholder content (a 1x1 white texture or a unit cube mesh),
+    // so the pointer returned by "AssetLoader<T>::get" is valid immediately and never changes.
+    // The real asset file is decoded on the decoder threads of the streamer, then the decoded data is uploaded to the GPU on the main thread by "update"
+    // and swapped into the asset object in one step (between two frames, so a frame never sees a half uploaded asset).
+    // The decodes do not go through the queues of the job system, since the job system only runs its queued jobs when a worker is free
+    // or when a thread waits for a counter: with no workers the decodes would never run during play, and otherwise a thread that waits
+    // for its own jobs (e.g. the system scheduler) could pick up a whole decode and stall the frame.
+    // (a decode may still use the job system for its parallel parts, e.g. the OBJ parser, like any other thread)
+    // To keep the frame times smooth, "update" uploads at most "uploadBudget" bytes per frame (but at least one asset).
+    class AssetStreamer
+    {
+        // A decoded asset waiting for its upload
+        struct PendingUpload
+        {
+            const void *target;       // The asset object that will receive the data
+            std::uint64_t ticket;     // The ticket of the stream request (to ignore the uploads of cancelled requests)
+            size_t bytes;             // The number of bytes that will be sent to the GPU
+            std::function<void()> upload;
+        };
+
+        size_t uploadBudget = DEFAULT_UPLOAD_BUDGET;
+
+        std::vector<std::thread> decoders;
+        std::deque<std::function<void()>> decodes; // The decodes that no decoder started yet (protected by "mutex")
+        size_t decoding = 0;                       // The number of decodes that are queued or running (protected by "mutex")
+        bool stopping = false;
+        std::condition_variable decodeQueued;      // Notified when a decode is queued or the streamer is stopping
+        std::condition_variable decodeDone;        // Notified when a decode is done
+
+        std::mutex mutex;
+        std::deque<PendingUpload> ready;                       // The decoded assets in the order they finished decoding
+        std::unordered_map<const void *, std::uint64_t> active; // The ticket of the current request of every asset that is still streaming
+        std::uint64_t nextTicket = 1;
+
+        // Registers a request for the given target and returns its ticket (any older request for the same target is cancelled)
+        std::uint64_t begin(const void *target);
+        // Ends the given request without uploading anything (e.g. if its file could not be decoded)
+        void end(const void *target, std::uint64_t ticket);
+        // Called by the decodes to queue their upload (it is dropped if the request was cancelled meanwhile)
+        void enqueue(PendingUpload upload);
+        // Queues a decode for the decoder threads
+        void decode(std::function<void()> job);
+        // The body of a decoder thread
+        void decoderLoop();
+
+    public:
+        // The default number of bytes uploaded per frame
+        static constexpr size_t DEFAULT_UPLOAD_BUDGET = size_t(8) << 20;
+
+        // The default number of decoder threads (they mostly wait for the files, and the OBJ parser runs its parallel parts on the job system)
+        static constexpr unsigned DEFAULT_DECODER_COUNT = 2;
+
+        explicit AssetStreamer(unsigned decoderCount = DEFAULT_DECODER_COUNT);
+        // The streamer drops the decodes that did not start yet and waits for the running ones, since they refer to it
+        ~AssetStreamer();
+
+        // Returns the streamer of the engine
+        static AssetStreamer &get();
+
+        // Sets the maximum number of bytes uploaded to the GPU per frame
+        void setUploadBudget(size_t bytesPerFrame) { uploadBudget = bytesPerFrame; }
+        size_t getUploadBudget() const { return uploadBudget; }
+
+        // These functions create an asset with a placeholder content and start streaming the file into it
+        // They must be called from the main thread (since they create OpenGL objects)
+        Texture2D *streamTexture(const std::string &path, texture_utils::ColorSpace colorSpace = texture_utils::ColorSpace::SRGB);
+        Mesh *streamMesh(const std::string &path);
+
+        // Uploads the decoded assets until the budget of this frame is used
+        // This must be called from the main thread once per frame (the application does it before drawing each frame)
+        void update();
+
+        // Stops streaming into the given asset (this must be called before a streamed asset is deleted)
+        void cancel(const void *target);
+        // Stops streaming into all the assets
+        void cancelAll();
+
+        // Returns the number of assets that are still streaming
+        size_t getPendingCount();
+        // Returns true if the given asset still has its placeholder content because its file is still streaming
+        // (e.g. the bounding box of a streaming mesh is the one of the unit cube, so it should not be used for collisions yet)
+        bool isStreaming(const void *target);
+        // Decodes & uploads all the streaming assets before returning (ignoring the budget)
+        void finish();
+
+        AssetStreamer(const AssetStreamer &) = delete;
+        AssetStreamer &operator=(const AssetStreamer &) = delete;
+    };
+
+}
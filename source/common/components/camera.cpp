@@ -1,5 +1,6 @@
 #include "camera.hpp"
 #include "../ecs/entity.hpp"
+#include "../scene/scene-stream.hpp"
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
@@ -25,6 +26,27 @@ namespace our
         orthoHeight = data.value("orthoHeight", 1.0f);
     }
 
+    // The record holds the parameters after they are read from json (so the fov is already in radians)
+    void CameraComponent::compile(const nlohmann::json &data, SceneWriter &writer) const
+    {
+        CameraComponent camera = *this;
+        camera.deserialize(data);
+        writer.write(camera.cameraType);
+        writer.write(camera.near);
+        writer.write(camera.far);
+        writer.write(camera.fovY);
+        writer.write(camera.orthoHeight);
+    }
+
+    void CameraComponent::deserialize(SceneReader &reader)
+    {
+        cameraType = reader.read<CameraType>();
+        near = reader.read<float>();
+        far = reader.read<float>();
+        fovY = reader.read<float>();
+        orthoHeight = reader.read<float>();
+    }
+
     // Creates and returns the camera view matrix
     glm::mat4 CameraComponent::getViewMatrix() const
     {
@@ -26,6 +26,9 @@ namespace our {
 
         // Reads camera parameters from the given json object
         void deserialize(const nlohmann::json& data) override;
+        // Writes & reads the binary record of this component in a compiled scene
+        void compile(const nlohmann::json& data, SceneWriter& writer) const override;
+        void deserialize(SceneReader& reader) override;
 
         // Creates and returns the camera view matrix
         glm::mat4 getViewMatrix() const;
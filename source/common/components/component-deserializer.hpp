@@ -8,41 +8,58 @@
 #include "random-movement.hpp"
 #include "light.hpp"
 
+#include <string>
+#include <unordered_map>
+
 namespace our
 {
 
+    // This struct describes a component type that can be read from a json file
+    struct ComponentTypeInfo
+    {
+        ComponentTypeID id;               // The dense type ID of the component type (see "getComponentTypeID")
+        Component *(*create)(Entity *);   // A function that adds a component of this type to the given entity
+        void (*compile)(const nlohmann::json &, SceneWriter &); // A function that writes the binary record of a component of this type (see "scene/compiled-scene.hpp")
+    };
+
+    // This function registers the component type T in the given registry using the string returned by "T::getID()" as a key
+    template <typename T>
+    void registerComponentType(std::unordered_map<std::string, ComponentTypeInfo> &registry)
+    {
+        registry[T::getID()] = {getComponentTypeID<T>(),
+                                [](Entity *entity) -> Component * { return entity->addComponent<T>(); },
+                                [](const nlohmann::json &data, SceneWriter &writer) { T().compile(data, writer); }};
+    }
+
+    // This returns the registry that maps the "type" string found in the json files to the component type
+    // When you create a new type of components, register it here so that it can be deserialized
+    inline const std::unordered_map<std::string, ComponentTypeInfo> &getComponentTypeRegistry()
+    {
+        static const std::unordered_map<std::string, ComponentTypeInfo> registry = []()
+        {
+            std::unordered_map<std::string, ComponentTypeInfo> registry;
+            registerComponentType<CameraComponent>(registry);
+            registerComponentType<MeshRendererComponent>(registry);
+            registerComponentType<FreeCameraControllerComponent>(registry);
+            registerComponentType<MovementComponent>(registry);
+            registerComponentType<LightComponent>(registry);
+            registerComponentType<RandomMovementComponent>(registry);
+            return registry;
+        }();
+        return registry;
+    }
+
     // Given a json object, this function picks and creates a component in the given entity
     // based on the "type" specified in the json object which is later deserialized from the rest of the json object
     inline void deserializeComponent(const nlohmann::json &data, Entity *entity)
     {
         std::string type = data.value("type", "");
-        Component *component = nullptr;
-        if (type == CameraComponent::getID())
-        {
-            component = entity->addComponent<CameraComponent>();
-        }
-        else if (type == MeshRendererComponent::getID())
-        {
-            component = entity->addComponent<MeshRendererComponent>();
-        }
-        else if (type == FreeCameraControllerComponent::getID())
+        const auto &registry = getComponentTypeRegistry();
+        if (auto it = registry.find(type); it != registry.end())
         {
-            component = entity->addComponent<FreeCameraControllerComponent>();
-        }
-        else if (type == MovementComponent::getID())
-        {
-            component = entity->addComponent<MovementComponent>();
-        }
-        else if (type == LightComponent::getID())
-        {
-            component = entity->addComponent<LightComponent>();
-        }
-        else if (type == RandomMovementComponent::getID())
-        {
-            component = entity->addComponent<RandomMovementComponent>();
-        }
-        if (component)
+            Component *component = it->second.create(entity);
             component->deserialize(data);
+        }
     }
 
 }
\ No newline at end of file
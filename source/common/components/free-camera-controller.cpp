@@ -1,6 +1,7 @@
 #include "free-camera-controller.hpp"
 #include "../ecs/entity.hpp"
 #include "../deserialize-utils.hpp"
+#include "../scene/scene-stream.hpp"
 
 namespace our {
     // Reads sensitivities & speedupFactor from the given json object
@@ -11,4 +12,20 @@ namespace our {
         positionSensitivity = data.value("positionSensitivity", positionSensitivity);
         speedupFactor = data.value("speedupFactor", speedupFactor);
     }
+
+    void FreeCameraControllerComponent::compile(const nlohmann::json& data, SceneWriter& writer) const {
+        FreeCameraControllerComponent controller = *this;
+        controller.deserialize(data);
+        writer.write(controller.rotationSensitivity);
+        writer.write(controller.fovSensitivity);
+        writer.write(controller.positionSensitivity);
+        writer.write(controller.speedupFactor);
+    }
+
+    void FreeCameraControllerComponent::deserialize(SceneReader& reader){
+        rotationSensitivity = reader.read<float>();
+        fovSensitivity = reader.read<float>();
+        positionSensitivity = reader.read<glm::vec3>();
+        speedupFactor = reader.read<float>();
+    }
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include "deserialize-utils.hpp"
+#include "../scene/scene-stream.hpp"
 
 namespace our
 {
@@ -33,4 +34,24 @@ namespace our
         attenuation = data.value("attenuation", glm::vec3(0, 0, 1));
         cone_angles = glm::radians(data.value("cone_angles", glm::vec2(15.0f,30.0f)));
     }
+
+    // The record holds the light parameters after they are read from json (so the cone angles are already in radians)
+    void LightComponent::compile(const nlohmann::json &data, SceneWriter &writer) const
+    {
+        LightComponent light = *this;
+        light.lightType = LightType::DIRECTIONAL;
+        light.deserialize(data);
+        writer.write(light.lightType);
+        writer.write(light.color);
+        writer.write(light.attenuation);
+        writer.write(light.cone_angles);
+    }
+
+    void LightComponent::deserialize(SceneReader &reader)
+    {
+        lightType = reader.read<LightType>();
+        color = reader.read<glm::vec3>();
+        attenuation = reader.read<glm::vec3>();
+        cone_angles = reader.read<glm::vec2>();
+    }
 }
\ No newline at end of file
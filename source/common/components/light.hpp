@@ -27,6 +27,9 @@ namespace our {
 
         // Reads light parameters from the given json object
         void deserialize(const nlohmann::json& data) override;
+        // Writes & reads the binary record of this component in a compiled scene
+        void compile(const nlohmann::json& data, SceneWriter& writer) const override;
+        void deserialize(SceneReader& reader) override;
     };
 
 }
\ No newline at end of file
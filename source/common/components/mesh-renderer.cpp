@@ -1,5 +1,7 @@
 #include "mesh-renderer.hpp"
 #include "../asset-loader.hpp"
+#include "../ecs/world.hpp"
+#include "../scene/scene-stream.hpp"
 
 namespace our
 {
@@ -9,10 +11,40 @@ namespace our
         if (!data.is_object())
             return;
         // Notice how we just get a string from the json file and pass it to the AssetLoader to get us the actual asset
-        mesh = AssetLoader<Mesh>::get(data["mesh"].get<std::string>());
-        material = AssetLoader<Material>::get(data["material"].get<std::string>());
+        mesh = AssetLoader<Mesh>::acquire(data["mesh"].get<std::string>());
+        material = AssetLoader<Material>::acquire(data["material"].get<std::string>());
         collidingType = (CollidingType)data.value<int>("collidingType", 2);
         kind = (RenderKind)data.value<int>("kind", 0);
         hidden = data.value<bool>("hidden", hidden);
     }
+
+    // Instead of the names, the record holds the indices of the mesh & material in the asset tables of the compiled scene
+    // so no name has to be looked up when the scene is loaded
+    void MeshRendererComponent::compile(const nlohmann::json &data, SceneWriter &writer) const
+    {
+        writer.writeAsset<Mesh>(data.value("mesh", ""));
+        writer.writeAsset<Material>(data.value("material", ""));
+        writer.write<std::int32_t>(data.value<int>("collidingType", 2));
+        writer.write<std::int32_t>(data.value<int>("kind", 0));
+        writer.write<bool>(data.value<bool>("hidden", hidden));
+    }
+
+    void MeshRendererComponent::deserialize(SceneReader &reader)
+    {
+        mesh = AssetLoader<Mesh>::acquire(reader.readAsset<Mesh>());
+        material = AssetLoader<Material>::acquire(reader.readAsset<Material>());
+        collidingType = (CollidingType)reader.read<std::int32_t>();
+        kind = (RenderKind)reader.read<std::int32_t>();
+        hidden = reader.read<bool>();
+    }
+
+    // The subtree is stored contiguously in the world's hierarchy order, so this is a single linear pass
+    void setSubtreeHidden(Entity *root, bool hidden)
+    {
+        for (Entity *entity : root->getWorld()->getSubtree(root))
+        {
+            if (MeshRendererComponent *meshRenderer = entity->getComponent<MeshRendererComponent>(); meshRenderer)
+                meshRenderer->hidden = hidden;
+        }
+    }
 }
\ No newline at end of file
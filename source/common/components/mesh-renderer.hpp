@@ -26,8 +26,8 @@ namespace our
     class MeshRendererComponent : public Component
     {
     public:
-        Mesh *mesh;                  // The mesh that should be drawn
-        Material *material;          // The material used to draw the mesh
+        AssetHandle<Mesh> mesh;         // The mesh that should be drawn
+        AssetHandle<Material> material; // The material used to draw the mesh
         CollidingType collidingType; // collidig type of the mesh renderer
         RenderKind kind;             // to know if its the main character
         bool hidden = false;
@@ -39,6 +39,13 @@ namespace our
 
         // Receives the mesh & material from the AssetLoader by the names given in the json object
         void deserialize(const nlohmann::json &data) override;
+        // Writes & reads the binary record of this component in a compiled scene
+        // The mesh & material are stored as indices into the asset tables of the compiled scene
+        void compile(const nlohmann::json &data, SceneWriter &writer) const override;
+        void deserialize(SceneReader &reader) override;
     };
 
+    // Hides (or shows) the mesh renderers of the given entity and all of its descendants
+    void setSubtreeHidden(Entity *root, bool hidden);
+
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "movement.hpp"
 #include "../ecs/entity.hpp"
 #include "../deserialize-utils.hpp"
+#include "../scene/scene-stream.hpp"
 
 namespace our {
     // Reads linearVelocity & angularVelocity from the given json object
@@ -9,4 +10,17 @@ namespace our {
         linearVelocity = data.value("linearVelocity", linearVelocity);
         angularVelocity = glm::radians(data.value("angularVelocity", angularVelocity));
     }
+
+    // The record holds the velocities after they are read from json (so the angular velocity is already in radians)
+    void MovementComponent::compile(const nlohmann::json& data, SceneWriter& writer) const {
+        MovementComponent movement = *this;
+        movement.deserialize(data);
+        writer.write(movement.linearVelocity);
+        writer.write(movement.angularVelocity);
+    }
+
+    void MovementComponent::deserialize(SceneReader& reader){
+        linearVelocity = reader.read<glm::vec3>();
+        angularVelocity = reader.read<glm::vec3>();
+    }
 }
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include <glm/glm.hpp>
 #include "../ecs/entity.hpp"
 #include "../deserialize-utils.hpp"
+#include "../scene/scene-stream.hpp"
 
 namespace our
 {
@@ -37,6 +38,25 @@ namespace our
             minBoundary = data.value("minBoundary", minBoundary);
             maxBoundary = data.value("maxBoundary", maxBoundary);
         };
+
+        // Writes & reads the binary record of this component in a compiled scene
+        void compile(const nlohmann::json &data, SceneWriter &writer) const override
+        {
+            RandomMovementComponent movement = *this;
+            movement.deserialize(data);
+            writer.write(movement.linearVelocity);
+            writer.write(movement.maxLinearVelocity);
+            writer.write(movement.minBoundary);
+            writer.write(movement.maxBoundary);
+        }
+
+        void deserialize(SceneReader &reader) override
+        {
+            linearVelocity = reader.read<glm::vec3>();
+            maxLinearVelocity = reader.read<glm::vec3>();
+            minBoundary = reader.read<glm::vec3>();
+            maxBoundary = reader.read<glm::vec3>();
+        }
     };
 
 }
\ No newline at end of file
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include <type_traits>
+#include "entity.hpp"
+
+namespace our {
+
+    // A pending entity refers to an entity that was created in a command buffer but does not exist yet
+    // It can only be used with the command buffer that created it
+    struct PendingEntity {
+        std::uint32_t index;
+    };
+
+    // The target of a command is either an existing entity (referred to by its handle) or a pending entity
+    struct CommandTarget {
+        static constexpr std::uint32_t NOT_PENDING = ~0u;
+        EntityHandle handle;
+        std::uint32_t pendingIndex = NOT_PENDING;
+
+        CommandTarget(EntityHandle handle) : handle(handle) {}
+        CommandTarget(const Entity* entity) : handle(entity->getHandle()) {}
+        CommandTarget(PendingEntity pending) : pendingIndex(pending.index) {}
+
+        bool isPending() const { return pendingIndex != NOT_PENDING; }
+    };
+
+    // A command buffer records structural changes to a world (creating & destroying entities and adding & removing components)
+    // without applying them. The world gives every thread its own buffer (see "World::getCommandBuffer"),
+    // so systems running in parallel can record changes without any locks and without invalidating the pools and views they iterate over.
+    // The recorded commands are applied by "World::applyCommands" at a sync point (once per frame, after the systems are done).
+    // The commands are applied in the following order:
+    // 1- All the entities are created (and their initializers are called).
+    // 2- The components are added and removed, sorted by entity (then in the order they were recorded by each thread).
+    // 3- The entities are destroyed.
+    // Commands that target an entity which no longer exists when the commands are applied are ignored.
+    class CommandBuffer {
+    public:
+        enum class CommandType : std::uint8_t {
+            CHANGE_COMPONENT = 0, // Adds or removes a component (both share the same phase so that they keep the recorded order)
+            DESTROY = 1
+        };
+
+    private:
+        struct Command {
+            CommandType type;
+            CommandTarget target;
+            std::function<void(Entity*)> apply; // Applies the change to the target entity (unused for DESTROY)
+        };
+
+        std::vector<std::function<void(Entity*)>> creations; // The initializer of each pending entity (may be empty)
+        std::vector<Command> commands; // The commands in the order they were recorded
+
+        friend class World; // The world is a friend since it applies the commands
+
+    public:
+        CommandBuffer() = default;
+
+        // Records the creation of an entity and returns a reference to it that can be used as a target for the next commands
+        // If an initializer is given, it is called right after the entity is created (e.g. to set its name, parent or transform)
+        PendingEntity create(std::function<void(Entity*)> initialize = {}) {
+            creations.push_back(std::move(initialize));
+            return PendingEntity{static_cast<std::uint32_t>(creations.size() - 1)};
+        }
+
+        // Records the destruction of an entity
+        void destroy(CommandTarget target) {
+            commands.push_back({CommandType::DESTROY, target, {}});
+        }
+
+        // Records adding a component of type T to an entity
+        // If an initializer is given, it is called with the new component (e.g. to set its data)
+        template<typename T>
+        void addComponent(CommandTarget target, std::function<void(T*)> initialize = {}) {
+            static_assert(std::is_base_of<Component, T>::value, "T must inherit from Component");
+            commands.push_back({CommandType::CHANGE_COMPONENT, target, [initialize = std::move(initialize)](Entity* entity){
+                T* component = entity->addComponent<T>();
+                if(initialize) initialize(component);
+            }});
+        }
+
+        // Records removing the component of type T from an entity
+        template<typename T>
+        void removeComponent(CommandTarget target) {
+            static_assert(std::is_base_of<Component, T>::value, "T must inherit from Component");
+            commands.push_back({CommandType::CHANGE_COMPONENT, target, [](Entity* entity){
+                entity->deleteComponent<T>();
+            }});
+        }
+
+        // Returns true if nothing was recorded
+        bool empty() const { return creations.empty() && commands.empty(); }
+
+        // Drops all the recorded commands (the memory is kept to be reused)
+        void clear() {
+            creations.clear();
+            commands.clear();
+        }
+
+        CommandBuffer(const CommandBuffer&) = delete;
+        CommandBuffer& operator=(const CommandBuffer&) = delete;
+    };
+
+}
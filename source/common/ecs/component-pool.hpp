@@ -0,0 +1,156 @@
+#pragma once
+
+#include "component.hpp"
+#include <vector>
+#include <memory>
+#include <new>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <type_traits>
+
+namespace our
+{
+
+    // This is the type-erased interface of a component pool
+    // The world keeps one pool per component type and uses this interface when it does not know the component type
+    // (for example, when an entity is destroyed and all of its components have to be released)
+    class ComponentPoolBase
+    {
+    public:
+        virtual ~ComponentPoolBase() = default;
+        // Removes the given component from the pool
+        // To keep the pool dense, the last component is moved into the freed slot.
+        // The function returns the new address of the moved component (or nullptr if nothing was moved)
+        // so that the caller can fix any reference to it.
+        virtual Component *remove(Component *component) = 0;
+        // Creates a copy of the given component at the end of the pool and returns it
+        // The copy still refers to the owner of the original, so the caller should attach it to its new owner
+        virtual Component *clone(const Component *source) = 0;
+        // Destroys all the components in the pool
+        virtual void clear() = 0;
+        // Returns the number of components in the pool
+        virtual size_t size() const = 0;
+    };
+
+    // A component pool stores all the components of type T in a world densely packed in memory.
+    // The components are stored in fixed size chunks such that:
+    // - Iterating over all the components of a type walks linearly through memory (which is cache friendly).
+    // - Adding a component never moves the other components, so pointers to components stay valid while the pool grows.
+    // WARNING: Removing a component moves the last component of the pool into the freed slot,
+    // so any pointer to that last component becomes invalid after a removal.
+    template <typename T>
+    class ComponentPool : public ComponentPoolBase
+    {
+        static_assert(std::is_base_of<Component, T>::value, "T must inherit from Component");
+
+    public:
+        // The number of components in each chunk (must be a power of 2)
+        static constexpr size_t CHUNK_SHIFT = 8;
+        static constexpr size_t CHUNK_SIZE = size_t(1) << CHUNK_SHIFT;
+        static constexpr size_t CHUNK_MASK = CHUNK_SIZE - 1;
+
+    private:
+        // Each chunk is a raw block of memory that can hold CHUNK_SIZE components
+        struct Chunk
+        {
+            std::aligned_storage_t<sizeof(T), alignof(T)> slots[CHUNK_SIZE];
+        };
+        std::vector<std::unique_ptr<Chunk>> chunks;
+        size_t count = 0; // The number of alive components in the pool
+
+        T *slot(size_t index) const
+        {
+            return std::launder(reinterpret_cast<T *>(&chunks[index >> CHUNK_SHIFT]->slots[index & CHUNK_MASK]));
+        }
+
+        // Returns the index of the given component in the pool (or count if it does not belong to this pool)
+        // Every component stores its index, so this costs O(1)
+        size_t indexOf(const Component *component) const
+        {
+            size_t index = component->poolIndex;
+            return index < count && slot(index) == component ? index : count;
+        }
+
+    public:
+        ComponentPool() = default;
+        ~ComponentPool() override { clear(); }
+
+        // Creates a new component at the end of the pool and returns a pointer to it
+        T *add()
+        {
+            if ((count >> CHUNK_SHIFT) == chunks.size())
+                chunks.push_back(std::make_unique<Chunk>());
+            T *component = new (slot(count)) T();
+            static_cast<Component *>(component)->poolIndex = std::uint32_t(count);
+            ++count;
+            return component;
+        }
+
+        Component *remove(Component *component) override
+        {
+            size_t index = indexOf(component);
+            if (index >= count)
+                return nullptr;
+            size_t last = count - 1;
+            T *moved = nullptr;
+            if (index != last)
+            {
+                *slot(index) = std::move(*slot(last));
+                moved = slot(index);
+                // The assignment copied the index of the last slot, so the moved component gets the index of its new slot
+                static_cast<Component *>(moved)->poolIndex = std::uint32_t(index);
+            }
+            slot(last)->~T();
+            --count;
+            return moved;
+        }
+
+        Component *clone(const Component *source) override
+        {
+            T *copy = add();
+            std::uint32_t index = static_cast<Component *>(copy)->poolIndex;
+            *copy = *static_cast<const T *>(source);
+            static_cast<Component *>(copy)->poolIndex = index;
+            return copy;
+        }
+
+        void clear() override
+        {
+            for (size_t index = 0; index < count; ++index)
+                slot(index)->~T();
+            count = 0;
+        }
+
+        size_t size() const override { return count; }
+
+        T &operator[](size_t index) { return *slot(index); }
+        const T &operator[](size_t index) const { return *slot(index); }
+
+        // A simple forward iterator that walks over the components in the pool in memory order
+        class iterator
+        {
+            const ComponentPool *pool;
+            size_t index;
+
+        public:
+            iterator(const ComponentPool *pool, size_t index) : pool(pool), index(index) {}
+            T &operator*() const { return *pool->slot(index); }
+            T *operator->() const { return pool->slot(index); }
+            iterator &operator++()
+            {
+                ++index;
+                return *this;
+            }
+            bool operator==(const iterator &other) const { return index == other.index; }
+            bool operator!=(const iterator &other) const { return index != other.index; }
+        };
+
+        iterator begin() const { return iterator(this, 0); }
+        iterator end() const { return iterator(this, count); }
+
+        ComponentPool(const ComponentPool &) = delete;
+        ComponentPool &operator=(const ComponentPool &) = delete;
+    };
+
+}
@@ -2,10 +2,59 @@
 
 #include <json/json.hpp>
 #include <string>
+#include <bitset>
+#include <cstdint>
+#include <cstdlib>
+#include <atomic>
+#include <iostream>
 
 namespace our {
 
     class Entity; // A forward declaration of the Entity Class
+    class SceneWriter; // Forward declarations of the classes that write & read compiled scenes (see "scene/scene-stream.hpp")
+    class SceneReader;
+    template<typename T> class ComponentPool; // A forward declaration of the component pool (see "component-pool.hpp")
+
+    // Each component type is identified by a small dense integer (0, 1, 2, ...)
+    // The integer is used to index the component arrays of the entity and the component pools of the world
+    // so looking up a component never needs to build, hash or compare strings.
+    typedef std::uint32_t ComponentTypeID;
+    // The maximum number of component types that can be used in the engine
+    constexpr ComponentTypeID MAX_COMPONENT_TYPES = 16;
+    // A bitmask where bit i is set if an entity holds a component whose type ID is i
+    typedef std::bitset<MAX_COMPONENT_TYPES> ComponentMask;
+
+    namespace internal {
+        // Returns a new type ID each time it is called
+        // It should only be called by "getComponentTypeID" below
+        // The counter is atomic since the IDs of different types may be requested for the first time from different threads at once
+        // (e.g. by systems running on the workers). Running out of IDs is fatal in every build, since the masks could not hold the new type.
+        inline ComponentTypeID nextComponentTypeID() {
+            static std::atomic<ComponentTypeID> next{0};
+            ComponentTypeID id = next.fetch_add(1, std::memory_order_relaxed);
+            if(id >= MAX_COMPONENT_TYPES) {
+                std::cerr << "ERROR: More than " << MAX_COMPONENT_TYPES << " component types are used, increase MAX_COMPONENT_TYPES" << std::endl;
+                std::abort();
+            }
+            return id;
+        }
+    }
+
+    // Returns the type ID of the component type T
+    // The ID is assigned the first time this template is called for T and never changes afterwards
+    template<typename T>
+    ComponentTypeID getComponentTypeID() {
+        static const ComponentTypeID id = internal::nextComponentTypeID();
+        return id;
+    }
+
+    // Returns a mask where the bits of the component types Ts are set
+    template<typename... Ts>
+    ComponentMask getComponentMask() {
+        ComponentMask mask;
+        (mask.set(getComponentTypeID<Ts>()), ...);
+        return mask;
+    }
 
     // A component is a data container that can be added to an entity.
     // The role of the entity in the world is defined by the components it holds.
@@ -13,15 +62,22 @@ namespace our {
     // Thus any renderer system should look for an entity holding a camera component in order to compute the camera related uniforms (e.g. VP matrix)
     class Component {
         Entity* owner; // A pointer to the entity that owns this component
+        std::uint32_t poolIndex = 0; // The index of this component in the pool of its type (so removing it from the pool needs no search)
         friend Entity; // The entity is a friend since it is the only one allowed to set itself as an owner of a certain component.
+        template<typename T> friend class ComponentPool; // The pool is a friend since it is the only one allowed to set the pool index
     public:
         // This static method returns a unique string that identifies each type of components
-        // This ID will be used as the key to store a component into the entity's component map 
+        // This string is the "type" used in the json files (see "component-deserializer.hpp")
         // When you create a new type of components, override this function to return a new unique ID
         static std::string getID() { return "Component"; }
         // Reads the data of the component from a json object
         // It is abstract since it must be overriden by derived components
         virtual void deserialize(const nlohmann::json& data) = 0;
+        // Writes the data of the component (read from a json object) into its binary record in a compiled scene
+        // The values must be written in the same order that "deserialize(SceneReader&)" reads them
+        virtual void compile(const nlohmann::json& data, SceneWriter& writer) const = 0;
+        // Reads the data of the component from its binary record in a compiled scene (see "scene/compiled-scene.hpp")
+        virtual void deserialize(SceneReader& reader) = 0;
         // Returns the owner of this component
         Entity* getOwner() const { return owner; }
     };
@@ -7,22 +7,55 @@
 namespace our
 {
 
-    // This function returns the transformation matrix from the entity's local space to the world space
+    // This function updates the cached transformation matrix from the entity's local space to the world space
     // Remember that you can get the transformation matrix from this entity to its parent from "localTransform"
     // To get the local to world matrix, you need to combine this entities matrix with its parent's matrix and
     // its parent's parent's matrix and so on till you reach the root.
-    glm::mat4 Entity::getLocalToWorldMatrix() const
+    // Since the parent's matrix is also cached, we only need to combine our local matrix with the parent's local to world matrix
+    // and we only do it if our local transform is dirty or the parent's matrix changed since the last time we computed ours
+    void Entity::updateLocalToWorldMatrix() const
     {
-        // TODO: Write this function
-        glm::mat4 transformationMatrix = localTransform.toMat4();
-        our::Entity *myParent = parent;
-        while (myParent) // as long as I have a parent get its transformation matrix
+        // Make sure that the parent is up to date before we use its matrix
+        if (parent)
+            parent->updateLocalToWorldMatrix();
+        refreshLocalToWorldMatrix();
+    }
+
+    void Entity::refreshLocalToWorldMatrix(const glm::mat4 *localMatrix) const
+    {
+        bool parentChanged = parent != cachedParent || (parent && parent->worldVersion != parentVersion);
+        if (!transformDirty && !parentChanged)
+            return;
+        glm::mat4 local = localMatrix ? *localMatrix : localTransform.toMat4();
+        localToWorld = parent ? parent->localToWorld * local : local;
+        cachedParent = parent;
+        parentVersion = parent ? parent->worldVersion : 0;
+        transformDirty = false;
+        ++worldVersion;
+    }
+
+    void Entity::attachComponent(ComponentTypeID id, Component *component)
+    {
+        component->owner = this;
+        components[id] = component;
+        ComponentMask oldMask = componentMask;
+        componentMask.set(id);
+        world->updateViews(this, oldMask, componentMask);
+    }
+
+    void Entity::setParent(Entity *newParent)
+    {
+        world->setParent(this, newParent);
+    }
+
+    // Since the components are stored in the world's pools, we release them there
+    Entity::~Entity()
+    {
+        for (ComponentTypeID id = 0; id < MAX_COMPONENT_TYPES; ++id)
         {
-            transformationMatrix = myParent->localTransform.toMat4() * transformationMatrix;
-            myParent = myParent->parent;
+            if (componentMask.test(id))
+                world->removeComponent(id, components[id]);
         }
-        // return glm::mat4(1.0f);
-        return transformationMatrix;
     }
 
     // Deserializes the entity data and components from a json object
@@ -31,7 +64,7 @@ namespace our
         if (!data.is_object())
             return;
         name = data.value("name", name);
-        localTransform.deserialize(data);
+        modifyLocalTransform().deserialize(data);
         if (data.contains("components"))
         {
             if (const auto &components = data["components"]; components.is_array())
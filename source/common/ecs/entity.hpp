@@ -2,7 +2,8 @@
 
 #include "component.hpp"
 #include "transform.hpp"
-#include <unordered_map>
+#include <array>
+#include <cstdint>
 #include <string>
 #include <type_traits>
 #include <glm/glm.hpp>
@@ -12,75 +13,164 @@ namespace our
 
     class World; // A forward declaration of the World Class
 
+    // A handle is a weak reference to an entity that can be safely kept across frames.
+    // It packs the index of the entity's slot in the world's entity pool (the lower INDEX_BITS bits)
+    // and the generation of that slot (the remaining upper bits).
+    // Whenever an entity is deleted, the generation of its slot is incremented so every handle to it becomes invalid
+    // and "World::get" returns a nullptr for it instead of a dangling pointer.
+    // NOTE: the generation wraps around after 2^GENERATION_BITS deletions of the same slot.
+    struct EntityHandle
+    {
+        static constexpr std::uint32_t INDEX_BITS = 22;
+        static constexpr std::uint32_t GENERATION_BITS = 32 - INDEX_BITS;
+        static constexpr std::uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+        static constexpr std::uint32_t GENERATION_MASK = (1u << GENERATION_BITS) - 1;
+
+        std::uint32_t value = ~0u; // By default, the handle is null (it refers to no entity)
+
+        EntityHandle() = default;
+        EntityHandle(std::uint32_t index, std::uint32_t generation) : value((generation & GENERATION_MASK) << INDEX_BITS | (index & INDEX_MASK)) {}
+
+        std::uint32_t index() const { return value & INDEX_MASK; }
+        std::uint32_t generation() const { return value >> INDEX_BITS; }
+        bool isNull() const { return value == ~0u; }
+
+        bool operator==(const EntityHandle &other) const { return value == other.value; }
+        bool operator!=(const EntityHandle &other) const { return value != other.value; }
+    };
+
     class Entity
     {
-        World *world;                                            // This defines what world own this entity
-        std::unordered_map<std::string, Component *> components; // A map of components that are owned by this entity
-                                                                 // The key is the ID of the component so an entity can only have one component of each type
+        World *world;                                                // This defines what world own this entity
+        EntityHandle handle;                                         // The handle of this entity in the world's entity pool
+        std::uint32_t denseIndex = 0;                                // The index of this entity in the world's dense array of entities
+        bool pendingRemoval = false;                                 // Is this entity marked for removal
+        ComponentMask componentMask;                                 // Bit i is set if the entity holds a component whose type ID is i
+        std::array<Component *, MAX_COMPONENT_TYPES> components = {}; // The components that are owned by this entity
+                                                                     // The index is the type ID of the component so an entity can only have one component of each type
+
+        Transform localTransform; // The transform of this entity relative to its parent.
+                                  // It is private so that every modification goes through the functions below and marks the transform as dirty
+
+        // The local to world matrix is cached and only recomputed when the local transform of this entity
+        // (or the local to world matrix of its parent) changes
+        mutable glm::mat4 localToWorld = glm::mat4(1.0f); // The cached local to world matrix
+        mutable bool transformDirty = true;               // Is the local transform modified since the last time we computed "localToWorld"
+        mutable std::uint32_t worldVersion = 0;           // Incremented every time "localToWorld" is recomputed
+        mutable std::uint32_t parentVersion = 0;          // The "worldVersion" of the parent when we last computed "localToWorld"
+        mutable const Entity *cachedParent = nullptr;     // The parent used when we last computed "localToWorld" (it is only compared, never dereferenced)
+
+        // The hierarchy is stored in the entities themselves, so building it never allocates:
+        // each entity links to its parent, its first & last children and its previous & next siblings.
+        // The world also keeps all the entities in a flat depth-first order (parents before their children),
+        // where the subtree of an entity is the "subtreeSize" entities starting at "hierarchyIndex" (see "World::getHierarchyOrder").
+        Entity *parent = nullptr;          // The parent of the entity. If parent is null, the entity is a root entity (has no parent).
+        Entity *firstChild = nullptr;      // The first child of this entity
+        Entity *lastChild = nullptr;       // The last child of this entity
+        Entity *previousSibling = nullptr; // The child of the parent before this entity
+        Entity *nextSibling = nullptr;     // The child of the parent after this entity
+        std::uint32_t childCount = 0;      // The number of children of this entity
+        std::uint32_t hierarchyIndex = 0;  // The index of this entity in the world's hierarchy order
+        std::uint32_t subtreeSize = 1;     // The number of entities in the subtree of this entity (including itself)
+
+        // Recomputes the cached local to world matrix if needed assuming that the matrix of the parent is up to date
+        // If the matrix of the local transform was already computed (e.g. by the batched kernel), it is given in "localMatrix"
+        void refreshLocalToWorldMatrix(const glm::mat4 *localMatrix = nullptr) const;
+        // Sets the given component (of the type identified by "id") as the component of this entity and updates the world's views
+        void attachComponent(ComponentTypeID id, Component *component);
 
         friend World;       // The world is a friend since it is the only class that is allowed to instantiate an entity
         Entity() = default; // The entity constructor is private since only the world is allowed to instantiate an entity
     public:
-        std::string name;         // The name of the entity. It could be useful to refer to an entity by its name
-        Entity *parent;           // The parent of the entity. The transform of the entity is relative to its parent.
-                                  // If parent is null, the entity is a root entity (has no parent).
-        Transform localTransform; // The transform of this entity relative to its parent.
+        std::string name; // The name of the entity. It could be useful to refer to an entity by its name
         Transform lastNonCollidedLocalTransform;
 
-        World *getWorld() const { return world; } // Returns the world to which this entity belongs
+        World *getWorld() const { return world; }          // Returns the world to which this entity belongs
+        EntityHandle getHandle() const { return handle; } // Returns a handle that can be stored to refer to this entity later
+
+        // Returns the parent of the entity (or nullptr if it is a root entity). The transform of the entity is relative to its parent.
+        Entity *getParent() const { return parent; }
+        // Changes the parent of the entity (nullptr makes it a root entity). The entity becomes the last child of its new parent.
+        // The whole subtree of the entity moves with it. See "World::setParent" for more details.
+        void setParent(Entity *newParent);
+        // Returns the first child of this entity (or nullptr if it has no children)
+        // The other children can be visited by following "getNextSibling" until it returns nullptr
+        Entity *getFirstChild() const { return firstChild; }
+        // Returns the next child of the parent of this entity (or nullptr if this is the last child)
+        Entity *getNextSibling() const { return nextSibling; }
+        // Returns the number of children of this entity
+        std::uint32_t getChildCount() const { return childCount; }
+
+        // Returns the transform of this entity relative to its parent (read only)
+        const Transform &getLocalTransform() const { return localTransform; }
+        // Returns the transform of this entity relative to its parent to be modified and marks it as dirty
+        // The returned reference should only be used to modify the transform right away (not stored for later frames)
+        Transform &modifyLocalTransform()
+        {
+            transformDirty = true;
+            return localTransform;
+        }
+        // Replaces the transform of this entity relative to its parent and marks it as dirty
+        void setLocalTransform(const Transform &transform)
+        {
+            localTransform = transform;
+            transformDirty = true;
+        }
 
-        glm::mat4 getLocalToWorldMatrix() const;  // Computes and returns the transformation from the entities local space to the world space
+        // Recomputes the cached local to world matrix if this entity or any of its ancestors has changed
+        // Each matrix is recomputed at most once per change, parents before their children
+        void updateLocalToWorldMatrix() const;
+        // Returns the transformation from the entities local space to the world space
+        // The matrix is cached so calling this function repeatedly is cheap
+        const glm::mat4 &getLocalToWorldMatrix() const
+        {
+            updateLocalToWorldMatrix();
+            return localToWorld;
+        }
         void deserialize(const nlohmann::json &); // Deserializes the entity data and components from a json object
 
+        // Returns the bitmask of the component types held by this entity
+        const ComponentMask &getComponentMask() const { return componentMask; }
+
         // This template method create a component of type T,
-        // adds it to the components map and returns a pointer to it
+        // adds it to the components array and returns a pointer to it
+        // The component itself is stored in the world's component pool of type T (see "world.hpp")
         template <typename T>
-        T *addComponent()
-        {
-            static_assert(std::is_base_of<Component, T>::value, "T must inherit from Component");
-            T *component = new T();
-            component->owner = this;
-            components[T::getID()] = component;
-            return component;
-        }
+        T *addComponent();
 
         // This template method searhes for a component of type T and returns a pointer to it
         // If no component of type T was found, it returns a nullptr
+        // The search is just a bit test followed by an array access
         template <typename T>
         T *getComponent()
         {
             static_assert(std::is_base_of<Component, T>::value, "T must inherit from Component");
-            if (auto it = components.find(static_cast<std::string>(T::getID())); it != components.end())
-            {
-                return dynamic_cast<T *>(it->second);
-            }
-            return nullptr;
+            ComponentTypeID id = getComponentTypeID<T>();
+            return componentMask.test(id) ? static_cast<T *>(components[id]) : nullptr;
         }
 
-        // This template method searhes for a component of type T and deletes it
+        // This template method returns true if the entity holds a component of type T
         template <typename T>
-        void deleteComponent()
+        bool hasComponent() const
         {
             static_assert(std::is_base_of<Component, T>::value, "T must inherit from Component");
-            if (auto it = components.find(static_cast<std::string>(T::getID())); it != components.end())
-            {
-                delete it->second;
-                components.erase(it);
-            }
+            return componentMask.test(getComponentTypeID<T>());
         }
 
-        // Since the entity owns its components, they should be deleted alongside the entity
-        ~Entity()
-        {
-            for (auto &it : components)
-            {
-                delete it.second;
-            }
-        }
+        // This template method searhes for a component of type T and deletes it
+        template <typename T>
+        void deleteComponent();
+
+        // Since the entity owns its components, they should be removed from the world's pools alongside the entity
+        ~Entity();
 
         // Entities should not be copyable
         Entity(const Entity &) = delete;
         Entity &operator=(Entity const &) = delete;
     };
 
-}
\ No newline at end of file
+}
+
+// The template methods of the entity need the complete definition of the world (since the components are stored there)
+// So they are defined at the end of "world.hpp" which we include here.
+#include "world.hpp"
\ No newline at end of file
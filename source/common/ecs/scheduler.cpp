@@ -0,0 +1,87 @@
+#include "scheduler.hpp"
+
+namespace our
+{
+
+    // Returns true if "writer" modifies transforms that "other" reads or modifies
+    // Modifying the transform of an entity also moves its descendants (their local to world matrices depend on it),
+    // so the writer conflicts with the other system if the other system touches an entity in the subtree of an entity that the writer modifies.
+    // This is checked by scanning the hierarchy (instead of using views) so that the check does not create a view cache for every pair of filters.
+    static bool transformsConflict(World *world, const SystemAccess &writer, const SystemAccess &other)
+    {
+        if (!writer.writesTransforms)
+            return false;
+        auto check = [&](const ComponentMask &filter)
+        {
+            return world->anyInSubtreeOf(writer.transformWriteFilter, filter);
+        };
+        return (other.writesTransforms && check(other.transformWriteFilter)) ||
+               (other.readsTransforms && check(other.transformReadFilter));
+    }
+
+    bool SystemScheduler::conflicts(World *world, const SystemAccess &first, const SystemAccess &second)
+    {
+        if ((first.writes & (second.reads | second.writes)).any() || (second.writes & first.reads).any())
+            return true;
+        return transformsConflict(world, first, second) || transformsConflict(world, second, first);
+    }
+
+    void SystemScheduler::add(const std::string &name, const SystemAccess &access, std::function<void(float)> update)
+    {
+        systems.push_back({name, access, std::move(update)});
+    }
+
+    void SystemScheduler::launch(size_t index)
+    {
+        auto job = [this, index]()
+        { execute(index); };
+        if (systems[index].access.mainThread)
+            jobs->submitToMainThread(job, &counter);
+        else
+            jobs->submit(job, &counter);
+    }
+
+    void SystemScheduler::execute(size_t index)
+    {
+        systems[index].update(deltaTime);
+        // The dependents are launched before this job is counted as done, so the counter never reaches 0 too early
+        for (size_t dependent : dependents[index])
+            if (pendingCounts[dependent].fetch_sub(1, std::memory_order_acq_rel) == 1)
+                launch(dependent);
+    }
+
+    void SystemScheduler::run(World *world, float deltaTime)
+    {
+        size_t count = systems.size();
+        this->deltaTime = deltaTime;
+
+        // First, we build the dependency graph
+        // Each system depends on the systems that were added before it and conflict with it
+        dependents.assign(count, {});
+        pendingCounts.reset(new std::atomic<size_t>[count]);
+        for (size_t second = 0; second < count; ++second)
+        {
+            size_t dependencies = 0;
+            for (size_t first = 0; first < second; ++first)
+            {
+                if (conflicts(world, systems[first].access, systems[second].access))
+                {
+                    dependents[first].push_back(second);
+                    ++dependencies;
+                }
+            }
+            pendingCounts[second].store(dependencies, std::memory_order_relaxed);
+        }
+        // Then we launch the systems that have no dependencies
+        for (size_t index = 0; index < count; ++index)
+            if (pendingCounts[index].load(std::memory_order_relaxed) == 0)
+                launch(index);
+
+        // While waiting, this thread runs the main thread systems and helps with the other jobs
+        jobs->wait(counter);
+
+        // Now that no system is running, this is the sync point where the structural changes recorded by the systems are applied
+        world->applyCommands();
+    }
+
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <functional>
+#include <atomic>
+#include <memory>
+#include "world.hpp"
+#include "../jobs/job-system.hpp"
+
+namespace our
+{
+
+    // This struct describes which data a system touches so that the scheduler can find out which systems can run at the same time
+    // - "reads" & "writes" are the component types that the system reads and modifies.
+    // - Since the transforms are stored in the entities (not in components), the system also declares whether it reads or modifies transforms
+    //   and the components that an entity must have for its transform to be touched (e.g. the movement system only modifies the transforms
+    //   of the entities that have a MovementComponent). An empty filter means that any transform can be touched.
+    // - If "mainThread" is true, the system is always run on the thread that called "SystemScheduler::run"
+    //   (e.g. systems that use the window, the input or OpenGL).
+    // Example: SystemAccess().read<MovementComponent>().writeTransforms<MovementComponent>()
+    struct SystemAccess
+    {
+        ComponentMask reads, writes;
+        bool readsTransforms = false, writesTransforms = false;
+        ComponentMask transformReadFilter, transformWriteFilter;
+        bool mainThread = false;
+
+        template <typename... Ts>
+        SystemAccess &read()
+        {
+            reads |= getComponentMask<Ts...>();
+            return *this;
+        }
+
+        template <typename... Ts>
+        SystemAccess &write()
+        {
+            writes |= getComponentMask<Ts...>();
+            return *this;
+        }
+
+        // Declares that the system reads the transforms of the entities that have all the components Ts (or any entity if Ts is empty)
+        // If called more than once, only the components common to all the filters are kept (which may only widen the set of entities)
+        template <typename... Ts>
+        SystemAccess &readTransforms()
+        {
+            transformReadFilter = readsTransforms ? (transformReadFilter & getComponentMask<Ts...>()) : getComponentMask<Ts...>();
+            readsTransforms = true;
+            return *this;
+        }
+
+        // Declares that the system modifies the transforms of the entities that have all the components Ts (or any entity if Ts is empty)
+        template <typename... Ts>
+        SystemAccess &writeTransforms()
+        {
+            transformWriteFilter = writesTransforms ? (transformWriteFilter & getComponentMask<Ts...>()) : getComponentMask<Ts...>();
+            writesTransforms = true;
+            return *this;
+        }
+
+        SystemAccess &onMainThread()
+        {
+            mainThread = true;
+            return *this;
+        }
+    };
+
+    // The system scheduler runs a list of systems every frame using a job system.
+    // Every frame, it builds a dependency graph where a system depends on every system that was added before it and conflicts with it
+    // (two systems conflict if one of them modifies data that the other one reads or modifies).
+    // Then the systems are run as soon as all of their dependencies are done, so systems that touch different data run concurrently,
+    // while conflicting systems keep the order in which they were added.
+    // The graph is rebuilt every frame since whether two transform filters overlap depends on the entities in the world.
+    class SystemScheduler
+    {
+        // A system is stored as a function that takes the delta time (so it can wrap any system regardless of its update signature)
+        struct ScheduledSystem
+        {
+            std::string name;
+            SystemAccess access;
+            std::function<void(float)> update;
+        };
+        std::vector<ScheduledSystem> systems;
+        JobSystem *jobs;
+
+        // The state of the current run
+        std::vector<std::vector<size_t>> dependents;          // For each system, the systems that wait for it
+        std::unique_ptr<std::atomic<size_t>[]> pendingCounts; // For each system, the number of dependencies that are not done yet
+        JobCounter counter;                                   // Counts the systems that were launched and are not done yet
+        float deltaTime = 0;
+
+        // Sends a system whose dependencies are done to the job system (as a main thread job if needed)
+        void launch(size_t index);
+        // Runs a system then launches the systems that were waiting for it
+        void execute(size_t index);
+
+    public:
+        // The scheduler runs its systems on the given job system (which must outlive the scheduler)
+        explicit SystemScheduler(JobSystem *jobs = &JobSystem::get()) : jobs(jobs) {}
+
+        // Adds a system to the scheduler. The order of addition is the order in which conflicting systems run.
+        void add(const std::string &name, const SystemAccess &access, std::function<void(float)> update);
+
+        // Removes all the systems
+        void clear() { systems.clear(); }
+
+        // Returns true if the two systems cannot run at the same time in the given world
+        static bool conflicts(World *world, const SystemAccess &first, const SystemAccess &second);
+
+        // Runs all the systems once and returns after all of them are done
+        // Then the commands that the systems recorded in the world's command buffers are applied
+        // (systems must not create or destroy entities or add or remove components directly, since other systems may be iterating over them)
+        // It should be called from the main thread of the job system so that the main thread systems can run
+        void run(World *world, float deltaTime);
+    };
+
+}
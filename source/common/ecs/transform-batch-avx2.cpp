@@ -0,0 +1,74 @@
+// This file is compiled with AVX2 & FMA enabled (see CMakeLists.txt)
+// so it must only be called after checking that the processor supports them (see "getBestSimdLevel")
+
+#include "transform-batch-kernel.hpp"
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+
+namespace our {
+
+    // The AVX2 wrappers used by the kernel (8 lanes)
+    struct SimdAVX2 {
+        typedef __m256 F;
+        typedef __m256i I;
+        static constexpr size_t WIDTH = 8;
+
+        static F load(const float* pointer) { return _mm256_loadu_ps(pointer); }
+        static F set1(float value) { return _mm256_set1_ps(value); }
+        static I set1i(int value) { return _mm256_set1_epi32(value); }
+        static F add(F a, F b) { return _mm256_add_ps(a, b); }
+        static F sub(F a, F b) { return _mm256_sub_ps(a, b); }
+        static F mul(F a, F b) { return _mm256_mul_ps(a, b); }
+        static F multiplyAdd(F a, F b, F c) { return _mm256_fmadd_ps(a, b, c); }
+        static F bitAnd(F a, F b) { return _mm256_and_ps(a, b); }
+        static F bitAndNot(F a, F b) { return _mm256_andnot_ps(a, b); }
+        static F bitXor(F a, F b) { return _mm256_xor_ps(a, b); }
+        static F select(F mask, F a, F b) { return _mm256_blendv_ps(b, a, mask); }
+        static I toInt(F a) { return _mm256_cvttps_epi32(a); }
+        static F toFloat(I a) { return _mm256_cvtepi32_ps(a); }
+        static F castToFloat(I a) { return _mm256_castsi256_ps(a); }
+        static I addi(I a, I b) { return _mm256_add_epi32(a, b); }
+        static I subi(I a, I b) { return _mm256_sub_epi32(a, b); }
+        static I andi(I a, I b) { return _mm256_and_si256(a, b); }
+        static I andNoti(I a, I b) { return _mm256_andnot_si256(a, b); }
+        static I equali(I a, I b) { return _mm256_cmpeq_epi32(a, b); }
+        static I shiftLeft29(I a) { return _mm256_slli_epi32(a, 29); }
+
+        // Transposes the 4 vectors (the x, y, z & w of a column for 8 transforms) and stores the column of each of the 8 matrices
+        // Each 128-bit half holds 4 transforms, so the halves are transposed like in the SSE2 kernel
+        static void storeColumn(F vectors[4], float* matrices, int column) {
+            for(int half = 0; half < 2; ++half) {
+                __m128 x = half ? _mm256_extractf128_ps(vectors[0], 1) : _mm256_castps256_ps128(vectors[0]);
+                __m128 y = half ? _mm256_extractf128_ps(vectors[1], 1) : _mm256_castps256_ps128(vectors[1]);
+                __m128 z = half ? _mm256_extractf128_ps(vectors[2], 1) : _mm256_castps256_ps128(vectors[2]);
+                __m128 w = half ? _mm256_extractf128_ps(vectors[3], 1) : _mm256_castps256_ps128(vectors[3]);
+                _MM_TRANSPOSE4_PS(x, y, z, w);
+                float* group = matrices + 16 * 4 * half + 4 * column;
+                _mm_storeu_ps(group, x);
+                _mm_storeu_ps(group + 16, y);
+                _mm_storeu_ps(group + 32, z);
+                _mm_storeu_ps(group + 48, w);
+            }
+        }
+    };
+
+    bool computeMatricesAVX2(const kernel::TransformArrays& batch, float* matrices, size_t count) {
+        kernel::computeMatrices<SimdAVX2>(batch, matrices, 0, count);
+        return true;
+    }
+
+}
+
+#else
+
+namespace our {
+
+    // This build has no AVX2 kernel
+    bool computeMatricesAVX2(const kernel::TransformArrays&, float*, size_t) {
+        return false;
+    }
+
+}
+
+#endif
@@ -0,0 +1,126 @@
+#pragma once
+
+// This file is only included by "transform-batch.cpp" & "transform-batch-avx2.cpp"
+// It holds the batched kernel written once for any vector width.
+// The kernel is a template over a "Simd" struct which wraps the intrinsics of an instruction set:
+// - Simd::F is a vector of floats and Simd::I is a vector of 32-bit integers with Simd::WIDTH lanes
+// - The static functions are thin wrappers around the intrinsics (add, mul, and, ...)
+// WARNING: This file must not use any inline function from another header (e.g. glm or std::vector).
+// Since "transform-batch-avx2.cpp" is compiled with AVX2 enabled, any inline function it uses could be compiled with AVX2 instructions
+// and the linker may then pick that version for the whole program (which would crash on processors without AVX2).
+// That is why the kernel only works on raw pointers.
+
+#include <cstddef>
+
+namespace our::kernel {
+
+    // Pointers to the arrays of a transform batch (see "TransformBatch")
+    struct TransformArrays {
+        const float *positionX, *positionY, *positionZ;
+        const float *rotationX, *rotationY, *rotationZ;
+        const float *scaleX, *scaleY, *scaleZ;
+    };
+
+    // Computes the sine & cosine of every lane of x at once
+    // This is the Cephes single precision algorithm (also used by the well known "sse_mathfun"):
+    // x is reduced to [-pi/4, pi/4] using the octant of x, then a polynomial for sin and one for cos are evaluated
+    // and the right one is picked (with the right sign) for each lane based on the octant.
+    // The maximum error is around 1e-7 for |x| < 8192 which is more than enough for Euler angles.
+    template<typename Simd>
+    inline void sincos(typename Simd::F x, typename Simd::F& sine, typename Simd::F& cosine) {
+        using F = typename Simd::F;
+        using I = typename Simd::I;
+        const F signMask = Simd::castToFloat(Simd::set1i(int(0x80000000)));
+
+        F signSine = Simd::bitAnd(x, signMask);
+        x = Simd::bitAndNot(signMask, x); // |x|
+
+        // The octant of |x| rounded up to an even number (so that the reduced x is in [-pi/4, pi/4])
+        I octant = Simd::toInt(Simd::mul(x, Simd::set1(1.27323954473516f))); // 4 / pi
+        octant = Simd::addi(octant, Simd::set1i(1));
+        octant = Simd::andi(octant, Simd::set1i(~1));
+        F y = Simd::toFloat(octant);
+
+        // Octants 4 to 7 flip the sign of the sine, octants 2 to 5 flip the sign of the cosine
+        F swapSignSine = Simd::castToFloat(Simd::shiftLeft29(Simd::andi(octant, Simd::set1i(4))));
+        F signCosine = Simd::castToFloat(Simd::shiftLeft29(Simd::andNoti(Simd::subi(octant, Simd::set1i(2)), Simd::set1i(4))));
+        signSine = Simd::bitXor(signSine, swapSignSine);
+        // In octants 2, 3, 6 & 7, the sine & cosine polynomials are swapped
+        F polynomialMask = Simd::castToFloat(Simd::equali(Simd::andi(octant, Simd::set1i(2)), Simd::set1i(0)));
+
+        // The extended precision modular arithmetic: x = ((x - y * DP1) - y * DP2) - y * DP3
+        x = Simd::multiplyAdd(y, Simd::set1(-0.78515625f), x);
+        x = Simd::multiplyAdd(y, Simd::set1(-2.4187564849853515625e-4f), x);
+        x = Simd::multiplyAdd(y, Simd::set1(-3.77489497744594108e-8f), x);
+
+        F z = Simd::mul(x, x);
+        // The cosine polynomial for x in [-pi/4, pi/4]
+        F polynomialCosine = Simd::set1(2.443315711809948e-5f);
+        polynomialCosine = Simd::multiplyAdd(polynomialCosine, z, Simd::set1(-1.388731625493765e-3f));
+        polynomialCosine = Simd::multiplyAdd(polynomialCosine, z, Simd::set1(4.166664568298827e-2f));
+        polynomialCosine = Simd::mul(Simd::mul(polynomialCosine, z), z);
+        polynomialCosine = Simd::multiplyAdd(z, Simd::set1(-0.5f), polynomialCosine);
+        polynomialCosine = Simd::add(polynomialCosine, Simd::set1(1.0f));
+        // The sine polynomial for x in [-pi/4, pi/4]
+        F polynomialSine = Simd::set1(-1.9515295891e-4f);
+        polynomialSine = Simd::multiplyAdd(polynomialSine, z, Simd::set1(8.3321608736e-3f));
+        polynomialSine = Simd::multiplyAdd(polynomialSine, z, Simd::set1(-1.6666654611e-1f));
+        polynomialSine = Simd::multiplyAdd(Simd::mul(polynomialSine, z), x, x);
+
+        sine = Simd::select(polynomialMask, polynomialSine, polynomialCosine);
+        cosine = Simd::select(polynomialMask, polynomialCosine, polynomialSine);
+        sine = Simd::bitXor(sine, signSine);
+        cosine = Simd::bitXor(cosine, signCosine);
+    }
+
+    // Computes the matrices of the transforms [begin, begin + count) where count is a multiple of Simd::WIDTH
+    // The matrices are written as 16 floats each in column major order (the layout of glm::mat4)
+    // The matrix is translation * yawPitchRoll(rotation.y, rotation.x, rotation.z) * scale, so the columns are:
+    // column 0 = R[0] * scale.x, column 1 = R[1] * scale.y, column 2 = R[2] * scale.z, column 3 = (position, 1)
+    template<typename Simd>
+    inline void computeMatrices(const TransformArrays& batch, float* matrices, size_t begin, size_t count) {
+        using F = typename Simd::F;
+        const F zero = Simd::set1(0.0f), one = Simd::set1(1.0f);
+        for(size_t index = begin; index < begin + count; index += Simd::WIDTH) {
+            F sh, ch, sp, cp, sb, cb; // The sine & cosine of the yaw (heading), pitch and roll (bank)
+            sincos<Simd>(Simd::load(batch.rotationY + index), sh, ch);
+            sincos<Simd>(Simd::load(batch.rotationX + index), sp, cp);
+            sincos<Simd>(Simd::load(batch.rotationZ + index), sb, cb);
+            F sx = Simd::load(batch.scaleX + index);
+            F sy = Simd::load(batch.scaleY + index);
+            F sz = Simd::load(batch.scaleZ + index);
+            F shsp = Simd::mul(sh, sp), chsp = Simd::mul(ch, sp);
+
+            // Each column is stored as 4 vectors (x, y, z, w) then transposed into the matrices
+            F columns[4][4] = {
+                {
+                    Simd::mul(Simd::multiplyAdd(shsp, sb, Simd::mul(ch, cb)), sx),
+                    Simd::mul(Simd::mul(sb, cp), sx),
+                    Simd::mul(Simd::multiplyAdd(chsp, sb, Simd::mul(Simd::sub(zero, sh), cb)), sx),
+                    zero
+                },
+                {
+                    Simd::mul(Simd::multiplyAdd(shsp, cb, Simd::mul(Simd::sub(zero, ch), sb)), sy),
+                    Simd::mul(Simd::mul(cb, cp), sy),
+                    Simd::mul(Simd::multiplyAdd(chsp, cb, Simd::mul(sb, sh)), sy),
+                    zero
+                },
+                {
+                    Simd::mul(Simd::mul(sh, cp), sz),
+                    Simd::mul(Simd::sub(zero, sp), sz),
+                    Simd::mul(Simd::mul(ch, cp), sz),
+                    zero
+                },
+                {
+                    Simd::load(batch.positionX + index),
+                    Simd::load(batch.positionY + index),
+                    Simd::load(batch.positionZ + index),
+                    one
+                }
+            };
+            for(int column = 0; column < 4; ++column)
+                Simd::storeColumn(columns[column], matrices + 16 * index, column);
+        }
+    }
+
+}
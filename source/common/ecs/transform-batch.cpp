@@ -0,0 +1,168 @@
+#include "transform-batch.hpp"
+#include "transform-batch-kernel.hpp"
+
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TRANSFORM_BATCH_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace our {
+
+    // Defined in "transform-batch-avx2.cpp" which is the only file compiled with AVX2 enabled
+    // It returns false if the file was compiled without AVX2 (e.g. on a different architecture)
+    bool computeMatricesAVX2(const kernel::TransformArrays& batch, float* matrices, size_t count);
+
+    void TransformBatch::clear() {
+        for(auto array : {&positionX, &positionY, &positionZ, &rotationX, &rotationY, &rotationZ, &scaleX, &scaleY, &scaleZ})
+            array->clear();
+    }
+
+    void TransformBatch::reserve(size_t count) {
+        for(auto array : {&positionX, &positionY, &positionZ, &rotationX, &rotationY, &rotationZ, &scaleX, &scaleY, &scaleZ})
+            array->reserve(count);
+    }
+
+    void TransformBatch::push(const Transform& transform) {
+        positionX.push_back(transform.position.x);
+        positionY.push_back(transform.position.y);
+        positionZ.push_back(transform.position.z);
+        rotationX.push_back(transform.rotation.x);
+        rotationY.push_back(transform.rotation.y);
+        rotationZ.push_back(transform.rotation.z);
+        scaleX.push_back(transform.scale.x);
+        scaleY.push_back(transform.scale.y);
+        scaleZ.push_back(transform.scale.z);
+    }
+
+    Transform TransformBatch::get(size_t index) const {
+        Transform transform;
+        transform.position = glm::vec3(positionX[index], positionY[index], positionZ[index]);
+        transform.rotation = glm::vec3(rotationX[index], rotationY[index], rotationZ[index]);
+        transform.scale = glm::vec3(scaleX[index], scaleY[index], scaleZ[index]);
+        return transform;
+    }
+
+#if defined(TRANSFORM_BATCH_SSE2)
+    // The SSE2 wrappers used by the kernel (4 lanes)
+    struct SimdSSE2 {
+        typedef __m128 F;
+        typedef __m128i I;
+        static constexpr size_t WIDTH = 4;
+
+        static F load(const float* pointer) { return _mm_loadu_ps(pointer); }
+        static F set1(float value) { return _mm_set1_ps(value); }
+        static I set1i(int value) { return _mm_set1_epi32(value); }
+        static F add(F a, F b) { return _mm_add_ps(a, b); }
+        static F sub(F a, F b) { return _mm_sub_ps(a, b); }
+        static F mul(F a, F b) { return _mm_mul_ps(a, b); }
+        static F multiplyAdd(F a, F b, F c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+        static F bitAnd(F a, F b) { return _mm_and_ps(a, b); }
+        static F bitAndNot(F a, F b) { return _mm_andnot_ps(a, b); }
+        static F bitXor(F a, F b) { return _mm_xor_ps(a, b); }
+        static F select(F mask, F a, F b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+        static I toInt(F a) { return _mm_cvttps_epi32(a); }
+        static F toFloat(I a) { return _mm_cvtepi32_ps(a); }
+        static F castToFloat(I a) { return _mm_castsi128_ps(a); }
+        static I addi(I a, I b) { return _mm_add_epi32(a, b); }
+        static I subi(I a, I b) { return _mm_sub_epi32(a, b); }
+        static I andi(I a, I b) { return _mm_and_si128(a, b); }
+        static I andNoti(I a, I b) { return _mm_andnot_si128(a, b); }
+        static I equali(I a, I b) { return _mm_cmpeq_epi32(a, b); }
+        static I shiftLeft29(I a) { return _mm_slli_epi32(a, 29); }
+
+        // Transposes the 4 vectors (the x, y, z & w of a column for 4 transforms) and stores the column of each of the 4 matrices
+        static void storeColumn(F vectors[4], float* matrices, int column) {
+            F x = vectors[0], y = vectors[1], z = vectors[2], w = vectors[3];
+            _MM_TRANSPOSE4_PS(x, y, z, w);
+            _mm_storeu_ps(matrices + 4 * column, x);
+            _mm_storeu_ps(matrices + 16 + 4 * column, y);
+            _mm_storeu_ps(matrices + 32 + 4 * column, z);
+            _mm_storeu_ps(matrices + 48 + 4 * column, w);
+        }
+    };
+#endif
+
+    // Returns true if the processor and the operating system support AVX2 & FMA
+    static bool isAVX2Supported() {
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+        int info[4];
+        __cpuid(info, 0);
+        if(info[0] < 7) return false;
+        __cpuid(info, 1);
+        bool fma = (info[2] & (1 << 12)) != 0, osxsave = (info[2] & (1 << 27)) != 0;
+        if(!fma || !osxsave || (_xgetbv(0) & 0x6) != 0x6) return false;
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        return false;
+#endif
+    }
+
+    SimdLevel getBestSimdLevel() {
+        static const SimdLevel level = [](){
+            // The AVX2 kernel is only available if its file was compiled with AVX2 enabled
+            if(isAVX2Supported() && computeMatricesAVX2(kernel::TransformArrays{}, nullptr, 0)) return SimdLevel::AVX2;
+#if defined(TRANSFORM_BATCH_SSE2)
+            return SimdLevel::SSE2;
+#else
+            return SimdLevel::SCALAR;
+#endif
+        }();
+        return level;
+    }
+
+    // Computes the matrices of the transforms [begin, end) one at a time, using the same formulas as the kernel
+    static void computeMatricesScalar(const TransformBatch& batch, glm::mat4* matrices, size_t begin, size_t end) {
+        for(size_t index = begin; index < end; ++index) {
+            float sh = std::sin(batch.rotationY[index]), ch = std::cos(batch.rotationY[index]);
+            float sp = std::sin(batch.rotationX[index]), cp = std::cos(batch.rotationX[index]);
+            float sb = std::sin(batch.rotationZ[index]), cb = std::cos(batch.rotationZ[index]);
+            float sx = batch.scaleX[index], sy = batch.scaleY[index], sz = batch.scaleZ[index];
+            glm::mat4& matrix = matrices[index];
+            matrix[0] = glm::vec4(ch * cb + sh * sp * sb, sb * cp, -sh * cb + ch * sp * sb, 0.0f) * sx;
+            matrix[1] = glm::vec4(-ch * sb + sh * sp * cb, cb * cp, sb * sh + ch * sp * cb, 0.0f) * sy;
+            matrix[2] = glm::vec4(sh * cp, -sp, ch * cp, 0.0f) * sz;
+            matrix[3] = glm::vec4(batch.positionX[index], batch.positionY[index], batch.positionZ[index], 1.0f);
+        }
+    }
+
+    void computeMatrices(const TransformBatch& batch, glm::mat4* matrices, SimdLevel level) {
+        size_t count = batch.size(), done = 0;
+        if(count == 0) return; // "matrices" may be a nullptr (e.g. the data of an empty vector)
+        kernel::TransformArrays arrays = {
+            batch.positionX.data(), batch.positionY.data(), batch.positionZ.data(),
+            batch.rotationX.data(), batch.rotationY.data(), batch.rotationZ.data(),
+            batch.scaleX.data(), batch.scaleY.data(), batch.scaleZ.data()
+        };
+        float* output = reinterpret_cast<float*>(matrices);
+        if(level == SimdLevel::AVX2 && getBestSimdLevel() != SimdLevel::AVX2) level = getBestSimdLevel();
+        if(level == SimdLevel::AVX2) {
+            done = count - count % 8;
+            computeMatricesAVX2(arrays, output, done);
+        }
+#if defined(TRANSFORM_BATCH_SSE2)
+        // The SSE2 kernel handles the transforms left by the AVX2 kernel too (if there are at least 4)
+        if(level != SimdLevel::SCALAR) {
+            size_t sseCount = (count - done) - (count - done) % 4;
+            kernel::computeMatrices<SimdSSE2>(arrays, output, done, sseCount);
+            done += sseCount;
+        }
+#endif
+        computeMatricesScalar(batch, matrices, done, count);
+    }
+
+    void computeMatricesReference(const TransformBatch& batch, glm::mat4* matrices) {
+        for(size_t index = 0; index < batch.size(); ++index)
+            matrices[index] = batch.get(index).toMat4();
+    }
+
+}
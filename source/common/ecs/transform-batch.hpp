@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <glm/glm.hpp>
+#include "transform.hpp"
+
+namespace our {
+
+    // This holds the transforms of many entities as a structure of arrays (SoA)
+    // where each component (e.g. the x of the position) of all the transforms is stored contiguously.
+    // This is the layout that the batched kernel reads since it loads the same component of 4 or 8 transforms at once.
+    struct TransformBatch {
+        std::vector<float> positionX, positionY, positionZ;
+        std::vector<float> rotationX, rotationY, rotationZ; // Euler angles (y: yaw, x: pitch, z: roll) as in "Transform"
+        std::vector<float> scaleX, scaleY, scaleZ;
+
+        size_t size() const { return positionX.size(); }
+        void clear();
+        void reserve(size_t count);
+        // Appends a transform at the end of the batch
+        void push(const Transform& transform);
+        // Returns the transform at the given index
+        Transform get(size_t index) const;
+    };
+
+    // The instruction sets that the batched kernel can use
+    enum class SimdLevel {
+        SCALAR, // Plain C++ (used for the remainder of the batches and on machines without SSE2)
+        SSE2,   // 4 transforms at a time
+        AVX2    // 8 transforms at a time (with FMA)
+    };
+
+    // Returns the best instruction set that the kernel can use on this machine
+    SimdLevel getBestSimdLevel();
+
+    // This computes the matrix of every transform in the batch and writes it to "matrices" (which must hold "batch.size()" matrices)
+    // It computes the same matrix as "Transform::toMat4" (translation * yawPitchRoll * scale) but it builds the composed matrix directly
+    // (without multiplying intermediate matrices) and computes the sine & cosine of the angles of many transforms at once.
+    // The sine & cosine are approximated by polynomials, so the results may differ from "Transform::toMat4" by a few ULPs.
+    // If the requested level is not supported by this machine (or this build), the best supported level is used instead.
+    void computeMatrices(const TransformBatch& batch, glm::mat4* matrices, SimdLevel level = getBestSimdLevel());
+
+    // This computes the matrices one by one using "Transform::toMat4"
+    // It is the reference that the batched kernel is compared against
+    void computeMatricesReference(const TransformBatch& batch, glm::mat4* matrices);
+
+}
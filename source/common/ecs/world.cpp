@@ -1,19 +1,358 @@
 #include "world.hpp"
+#include "../trace/trace.hpp"
+
+#include <cassert>
+#include <new>
+#include <atomic>
+#include <algorithm>
+#include <utility>
 
 namespace our {
 
+    // Every world gets a unique ID so that the threads can tell the worlds apart
+    // (comparing addresses is not enough since a new world can be allocated where a deleted one was)
+    static std::atomic<std::uint64_t> worldCounter{0};
+
+    World::World() : id(++worldCounter) {}
+
+    World::~World(){
+        clear();
+    }
+
     // This will deserialize a json array of entities and add the new entities to the current world
     // If parent pointer is not null, the new entities will be have their parent set to that given pointer
     // If any of the entities has children, this function will be called recursively for these children
     void World::deserialize(const nlohmann::json& data, Entity* parent){
+        // Only the outermost call is traced (the recursive calls are part of it)
+        our::trace::Scope scope(parent == nullptr ? "deserialize world" : nullptr);
         if(!data.is_array()) return;
         for(const auto& entityData : data){
             Entity* entity = add();
-            entity->parent = parent;
+            // Since the entity is added right after its parent's subtree, this never moves any entity in the hierarchy order
+            setParent(entity, parent);
             entity->deserialize(entityData);
             if(entityData.contains("children"))
                 this->deserialize(entityData["children"], entity);
         }
     }
 
+    // This adds an entity to the world and returns a pointer to it
+    // The entity is constructed in a free slot of the entity pool (a new chunk is allocated only if there are no free slots)
+    Entity* World::add(){
+        std::uint32_t index;
+        if(!freeSlots.empty()){
+            index = freeSlots.back();
+            freeSlots.pop_back();
+        } else {
+            index = static_cast<std::uint32_t>(generations.size());
+            assert(index < EntityHandle::INDEX_MASK && "The entity pool is full");
+            if(index % ENTITY_CHUNK_SIZE == 0)
+                entityChunks.push_back(std::make_unique<EntityChunk>());
+            generations.push_back(0);
+        }
+        Entity* entity = new (getSlot(index)) Entity();
+        entity->world = this;
+        entity->handle = EntityHandle(index, generations[index]);
+        entity->denseIndex = static_cast<std::uint32_t>(entities.size());
+        entities.push_back(entity);
+        // A new entity is a root entity, so it is added at the end of the hierarchy order
+        entity->hierarchyIndex = static_cast<std::uint32_t>(hierarchyOrder.size());
+        hierarchyOrder.push_back(entity);
+        return entity;
+    }
+
+    // The marked entities are deleted in three passes:
+    // 1- The descendants of the marked entities are marked too.
+    // 2- The entities are removed from the hierarchy (and the hierarchy order is compacted once).
+    // 3- The entities are destroyed.
+    void World::deleteMarkedEntities(){
+        size_t markedCount = markedForRemoval.size();
+        for(size_t index = 0; index < markedCount; ++index){
+            Entity* entity = markedForRemoval[index];
+            // If the parent is marked, its subtree (which includes this entity) will be marked anyway
+            if(entity->parent && entity->parent->pendingRemoval) continue;
+            for(Entity* descendant : getDescendants(entity)) markForRemoval(descendant);
+        }
+
+        for(auto entity: markedForRemoval){
+            Entity* parent = entity->parent;
+            if(parent && !parent->pendingRemoval){
+                // This is the root of a removed subtree, so we unlink it from its parent
+                // and remove its subtree from the sizes of its ancestors
+                if(entity->previousSibling) entity->previousSibling->nextSibling = entity->nextSibling;
+                else parent->firstChild = entity->nextSibling;
+                if(entity->nextSibling) entity->nextSibling->previousSibling = entity->previousSibling;
+                else parent->lastChild = entity->previousSibling;
+                --parent->childCount;
+                for(Entity* ancestor = parent; ancestor; ancestor = ancestor->parent) ancestor->subtreeSize -= entity->subtreeSize;
+            }
+            hierarchyOrder[entity->hierarchyIndex] = nullptr;
+        }
+        hierarchyOrder.erase(std::remove(hierarchyOrder.begin(), hierarchyOrder.end(), nullptr), hierarchyOrder.end());
+        reindexHierarchy(0, hierarchyOrder.size());
+
+        for(auto entity: markedForRemoval){
+            destroy(entity);
+        }
+        markedForRemoval.clear();
+    }
+
+    void World::setParent(Entity* entity, Entity* parent){
+        if(entity->parent == parent) return;
+        std::uint32_t begin = entity->hierarchyIndex, size = entity->subtreeSize;
+        if(parent){
+            assert(parent->world == this && "The parent must belong to the same world");
+            // We refuse to attach an entity to itself or to one of its descendants
+            if(parent->hierarchyIndex >= begin && parent->hierarchyIndex < begin + size) return;
+        }
+
+        // First, we move the subtree of the entity to the end of the new parent's subtree (or to the end of the hierarchy order for roots)
+        // The sizes are not updated yet, so if the entity is already a descendant of the new parent, "destination" is after the subtree
+        size_t destination = parent ? parent->hierarchyIndex + parent->subtreeSize : hierarchyOrder.size();
+        auto order = hierarchyOrder.begin();
+        if(destination > begin + size){
+            std::rotate(order + begin, order + begin + size, order + destination);
+            reindexHierarchy(begin, destination);
+        } else if(destination < begin){
+            std::rotate(order + destination, order + begin, order + begin + size);
+            reindexHierarchy(destination, begin + size);
+        }
+
+        // Then we update the sizes of the old and the new ancestors
+        for(Entity* ancestor = entity->parent; ancestor; ancestor = ancestor->parent) ancestor->subtreeSize -= size;
+        for(Entity* ancestor = parent; ancestor; ancestor = ancestor->parent) ancestor->subtreeSize += size;
+
+        // Finally, we unlink the entity from its old parent and link it as the last child of the new parent
+        if(Entity* oldParent = entity->parent; oldParent){
+            if(entity->previousSibling) entity->previousSibling->nextSibling = entity->nextSibling;
+            else oldParent->firstChild = entity->nextSibling;
+            if(entity->nextSibling) entity->nextSibling->previousSibling = entity->previousSibling;
+            else oldParent->lastChild = entity->previousSibling;
+            --oldParent->childCount;
+        }
+        entity->previousSibling = entity->nextSibling = nullptr;
+        entity->parent = parent;
+        if(parent){
+            entity->previousSibling = parent->lastChild;
+            if(parent->lastChild) parent->lastChild->nextSibling = entity;
+            else parent->firstChild = entity;
+            parent->lastChild = entity;
+            ++parent->childCount;
+        }
+    }
+
+    void World::updateLocalToWorldMatrices(){
+        // The dirty transforms are gathered in the hierarchy order, so the second pass meets them in the same order
+        dirtyTransforms.clear();
+        for(Entity* entity : hierarchyOrder){
+            if(entity->transformDirty) dirtyTransforms.push(entity->localTransform);
+        }
+        dirtyMatrices.resize(dirtyTransforms.size());
+        computeMatrices(dirtyTransforms, dirtyMatrices.data());
+        size_t next = 0;
+        for(Entity* entity : hierarchyOrder){
+            if(entity->transformDirty) entity->refreshLocalToWorldMatrix(&dirtyMatrices[next++]);
+            else entity->refreshLocalToWorldMatrix();
+        }
+    }
+
+    // Since the subtree of an entity follows it in the hierarchy order, we only need to remember where the last subtree of a matching ancestor ends
+    bool World::anyInSubtreeOf(const ComponentMask& ancestor, const ComponentMask& touched) const {
+        size_t subtreeEnd = 0;
+        for(size_t index = 0; index < hierarchyOrder.size(); ++index){
+            const ComponentMask& mask = hierarchyOrder[index]->componentMask;
+            if((mask & ancestor) == ancestor) subtreeEnd = std::max<size_t>(subtreeEnd, index + hierarchyOrder[index]->subtreeSize);
+            if(index < subtreeEnd && (mask & touched) == touched) return true;
+        }
+        return false;
+    }
+
+    // The copies are built as a new root subtree at the end of the hierarchy order (so adding them never moves other entities)
+    // then the copy of the source is attached to the requested parent at once
+    Entity* World::clone(const Entity* source, Entity* parent){
+        EntityRange subtree = getSubtree(source);
+        std::vector<Entity*> originals(subtree.begin(), subtree.end());
+        std::vector<Entity*> copies;
+        copies.reserve(originals.size());
+        for(size_t index = 0; index < originals.size(); ++index){
+            const Entity* original = originals[index];
+            Entity* copy = add();
+            copy->name = original->name;
+            copy->setLocalTransform(original->localTransform);
+            copy->lastNonCollidedLocalTransform = original->lastNonCollidedLocalTransform;
+            for(ComponentTypeID id = 0; id < MAX_COMPONENT_TYPES; ++id){
+                if(original->componentMask.test(id)) copy->attachComponent(id, pools[id]->clone(original->components[id]));
+            }
+            // Every original (except the source) has its parent before it in "originals"
+            // and the position of the parent in "originals" is the distance between the parent and the source in the hierarchy order
+            if(index > 0) setParent(copy, copies[original->parent->hierarchyIndex - source->hierarchyIndex]);
+            copies.push_back(copy);
+        }
+        setParent(copies.front(), parent);
+        return copies.front();
+    }
+
+    // This destroys the given entity, removes it from the dense array and returns its slot to the pool
+    // The generation of the slot is incremented so that all the handles to this entity become invalid
+    void World::destroy(Entity* entity){
+        // To keep the array dense, we move the last entity to the place of the destroyed one
+        Entity* last = entities.back();
+        entities[entity->denseIndex] = last;
+        last->denseIndex = entity->denseIndex;
+        entities.pop_back();
+
+        removeFromViews(entity);
+
+        std::uint32_t index = entity->handle.index();
+        entity->~Entity();
+        generations[index] = (generations[index] + 1) & EntityHandle::GENERATION_MASK;
+        freeSlots.push_back(index);
+    }
+
+    // This deletes all the entities in the world
+    void World::clear(){
+        // Since every component is going away, we clear the pools at once instead of removing the components one by one
+        for(auto& pool: pools){
+            if(pool) pool->clear();
+        }
+        for(auto entity: entities){
+            entity->componentMask.reset();
+            std::uint32_t index = entity->handle.index();
+            entity->~Entity();
+            generations[index] = (generations[index] + 1) & EntityHandle::GENERATION_MASK;
+            freeSlots.push_back(index);
+        }
+        entities.clear();
+        markedForRemoval.clear();
+        hierarchyOrder.clear();
+        for(auto& buffer: commandBuffers){
+            buffer->clear();
+        }
+        for(auto& view: views){
+            view->entities.clear();
+            view->positions.clear();
+        }
+    }
+
+    // Returns the view cache of the given mask
+    // If no one requested this view before, we create it and fill it by scanning all the entities once
+    World::ViewCache& World::getViewCache(const ComponentMask& mask){
+        for(auto& view: views){
+            if(view->mask == mask) return *view;
+        }
+        auto view = std::make_unique<ViewCache>();
+        view->mask = mask;
+        for(auto entity: entities){
+            if((entity->componentMask & mask) == mask){
+                std::uint32_t index = entity->handle.index();
+                if(index >= view->positions.size()) view->positions.resize(generations.size(), ViewCache::INVALID_POSITION);
+                view->positions[index] = static_cast<std::uint32_t>(view->entities.size());
+                view->entities.push_back(entity);
+            }
+        }
+        views.push_back(std::move(view));
+        return *views.back();
+    }
+
+    // Adds or removes the entity from the views after its component mask changed from "oldMask" to "newMask"
+    void World::updateViews(Entity* entity, const ComponentMask& oldMask, const ComponentMask& newMask){
+        std::uint32_t index = entity->handle.index();
+        for(auto& view: views){
+            bool wasInView = (oldMask & view->mask) == view->mask;
+            bool isInView = (newMask & view->mask) == view->mask;
+            if(wasInView == isInView) continue;
+            if(isInView){
+                if(index >= view->positions.size()) view->positions.resize(generations.size(), ViewCache::INVALID_POSITION);
+                view->positions[index] = static_cast<std::uint32_t>(view->entities.size());
+                view->entities.push_back(entity);
+            } else {
+                // To keep the list dense, we move the last entity in the view to the position of the removed one
+                std::uint32_t position = view->positions[index];
+                Entity* last = view->entities.back();
+                view->entities[position] = last;
+                view->positions[last->handle.index()] = position;
+                view->entities.pop_back();
+                view->positions[index] = ViewCache::INVALID_POSITION;
+            }
+        }
+    }
+
+    // Removes the entity from all the views that contain it (it is called before the entity is destroyed)
+    void World::removeFromViews(Entity* entity){
+        updateViews(entity, entity->componentMask, ComponentMask());
+    }
+
+    // Each thread remembers the buffer it got from each world so that it only locks the world the first time
+    CommandBuffer& World::getCommandBuffer(){
+        thread_local std::vector<std::pair<std::uint64_t, CommandBuffer*>> threadBuffers;
+        for(auto& [worldId, buffer] : threadBuffers){
+            if(worldId == id) return *buffer;
+        }
+        CommandBuffer* buffer;
+        {
+            std::lock_guard<std::mutex> lock(commandBuffersMutex);
+            commandBuffers.push_back(std::make_unique<CommandBuffer>());
+            buffer = commandBuffers.back().get();
+        }
+        threadBuffers.emplace_back(id, buffer);
+        return *buffer;
+    }
+
+    // The commands of all the buffers are applied in one pass (see "command-buffer.hpp" for the order)
+    void World::applyCommands(){
+        // First, we create the pending entities of every buffer
+        std::vector<std::vector<Entity*>> created(commandBuffers.size());
+        for(size_t bufferIndex = 0; bufferIndex < commandBuffers.size(); ++bufferIndex){
+            for(auto& initialize : commandBuffers[bufferIndex]->creations){
+                Entity* entity = add();
+                if(initialize) initialize(entity);
+                created[bufferIndex].push_back(entity);
+            }
+        }
+
+        // Then we resolve the target of every command and sort the commands by phase, then by entity, then by the order of recording
+        // Sorting by entity groups all the changes of an entity together so each entity is visited once
+        struct SortedCommand {
+            CommandBuffer::CommandType type;
+            std::uint32_t slot;
+            std::uint32_t buffer;
+            std::uint32_t sequence;
+            Entity* entity;
+            CommandBuffer::Command* command;
+        };
+        std::vector<SortedCommand> sorted;
+        for(size_t bufferIndex = 0; bufferIndex < commandBuffers.size(); ++bufferIndex){
+            auto& commands = commandBuffers[bufferIndex]->commands;
+            for(size_t sequence = 0; sequence < commands.size(); ++sequence){
+                auto& command = commands[sequence];
+                Entity* entity;
+                if(command.target.isPending()){
+                    auto& pending = created[bufferIndex];
+                    entity = command.target.pendingIndex < pending.size() ? pending[command.target.pendingIndex] : nullptr;
+                } else {
+                    entity = get(command.target.handle);
+                }
+                if(!entity) continue;
+                sorted.push_back({command.type, entity->handle.index(), std::uint32_t(bufferIndex), std::uint32_t(sequence), entity, &command});
+            }
+        }
+        std::sort(sorted.begin(), sorted.end(), [](const SortedCommand& first, const SortedCommand& second){
+            if(first.type != second.type) return first.type < second.type;
+            if(first.slot != second.slot) return first.slot < second.slot;
+            if(first.buffer != second.buffer) return first.buffer < second.buffer;
+            return first.sequence < second.sequence;
+        });
+
+        // Finally we apply them. The destroyed entities are only deleted after all the commands are applied.
+        for(auto& item : sorted){
+            if(item.type == CommandBuffer::CommandType::DESTROY) markForRemoval(item.entity);
+            else item.command->apply(item.entity);
+        }
+        deleteMarkedEntities();
+
+        for(auto& buffer: commandBuffers){
+            buffer->clear();
+        }
+    }
+
 }
\ No newline at end of file
@@ -1,18 +1,108 @@
 #pragma once
 
-#include <unordered_set>
+#include <vector>
+#include <array>
+#include <memory>
+#include <cstdint>
+#include <type_traits>
+#include <mutex>
 #include "entity.hpp"
+#include "component-pool.hpp"
+#include "command-buffer.hpp"
+#include "transform-batch.hpp"
 
 namespace our {
 
+    // A range of entities stored contiguously (e.g. a subtree in the hierarchy order of a world)
+    // It is only valid until the hierarchy of the world changes
+    struct EntityRange {
+        Entity* const* first;
+        Entity* const* last;
+
+        Entity* const* begin() const { return first; }
+        Entity* const* end() const { return last; }
+        size_t size() const { return size_t(last - first); }
+        bool empty() const { return first == last; }
+        Entity* operator[](size_t index) const { return first[index]; }
+    };
+
     // This class holds a set of entities
+    // The entities are allocated from a chunked pool owned by the world (so adding and deleting entities rarely touches the heap)
+    // and the alive entities are also kept in a dense array for fast iteration
     class World {
-        std::unordered_set<Entity*> entities; // These are the entities held by this world
-        std::unordered_set<Entity*> markedForRemoval; // These are the entities that are awaiting to be deleted
-                                                      // when deleteMarkedEntities is called
     public:
+        // The number of entities in each chunk of the entity pool
+        static constexpr std::uint32_t ENTITY_CHUNK_SIZE = 1024;
+
+    private:
+        // Each chunk is a raw block of memory that can hold ENTITY_CHUNK_SIZE entities
+        // Entities never move once created, so pointers to entities stay valid until they are deleted
+        struct EntityChunk {
+            std::aligned_storage_t<sizeof(Entity), alignof(Entity)> slots[ENTITY_CHUNK_SIZE];
+        };
+        std::vector<std::unique_ptr<EntityChunk>> entityChunks; // The memory of the entity pool
+        std::vector<std::uint32_t> generations; // The current generation of each slot in the entity pool
+        std::vector<std::uint32_t> freeSlots; // The indices of the slots that are free to be reused
+
+        std::vector<Entity*> entities; // These are the entities held by this world (densely packed)
+        std::vector<Entity*> markedForRemoval; // These are the entities that are awaiting to be deleted
+                                               // when deleteMarkedEntities is called
+        std::vector<Entity*> hierarchyOrder; // All the entities in depth-first order (every entity comes before its descendants,
+                                             // and the descendants of an entity come right after it)
+        std::array<std::unique_ptr<ComponentPoolBase>, MAX_COMPONENT_TYPES> pools; // The component pools of this world
+                                                                                  // The index is the type ID of the component type
+
+        // A view cache holds the list of the entities that have all the components in "mask"
+        // The list is kept up to date whenever a component is added or removed, so querying it costs nothing
+        struct ViewCache {
+            static constexpr std::uint32_t INVALID_POSITION = ~0u;
+            ComponentMask mask; // The component types that an entity must have to be in this view
+            std::vector<Entity*> entities; // The matching entities
+            std::vector<std::uint32_t> positions; // The position of each entity in "entities" (indexed by the slot index of the entity)
+                                                  // or INVALID_POSITION if the entity is not in the view
+        };
+        std::vector<std::unique_ptr<ViewCache>> views; // The views that were requested from this world
+
+        // The dirty local transforms gathered by "updateLocalToWorldMatrices" and their matrices (kept to reuse their memory every frame)
+        TransformBatch dirtyTransforms;
+        std::vector<glm::mat4> dirtyMatrices;
 
-        World() = default;
+        const std::uint64_t id; // A unique ID of this world (used by the threads to find their command buffer in this world)
+        std::vector<std::unique_ptr<CommandBuffer>> commandBuffers; // The command buffer of each thread that recorded commands in this world
+        std::mutex commandBuffersMutex; // Protects "commandBuffers" (it is only locked the first time a thread requests its buffer)
+
+        friend Entity; // The entity is a friend since it stores and releases its components in the pools of its world
+
+        // Returns the address of the given slot in the entity pool
+        void* getSlot(std::uint32_t index) const {
+            return &entityChunks[index / ENTITY_CHUNK_SIZE]->slots[index % ENTITY_CHUNK_SIZE];
+        }
+
+        // Destroys the given entity and returns its slot to the entity pool
+        void destroy(Entity* entity);
+
+        // Updates the hierarchy index of the entities in the hierarchy order between "begin" and "end"
+        void reindexHierarchy(size_t begin, size_t end){
+            for(size_t index = begin; index < end; ++index) hierarchyOrder[index]->hierarchyIndex = static_cast<std::uint32_t>(index);
+        }
+
+        // Removes the given component (of the type identified by "id") from its pool
+        // If another component was moved to keep the pool dense, its owner is updated to point to its new address
+        void removeComponent(ComponentTypeID id, Component* component){
+            if(!pools[id]) return;
+            if(Component* moved = pools[id]->remove(component); moved)
+                moved->getOwner()->components[id] = moved;
+        }
+
+        // Returns the view cache of the given mask (the view is created and filled the first time it is requested)
+        ViewCache& getViewCache(const ComponentMask& mask);
+        // Adds or removes the entity from the views after its component mask changed from "oldMask" to "newMask"
+        void updateViews(Entity* entity, const ComponentMask& oldMask, const ComponentMask& newMask);
+        // Removes the entity from all the views that contain it
+        void removeFromViews(Entity* entity);
+    public:
+
+        World();
 
         // This will deserialize a json array of entities and add the new entities to the current world
         // If parent pointer is not null, the new entities will be have their parent set to that given pointer
@@ -23,52 +113,176 @@ namespace our {
         // WARNING The entity is owned by this world so don't use "delete" to delete it, instead, call "markForRemoval"
         // to put it in the "markedForRemoval" set. The elements in the "markedForRemoval" set will be removed and
         // deleted when "deleteMarkedEntities" is called.
-        Entity* add() {
-            Entity* entity = new Entity();
-            entity->world = this;
-            entities.insert(entity);
-            return entity;
+        Entity* add();
+
+        // Returns the entity referred to by the given handle
+        // If the entity was deleted (or the handle is null), it returns a nullptr
+        Entity* get(EntityHandle handle) const {
+            std::uint32_t index = handle.index();
+            if(index >= generations.size() || generations[index] != handle.generation()) return nullptr;
+            return static_cast<Entity*>(getSlot(index));
         }
 
-        // This returns and immutable reference to the set of all entites in the world.
-        const std::unordered_set<Entity*>& getEntities() {
+        // This returns and immutable reference to the array of all entites in the world.
+        const std::vector<Entity*>& getEntities() {
             return entities;
         }
 
         // This marks an entity for removal by adding it to the "markedForRemoval" set.
         // The elements in the "markedForRemoval" set will be removed and deleted when "deleteMarkedEntities" is called.
+        // Since an entity can not outlive its parent, the descendants of the entity are deleted with it.
         void markForRemoval(Entity* entity){
-            if(entities.find(entity) != entities.end())
-                markedForRemoval.insert(entity);
+            if(entity && entity->world == this && !entity->pendingRemoval){
+                entity->pendingRemoval = true;
+                markedForRemoval.push_back(entity);
+            }
         }
 
-        // This removes the elements in "markedForRemoval" from the "entities" set.
+        // This removes the elements in "markedForRemoval" (and their descendants) from the "entities" set.
         // Then each of these elements are deleted.
-        void deleteMarkedEntities(){
-            for(auto entity: markedForRemoval){
-                entities.erase(entity);
-                delete entity;
-            }
-            markedForRemoval.clear();
+        void deleteMarkedEntities();
+
+        // This changes the parent of the given entity (nullptr makes it a root entity)
+        // The entity becomes the last child of its new parent and its whole subtree moves with it in the hierarchy order.
+        // The local transform is kept, so the entity moves in the world space if its new parent is at a different place.
+        // If the new parent is the entity itself or one of its descendants, nothing happens (since it would create a cycle).
+        // The hierarchy order is updated incrementally: only the entities between the old and the new place of the subtree are moved.
+        void setParent(Entity* entity, Entity* parent);
+
+        // This returns all the entities in depth-first order (every parent comes before its children)
+        // so the descendants of an entity are stored contiguously right after it (see "getDescendants")
+        const std::vector<Entity*>& getHierarchyOrder() const {
+            return hierarchyOrder;
+        }
+
+        // This returns the descendants of the given entity (its children, their children and so on) in depth-first order
+        // It costs O(1) since the descendants are stored contiguously in the hierarchy order
+        EntityRange getDescendants(const Entity* entity) const {
+            Entity* const* first = hierarchyOrder.data() + entity->hierarchyIndex;
+            return EntityRange{first + 1, first + entity->subtreeSize};
         }
 
-        //This deletes all entities in the world
-        void clear(){
-            for(auto entity: entities){
-                delete entity;
+        // This returns the given entity followed by its descendants in depth-first order
+        EntityRange getSubtree(const Entity* entity) const {
+            Entity* const* first = hierarchyOrder.data() + entity->hierarchyIndex;
+            return EntityRange{first, first + entity->subtreeSize};
+        }
+
+        // This returns true if an entity that has all the components in "touched" is in the subtree of an entity that has all the components
+        // in "ancestor" (every entity is in its own subtree, and an empty mask matches any entity)
+        // It scans the hierarchy order once without creating a view, so it is meant for occasional queries
+        // (e.g. the scheduler checking whether a system that moves some entities touches the transforms that another system uses)
+        bool anyInSubtreeOf(const ComponentMask& ancestor, const ComponentMask& touched) const;
+
+        // This creates a copy of the given entity and all of its descendants (with copies of their components)
+        // and returns the copy of the given entity after attaching it to "parent" (or as a root entity if "parent" is null)
+        Entity* clone(const Entity* source, Entity* parent = nullptr);
+
+        // This returns the command buffer of the calling thread in this world
+        // Commands recorded in it are applied when "applyCommands" is called. See "command-buffer.hpp" for more details.
+        // This is safe to call from any thread (each thread gets its own buffer so recording commands needs no locks)
+        CommandBuffer& getCommandBuffer();
+
+        // This applies all the commands recorded in the command buffers of all the threads then clears the buffers
+        // It must be called from a single thread while no other thread is using this world (e.g. once per frame after the systems are done)
+        void applyCommands();
+
+        // This updates the cached local to world matrices of all the entities in the world
+        // It should be called once per frame after the systems modified the transforms and before the matrices are used (e.g. rendering)
+        // Only the entities whose transform (or an ancestor's transform) changed are recomputed
+        // The local matrices of the dirty transforms are computed together by the batched kernel (see "transform-batch.hpp"),
+        // then they are combined with the matrices of their parents in a single linear pass over the hierarchy order
+        // (which puts every parent before its children)
+        void updateLocalToWorldMatrices();
+
+        // This returns the pool that holds all the components of type T in this world
+        // Iterating over the pool visits every component of type T linearly in memory
+        // and each component can be linked back to its entity via "getOwner"
+        template<typename T>
+        ComponentPool<T>& getComponents(){
+            auto& pool = pools[getComponentTypeID<T>()];
+            if(!pool) pool = std::make_unique<ComponentPool<T>>();
+            return *static_cast<ComponentPool<T>*>(pool.get());
+        }
+
+        // This returns the list of all the entities that have all the components Ts (e.g. view<CameraComponent, FreeCameraControllerComponent>())
+        // The list is cached and updated incrementally whenever a component is added or removed, so calling this every frame is cheap.
+        // WARNING: The list changes if an entity is added to or removed from the view, so don't add or remove components of the types Ts
+        // while iterating over it.
+        template<typename... Ts>
+        const std::vector<Entity*>& view(){
+            static_assert(sizeof...(Ts) > 0, "A view needs at least one component type");
+            return getViewCache(getComponentMask<Ts...>()).entities;
+        }
+
+        // This returns the list of all the entities that have all the components in "mask"
+        // It is the same as "view<Ts...>()" but it is useful when the component types are only known at runtime
+        // If the mask is empty, all the entities in the world are returned
+        const std::vector<Entity*>& view(const ComponentMask& mask){
+            if(mask.none()) return entities;
+            return getViewCache(mask).entities;
+        }
+
+        // This calls "function(entity, componentT1, componentT2, ...)" for every entity that has all the components Ts
+        template<typename... Ts, typename Function>
+        void each(Function function){
+            for(Entity* entity : view<Ts...>()){
+                function(entity, *entity->template getComponent<Ts>()...);
             }
-            entities.clear();
-            markedForRemoval.clear();
         }
 
-        //Since the world owns all of its entities, they should be deleted alongside it.
-        ~World(){
-            clear();
+        // This returns the first entity that has all the components Ts (or nullptr if there is none)
+        // It is useful for singletons such as the main camera, and costs O(1) once the view is cached
+        template<typename... Ts>
+        Entity* single(){
+            const auto& entities = view<Ts...>();
+            return entities.empty() ? nullptr : entities.front();
         }
 
+        //This deletes all entities in the world (and drops any command that was not applied yet)
+        //The memory of the entity pool is kept to be reused by the next entities
+        void clear();
+
+        //Since the world owns all of its entities, they should be deleted alongside it.
+        ~World();
+
         // The world should not be copyable
         World(const World&) = delete;
         World &operator=(World const &) = delete;
     };
 
+}
+
+namespace our {
+
+    // These are the template methods of the entity (declared in "entity.hpp")
+    // They are defined here since they need the complete definition of the world
+
+    template <typename T>
+    T *Entity::addComponent()
+    {
+        static_assert(std::is_base_of<Component, T>::value, "T must inherit from Component");
+        // An entity can only have one component of each type, so we remove the old one (if any)
+        deleteComponent<T>();
+        ComponentTypeID id = getComponentTypeID<T>();
+        T *component = world->getComponents<T>().add();
+        attachComponent(id, component);
+        return component;
+    }
+
+    template <typename T>
+    void Entity::deleteComponent()
+    {
+        static_assert(std::is_base_of<Component, T>::value, "T must inherit from Component");
+        if (ComponentTypeID id = getComponentTypeID<T>(); componentMask.test(id))
+        {
+            Component *component = components[id];
+            components[id] = nullptr;
+            ComponentMask oldMask = componentMask;
+            componentMask.reset(id);
+            world->updateViews(this, oldMask, componentMask);
+            world->removeComponent(id, component);
+        }
+    }
+
 }
\ No newline at end of file
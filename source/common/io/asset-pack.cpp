@@ -0,0 +1,420 @@
+#include "asset-pack.hpp"
+#include "file-cache.hpp"
+#include "lz-codec.hpp"
+#include "../jobs/job-system.hpp"
+
+#include <cstring>
+#include <algorithm>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <atomic>
+#include <utility>
+
+namespace our
+{
+
+    namespace
+    {
+        constexpr std::uint64_t alignTo16(std::uint64_t offset)
+        {
+            return (offset + 15u) & ~std::uint64_t(15u);
+        }
+
+        // Checks that the range [offset, offset + size) is inside a file of the given size (without overflowing)
+        bool isInside(std::uint64_t offset, std::uint64_t size, std::uint64_t fileSize)
+        {
+            return offset <= fileSize && size <= fileSize - offset;
+        }
+
+        std::uint64_t hashPath(const std::string &path)
+        {
+            return hashBytes(path.data(), path.size());
+        }
+    }
+
+    std::string normalizePackPath(const std::string &path)
+    {
+        return std::filesystem::path(path).lexically_normal().generic_string();
+    }
+
+    bool AssetPack::open(const std::string &path)
+    {
+        close();
+        if (!file.open(path))
+            return false;
+        const std::byte *base = file.data();
+        std::uint64_t fileSize = file.size();
+        auto candidate = reinterpret_cast<const PackHeader *>(base);
+        bool valid = fileSize >= sizeof(PackHeader) &&
+                     std::memcmp(candidate->magic, ASSET_PACK_MAGIC, sizeof(ASSET_PACK_MAGIC)) == 0 &&
+                     candidate->version == ASSET_PACK_VERSION &&
+                     candidate->slotCount > candidate->entryCount && (candidate->slotCount & (candidate->slotCount - 1)) == 0 &&
+                     candidate->slotsOffset % 16 == 0 && candidate->entriesOffset % 16 == 0 && candidate->blocksOffset % 16 == 0 &&
+                     isInside(candidate->slotsOffset, std::uint64_t(candidate->slotCount) * sizeof(std::uint32_t), fileSize) &&
+                     isInside(candidate->entriesOffset, std::uint64_t(candidate->entryCount) * sizeof(PackEntry), fileSize) &&
+                     isInside(candidate->blocksOffset, std::uint64_t(candidate->blockCount) * sizeof(PackBlock), fileSize) &&
+                     isInside(candidate->pathsOffset, candidate->pathsSize, fileSize);
+        if (valid)
+        {
+            // Every table is checked once here, so the lookups & reads do not need to check anything
+            auto candidateSlots = reinterpret_cast<const std::uint32_t *>(base + candidate->slotsOffset);
+            auto candidateEntries = reinterpret_cast<const PackEntry *>(base + candidate->entriesOffset);
+            auto candidateBlocks = reinterpret_cast<const PackBlock *>(base + candidate->blocksOffset);
+            for (std::uint32_t slot = 0; valid && slot < candidate->slotCount; ++slot)
+                valid = candidateSlots[slot] == ASSET_PACK_EMPTY_SLOT || candidateSlots[slot] < candidate->entryCount;
+            for (std::uint32_t index = 0; valid && index < candidate->entryCount; ++index)
+            {
+                const PackEntry &entry = candidateEntries[index];
+                valid = isInside(entry.pathOffset, entry.pathLength, candidate->pathsSize);
+                if (!valid)
+                    break;
+                if (entry.flags & PACK_ENTRY_COMPRESSED)
+                {
+                    // The blocks must cover the entry exactly (every block is full except the last one)
+                    valid = isInside(entry.firstBlock, entry.blockCount, candidate->blockCount) &&
+                            entry.blockCount == (entry.size + ASSET_PACK_BLOCK_SIZE - 1) / ASSET_PACK_BLOCK_SIZE;
+                    for (std::uint32_t block = 0; valid && block < entry.blockCount; ++block)
+                    {
+                        const PackBlock &range = candidateBlocks[entry.firstBlock + block];
+                        std::uint64_t expected = std::min<std::uint64_t>(ASSET_PACK_BLOCK_SIZE, entry.size - std::uint64_t(block) * ASSET_PACK_BLOCK_SIZE);
+                        valid = range.size == expected && isInside(range.offset, range.compressedSize, fileSize);
+                    }
+                }
+                else
+                {
+                    valid = isInside(entry.dataOffset, entry.size, fileSize);
+                }
+            }
+            if (valid)
+            {
+                slots = candidateSlots;
+                entries = candidateEntries;
+                blocks = candidateBlocks;
+                paths = reinterpret_cast<const char *>(base + candidate->pathsOffset);
+                header = candidate;
+                std::error_code error;
+                modifiedTime = std::int64_t(std::filesystem::last_write_time(path, error).time_since_epoch().count());
+                std::lock_guard<std::mutex> lock(staleMutex);
+                stalePaths.clear();
+                return true;
+            }
+        }
+        file.close();
+        return false;
+    }
+
+    void AssetPack::close()
+    {
+        header = nullptr;
+        slots = nullptr;
+        entries = nullptr;
+        blocks = nullptr;
+        paths = nullptr;
+        file.close();
+    }
+
+    void AssetPack::prefetch() const
+    {
+        file.prefetch(0, file.size());
+    }
+
+    const PackEntry *AssetPack::find(const std::string &path) const
+    {
+        if (!header)
+            return nullptr;
+        std::string normalized = normalizePackPath(path);
+        std::uint64_t hash = hashPath(normalized);
+        std::uint32_t mask = header->slotCount - 1;
+        // The table is never full, so the probing always reaches an empty slot
+        for (std::uint32_t slot = std::uint32_t(hash) & mask;; slot = (slot + 1) & mask)
+        {
+            std::uint32_t index = slots[slot];
+            if (index == ASSET_PACK_EMPTY_SLOT)
+                return nullptr;
+            const PackEntry &entry = entries[index];
+            if (entry.pathHash == hash && entry.pathLength == normalized.size() &&
+                std::memcmp(paths + entry.pathOffset, normalized.data(), normalized.size()) == 0)
+                return &entry;
+        }
+    }
+
+    // A shipped build has no loose files, so the check costs a failed "stat" per opened asset
+    const PackEntry *AssetPack::findCurrent(const std::string &path) const
+    {
+        const PackEntry *entry = find(path);
+        if (!entry)
+            return nullptr;
+        std::error_code error;
+        auto looseTime = std::filesystem::last_write_time(path, error);
+        if (error || std::int64_t(looseTime.time_since_epoch().count()) <= modifiedTime)
+            return entry;
+        std::lock_guard<std::mutex> lock(staleMutex);
+        if (stalePaths.insert(path).second)
+            std::cerr << "WARNING: \"" << path << "\" is newer than its copy in the asset pack, so it is read from the file system (run ASSET_PACKER to update the pack)" << std::endl;
+        return nullptr;
+    }
+
+    const std::byte *AssetPack::getStoredData(const PackEntry &entry) const
+    {
+        if (entry.flags & PACK_ENTRY_COMPRESSED)
+            return nullptr;
+        return file.data() + entry.dataOffset;
+    }
+
+    bool AssetPack::read(const PackEntry &entry, std::byte *destination) const
+    {
+        if (const std::byte *stored = getStoredData(entry))
+        {
+            std::memcpy(destination, stored, entry.size);
+            return true;
+        }
+        std::atomic<bool> valid{true};
+        auto decompress = [&](size_t begin, size_t end)
+        {
+            for (size_t block = begin; block < end; ++block)
+            {
+                const PackBlock &range = blocks[entry.firstBlock + block];
+                std::byte *output = destination + block * size_t(ASSET_PACK_BLOCK_SIZE);
+                const std::byte *input = file.data() + range.offset;
+                bool decoded = range.compressedSize == range.size ? (std::memcpy(output, input, range.size), true)
+                                                                  : lzDecompress(input, range.compressedSize, output, range.size);
+                if (!decoded)
+                    valid.store(false, std::memory_order_relaxed);
+            }
+        };
+        // A block is decompressed in a fraction of a millisecond, so small entries are not worth splitting
+        if (entry.blockCount > 4)
+            JobSystem::get().parallelFor(0, entry.blockCount, 2, decompress);
+        else
+            decompress(0, entry.blockCount);
+        return valid.load(std::memory_order_relaxed);
+    }
+
+    AssetPack &AssetPack::get()
+    {
+        static AssetPack pack;
+        return pack;
+    }
+
+    bool mountAssetPack(const std::string &path)
+    {
+        AssetPack &pack = AssetPack::get();
+        if (!pack.open(path))
+            return false;
+        pack.prefetch();
+        return true;
+    }
+
+    bool AssetFile::open(const std::string &path)
+    {
+        close();
+        const AssetPack &pack = AssetPack::get();
+        if (const PackEntry *entry = pack.findCurrent(path))
+        {
+            if (const std::byte *stored = pack.getStoredData(*entry))
+            {
+                bytes = stored;
+            }
+            else
+            {
+                storage.resize(entry->size);
+                if (!pack.read(*entry, storage.data()))
+                {
+                    storage.clear();
+                    return false;
+                }
+                bytes = storage.data();
+            }
+            length = entry->size;
+            opened = true;
+            return true;
+        }
+        if (!mapped.open(path))
+            return false;
+        bytes = mapped.data();
+        length = mapped.size();
+        opened = true;
+        return true;
+    }
+
+    void AssetFile::adopt(std::vector<std::byte> &&data)
+    {
+        close();
+        storage = std::move(data);
+        bytes = storage.data();
+        length = storage.size();
+        opened = true;
+    }
+
+    // Moving the mapping or the storage does not move their data, so "bytes" stays valid
+    AssetFile::AssetFile(AssetFile &&other) noexcept
+        : bytes(other.bytes), length(other.length), opened(other.opened), mapped(std::move(other.mapped)), storage(std::move(other.storage))
+    {
+        other.bytes = nullptr;
+        other.length = 0;
+        other.opened = false;
+    }
+
+    AssetFile &AssetFile::operator=(AssetFile &&other) noexcept
+    {
+        if (this != &other)
+        {
+            close();
+            bytes = other.bytes;
+            length = other.length;
+            opened = other.opened;
+            mapped = std::move(other.mapped);
+            storage = std::move(other.storage);
+            other.bytes = nullptr;
+            other.length = 0;
+            other.opened = false;
+        }
+        return *this;
+    }
+
+    void AssetFile::close()
+    {
+        bytes = nullptr;
+        length = 0;
+        opened = false;
+        mapped.close();
+        storage.clear();
+    }
+
+    bool buildAssetPack(const std::vector<std::string> &paths, const std::string &packPath, std::ostream *log)
+    {
+        // The paths are normalized first, so the same file is only added once
+        std::vector<std::string> names;
+        for (const std::string &path : paths)
+        {
+            std::string name = normalizePackPath(path);
+            if (std::find(names.begin(), names.end(), name) == names.end())
+                names.push_back(name);
+        }
+
+        PackHeader header = {};
+        std::memcpy(header.magic, ASSET_PACK_MAGIC, sizeof(ASSET_PACK_MAGIC));
+        header.version = ASSET_PACK_VERSION;
+        header.entryCount = std::uint32_t(names.size());
+        // The table is at most half full, so the probe sequences stay short
+        header.slotCount = 16;
+        while (header.slotCount < header.entryCount * 2)
+            header.slotCount *= 2;
+
+        std::vector<std::uint32_t> slots(header.slotCount, ASSET_PACK_EMPTY_SLOT);
+        std::vector<PackEntry> entries(names.size());
+        std::vector<PackBlock> blocks;
+        std::string pathData;
+        // The data of each entry is compressed into its own buffer, then the buffers are written after the tables
+        std::vector<std::vector<std::byte>> payloads(names.size());
+        std::vector<std::vector<PackBlock>> payloadBlocks(names.size()); // The block offsets are relative to the payload until the layout is known
+
+        std::uint64_t totalSize = 0, totalStored = 0;
+        for (size_t index = 0; index < names.size(); ++index)
+        {
+            const std::string &name = names[index];
+            // (Empty files can not be mapped, so they are added without opening them)
+            MappedFile source;
+            std::error_code error;
+            bool empty = std::filesystem::is_regular_file(name, error) && std::filesystem::file_size(name, error) == 0;
+            if (!empty && !source.open(name))
+            {
+                if (log)
+                    *log << "ERROR: Couldn't read \"" << name << "\"" << std::endl;
+                return false;
+            }
+            PackEntry &entry = entries[index];
+            entry.pathHash = hashPath(name);
+            entry.pathOffset = std::uint32_t(pathData.size());
+            entry.pathLength = std::uint32_t(name.size());
+            entry.size = source.size();
+            pathData += name;
+
+            // Every block is compressed independently (a block that does not shrink is stored as it is)
+            std::vector<std::byte> &payload = payloads[index];
+            std::vector<std::byte> compressed(lzCompressBound(ASSET_PACK_BLOCK_SIZE));
+            for (std::uint64_t offset = 0; offset < entry.size; offset += ASSET_PACK_BLOCK_SIZE)
+            {
+                std::uint32_t size = std::uint32_t(std::min<std::uint64_t>(ASSET_PACK_BLOCK_SIZE, entry.size - offset));
+                size_t compressedSize = lzCompress(source.data() + offset, size, compressed.data(), size - 1);
+                PackBlock block = {payload.size(), compressedSize ? std::uint32_t(compressedSize) : size, size};
+                const std::byte *blockData = compressedSize ? compressed.data() : source.data() + offset;
+                payload.insert(payload.end(), blockData, blockData + block.compressedSize);
+                payloadBlocks[index].push_back(block);
+            }
+            // Compression must save at least an eighth of the file, otherwise the file is stored uncompressed so it can be read without a copy
+            if (payload.size() + payload.size() / 7 < entry.size)
+            {
+                entry.flags = PACK_ENTRY_COMPRESSED;
+                entry.firstBlock = std::uint32_t(blocks.size());
+                entry.blockCount = std::uint32_t(payloadBlocks[index].size());
+                blocks.insert(blocks.end(), payloadBlocks[index].begin(), payloadBlocks[index].end());
+            }
+            else
+            {
+                payload.assign(source.data(), source.data() + entry.size);
+                payloadBlocks[index].clear();
+            }
+
+            for (std::uint32_t slot = std::uint32_t(entry.pathHash) & (header.slotCount - 1);; slot = (slot + 1) & (header.slotCount - 1))
+            {
+                if (slots[slot] == ASSET_PACK_EMPTY_SLOT)
+                {
+                    slots[slot] = std::uint32_t(index);
+                    break;
+                }
+            }
+            totalSize += entry.size;
+            totalStored += payload.size();
+            if (log)
+                *log << "  " << std::left << std::setw(48) << name << std::right << std::setw(10) << entry.size / 1024 << " KB -> "
+                     << std::setw(8) << payload.size() / 1024 << " KB" << ((entry.flags & PACK_ENTRY_COMPRESSED) ? "" : " (stored)") << std::endl;
+        }
+        header.blockCount = std::uint32_t(blocks.size());
+
+        // Lay out the file
+        std::uint64_t offset = alignTo16(sizeof(PackHeader));
+        header.slotsOffset = offset;
+        offset = alignTo16(offset + slots.size() * sizeof(std::uint32_t));
+        header.entriesOffset = offset;
+        offset = alignTo16(offset + entries.size() * sizeof(PackEntry));
+        header.blocksOffset = offset;
+        offset = alignTo16(offset + blocks.size() * sizeof(PackBlock));
+        header.pathsOffset = offset;
+        header.pathsSize = pathData.size();
+        offset = alignTo16(offset + pathData.size());
+        for (size_t index = 0; index < entries.size(); ++index)
+        {
+            PackEntry &entry = entries[index];
+            if (entry.flags & PACK_ENTRY_COMPRESSED)
+            {
+                for (std::uint32_t block = 0; block < entry.blockCount; ++block)
+                    blocks[entry.firstBlock + block].offset += offset;
+            }
+            else
+            {
+                entry.dataOffset = offset;
+            }
+            offset = alignTo16(offset + payloads[index].size());
+        }
+
+        std::vector<std::byte> bytes(offset);
+        std::memcpy(bytes.data(), &header, sizeof(header));
+        std::memcpy(bytes.data() + header.slotsOffset, slots.data(), slots.size() * sizeof(std::uint32_t));
+        std::memcpy(bytes.data() + header.entriesOffset, entries.data(), entries.size() * sizeof(PackEntry));
+        std::memcpy(bytes.data() + header.blocksOffset, blocks.data(), blocks.size() * sizeof(PackBlock));
+        std::memcpy(bytes.data() + header.pathsOffset, pathData.data(), pathData.size());
+        for (size_t index = 0; index < entries.size(); ++index)
+        {
+            std::uint64_t start = (entries[index].flags & PACK_ENTRY_COMPRESSED) ? blocks[entries[index].firstBlock].offset : entries[index].dataOffset;
+            if (!payloads[index].empty())
+                std::memcpy(bytes.data() + start, payloads[index].data(), payloads[index].size());
+        }
+        if (log)
+            *log << "Packed " << entries.size() << " files: " << totalSize / 1024 << " KB -> " << totalStored / 1024 << " KB of data ("
+                 << bytes.size() / 1024 << " KB with the tables)" << std::endl;
+        return writeFileAtomically(packPath, bytes.data(), bytes.size());
+    }
+
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <ostream>
+#include <mutex>
+#include <unordered_set>
+
+#include "mapped-file.hpp"
+
+namespace our
+{
+
+    // An asset pack bundles many asset files into a single file, so loading the assets reads one big file instead of opening dozens of small ones.
+    // The pack is memory mapped and its file is laid out as follows:
+    // - a header (see "PackHeader")
+    // - a hash table of entry indices, which finds the entry of a path with a single probe in most cases
+    // - the entries (one per file, see "PackEntry") and the blocks of the compressed entries (see "PackBlock")
+    // - the paths of the entries
+    // - the data of the entries
+    // The data of an entry is split into blocks of 64 KB that are compressed independently (see "lz-codec.hpp").
+    // If compressing a file does not save enough space (e.g. a JPEG or a PNG), it is stored uncompressed,
+    // so it can be read directly from the mapping without any copy.
+    // All the offsets are in bytes from the start of the file.
+    constexpr char ASSET_PACK_MAGIC[4] = {'O', 'P', 'A', 'K'};
+    constexpr std::uint32_t ASSET_PACK_VERSION = 1;
+    constexpr std::uint32_t ASSET_PACK_BLOCK_SIZE = 64 * 1024;
+    constexpr std::uint32_t ASSET_PACK_EMPTY_SLOT = UINT32_MAX;
+
+    struct PackHeader
+    {
+        char magic[4];
+        std::uint32_t version;
+        std::uint32_t entryCount;
+        std::uint32_t slotCount; // The size of the hash table (a power of 2)
+        std::uint32_t blockCount;
+        std::uint32_t padding;
+        std::uint64_t slotsOffset;   // The hash table (uint32 entry indices, ASSET_PACK_EMPTY_SLOT marks an empty slot)
+        std::uint64_t entriesOffset; // The entries (PackEntry)
+        std::uint64_t blocksOffset;  // The blocks of the compressed entries (PackBlock)
+        std::uint64_t pathsOffset;   // The paths of the entries (not null terminated)
+        std::uint64_t pathsSize;
+    };
+
+    enum PackEntryFlags : std::uint32_t
+    {
+        PACK_ENTRY_COMPRESSED = 1,
+    };
+
+    struct PackEntry
+    {
+        std::uint64_t pathHash;   // The hash of the path (see "hashBytes" in "file-cache.hpp")
+        std::uint32_t pathOffset; // The path of the file (relative to the paths section)
+        std::uint32_t pathLength;
+        std::uint64_t size;       // The size of the file in bytes
+        std::uint64_t dataOffset; // Where the data of an uncompressed entry starts
+        std::uint32_t firstBlock; // The blocks of a compressed entry
+        std::uint32_t blockCount;
+        std::uint32_t flags;
+        std::uint32_t padding;
+    };
+
+    struct PackBlock
+    {
+        std::uint64_t offset;
+        std::uint32_t compressedSize; // If it is equal to "size", the block is stored uncompressed
+        std::uint32_t size;           // The size of the decompressed block (ASSET_PACK_BLOCK_SIZE except for the last block of an entry)
+    };
+
+    // Returns the path in the form used by the pack (with '/' separators and without "./" or ".." parts)
+    std::string normalizePackPath(const std::string &path);
+
+    // This class reads a memory mapped asset pack
+    // Reading from a pack is thread safe.
+    class AssetPack
+    {
+        MappedFile file;
+        const PackHeader *header = nullptr;
+        const std::uint32_t *slots = nullptr;
+        const PackEntry *entries = nullptr;
+        const PackBlock *blocks = nullptr;
+        const char *paths = nullptr;
+        std::int64_t modifiedTime = 0; // The last write time of the pack file when it was opened
+        mutable std::mutex staleMutex;
+        mutable std::unordered_set<std::string> stalePaths; // The loose files that were found newer than the pack (each is only reported once)
+
+    public:
+        // Maps the pack and checks that all of its tables are valid (so they can be read without any further check)
+        // Returns false if the file can not be opened or is not a valid pack
+        bool open(const std::string &path);
+        void close();
+        bool isOpen() const { return header != nullptr; }
+
+        // Asks the operating system to read the whole pack ahead (as one large sequential read) before its entries are accessed
+        void prefetch() const;
+
+        // Returns the entry of the given path (or a nullptr if the pack does not contain it)
+        const PackEntry *find(const std::string &path) const;
+        // Same as "find", except that it returns a nullptr if the loose file at the given path was modified after the pack was written,
+        // so an asset that was edited during development is read from the file system instead of its stale copy in the pack (with a warning).
+        // The asset loading goes through this function, while "find" only looks at the content of the pack.
+        const PackEntry *findCurrent(const std::string &path) const;
+        size_t getEntryCount() const { return header ? header->entryCount : 0; }
+        const PackEntry &getEntry(size_t index) const { return entries[index]; }
+        std::string getPath(const PackEntry &entry) const { return std::string(paths + entry.pathOffset, entry.pathLength); }
+        // Returns the size of the mapped pack in bytes
+        size_t getSize() const { return file.size(); }
+        // Returns the last write time of the pack file (in the units of the file system clock)
+        std::int64_t getModifiedTime() const { return modifiedTime; }
+
+        // Returns a pointer to the data of an uncompressed entry inside the mapping (or a nullptr if the entry is compressed)
+        const std::byte *getStoredData(const PackEntry &entry) const;
+        // Decompresses the data of an entry into "destination" (which must have room for "entry.size" bytes)
+        // The blocks of big entries are decompressed in parallel on the job system
+        // Returns false if the data is corrupted
+        bool read(const PackEntry &entry, std::byte *destination) const;
+
+        // Returns the pack mounted by "mountAssetPack" (which may not be open)
+        static AssetPack &get();
+    };
+
+    // Mounts the asset pack at the given path, so the asset files are read from it first (see "AssetFile")
+    // Returns false if the pack could not be opened (then the asset files are only read from the file system)
+    bool mountAssetPack(const std::string &path);
+
+    // The content of an asset file, which is read from the mounted asset pack if the pack has it, or from the file system otherwise
+    // (a loose file that is newer than the pack is read from the file system too, see "AssetPack::findCurrent")
+    // The data is not copied if it can be read directly from a mapping (a file on the file system or an uncompressed entry in the pack)
+    class AssetFile
+    {
+        const std::byte *bytes = nullptr;
+        size_t length = 0;
+        bool opened = false;
+        MappedFile mapped;              // The file when it is read from the file system
+        std::vector<std::byte> storage; // The decompressed data when it is read from a compressed entry
+
+    public:
+        // Opens the file at the given path (the path is relative to the working directory, like the paths in the config files)
+        // Returns false if neither the pack nor the file system has the file
+        bool open(const std::string &path);
+        // Takes the data of a file that was already read into memory (e.g. by the "AsyncFileReader")
+        void adopt(std::vector<std::byte> &&data);
+        void close();
+
+        bool isOpen() const { return opened; }
+        const std::byte *data() const { return bytes; }
+        size_t size() const { return length; }
+
+        AssetFile() = default;
+        AssetFile(AssetFile &&other) noexcept;
+        AssetFile &operator=(AssetFile &&other) noexcept;
+        AssetFile(const AssetFile &) = delete;
+        AssetFile &operator=(const AssetFile &) = delete;
+    };
+
+    // Writes an asset pack containing the given files (the paths are stored in their normalized form)
+    // A file is compressed only if that saves at least an eighth of its size
+    // The progress and the compression of every file are written to "log" (if given)
+    // Returns false if a file could not be read or the pack could not be written
+    bool buildAssetPack(const std::vector<std::string> &paths, const std::string &packPath, std::ostream *log = nullptr);
+
+}
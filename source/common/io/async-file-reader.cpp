@@ -0,0 +1,431 @@
+#include "async-file-reader.hpp"
+#include "../trace/trace.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <utility>
+#include <algorithm>
+#include <cstring>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define OUR_HAS_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+#endif
+
+namespace our
+{
+
+    namespace
+    {
+        // Reads a whole file with a blocking read (used by the THREADS backend and when a ring fails)
+        AssetFile readFileBlocking(const std::string &path, std::size_t &bytesRead)
+        {
+            AssetFile file;
+            std::ifstream stream(path, std::ios::binary | std::ios::ate);
+            if (!stream)
+                return file;
+            std::streamoff size = stream.tellg();
+            if (size < 0)
+                return file;
+            std::vector<std::byte> data(static_cast<std::size_t>(size));
+            stream.seekg(0);
+            if (!data.empty() && !stream.read(reinterpret_cast<char *>(data.data()), size))
+                return file;
+            bytesRead += data.size();
+            file.adopt(std::move(data));
+            return file;
+        }
+    }
+
+#ifdef OUR_HAS_IO_URING
+
+    // The rings that are shared with the kernel. The application writes the submissions to the tail of the submission ring
+    // and the kernel writes the completions to the tail of the completion ring. The other side of each ring is read with acquire loads,
+    // so the entries are visible before the tail that publishes them.
+    // liburing is not used, so the rings are set up with the raw system calls (the layout is described by "io_uring_params").
+    struct AsyncFileReader::IoRing
+    {
+        int fd = -1;
+        void *submissionMap = MAP_FAILED;
+        std::size_t submissionMapSize = 0;
+        void *completionMap = MAP_FAILED;
+        std::size_t completionMapSize = 0;
+        io_uring_sqe *submissions = static_cast<io_uring_sqe *>(MAP_FAILED);
+        std::size_t submissionsSize = 0;
+
+        unsigned *submissionHead = nullptr, *submissionTail = nullptr, *submissionMask = nullptr, *submissionArray = nullptr;
+        unsigned *completionHead = nullptr, *completionTail = nullptr, *completionMask = nullptr;
+        io_uring_cqe *completions = nullptr;
+        unsigned entries = 0;
+
+        ~IoRing() { destroy(); }
+
+        // Creates a ring with (at least) the given number of entries
+        // Returns false if the kernel does not support io_uring (or it is not allowed, e.g. in some containers)
+        bool setup(unsigned entryCount)
+        {
+            io_uring_params params;
+            std::memset(&params, 0, sizeof(params));
+            fd = int(syscall(__NR_io_uring_setup, entryCount, &params));
+            if (fd < 0)
+                return false;
+            entries = params.sq_entries;
+
+            submissionMapSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            completionMapSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            // Newer kernels map both rings with a single mapping
+            bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+            if (singleMap)
+                submissionMapSize = completionMapSize = std::max(submissionMapSize, completionMapSize);
+            submissionMap = mmap(nullptr, submissionMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+            if (submissionMap == MAP_FAILED)
+                return destroy();
+            if (singleMap)
+                completionMap = submissionMap;
+            else
+            {
+                completionMap = mmap(nullptr, completionMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+                if (completionMap == MAP_FAILED)
+                    return destroy();
+            }
+            submissionsSize = params.sq_entries * sizeof(io_uring_sqe);
+            submissions = static_cast<io_uring_sqe *>(mmap(nullptr, submissionsSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+            if (submissions == MAP_FAILED)
+                return destroy();
+
+            char *submissionBase = static_cast<char *>(submissionMap);
+            submissionHead = reinterpret_cast<unsigned *>(submissionBase + params.sq_off.head);
+            submissionTail = reinterpret_cast<unsigned *>(submissionBase + params.sq_off.tail);
+            submissionMask = reinterpret_cast<unsigned *>(submissionBase + params.sq_off.ring_mask);
+            submissionArray = reinterpret_cast<unsigned *>(submissionBase + params.sq_off.array);
+            char *completionBase = static_cast<char *>(completionMap);
+            completionHead = reinterpret_cast<unsigned *>(completionBase + params.cq_off.head);
+            completionTail = reinterpret_cast<unsigned *>(completionBase + params.cq_off.tail);
+            completionMask = reinterpret_cast<unsigned *>(completionBase + params.cq_off.ring_mask);
+            completions = reinterpret_cast<io_uring_cqe *>(completionBase + params.cq_off.cqes);
+            return true;
+        }
+
+        // Releases the ring (the kernel cancels or finishes any request that is still in flight before the ring is freed)
+        // It always returns false, so a failed setup can return it directly
+        bool destroy()
+        {
+            if (submissions != MAP_FAILED)
+                munmap(submissions, submissionsSize);
+            if (completionMap != MAP_FAILED && completionMap != submissionMap)
+                munmap(completionMap, completionMapSize);
+            if (submissionMap != MAP_FAILED)
+                munmap(submissionMap, submissionMapSize);
+            if (fd >= 0)
+                ::close(fd);
+            submissions = static_cast<io_uring_sqe *>(MAP_FAILED);
+            completionMap = submissionMap = MAP_FAILED;
+            fd = -1;
+            return false;
+        }
+
+        // Queues a vectored read (the submission is only seen by the kernel after the next call to "enter")
+        void pushRead(int file, const iovec *vector, std::uint64_t offset, std::uint64_t userData)
+        {
+            unsigned tail = *submissionTail; // Only this thread writes the tail
+            unsigned index = tail & *submissionMask;
+            io_uring_sqe &entry = submissions[index];
+            std::memset(&entry, 0, sizeof(entry));
+            entry.opcode = IORING_OP_READV;
+            entry.fd = file;
+            entry.addr = reinterpret_cast<std::uint64_t>(vector);
+            entry.len = 1;
+            entry.off = offset;
+            entry.user_data = userData;
+            submissionArray[index] = index;
+            __atomic_store_n(submissionTail, tail + 1, __ATOMIC_RELEASE);
+        }
+
+        // Submits the queued reads and waits for at least one completion
+        // Returns false if the ring failed
+        bool enter(unsigned submitCount)
+        {
+            while (true)
+            {
+                long result = syscall(__NR_io_uring_enter, fd, submitCount, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+                if (result >= 0)
+                    return true;
+                if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+                    return false;
+                // The submissions that were consumed before the interruption must not be submitted again
+                submitCount = __atomic_load_n(submissionTail, __ATOMIC_RELAXED) - __atomic_load_n(submissionHead, __ATOMIC_ACQUIRE);
+            }
+        }
+    };
+
+    void AsyncFileReader::readWithRing(IoRing &ring)
+    {
+        trace::setThreadName("io");
+        OUR_TRACE_SCOPE("read files (io_uring)");
+        const std::vector<std::size_t> &indices = queued;
+        // The state of a file while its read is in flight
+        struct FileRead
+        {
+            int fd = -1;
+            std::vector<std::byte> data;
+            std::size_t done = 0;
+            iovec vector;
+            bool delivered = false;
+            bool submitted = false; // True while the kernel may still write into "data" (until the completion of the read is reaped)
+        };
+        std::vector<FileRead> reads(indices.size());
+        std::vector<std::size_t> retries; // The reads that must be submitted again (short reads or interrupted reads)
+        std::size_t nextRead = 0, inFlight = 0, finished = 0;
+        bool failed = false;
+
+        auto finish = [&](std::size_t slot, bool success)
+        {
+            FileRead &read = reads[slot];
+            if (read.fd >= 0)
+                ::close(read.fd);
+            read.fd = -1;
+            read.delivered = true;
+            ++finished;
+            AssetFile file;
+            if (success)
+            {
+                bytesRead.fetch_add(read.data.size(), std::memory_order_relaxed);
+                file.adopt(std::move(read.data));
+            }
+            deliver(indices[slot], std::move(file));
+        };
+        auto submit = [&](std::size_t slot)
+        {
+            FileRead &read = reads[slot];
+            read.vector.iov_base = read.data.data() + read.done;
+            read.vector.iov_len = read.data.size() - read.done;
+            ring.pushRead(read.fd, &read.vector, read.done, slot);
+            read.submitted = true;
+            ++inFlight;
+        };
+
+        while (finished < reads.size())
+        {
+            // The ring is kept full: the retries go first, then the next files are opened (only as many files are open as there are reads in flight)
+            unsigned submitCount = 0;
+            for (std::size_t slot : retries)
+            {
+                submit(slot);
+                ++submitCount;
+            }
+            retries.clear();
+            while (inFlight < ring.entries && nextRead < reads.size())
+            {
+                std::size_t slot = nextRead++;
+                FileRead &read = reads[slot];
+                read.fd = ::open(paths[indices[slot]].c_str(), O_RDONLY | O_CLOEXEC);
+                struct stat status;
+                if (read.fd < 0 || fstat(read.fd, &status) != 0)
+                {
+                    finish(slot, false);
+                    continue;
+                }
+                read.data.resize(std::size_t(status.st_size));
+                if (read.data.empty())
+                {
+                    finish(slot, true);
+                    continue;
+                }
+                submit(slot);
+                ++submitCount;
+            }
+            if (inFlight == 0)
+                continue;
+            if (!ring.enter(submitCount))
+            {
+                failed = true;
+                break;
+            }
+
+            unsigned head = *ring.completionHead; // Only this thread writes the head
+            unsigned tail = __atomic_load_n(ring.completionTail, __ATOMIC_ACQUIRE);
+            for (; head != tail; ++head)
+            {
+                const io_uring_cqe &completion = ring.completions[head & *ring.completionMask];
+                std::size_t slot = std::size_t(completion.user_data);
+                FileRead &read = reads[slot];
+                read.submitted = false;
+                --inFlight;
+                if (completion.res == -EAGAIN || completion.res == -EINTR)
+                    retries.push_back(slot);
+                else if (completion.res < 0)
+                    finish(slot, false);
+                else if (completion.res == 0)
+                {
+                    // The file got shorter since it was opened, so only the part that was read is kept
+                    read.data.resize(read.done);
+                    finish(slot, true);
+                }
+                else
+                {
+                    read.done += std::size_t(completion.res);
+                    if (read.done < read.data.size())
+                        retries.push_back(slot);
+                    else
+                        finish(slot, true);
+                }
+            }
+            __atomic_store_n(ring.completionHead, head, __ATOMIC_RELEASE);
+        }
+
+        if (failed)
+        {
+            // Releasing the ring does not stop the reads in flight (closing the ring only queues its teardown, so they can still complete later)
+            // so their completions are reaped first (the queued reads that the kernel did not consume yet are submitted with them).
+            // The results are dropped, since these files are read again with blocking reads.
+            // "enter" already retries the interrupted calls, so an attempt only fails on a real error of the ring.
+            constexpr int DRAIN_ATTEMPTS = 16;
+            for (int attempt = 0; inFlight > 0 && attempt < DRAIN_ATTEMPTS;)
+            {
+                unsigned pending = __atomic_load_n(ring.submissionTail, __ATOMIC_RELAXED) - __atomic_load_n(ring.submissionHead, __ATOMIC_ACQUIRE);
+                if (!ring.enter(pending))
+                {
+                    ++attempt;
+                    continue;
+                }
+                unsigned head = *ring.completionHead;
+                unsigned tail = __atomic_load_n(ring.completionTail, __ATOMIC_ACQUIRE);
+                for (; head != tail; ++head)
+                {
+                    reads[std::size_t(ring.completions[head & *ring.completionMask].user_data)].submitted = false;
+                    --inFlight;
+                }
+                __atomic_store_n(ring.completionHead, head, __ATOMIC_RELEASE);
+            }
+            // If the ring can not be drained, the kernel may still write into the buffers (and read the vectors) of the reads in flight,
+            // so they are deliberately leaked (with their files left open) instead of being freed when this function returns
+            std::vector<FileRead> *abandoned = &reads;
+            if (inFlight > 0)
+            {
+                std::cerr << "WARNING: " << inFlight << " io_uring reads could not be drained, so their buffers are leaked" << std::endl;
+                abandoned = new std::vector<FileRead>(std::move(reads));
+            }
+            ring.destroy();
+            for (std::size_t slot = 0; slot < abandoned->size(); ++slot)
+            {
+                const FileRead &state = (*abandoned)[slot];
+                if (state.delivered)
+                    continue;
+                if (state.fd >= 0 && !state.submitted)
+                    ::close(state.fd);
+                std::size_t read = 0;
+                AssetFile file = readFileBlocking(paths[indices[slot]], read);
+                bytesRead.fetch_add(read, std::memory_order_relaxed);
+                deliver(indices[slot], std::move(file));
+            }
+        }
+    }
+
+#else
+
+    struct AsyncFileReader::IoRing
+    {
+        unsigned entries = 0;
+        bool setup(unsigned) { return false; }
+    };
+
+    void AsyncFileReader::readWithRing(IoRing &) {}
+
+#endif
+
+    void AsyncFileReader::start(std::vector<std::string> paths, Callback onRead, AsyncReadBackend backend)
+    {
+        wait();
+        this->paths = std::move(paths);
+        this->onRead = std::move(onRead);
+        next.store(0, std::memory_order_relaxed);
+        bytesRead.store(0, std::memory_order_relaxed);
+        remaining.store(this->paths.size(), std::memory_order_release);
+
+        // The files in the asset pack are already mapped, so they are handed over right away (and they never reach the disk queue)
+        queued.clear();
+        const AssetPack &pack = AssetPack::get();
+        for (std::size_t index = 0; index < this->paths.size(); ++index)
+        {
+            if (pack.isOpen() && pack.findCurrent(this->paths[index]))
+            {
+                AssetFile file;
+                file.open(this->paths[index]);
+                deliver(index, std::move(file));
+            }
+            else
+            {
+                queued.push_back(index);
+            }
+        }
+        if (queued.empty())
+            return;
+
+        if (backend != AsyncReadBackend::THREADS)
+        {
+            auto ring = std::make_shared<IoRing>();
+            if (ring->setup(QUEUE_DEPTH))
+            {
+                usedBackend = AsyncReadBackend::IO_URING;
+                threads.emplace_back([this, ring]()
+                                     { readWithRing(*ring); });
+                return;
+            }
+        }
+        usedBackend = AsyncReadBackend::THREADS;
+        std::size_t threadCount = std::min<std::size_t>(THREAD_COUNT, queued.size());
+        for (std::size_t thread = 0; thread < threadCount; ++thread)
+            threads.emplace_back(&AsyncFileReader::readWithThread, this);
+    }
+
+    void AsyncFileReader::readWithThread()
+    {
+        trace::setThreadName("io");
+        OUR_TRACE_SCOPE("read files (threads)");
+        // The threads take the queued files in the order of the list
+        std::size_t position;
+        while ((position = next.fetch_add(1, std::memory_order_relaxed)) < queued.size())
+        {
+            std::size_t index = queued[position];
+            std::size_t read = 0;
+            AssetFile file = readFileBlocking(paths[index], read);
+            bytesRead.fetch_add(read, std::memory_order_relaxed);
+            deliver(index, std::move(file));
+        }
+    }
+
+    void AsyncFileReader::wait()
+    {
+        for (std::thread &thread : threads)
+            thread.join();
+        threads.clear();
+    }
+
+    const char *AsyncFileReader::getBackendName() const
+    {
+        switch (usedBackend)
+        {
+        case AsyncReadBackend::IO_URING:
+            return "io_uring";
+        default:
+            return "threads";
+        }
+    }
+
+    void AsyncFileReader::deliver(std::size_t index, AssetFile &&file)
+    {
+        onRead(index, std::move(file));
+        remaining.fetch_sub(1, std::memory_order_acq_rel);
+    }
+
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <cstddef>
+
+#include "asset-pack.hpp"
+
+namespace our
+{
+
+    // The ways the asynchronous file reader can read the files
+    enum class AsyncReadBackend
+    {
+        AUTO,     // io_uring if the system supports it, otherwise threads
+        IO_URING, // All the reads are submitted at once to the kernel through an io_uring (Linux only)
+        THREADS,  // A few threads read the files with blocking reads
+    };
+
+    // This class reads a list of files in the background and hands every file to a callback as soon as it is read
+    // so the files can be decoded while the other files are still being read (the disk latency overlaps the decoding work).
+    // - The files found in the mounted asset pack (see "asset-pack.hpp") are handed over right away, since they are already mapped.
+    // - With io_uring, one I/O thread submits the reads of all the files (up to the depth of the ring) and hands them over as they complete.
+    // - Otherwise, a few I/O threads read the files with blocking reads (which also overlaps the latency of several files).
+    // The files are read into memory (instead of being mapped), so the decoders never stall on page faults.
+    class AsyncFileReader
+    {
+    public:
+        // Receives the index of the file in the list and its content (the file is not open if it could not be read)
+        // It is called on an I/O thread (or on the calling thread for the files in the asset pack), so it should only queue the work (e.g. submit a job)
+        using Callback = std::function<void(std::size_t, AssetFile &&)>;
+
+        // The number of files that are read at the same time (by the ring or by the threads)
+        static constexpr unsigned QUEUE_DEPTH = 64;
+        static constexpr unsigned THREAD_COUNT = 4;
+
+        AsyncFileReader() = default;
+        // Waits for the reads that are still in flight
+        ~AsyncFileReader() { wait(); }
+
+        // Starts reading the files (a reader can only run one list at a time, so any previous list is waited for first)
+        void start(std::vector<std::string> paths, Callback onRead, AsyncReadBackend backend = AsyncReadBackend::AUTO);
+        // Returns true once every file was handed to the callback
+        bool isDone() const { return remaining.load(std::memory_order_acquire) == 0; }
+        // Waits until every file was handed to the callback
+        void wait();
+
+        // Returns the backend used by the last list
+        AsyncReadBackend getBackend() const { return usedBackend; }
+        const char *getBackendName() const;
+        // Returns the number of bytes that were read from the files (the files in the asset pack are not counted)
+        std::size_t getBytesRead() const { return bytesRead.load(std::memory_order_relaxed); }
+
+        AsyncFileReader(const AsyncFileReader &) = delete;
+        AsyncFileReader &operator=(const AsyncFileReader &) = delete;
+
+    private:
+        struct IoRing; // The rings shared with the kernel (defined in the source file)
+
+        std::vector<std::string> paths;
+        std::vector<std::size_t> queued; // The indices of the files that are read from the file system (the rest are in the asset pack)
+        Callback onRead;
+        std::vector<std::thread> threads;
+        std::atomic<std::size_t> remaining{0}; // The number of files that were not handed over yet
+        std::atomic<std::size_t> next{0};      // The next queued file to be read by the threads
+        std::atomic<std::size_t> bytesRead{0};
+        AsyncReadBackend usedBackend = AsyncReadBackend::THREADS;
+
+        // Hands a file over to the callback
+        void deliver(std::size_t index, AssetFile &&file);
+        // The body of an I/O thread of the THREADS backend
+        void readWithThread();
+        // The body of the I/O thread of the IO_URING backend
+        void readWithRing(IoRing &ring);
+    };
+
+}
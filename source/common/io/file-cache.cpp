@@ -0,0 +1,182 @@
+#include "file-cache.hpp"
+#include "asset-pack.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <filesystem>
+#include <system_error>
+#include <atomic>
+#include <thread>
+#include <functional>
+
+namespace our
+{
+
+    // The constants & the structure of the hash are borrowed from xxHash64 (with a single lane)
+    namespace
+    {
+        constexpr std::uint64_t PRIME1 = 0x9E3779B185EBCA87ull;
+        constexpr std::uint64_t PRIME2 = 0xC2B2AE3D27D4EB4Full;
+        constexpr std::uint64_t PRIME3 = 0x165667B19E3779F9ull;
+        constexpr std::uint64_t PRIME4 = 0x85EBCA77C2B2AE63ull;
+        constexpr std::uint64_t PRIME5 = 0x27D4EB2F165667C5ull;
+
+        inline std::uint64_t rotateLeft(std::uint64_t value, int bits)
+        {
+            return (value << bits) | (value >> (64 - bits));
+        }
+
+        inline std::uint64_t mixWord(std::uint64_t word)
+        {
+            return rotateLeft(word * PRIME2, 31) * PRIME1;
+        }
+    }
+
+    std::uint64_t hashBytes(const void *data, size_t size, std::uint64_t seed)
+    {
+        auto bytes = static_cast<const unsigned char *>(data);
+        std::uint64_t hash = seed + PRIME5 + std::uint64_t(size);
+        // We consume 8 bytes at a time (memcpy is used since the data may not be aligned)
+        size_t index = 0;
+        for (; index + 8 <= size; index += 8)
+        {
+            std::uint64_t word;
+            std::memcpy(&word, bytes + index, 8);
+            hash ^= mixWord(word);
+            hash = rotateLeft(hash, 27) * PRIME1 + PRIME4;
+        }
+        for (; index < size; ++index)
+        {
+            hash ^= bytes[index] * PRIME5;
+            hash = rotateLeft(hash, 11) * PRIME1;
+        }
+        // The final avalanche makes sure that every input bit affects every output bit
+        hash ^= hash >> 33;
+        hash *= PRIME2;
+        hash ^= hash >> 29;
+        hash *= PRIME3;
+        hash ^= hash >> 32;
+        return hash;
+    }
+
+    bool hashFile(const std::string &path, std::uint64_t &hash, std::uint64_t seed)
+    {
+        AssetFile file;
+        if (!file.open(path))
+            return false;
+        hash = hashBytes(file.data(), file.size(), seed);
+        return true;
+    }
+
+    std::string getCachePath(const std::string &category, std::uint64_t key, const std::string &extension)
+    {
+        char name[17];
+        static const char digits[] = "0123456789abcdef";
+        for (int digit = 15; digit >= 0; --digit, key >>= 4)
+            name[digit] = digits[key & 0xF];
+        name[16] = '\0';
+        return (std::filesystem::path(CACHE_DIRECTORY) / category / (name + extension)).string();
+    }
+
+    namespace
+    {
+        // An index file is this record followed by the path of the source (to tell apart the paths whose hashes collide)
+        struct CacheIndexRecord
+        {
+            char magic[4];
+            std::uint32_t pathLength;
+            SourceStamp stamp;
+            std::uint64_t seed;
+            std::uint64_t key;
+        };
+        constexpr char CACHE_INDEX_MAGIC[4] = {'O', 'I', 'D', 'X'};
+
+        std::string getCacheIndexPath(const std::string &category, const std::string &path)
+        {
+            return getCachePath(category + "/index", hashBytes(path.data(), path.size()), ".key");
+        }
+    }
+
+    bool getSourceStamp(const std::string &path, SourceStamp &stamp)
+    {
+        const AssetPack &pack = AssetPack::get();
+        if (const PackEntry *entry = pack.findCurrent(path))
+        {
+            // The pack is never modified in place, so its own write time stands for the write times of its entries
+            stamp = {entry->size, pack.getModifiedTime()};
+            return true;
+        }
+        std::error_code error;
+        std::uintmax_t size = std::filesystem::file_size(path, error);
+        if (error)
+            return false;
+        auto modifiedTime = std::filesystem::last_write_time(path, error);
+        if (error)
+            return false;
+        stamp = {std::uint64_t(size), std::int64_t(modifiedTime.time_since_epoch().count())};
+        return true;
+    }
+
+    bool findIndexedCacheKey(const std::string &category, const std::string &path, const SourceStamp &stamp, std::uint64_t seed, std::uint64_t &key)
+    {
+        std::ifstream file(getCacheIndexPath(category, path), std::ios::binary);
+        CacheIndexRecord record;
+        if (!file.read(reinterpret_cast<char *>(&record), sizeof(record)))
+            return false;
+        if (std::memcmp(record.magic, CACHE_INDEX_MAGIC, sizeof(CACHE_INDEX_MAGIC)) != 0 || record.pathLength != path.size() ||
+            record.stamp.size != stamp.size || record.stamp.modifiedTime != stamp.modifiedTime || record.seed != seed)
+            return false;
+        std::string recordedPath(record.pathLength, '\0');
+        if (!file.read(recordedPath.data(), std::streamsize(recordedPath.size())) || recordedPath != path)
+            return false;
+        key = record.key;
+        return true;
+    }
+
+    void storeIndexedCacheKey(const std::string &category, const std::string &path, const SourceStamp &stamp, std::uint64_t seed, std::uint64_t key)
+    {
+        CacheIndexRecord record = {};
+        std::memcpy(record.magic, CACHE_INDEX_MAGIC, sizeof(CACHE_INDEX_MAGIC));
+        record.pathLength = std::uint32_t(path.size());
+        record.stamp = stamp;
+        record.seed = seed;
+        record.key = key;
+        std::string bytes(reinterpret_cast<const char *>(&record), sizeof(record));
+        bytes += path;
+        writeFileAtomically(getCacheIndexPath(category, path), bytes.data(), bytes.size());
+    }
+
+    bool writeFileAtomically(const std::string &path, const void *data, size_t size)
+    {
+        std::error_code error;
+        std::filesystem::path parent = std::filesystem::path(path).parent_path();
+        if (!parent.empty())
+            std::filesystem::create_directories(parent, error);
+
+        // The temporary file name is unique to this writer, so concurrent writers of the same file never write into each other's files
+        static std::atomic<unsigned> counter{0};
+        std::string temporaryPath = path + "." +
+                                    std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()) & 0xFFFFFF) + "." +
+                                    std::to_string(counter++) + ".tmp";
+        {
+            std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+            if (!file)
+                return false;
+            file.write(static_cast<const char *>(data), std::streamsize(size));
+            if (!file)
+            {
+                file.close();
+                std::filesystem::remove(temporaryPath, error);
+                return false;
+            }
+        }
+        std::filesystem::rename(temporaryPath, path, error);
+        if (error)
+        {
+            std::filesystem::remove(temporaryPath, error);
+            return false;
+        }
+        return true;
+    }
+
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+namespace our
+{
+
+    // The engine caches the results of expensive asset processing (e.g. parsing a mesh) in files under this directory
+    // Each cache file is named after a hash of the content of its source file (and of the version of the code that wrote it),
+    // so editing a source file or changing the cache format simply makes the engine look for a different file.
+    // The directory can be deleted at any time (the files are written again the next time the assets are loaded).
+    constexpr const char *CACHE_DIRECTORY = ".cache";
+
+    // Returns a 64-bit hash of the given bytes
+    // The hash is fast and well mixed, but it is not cryptographic. It should only be used to detect changes, not tampering.
+    std::uint64_t hashBytes(const void *data, size_t size, std::uint64_t seed = 0);
+    // Computes the hash of the content of a file (the file is read through the asset pack first, see "AssetFile" in "asset-pack.hpp")
+    // Returns false if the file could not be read
+    bool hashFile(const std::string &path, std::uint64_t &hash, std::uint64_t seed = 0);
+
+    // Returns the path of the cache file with the given key (e.g. ".cache/meshes/0123456789abcdef.ourmesh")
+    std::string getCachePath(const std::string &category, std::uint64_t key, const std::string &extension);
+
+    // The stamp of a source file tells whether it may have changed since its content was hashed, without reading it:
+    // the size & the last write time of the file (or of the mounted asset pack if the file is read from the pack).
+    struct SourceStamp
+    {
+        std::uint64_t size;
+        std::int64_t modifiedTime;
+    };
+    // Returns the stamp of the file at the given path (from the pack first, like "AssetFile")
+    // Returns false if neither the pack nor the file system has the file
+    bool getSourceStamp(const std::string &path, SourceStamp &stamp);
+
+    // Since the cache files are named after the hash of the content of their source files, finding the cache file of a source
+    // would need to read & hash the whole source. So every category keeps a small index (".cache/<category>/index/<hash of the path>.key")
+    // that maps a source path, its stamp and the seed of the key (the cache version & the options) to the last key computed for it.
+    // The source is only hashed again when its stamp (or the seed) changes.
+    // Returns true and the key if the index has the given path with the same stamp & seed
+    bool findIndexedCacheKey(const std::string &category, const std::string &path, const SourceStamp &stamp, std::uint64_t seed, std::uint64_t &key);
+    // Records the key of the given source in the index (a failure to write the index is ignored, since it only costs a hash next time)
+    void storeIndexedCacheKey(const std::string &category, const std::string &path, const SourceStamp &stamp, std::uint64_t seed, std::uint64_t key);
+
+    // Writes the given bytes to a file (creating its parent directories if needed)
+    // The bytes are written to a temporary file first then renamed, so a reader never sees a partially written file.
+    // It is safe to write the same file from multiple threads (or processes) at the same time, since every writer uses its own temporary file.
+    bool writeFileAtomically(const std::string &path, const void *data, size_t size);
+
+}
@@ -0,0 +1,197 @@
+#include "lz-codec.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace our
+{
+
+    namespace
+    {
+        constexpr size_t MIN_MATCH = 4;       // The shortest match that is worth encoding
+        constexpr size_t LAST_LITERALS = 5;   // The last bytes of a block are always literals
+        constexpr size_t MATCH_LIMIT = 12;    // No match starts in the last bytes of a block
+        constexpr size_t MAX_OFFSET = 65535;  // The offset is stored in 2 bytes
+        constexpr int HASH_BITS = 14;         // The size of the table that finds the match candidates
+        constexpr std::uint32_t NO_POSITION = UINT32_MAX;
+
+        std::uint32_t read32(const std::uint8_t *pointer)
+        {
+            std::uint32_t value;
+            std::memcpy(&value, pointer, sizeof(value));
+            return value;
+        }
+
+        std::uint32_t hash4(std::uint32_t sequence)
+        {
+            return (sequence * 2654435761u) >> (32 - HASH_BITS);
+        }
+
+        // Writes the part of a count that did not fit in its 4 bits of the token
+        bool writeCount(std::uint8_t *&output, const std::uint8_t *outputEnd, size_t count)
+        {
+            if (size_t(outputEnd - output) < count / 255 + 1)
+                return false;
+            for (; count >= 255; count -= 255)
+                *output++ = 255;
+            *output++ = std::uint8_t(count);
+            return true;
+        }
+
+        // Reads the continuation bytes of a count (see "writeCount")
+        bool readCount(const std::uint8_t *&input, const std::uint8_t *inputEnd, size_t &count)
+        {
+            std::uint8_t byte;
+            do
+            {
+                if (input >= inputEnd)
+                    return false;
+                byte = *input++;
+                count += byte;
+            } while (byte == 255);
+            return true;
+        }
+
+        // Writes a sequence of literals followed by a match (a match length of 0 means that there is no match, which ends the block)
+        bool writeSequence(std::uint8_t *&output, const std::uint8_t *outputEnd, const std::uint8_t *literals, size_t literalCount, size_t offset, size_t matchLength)
+        {
+            if (output >= outputEnd)
+                return false;
+            std::uint8_t *token = output++;
+            *token = std::uint8_t((literalCount < 15 ? literalCount : 15) << 4);
+            if (literalCount >= 15 && !writeCount(output, outputEnd, literalCount - 15))
+                return false;
+            if (size_t(outputEnd - output) < literalCount)
+                return false;
+            std::memcpy(output, literals, literalCount);
+            output += literalCount;
+            if (matchLength == 0)
+                return true;
+            if (outputEnd - output < 2)
+                return false;
+            *output++ = std::uint8_t(offset & 0xFF);
+            *output++ = std::uint8_t(offset >> 8);
+            size_t length = matchLength - MIN_MATCH;
+            *token |= std::uint8_t(length < 15 ? length : 15);
+            return length < 15 || writeCount(output, outputEnd, length - 15);
+        }
+    }
+
+    size_t lzCompressBound(size_t size)
+    {
+        return size + size / 255 + 16;
+    }
+
+    size_t lzCompress(const std::byte *source, size_t size, std::byte *destination, size_t capacity)
+    {
+        const std::uint8_t *input = reinterpret_cast<const std::uint8_t *>(source);
+        const std::uint8_t *inputEnd = input + size;
+        std::uint8_t *output = reinterpret_cast<std::uint8_t *>(destination);
+        const std::uint8_t *outputEnd = output + capacity;
+        const std::uint8_t *anchor = input; // The first byte that was not written yet
+
+        if (size > MATCH_LIMIT)
+        {
+            // The table holds the last position at which each hash of 4 bytes was seen
+            std::vector<std::uint32_t> table(size_t(1) << HASH_BITS, NO_POSITION);
+            const std::uint8_t *matchLimit = inputEnd - MATCH_LIMIT;
+            const std::uint8_t *matchEnd = inputEnd - LAST_LITERALS;
+            const std::uint8_t *current = input;
+            while (current < matchLimit)
+            {
+                std::uint32_t sequence = read32(current);
+                std::uint32_t &slot = table[hash4(sequence)];
+                std::uint32_t candidate = slot;
+                slot = std::uint32_t(current - input);
+                if (candidate == NO_POSITION || size_t(current - input) - candidate > MAX_OFFSET || read32(input + candidate) != sequence)
+                {
+                    // The longer we go without a match, the faster we skip (incompressible data is not searched byte by byte)
+                    current += 1 + ((current - anchor) >> 6);
+                    continue;
+                }
+                const std::uint8_t *match = input + candidate;
+                // Extend the match backwards over the pending literals, then forwards
+                while (current > anchor && match > input && current[-1] == match[-1])
+                {
+                    --current;
+                    --match;
+                }
+                size_t length = MIN_MATCH;
+                while (current + length < matchEnd && current[length] == match[length])
+                    ++length;
+                if (!writeSequence(output, outputEnd, anchor, size_t(current - anchor), size_t(current - match), length))
+                    return 0;
+                current += length;
+                anchor = current;
+                // The position just before the end of the match is hashed too, since it often starts the next match
+                if (current < matchLimit)
+                    table[hash4(read32(current - 2))] = std::uint32_t(current - 2 - input);
+            }
+        }
+        if (!writeSequence(output, outputEnd, anchor, size_t(inputEnd - anchor), 0, 0))
+            return 0;
+        return size_t(output - reinterpret_cast<std::uint8_t *>(destination));
+    }
+
+    bool lzDecompress(const std::byte *source, size_t size, std::byte *destination, size_t decompressedSize)
+    {
+        const std::uint8_t *input = reinterpret_cast<const std::uint8_t *>(source);
+        const std::uint8_t *inputEnd = input + size;
+        std::uint8_t *start = reinterpret_cast<std::uint8_t *>(destination);
+        std::uint8_t *output = start;
+        std::uint8_t *outputEnd = start + decompressedSize;
+        while (input < inputEnd)
+        {
+            std::uint8_t token = *input++;
+            size_t literalCount = token >> 4;
+            if (literalCount == 15 && !readCount(input, inputEnd, literalCount))
+                return false;
+            if (literalCount > size_t(inputEnd - input) || literalCount > size_t(outputEnd - output))
+                return false;
+            // Most literal runs are short, so they are copied with a single fixed size copy when there is room for it
+            if (literalCount <= 16 && inputEnd - input >= 16 && outputEnd - output >= 16)
+                std::memcpy(output, input, 16);
+            else
+                std::memcpy(output, input, literalCount);
+            input += literalCount;
+            output += literalCount;
+            // The last sequence has no match
+            if (input == inputEnd)
+                break;
+            if (inputEnd - input < 2)
+                return false;
+            size_t offset = size_t(input[0]) | (size_t(input[1]) << 8);
+            input += 2;
+            size_t length = token & 15;
+            if (length == 15 && !readCount(input, inputEnd, length))
+                return false;
+            length += MIN_MATCH;
+            if (offset == 0 || offset > size_t(output - start) || length > size_t(outputEnd - output))
+                return false;
+            const std::uint8_t *match = output - offset;
+            if (offset >= 8 && size_t(outputEnd - output) >= length + 8)
+            {
+                // The match is copied 8 bytes at a time. Each copy only reads bytes that were already written (since the offset is at least 8)
+                // and the copy may write up to 7 bytes past the match, which are overwritten by the next sequence.
+                std::uint8_t *end = output + length;
+                for (; output < end; output += 8, match += 8)
+                    std::memcpy(output, match, 8);
+                output = end;
+            }
+            else if (offset >= length)
+            {
+                std::memcpy(output, match, length);
+                output += length;
+            }
+            else
+            {
+                // The match overlaps the bytes it writes (e.g. a run of the same byte), so it is copied forward one byte at a time
+                for (size_t index = 0; index < length; ++index)
+                    *output++ = match[index];
+            }
+        }
+        return output == outputEnd;
+    }
+
+}
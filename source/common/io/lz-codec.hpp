@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+
+namespace our
+{
+
+    // A small LZ77 block codec in the style of LZ4 (the asset pack uses it to compress its blocks, see "asset-pack.hpp")
+    // A compressed block is a list of sequences. Each sequence is:
+    // - a token byte: the high 4 bits hold the literal count and the low 4 bits hold the match length minus 4
+    //   (a value of 15 means that the count continues in the following bytes, each adding up to 255 until a byte is not 255)
+    // - the literal bytes
+    // - a 2-byte little endian offset back into the decompressed data, then the match length continuation bytes (if any)
+    // The last sequence only has literals. Decompression is a tight loop of copies, so it is much faster than reading the bytes from a disk.
+    // Every block is independent, so blocks can be decompressed in any order (and in parallel).
+
+    // Returns the maximum size of the compressed data of a block with the given size
+    size_t lzCompressBound(size_t size);
+    // Compresses the given bytes into "destination" which has room for "capacity" bytes
+    // Returns the compressed size, or 0 if the compressed data does not fit in "capacity"
+    size_t lzCompress(const std::byte *source, size_t size, std::byte *destination, size_t capacity);
+    // Decompresses a block into "destination" which must have the exact decompressed size
+    // Every read and write is checked, so corrupted data returns false instead of reading or writing out of bounds
+    bool lzDecompress(const std::byte *source, size_t size, std::byte *destination, size_t decompressedSize);
+
+}
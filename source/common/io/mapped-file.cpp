@@ -0,0 +1,157 @@
+#include "mapped-file.hpp"
+
+#include <utility>
+#include <algorithm>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace our
+{
+
+#ifdef _WIN32
+
+    bool MappedFile::open(const std::string &path)
+    {
+        close();
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+        {
+            CloseHandle(file);
+            return false;
+        }
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping)
+        {
+            CloseHandle(file);
+            return false;
+        }
+        void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!view)
+        {
+            CloseHandle(mapping);
+            CloseHandle(file);
+            return false;
+        }
+        fileHandle = file;
+        mappingHandle = mapping;
+        address = static_cast<const std::byte *>(view);
+        length = static_cast<size_t>(fileSize.QuadPart);
+        return true;
+    }
+
+    void MappedFile::close()
+    {
+        if (address)
+            UnmapViewOfFile(address);
+        if (mappingHandle)
+            CloseHandle(mappingHandle);
+        if (fileHandle)
+            CloseHandle(fileHandle);
+        address = nullptr;
+        length = 0;
+        fileHandle = mappingHandle = nullptr;
+    }
+
+    void MappedFile::prefetch(size_t offset, size_t size) const
+    {
+        if (!address || offset >= length)
+            return;
+#if defined(_WIN32_WINNT) && _WIN32_WINNT >= 0x0602
+        // PrefetchVirtualMemory is only available since Windows 8
+        WIN32_MEMORY_RANGE_ENTRY range = {const_cast<std::byte *>(address + offset), std::min(size, length - offset)};
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+        (void)size;
+#endif
+    }
+
+    MappedFile::MappedFile(MappedFile &&other) noexcept
+        : address(std::exchange(other.address, nullptr)), length(std::exchange(other.length, 0)),
+          fileHandle(std::exchange(other.fileHandle, nullptr)), mappingHandle(std::exchange(other.mappingHandle, nullptr)) {}
+
+    MappedFile &MappedFile::operator=(MappedFile &&other) noexcept
+    {
+        if (this != &other)
+        {
+            close();
+            address = std::exchange(other.address, nullptr);
+            length = std::exchange(other.length, 0);
+            fileHandle = std::exchange(other.fileHandle, nullptr);
+            mappingHandle = std::exchange(other.mappingHandle, nullptr);
+        }
+        return *this;
+    }
+
+#else
+
+    bool MappedFile::open(const std::string &path)
+    {
+        close();
+        int descriptor = ::open(path.c_str(), O_RDONLY);
+        if (descriptor < 0)
+            return false;
+        struct stat status;
+        if (fstat(descriptor, &status) != 0 || status.st_size <= 0)
+        {
+            ::close(descriptor);
+            return false;
+        }
+        void *mapping = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+        // The mapping keeps its own reference to the file, so the descriptor is no longer needed
+        ::close(descriptor);
+        if (mapping == MAP_FAILED)
+            return false;
+        address = static_cast<const std::byte *>(mapping);
+        length = static_cast<size_t>(status.st_size);
+        return true;
+    }
+
+    void MappedFile::close()
+    {
+        if (address)
+            munmap(const_cast<std::byte *>(address), length);
+        address = nullptr;
+        length = 0;
+    }
+
+    void MappedFile::prefetch(size_t offset, size_t size) const
+    {
+        if (!address || offset >= length)
+            return;
+        // The advice must start at a page boundary
+        size_t pageSize = size_t(sysconf(_SC_PAGESIZE));
+        size_t start = offset - offset % pageSize;
+        size_t end = offset + std::min(size, length - offset);
+        madvise(const_cast<std::byte *>(address + start), end - start, MADV_WILLNEED);
+    }
+
+    MappedFile::MappedFile(MappedFile &&other) noexcept
+        : address(std::exchange(other.address, nullptr)), length(std::exchange(other.length, 0)) {}
+
+    MappedFile &MappedFile::operator=(MappedFile &&other) noexcept
+    {
+        if (this != &other)
+        {
+            close();
+            address = std::exchange(other.address, nullptr);
+            length = std::exchange(other.length, 0);
+        }
+        return *this;
+    }
+
+#endif
+
+}
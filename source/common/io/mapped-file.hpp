@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+namespace our
+{
+
+    // This class maps a whole file into the address space of the process (read only)
+    // The operating system pages the file in on demand, so opening a file is cheap
+    // and the data can be read directly from the mapping without copying it into a buffer.
+    // The mapping is released when the object is destroyed (or when "close" is called).
+    class MappedFile
+    {
+        const std::byte *address = nullptr; // The address of the first byte of the mapping
+        size_t length = 0;                  // The size of the mapped file in bytes
+#ifdef _WIN32
+        void *fileHandle = nullptr;    // The handle of the opened file
+        void *mappingHandle = nullptr; // The handle of the file mapping object
+#endif
+
+    public:
+        MappedFile() = default;
+        ~MappedFile() { close(); }
+
+        // Maps the file at the given path. Any file that was previously mapped by this object is closed first.
+        // Returns false if the file could not be opened or mapped (empty files can not be mapped either).
+        bool open(const std::string &path);
+        // Releases the mapping (if any)
+        void close();
+
+        // Returns true if a file is currently mapped
+        bool isOpen() const { return address != nullptr; }
+        // Returns a pointer to the first byte of the file
+        const std::byte *data() const { return address; }
+        // Returns the size of the file in bytes
+        size_t size() const { return length; }
+        // Asks the operating system to start reading the given range of the file in the background
+        // It turns the page faults of a later access into one large sequential read (it is only a hint, so it may do nothing)
+        void prefetch(size_t offset, size_t size) const;
+
+        MappedFile(MappedFile &&other) noexcept;
+        MappedFile &operator=(MappedFile &&other) noexcept;
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+    };
+
+}
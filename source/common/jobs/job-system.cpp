@@ -0,0 +1,244 @@
+#include "job-system.hpp"
+#include "../trace/trace.hpp"
+
+#include <algorithm>
+#include <string>
+
+namespace our
+{
+
+    // Each worker remembers the job system it belongs to and the index of its queue
+    // Any other thread uses the queue at index 0
+    static thread_local const JobSystem *currentJobSystem = nullptr;
+    static thread_local std::size_t currentQueueIndex = 0;
+
+    JobSystem::JobSystem(unsigned workerCount) : mainThreadId(std::this_thread::get_id())
+    {
+        queues.reserve(workerCount + 1);
+        for (unsigned index = 0; index <= workerCount; ++index)
+            queues.push_back(std::make_unique<WorkerQueue>());
+        workers.reserve(workerCount);
+        for (unsigned index = 1; index <= workerCount; ++index)
+            workers.emplace_back([this, index]()
+                                 { workerLoop(index); });
+    }
+
+    JobSystem::~JobSystem()
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        wakeUp.notify_all();
+        for (auto &worker : workers)
+            worker.join();
+        // Any job left in the queues is run here
+        while (tryRunOne())
+            ;
+        runMainThreadJobs();
+    }
+
+    JobSystem &JobSystem::get()
+    {
+        static JobSystem jobSystem(getDefaultWorkerCount());
+        return jobSystem;
+    }
+
+    unsigned JobSystem::getDefaultWorkerCount()
+    {
+        unsigned hardwareThreads = std::thread::hardware_concurrency();
+        return hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+    }
+
+    std::size_t JobSystem::getQueueIndex() const
+    {
+        return currentJobSystem == this ? currentQueueIndex : 0;
+    }
+
+    void JobSystem::execute(Entry &entry)
+    {
+        entry.job();
+        if (entry.counter)
+            entry.counter->pending.fetch_sub(1, std::memory_order_acq_rel);
+    }
+
+    bool JobSystem::tryPop(Entry &entry)
+    {
+        std::size_t own = getQueueIndex();
+        // First, we pop the newest job from our own queue
+        {
+            WorkerQueue &queue = *queues[own];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.entries.empty())
+            {
+                entry = std::move(queue.entries.back());
+                queue.entries.pop_back();
+                queuedCount.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        // If it is empty, we steal the oldest job from the other queues (starting from our neighbour so that the thieves spread out)
+        for (std::size_t offset = 1; offset < queues.size(); ++offset)
+        {
+            WorkerQueue &queue = *queues[(own + offset) % queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.entries.empty())
+            {
+                entry = std::move(queue.entries.front());
+                queue.entries.pop_front();
+                queuedCount.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void JobSystem::workerLoop(std::size_t index)
+    {
+        trace::setThreadName("worker " + std::to_string(index));
+        currentJobSystem = this;
+        currentQueueIndex = index;
+        while (true)
+        {
+            Entry entry;
+            if (tryPop(entry))
+            {
+                execute(entry);
+                continue;
+            }
+            // If there is nothing to do, we sleep until a job is queued
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wakeUp.wait(lock, [this]()
+                        { return stopping || queuedCount.load(std::memory_order_relaxed) > 0; });
+            if (stopping && queuedCount.load(std::memory_order_relaxed) == 0)
+                return;
+        }
+    }
+
+    void JobSystem::submit(Job job, JobCounter *counter)
+    {
+        if (counter)
+            counter->pending.fetch_add(1, std::memory_order_relaxed);
+        {
+            WorkerQueue &queue = *queues[getQueueIndex()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.entries.push_back({std::move(job), counter});
+        }
+        queuedCount.fetch_add(1, std::memory_order_relaxed);
+        // Taking the lock makes sure that a worker checking whether it should sleep either sees the job or gets notified
+        if (!workers.empty())
+        {
+            {
+                std::lock_guard<std::mutex> lock(sleepMutex);
+            }
+            wakeUp.notify_one();
+        }
+    }
+
+    void JobSystem::submitToMainThread(Job job, JobCounter *counter)
+    {
+        if (counter)
+            counter->pending.fetch_add(1, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(mainThreadMutex);
+        mainThreadEntries.push_back({std::move(job), counter});
+    }
+
+    void JobSystem::runMainThreadJobs()
+    {
+        while (true)
+        {
+            Entry entry;
+            {
+                std::lock_guard<std::mutex> lock(mainThreadMutex);
+                if (mainThreadEntries.empty())
+                    return;
+                entry = std::move(mainThreadEntries.front());
+                mainThreadEntries.pop_front();
+            }
+            execute(entry);
+        }
+    }
+
+    bool JobSystem::tryRunOne()
+    {
+        Entry entry;
+        if (isMainThread())
+        {
+            std::lock_guard<std::mutex> lock(mainThreadMutex);
+            if (!mainThreadEntries.empty())
+            {
+                entry = std::move(mainThreadEntries.front());
+                mainThreadEntries.pop_front();
+            }
+        }
+        if (entry.job || tryPop(entry))
+        {
+            execute(entry);
+            return true;
+        }
+        return false;
+    }
+
+    void JobSystem::wait(const JobCounter &counter)
+    {
+        while (!counter.isDone())
+        {
+            if (!tryRunOne())
+                std::this_thread::yield();
+        }
+    }
+
+    void JobSystem::parallelFor(std::size_t begin, std::size_t end, std::size_t grain, const std::function<void(std::size_t, std::size_t)> &body)
+    {
+        if (begin >= end)
+            return;
+        grain = std::max<std::size_t>(grain, 1);
+        // If there is a single chunk (or no one to share the work with), we just run the chunks here
+        if (end - begin <= grain || workers.empty())
+        {
+            for (std::size_t chunkBegin = begin; chunkBegin < end; chunkBegin += grain)
+                body(chunkBegin, std::min(chunkBegin + grain, end));
+            return;
+        }
+        JobCounter counter;
+        // We queue all the chunks except the first one which we run ourselves
+        for (std::size_t chunkBegin = begin + grain; chunkBegin < end; chunkBegin += grain)
+        {
+            std::size_t chunkEnd = std::min(chunkBegin + grain, end);
+            submit([&body, chunkBegin, chunkEnd]()
+                   { body(chunkBegin, chunkEnd); },
+                   &counter);
+        }
+        body(begin, begin + grain);
+        wait(counter);
+    }
+
+    void JobSystem::parallelFor(std::size_t begin, std::size_t end, const std::function<void(std::size_t, std::size_t)> &body, std::size_t minimumGrain)
+    {
+        if (begin >= end)
+            return;
+        minimumGrain = std::max<std::size_t>(minimumGrain, 1);
+        if (end - begin <= minimumGrain || workers.empty())
+        {
+            body(begin, end);
+            return;
+        }
+        JobCounter counter;
+        // This runs a range, but first it gives away its second half (recursively) as long as there are idle threads to take it
+        std::function<void(std::size_t, std::size_t)> split = [&](std::size_t rangeBegin, std::size_t rangeEnd)
+        {
+            while (rangeEnd - rangeBegin > minimumGrain && queuedCount.load(std::memory_order_relaxed) < getThreadCount())
+            {
+                std::size_t middle = rangeBegin + (rangeEnd - rangeBegin) / 2;
+                submit([&split, middle, rangeEnd]()
+                       { split(middle, rangeEnd); },
+                       &counter);
+                rangeEnd = middle;
+            }
+            body(rangeBegin, rangeEnd);
+        };
+        split(begin, end);
+        wait(counter);
+    }
+
+}
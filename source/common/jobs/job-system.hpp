@@ -0,0 +1,133 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <cstddef>
+
+namespace our
+{
+
+    // A job is any function that takes no arguments and returns nothing
+    typedef std::function<void()> Job;
+
+    // A job counter counts the jobs that were submitted with it and are not done yet.
+    // It is used as a fence: "JobSystem::wait(counter)" returns once every job submitted with the counter is done.
+    // A counter can be reused once it is done, but it must outlive the jobs that were submitted with it.
+    class JobCounter
+    {
+        std::atomic<std::size_t> pending{0};
+        friend class JobSystem;
+
+    public:
+        JobCounter() = default;
+        // Returns true if all the jobs submitted with this counter are done
+        bool isDone() const { return pending.load(std::memory_order_acquire) == 0; }
+        // Returns the number of jobs that are not done yet
+        std::size_t getPendingCount() const { return pending.load(std::memory_order_acquire); }
+
+        JobCounter(const JobCounter &) = delete;
+        JobCounter &operator=(const JobCounter &) = delete;
+    };
+
+    // The job system runs jobs on a set of worker threads using work stealing:
+    // - Every worker has its own deque. A worker pushes the jobs it submits to the back of its deque and pops from the back too
+    //   (so it keeps working on recent jobs whose data is probably still in its cache).
+    // - When its deque is empty, a worker steals from the front of the other deques (the oldest jobs, which are usually the biggest).
+    // - The main thread (the thread that created the job system) also owns a deque, which is used by any thread that is not a worker.
+    // A thread that waits for a counter never sleeps, instead it helps by running jobs until the counter is done.
+    // So a job system with 0 workers is valid: every job is run by the waiting thread.
+    // Jobs that must run on the main thread (e.g. OpenGL calls, since the OpenGL context is only current on the main thread)
+    // are submitted with "submitToMainThread" and are run when the main thread calls "runMainThreadJobs" or waits for a counter.
+    class JobSystem
+    {
+        // A queued job with the counter it should decrement when done (if any)
+        struct Entry
+        {
+            Job job;
+            JobCounter *counter = nullptr;
+        };
+        // The deque of a worker (or of the main thread)
+        // It is protected by a mutex which is almost never contended since the owner is usually the only one touching it
+        struct WorkerQueue
+        {
+            std::mutex mutex;
+            std::deque<Entry> entries;
+        };
+
+        std::vector<std::unique_ptr<WorkerQueue>> queues; // The queue at index 0 belongs to the main thread, the rest belong to the workers
+        std::vector<std::thread> workers;
+        std::thread::id mainThreadId;
+
+        std::mutex mainThreadMutex;          // Protects "mainThreadEntries"
+        std::deque<Entry> mainThreadEntries; // The jobs that must run on the main thread
+
+        std::atomic<std::size_t> queuedCount{0}; // The number of jobs in the worker queues (used to put the idle workers to sleep)
+        std::mutex sleepMutex;
+        std::condition_variable wakeUp; // Notified when a job is queued or the job system is stopping
+        std::atomic<bool> stopping{false};
+
+        // Returns the index of the queue owned by the calling thread
+        std::size_t getQueueIndex() const;
+        // Pops a job from the calling thread's queue or steals one from another queue
+        bool tryPop(Entry &entry);
+        // Runs the job then decrements its counter
+        static void execute(Entry &entry);
+        void workerLoop(std::size_t index);
+
+    public:
+        // Creates a job system with the given number of workers. The calling thread is considered the main thread.
+        explicit JobSystem(unsigned workerCount);
+        // Runs the remaining jobs then joins the workers
+        ~JobSystem();
+
+        // Returns the job system shared by the whole engine
+        // It is created the first time this function is called, so the application calls it first from the main thread.
+        static JobSystem &get();
+
+        // Returns a worker count suitable for this machine (one worker per hardware thread except the main thread)
+        static unsigned getDefaultWorkerCount();
+
+        // Returns the number of threads that run jobs (the workers and the main thread)
+        unsigned getThreadCount() const { return static_cast<unsigned>(workers.size()) + 1; }
+
+        // Returns true if the calling thread is the main thread of this job system
+        bool isMainThread() const { return std::this_thread::get_id() == mainThreadId; }
+
+        // Queues a job to be run by any thread. If a counter is given, it is incremented now and decremented when the job is done.
+        void submit(Job job, JobCounter *counter = nullptr);
+
+        // Queues a job that must be run by the main thread
+        void submitToMainThread(Job job, JobCounter *counter = nullptr);
+
+        // Runs all the queued main thread jobs (this must be called from the main thread, e.g. once every frame)
+        void runMainThreadJobs();
+
+        // Runs one queued job on the calling thread (a main thread job if called from the main thread)
+        // Returns false if no job was found
+        bool tryRunOne();
+
+        // Runs jobs on the calling thread until all the jobs submitted with the given counter are done
+        void wait(const JobCounter &counter);
+
+        // Splits the range [begin, end) into chunks of "grain" elements and calls "body(chunkBegin, chunkEnd)" for each chunk in parallel.
+        // It returns after all the chunks are done.
+        // Since the chunk boundaries only depend on "begin" and "grain", the caller can use (chunkBegin - begin) / grain as a chunk index.
+        void parallelFor(std::size_t begin, std::size_t end, std::size_t grain, const std::function<void(std::size_t, std::size_t)> &body);
+
+        // Same as the above, but the grain size is picked adaptively:
+        // each range is split in halves only while some threads are idle (there are fewer queued jobs than threads),
+        // so the range is divided in a few big chunks when all the threads are busy and in many smaller chunks when they are starving.
+        // The chunks are never smaller than "minimumGrain" elements.
+        void parallelFor(std::size_t begin, std::size_t end, const std::function<void(std::size_t, std::size_t)> &body, std::size_t minimumGrain = 256);
+
+        JobSystem(const JobSystem &) = delete;
+        JobSystem &operator=(const JobSystem &) = delete;
+    };
+
+}
@@ -24,11 +24,33 @@ namespace our
         {
             pipelineState.deserialize(data["pipelineState"]);
         }
-        shader = AssetLoader<ShaderProgram>::get(data["shader"].get<std::string>());
+        shader = AssetLoader<ShaderProgram>::acquire(data["shader"].get<std::string>());
         transparent = data.value("transparent", false);
         gameScreenItem = data.value("gameScreenItem", false);
     }
 
+    // The shader is stored as an index into the shader table of the compiled scene
+    void Material::compile(const nlohmann::json &data, SceneWriter &writer) const
+    {
+        PipelineState state;
+        if (data.contains("pipelineState"))
+        {
+            state.deserialize(data["pipelineState"]);
+        }
+        writer.write(state);
+        writer.writeAsset<ShaderProgram>(data.value("shader", ""));
+        writer.write(data.value("transparent", false));
+        writer.write(data.value("gameScreenItem", false));
+    }
+
+    void Material::deserialize(SceneReader &reader)
+    {
+        pipelineState = reader.read<PipelineState>();
+        shader = AssetLoader<ShaderProgram>::acquire(reader.readAsset<ShaderProgram>());
+        transparent = reader.read<bool>();
+        gameScreenItem = reader.read<bool>();
+    }
+
     // This function should call the setup of its parent and
     // set the "tint" uniform to the value in the member variable tint
     void TintedMaterial::setup() const
@@ -47,6 +69,18 @@ namespace our
         tint = data.value("tint", glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
     }
 
+    void TintedMaterial::compile(const nlohmann::json &data, SceneWriter &writer) const
+    {
+        Material::compile(data, writer);
+        writer.write(data.value("tint", glm::vec4(1.0f, 1.0f, 1.0f, 1.0f)));
+    }
+
+    void TintedMaterial::deserialize(SceneReader &reader)
+    {
+        Material::deserialize(reader);
+        tint = reader.read<glm::vec4>();
+    }
+
     // This function should call the setup of its parent and
     // set the "alphaThreshold" uniform to the value in the member variable alphaThreshold
     // Then it should bind the texture and sampler to a texture unit and send the unit number to the uniform variable "tex"
@@ -71,8 +105,24 @@ namespace our
         if (!data.is_object())
             return;
         alphaThreshold = data.value("alphaThreshold", 0.0f);
-        texture = AssetLoader<Texture2D>::get(data.value("texture", ""));
-        sampler = AssetLoader<Sampler>::get(data.value("sampler", ""));
+        texture = AssetLoader<Texture2D>::acquire(data.value("texture", ""));
+        sampler = AssetLoader<Sampler>::acquire(data.value("sampler", ""));
+    }
+
+    void TexturedMaterial::compile(const nlohmann::json &data, SceneWriter &writer) const
+    {
+        TintedMaterial::compile(data, writer);
+        writer.write(data.value("alphaThreshold", 0.0f));
+        writer.writeAsset<Texture2D>(data.value("texture", ""));
+        writer.writeAsset<Sampler>(data.value("sampler", ""));
+    }
+
+    void TexturedMaterial::deserialize(SceneReader &reader)
+    {
+        TintedMaterial::deserialize(reader);
+        alphaThreshold = reader.read<float>();
+        texture = AssetLoader<Texture2D>::acquire(reader.readAsset<Texture2D>());
+        sampler = AssetLoader<Sampler>::acquire(reader.readAsset<Sampler>());
     }
 
 
@@ -130,16 +180,38 @@ namespace our
             return;
         
 
-        albedo_texture = AssetLoader<Texture2D>::get(data.value("albedo_texture", ""));
-        specular_texture = AssetLoader<Texture2D>::get(data.value("specular_texture", ""));
-        roughness_texture  = AssetLoader<Texture2D>::get(data.value("roughness_texture", ""));
-        ao_texture = AssetLoader<Texture2D>::get(data.value("ao_texture", ""));
-        emission_texture = AssetLoader<Texture2D>::get(data.value("emission_texture", ""));
+        albedo_texture = AssetLoader<Texture2D>::acquire(data.value("albedo_texture", ""));
+        specular_texture = AssetLoader<Texture2D>::acquire(data.value("specular_texture", ""));
+        roughness_texture  = AssetLoader<Texture2D>::acquire(data.value("roughness_texture", ""));
+        ao_texture = AssetLoader<Texture2D>::acquire(data.value("ao_texture", ""));
+        emission_texture = AssetLoader<Texture2D>::acquire(data.value("emission_texture", ""));
         
-        sampler = AssetLoader<Sampler>::get(data.value("sampler", ""));;
+        sampler = AssetLoader<Sampler>::acquire(data.value("sampler", ""));;
 
     }
 
+    void LitMaterial::compile(const nlohmann::json &data, SceneWriter &writer) const
+    {
+        Material::compile(data, writer);
+        writer.writeAsset<Texture2D>(data.value("albedo_texture", ""));
+        writer.writeAsset<Texture2D>(data.value("specular_texture", ""));
+        writer.writeAsset<Texture2D>(data.value("roughness_texture", ""));
+        writer.writeAsset<Texture2D>(data.value("ao_texture", ""));
+        writer.writeAsset<Texture2D>(data.value("emission_texture", ""));
+        writer.writeAsset<Sampler>(data.value("sampler", ""));
+    }
+
+    void LitMaterial::deserialize(SceneReader &reader)
+    {
+        Material::deserialize(reader);
+        albedo_texture = AssetLoader<Texture2D>::acquire(reader.readAsset<Texture2D>());
+        specular_texture = AssetLoader<Texture2D>::acquire(reader.readAsset<Texture2D>());
+        roughness_texture = AssetLoader<Texture2D>::acquire(reader.readAsset<Texture2D>());
+        ao_texture = AssetLoader<Texture2D>::acquire(reader.readAsset<Texture2D>());
+        emission_texture = AssetLoader<Texture2D>::acquire(reader.readAsset<Texture2D>());
+        sampler = AssetLoader<Sampler>::acquire(reader.readAsset<Sampler>());
+    }
+
 
 
     
@@ -4,10 +4,13 @@
 #include "../texture/texture2d.hpp"
 #include "../texture/sampler.hpp"
 #include "../shader/shader.hpp"
+#include "../asset-handle.hpp"
 
 #include <glm/vec4.hpp>
 #include <json/json.hpp>
 
+#include "../scene/scene-stream.hpp"
+
 namespace our {
 
     // This is the base class for all the materials
@@ -19,14 +22,22 @@ namespace our {
     class Material {
     public:
         PipelineState pipelineState;
-        ShaderProgram* shader;
+        // The material holds handles to its assets, so they are never evicted while the material exists
+        AssetHandle<ShaderProgram> shader;
         bool transparent;
         bool gameScreenItem;
+
+        // Materials are deleted through pointers to this base class (e.g. by the asset loader)
+        virtual ~Material() = default;
         
         // This function does 2 things: setup the pipeline state and set the shader program to be used
         virtual void setup() const;
         // This function read a material from a json object
         virtual void deserialize(const nlohmann::json& data);
+        // These functions write & read the binary record of a material in a compiled scene (see "scene/compiled-scene.hpp")
+        // The values must be read in the same order they are written
+        virtual void compile(const nlohmann::json& data, SceneWriter& writer) const;
+        virtual void deserialize(SceneReader& reader);
     };
 
     // This material adds a uniform for a tint (a color that will be sent to the shader)
@@ -37,6 +48,8 @@ namespace our {
 
         void setup() const override;
         void deserialize(const nlohmann::json& data) override;
+        void compile(const nlohmann::json& data, SceneWriter& writer) const override;
+        void deserialize(SceneReader& reader) override;
     };
 
     // This material adds two uniforms (besides the tint from Tinted Material)
@@ -46,12 +59,14 @@ namespace our {
     // An example where this material can be used is when the object has a texture
     class TexturedMaterial : public TintedMaterial {
     public:
-        Texture2D* texture;
-        Sampler* sampler;
+        AssetHandle<Texture2D> texture;
+        AssetHandle<Sampler> sampler;
         float alphaThreshold;
 
         void setup() const override;
         void deserialize(const nlohmann::json& data) override;
+        void compile(const nlohmann::json& data, SceneWriter& writer) const override;
+        void deserialize(SceneReader& reader) override;
     };
 
     
@@ -60,20 +75,22 @@ namespace our {
     public:
 
         //Albedo, Specular, Roughness, Ambient Occlusion, Emission
-        Texture2D* albedo_texture;
-        Texture2D* specular_texture;
-        Texture2D* roughness_texture;
-        Texture2D* ao_texture;
-        Texture2D* emission_texture;
+        AssetHandle<Texture2D> albedo_texture;
+        AssetHandle<Texture2D> specular_texture;
+        AssetHandle<Texture2D> roughness_texture;
+        AssetHandle<Texture2D> ao_texture;
+        AssetHandle<Texture2D> emission_texture;
 
         //One Sampler for all textures
-        Sampler* sampler;
+        AssetHandle<Sampler> sampler;
 
         float shineness;
         float alphaThreshold;
 
         void setup() const override;
         void deserialize(const nlohmann::json& data) override;
+        void compile(const nlohmann::json& data, SceneWriter& writer) const override;
+        void deserialize(SceneReader& reader) override;
     };
     //END OF PHASE 3
     
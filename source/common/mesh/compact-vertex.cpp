@@ -0,0 +1,104 @@
+#include "compact-vertex.hpp"
+
+#include <glm/gtc/packing.hpp>
+#include <atomic>
+
+namespace our
+{
+
+    namespace
+    {
+        std::atomic<bool> compactVertexEnabled{false};
+
+        // Returns 1 for positive numbers and zero, and -1 for negative numbers
+        glm::vec2 signNotZero(glm::vec2 value)
+        {
+            return glm::vec2(value.x >= 0.0f ? 1.0f : -1.0f, value.y >= 0.0f ? 1.0f : -1.0f);
+        }
+
+        // Quantizes a number in [0, 1] to an unsigned normalized 16-bit number
+        std::uint16_t toUnorm16(float value)
+        {
+            return std::uint16_t(glm::round(glm::clamp(value, 0.0f, 1.0f) * 65535.0f));
+        }
+        // Quantizes a number in [-1, 1] to a signed normalized 16-bit number
+        std::int16_t toSnorm16(float value)
+        {
+            return std::int16_t(glm::round(glm::clamp(value, -1.0f, 1.0f) * 32767.0f));
+        }
+    }
+
+    glm::vec2 encodeOctahedral(glm::vec3 normal)
+    {
+        // The normal is projected onto the octahedron |x| + |y| + |z| = 1, then the lower half is folded over the upper half
+        float sum = glm::abs(normal.x) + glm::abs(normal.y) + glm::abs(normal.z);
+        if (sum == 0.0f)
+            return glm::vec2(0.0f);
+        glm::vec2 encoded = glm::vec2(normal.x, normal.y) / sum;
+        if (normal.z < 0.0f)
+            encoded = (1.0f - glm::abs(glm::vec2(encoded.y, encoded.x))) * signNotZero(encoded);
+        return encoded;
+    }
+
+    glm::vec3 decodeOctahedral(glm::vec2 encoded)
+    {
+        glm::vec3 normal = glm::vec3(encoded.x, encoded.y, 1.0f - glm::abs(encoded.x) - glm::abs(encoded.y));
+        if (normal.z < 0.0f)
+        {
+            glm::vec2 folded = (1.0f - glm::abs(glm::vec2(normal.y, normal.x))) * signNotZero(glm::vec2(normal));
+            normal.x = folded.x;
+            normal.y = folded.y;
+        }
+        return glm::normalize(normal);
+    }
+
+    void compactVertices(const Vertex *vertices, size_t vertexCount, glm::vec3 min, glm::vec3 max,
+                         std::vector<CompactVertex> &compact, std::vector<Color> &colors)
+    {
+        // An axis on which the mesh is flat keeps its positions at the minimum
+        glm::vec3 extent = max - min;
+        glm::vec3 inverseExtent = glm::vec3(extent.x > 0.0f ? 1.0f / extent.x : 0.0f,
+                                            extent.y > 0.0f ? 1.0f / extent.y : 0.0f,
+                                            extent.z > 0.0f ? 1.0f / extent.z : 0.0f);
+        compact.resize(vertexCount);
+        colors.clear();
+        bool white = true;
+        for (size_t index = 0; index < vertexCount; ++index)
+        {
+            const Vertex &vertex = vertices[index];
+            glm::vec3 position = (vertex.position - min) * inverseExtent;
+            glm::vec2 normal = encodeOctahedral(vertex.normal);
+            compact[index].position = glm::u16vec4(toUnorm16(position.x), toUnorm16(position.y), toUnorm16(position.z), 0);
+            compact[index].normal = glm::i16vec2(toSnorm16(normal.x), toSnorm16(normal.y));
+            compact[index].tex_coord = glm::u16vec2(glm::packHalf1x16(vertex.tex_coord.x), glm::packHalf1x16(vertex.tex_coord.y));
+            white = white && vertex.color == Color(255);
+        }
+        if (!white)
+        {
+            colors.resize(vertexCount);
+            for (size_t index = 0; index < vertexCount; ++index)
+                colors[index] = vertices[index].color;
+        }
+    }
+
+    Vertex expandVertex(const CompactVertex &vertex, Color color, glm::vec3 min, glm::vec3 max)
+    {
+        Vertex expanded;
+        expanded.position = min + glm::vec3(vertex.position) / 65535.0f * (max - min);
+        expanded.color = color;
+        expanded.tex_coord = glm::vec2(glm::unpackHalf1x16(vertex.tex_coord.x), glm::unpackHalf1x16(vertex.tex_coord.y));
+        expanded.normal = decodeOctahedral(glm::max(glm::vec2(vertex.normal) / 32767.0f, -1.0f));
+        return expanded;
+    }
+
+    void mesh_utils::setCompactVertices(bool enabled)
+    {
+        compactVertexEnabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    bool mesh_utils::isCompactVertexEnabled()
+    {
+        return compactVertexEnabled.load(std::memory_order_relaxed);
+    }
+
+}
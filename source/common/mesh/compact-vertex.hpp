@@ -0,0 +1,50 @@
+#pragma once
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+
+#include "vertex.hpp"
+
+namespace our
+{
+
+    // The compact vertex stores the same data as the vertex (see "vertex.hpp") in 16 bytes instead of 36,
+    // so a mesh uses less than half of the VRAM and the memory bandwidth that it needs to be drawn:
+    // - The position is quantized to 16 bits per axis relative to the bounding box of the mesh
+    //   (so the precision is 1/65535 of the size of the mesh on each axis).
+    // - The normal is encoded as a point on an octahedron (2 signed normalized 16-bit numbers).
+    // - The texture coordinates are half floats.
+    // - The colors are stored in a separate stream, which a mesh only has if one of its vertices is not white.
+    // The vertex shaders turn the position & the normal back into floats using the uniforms that the mesh sets (see "Mesh::setDequantization").
+    struct CompactVertex
+    {
+        glm::u16vec4 position;  // x, y & z in the bounding box ([0, 65535] maps to [min, max]), the 4th component is padding
+        glm::i16vec2 normal;    // The octahedral encoding of the normal
+        glm::u16vec2 tex_coord; // Half floats
+    };
+    static_assert(sizeof(CompactVertex) == 16, "The compact vertex must be 16 bytes");
+
+    // Returns the octahedral encoding of a normal (each component is in [-1, 1])
+    glm::vec2 encodeOctahedral(glm::vec3 normal);
+    // Returns the normal of an octahedral encoding
+    glm::vec3 decodeOctahedral(glm::vec2 encoded);
+
+    // Converts the vertices to compact vertices given the bounding box of their positions
+    // The colors are written to "colors" unless every vertex is white (then "colors" is left empty)
+    void compactVertices(const Vertex *vertices, size_t vertexCount, glm::vec3 min, glm::vec3 max,
+                         std::vector<CompactVertex> &compact, std::vector<Color> &colors);
+    // Converts a compact vertex back to a vertex (e.g. to check the precision of the conversion)
+    Vertex expandVertex(const CompactVertex &vertex, Color color, glm::vec3 min, glm::vec3 max);
+
+    namespace mesh_utils
+    {
+        // Enables or disables the compact vertex format for the loaded meshes (it is disabled by default)
+        // If it is enabled, "loadMeshData" compacts every mesh after parsing it, so the compact mesh is stored in the mesh cache
+        // (the compact and the float meshes are cached under different keys).
+        void setCompactVertices(bool enabled);
+        bool isCompactVertexEnabled();
+    }
+
+}
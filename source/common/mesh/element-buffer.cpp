@@ -0,0 +1,75 @@
+#include "element-buffer.hpp"
+
+#include <algorithm>
+
+namespace our
+{
+
+    void packElements(const GLuint *elements, size_t elementCount, size_t vertexCount, PackedElements &packed)
+    {
+        size_t triangleCount = elementCount / 3;
+        packed.shorts.clear();
+        packed.integers.clear();
+        packed.ranges.clear();
+        if (triangleCount == 0)
+            return;
+
+        if (vertexCount <= SHORT_ELEMENT_VERTICES)
+        {
+            packed.shorts.assign(elements, elements + triangleCount * 3);
+            packed.ranges.push_back({GL_UNSIGNED_SHORT, 0, GLsizei(triangleCount * 3), 0});
+            return;
+        }
+
+        // The window of every triangle (or "outside" if it does not fit in its window), and the number of triangles in every window
+        size_t windowCount = (vertexCount + SHORT_ELEMENT_WINDOW_STRIDE - 1) / SHORT_ELEMENT_WINDOW_STRIDE;
+        size_t outside = windowCount;
+        std::vector<std::uint32_t> windows(triangleCount);
+        std::vector<size_t> counts(windowCount + 1, 0);
+        for (size_t triangle = 0; triangle < triangleCount; ++triangle)
+        {
+            const GLuint *corners = elements + 3 * triangle;
+            GLuint low = std::min({corners[0], corners[1], corners[2]});
+            GLuint high = std::max({corners[0], corners[1], corners[2]});
+            size_t window = low / SHORT_ELEMENT_WINDOW_STRIDE;
+            if (high - window * SHORT_ELEMENT_WINDOW_STRIDE >= SHORT_ELEMENT_VERTICES)
+                window = outside;
+            windows[triangle] = std::uint32_t(window);
+            ++counts[window];
+        }
+
+        // The windows are laid out in order, and every window gets a range if it has triangles
+        std::vector<size_t> firsts(windowCount + 1, 0);
+        size_t shortCount = 0;
+        for (size_t window = 0; window < windowCount; ++window)
+        {
+            firsts[window] = shortCount;
+            if (counts[window] > 0)
+                packed.ranges.push_back({GL_UNSIGNED_SHORT, shortCount * sizeof(std::uint16_t), GLsizei(counts[window] * 3),
+                                         GLint(window * SHORT_ELEMENT_WINDOW_STRIDE)});
+            shortCount += counts[window] * 3;
+        }
+        packed.shorts.resize(shortCount);
+        packed.integers.resize(counts[outside] * 3);
+        if (counts[outside] > 0)
+            packed.ranges.push_back({GL_UNSIGNED_INT, packed.getIntegerOffset(), GLsizei(counts[outside] * 3), 0});
+
+        for (size_t triangle = 0; triangle < triangleCount; ++triangle)
+        {
+            const GLuint *corners = elements + 3 * triangle;
+            size_t window = windows[triangle];
+            if (window == outside)
+            {
+                std::copy(corners, corners + 3, packed.integers.begin() + firsts[outside]);
+            }
+            else
+            {
+                GLuint base = GLuint(window * SHORT_ELEMENT_WINDOW_STRIDE);
+                for (int corner = 0; corner < 3; ++corner)
+                    packed.shorts[firsts[window] + corner] = std::uint16_t(corners[corner] - base);
+            }
+            firsts[window] += 3;
+        }
+    }
+
+}
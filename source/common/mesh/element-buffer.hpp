@@ -0,0 +1,52 @@
+#pragma once
+
+#include <glad/gl.h>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace our
+{
+
+    // The element buffer of a mesh is uploaded with the smallest element type that can address its vertices,
+    // since the elements are read for every drawn triangle (16-bit elements use half of the memory and the bandwidth of 32-bit elements):
+    // - If the mesh has at most 65536 vertices, its elements are 16-bit and the mesh is drawn with one draw call.
+    // - Otherwise, the vertices are covered by windows of 65536 vertices that start every 32768 vertices, and every triangle goes to
+    //   the window that starts before its lowest vertex. Every window is drawn by its own draw call with 16-bit elements
+    //   where the base vertex is the start of the window. The triangles that do not fit in their window (their vertices are more than 32768 apart)
+    //   are stored after the 16-bit elements in the same buffer as 32-bit elements, and are drawn by one more draw call.
+    //   So a mesh is drawn by at most "vertexCount / 32768 + 2" draw calls, and the triangles keep their order within every range.
+    //   (when the vertices are in the order the triangles use them, e.g. after the vertex fetch optimization, the windows follow the triangle order)
+
+    // The number of vertices that 16-bit elements can address
+    constexpr size_t SHORT_ELEMENT_VERTICES = 65536;
+    // The distance between the starts of two consecutive windows of vertices
+    constexpr size_t SHORT_ELEMENT_WINDOW_STRIDE = SHORT_ELEMENT_VERTICES / 2;
+
+    // A range of the element buffer that is drawn by one draw call
+    struct ElementRange
+    {
+        GLenum type;        // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+        size_t offset;      // The offset of the first element of the range in the element buffer (in bytes)
+        GLsizei count;      // The number of elements in the range
+        GLint baseVertex;   // The value that is added to the elements of the range before reading the vertices
+    };
+
+    // The content of an element buffer: the 16-bit elements followed by the 32-bit elements (at "getIntegerOffset()")
+    struct PackedElements
+    {
+        std::vector<std::uint16_t> shorts;
+        std::vector<GLuint> integers;
+        std::vector<ElementRange> ranges; // The ranges that draw the whole mesh
+
+        // The 32-bit elements are aligned to 4 bytes
+        size_t getIntegerOffset() const { return (shorts.size() * sizeof(std::uint16_t) + 3) & ~size_t(3); }
+        // Returns the size of the element buffer in bytes
+        size_t getByteCount() const { return integers.empty() ? shorts.size() * sizeof(std::uint16_t) : getIntegerOffset() + integers.size() * sizeof(GLuint); }
+    };
+
+    // Converts the elements of a mesh with "vertexCount" vertices to the smallest element types and splits them into ranges if needed
+    // The incomplete triangle at the end of the elements (if any) is dropped, since it is never drawn anyway
+    void packElements(const GLuint *elements, size_t elementCount, size_t vertexCount, PackedElements &packed);
+
+}
@@ -0,0 +1,111 @@
+#include "mesh-cache.hpp"
+#include "mesh-utils.hpp"
+#include "mesh-optimizer.hpp"
+#include "compact-vertex.hpp"
+#include "../io/file-cache.hpp"
+#include "../io/asset-pack.hpp"
+
+#include <cstring>
+#include <vector>
+
+namespace our
+{
+
+    namespace
+    {
+        constexpr std::uint32_t alignTo16(std::uint32_t offset)
+        {
+            return (offset + 15u) & ~15u;
+        }
+    }
+
+    bool CachedMesh::open(const std::string &path, std::uint64_t key)
+    {
+        close();
+        if (!file.open(path))
+            return false;
+        auto candidate = reinterpret_cast<const MeshCacheHeader *>(file.data());
+        // Every range is checked in 64-bit, so corrupted counts can not overflow the checks
+        bool valid = file.size() >= sizeof(MeshCacheHeader) &&
+                     std::memcmp(candidate->magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC)) == 0 &&
+                     candidate->version == MESH_CACHE_VERSION &&
+                     candidate->key == key &&
+                     candidate->vertexFormat <= 1 &&
+                     candidate->vertexSize == (candidate->vertexFormat == 1 ? sizeof(CompactVertex) : sizeof(Vertex)) &&
+                     candidate->vertexOffset % 16 == 0 && candidate->colorOffset % 16 == 0 && candidate->elementOffset % 16 == 0 &&
+                     std::uint64_t(candidate->vertexOffset) + std::uint64_t(candidate->vertexCount) * candidate->vertexSize <= file.size() &&
+                     std::uint64_t(candidate->colorOffset) + std::uint64_t(candidate->vertexCount) * sizeof(Color) <= file.size() &&
+                     (candidate->colorOffset == 0 || candidate->vertexFormat == 1) &&
+                     std::uint64_t(candidate->elementOffset) + std::uint64_t(candidate->elementCount) * sizeof(GLuint) <= file.size();
+        if (!valid)
+        {
+            file.close();
+            return false;
+        }
+        header = candidate;
+        return true;
+    }
+
+    void CachedMesh::close()
+    {
+        header = nullptr;
+        file.close();
+    }
+
+    bool getMeshCacheKey(const std::string &sourcePath, std::uint64_t &key)
+    {
+        AssetFile source;
+        if (!source.open(sourcePath))
+            return false;
+        key = getMeshCacheKey(source);
+        return true;
+    }
+
+    std::uint64_t getMeshCacheSeed()
+    {
+        // The version is part of the key, so a new version never even opens the files of an older one
+        // So are the mesh optimization and the compact vertex format, since they change the buffers
+        return MESH_CACHE_VERSION | (std::uint64_t(mesh_utils::isMeshOptimizationEnabled()) << 32) |
+               (std::uint64_t(mesh_utils::isCompactVertexEnabled()) << 33);
+    }
+
+    std::uint64_t getMeshCacheKey(const AssetFile &source)
+    {
+        return hashBytes(source.data(), source.size(), getMeshCacheSeed());
+    }
+
+    std::string getMeshCachePath(std::uint64_t key)
+    {
+        return getCachePath("meshes", key, MESH_CACHE_EXTENSION);
+    }
+
+    bool saveMeshCache(const mesh_utils::MeshData &data, std::uint64_t key, const std::string &path)
+    {
+        MeshCacheHeader header = {};
+        std::memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC));
+        header.version = MESH_CACHE_VERSION;
+        header.key = key;
+        bool compact = data.isCompact();
+        header.vertexFormat = compact ? 1 : 0;
+        header.vertexSize = std::uint32_t(compact ? sizeof(CompactVertex) : sizeof(Vertex));
+        header.vertexCount = std::uint32_t(data.getVertexCount());
+        header.vertexOffset = alignTo16(sizeof(MeshCacheHeader));
+        std::uint32_t verticesEnd = header.vertexOffset + header.vertexCount * header.vertexSize;
+        const Color *colors = compact ? data.getColors() : nullptr;
+        header.colorOffset = colors ? alignTo16(verticesEnd) : 0;
+        header.elementCount = std::uint32_t(data.getElementCount());
+        header.elementOffset = alignTo16(colors ? header.colorOffset + header.vertexCount * std::uint32_t(sizeof(Color)) : verticesEnd);
+        header.min = data.min;
+        header.max = data.max;
+
+        std::vector<std::byte> bytes(header.elementOffset + header.elementCount * sizeof(GLuint));
+        std::memcpy(bytes.data(), &header, sizeof(header));
+        const void *vertices = compact ? static_cast<const void *>(data.getCompactVertices()) : static_cast<const void *>(data.getVertices());
+        std::memcpy(bytes.data() + header.vertexOffset, vertices, header.vertexCount * header.vertexSize);
+        if (colors)
+            std::memcpy(bytes.data() + header.colorOffset, colors, header.vertexCount * sizeof(Color));
+        std::memcpy(bytes.data() + header.elementOffset, data.getElements(), header.elementCount * sizeof(GLuint));
+        return writeFileAtomically(path, bytes.data(), bytes.size());
+    }
+
+}
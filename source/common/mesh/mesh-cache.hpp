@@ -0,0 +1,91 @@
+#pragma once
+
+#include <glad/gl.h>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+#include "vertex.hpp"
+#include "compact-vertex.hpp"
+#include "../io/mapped-file.hpp"
+
+namespace our
+{
+
+    class AssetFile;
+
+    // The mesh cache stores the final vertex & element buffers of every loaded mesh file (after parsing and removing duplicated vertices)
+    // in ".cache/meshes/<hash>.ourmesh" where the hash is computed from the content of the mesh file, the cache version
+    // and whether the mesh optimization & the compact vertex format are enabled (see "mesh-optimizer.hpp" & "compact-vertex.hpp").
+    // On the next startup, the cache file is memory mapped and its buffers are sent to the GPU as they are (no parsing and no hashing of vertices).
+    // A cache file is never updated: If the mesh file changes (or the cache version changes), the engine looks for a different cache file.
+
+    // The layout of a mesh cache file:
+    //      MeshCacheHeader
+    //      The vertices (vertexCount * vertexSize bytes starting at vertexOffset), which are either Vertex or CompactVertex (see vertexFormat)
+    //      The colors of the compact vertices (vertexCount * sizeof(Color) bytes starting at colorOffset) if the mesh has a color stream
+    //      The elements (elementCount * sizeof(GLuint) bytes starting at elementOffset)
+    constexpr char MESH_CACHE_MAGIC[4] = {'O', 'M', 'S', 'H'};
+    // Increment this whenever the layout of the file, the vertex structure or the output of the mesh loader changes
+    constexpr std::uint32_t MESH_CACHE_VERSION = 3;
+    // The extension of the mesh cache files
+    constexpr const char *MESH_CACHE_EXTENSION = ".ourmesh";
+
+    struct MeshCacheHeader
+    {
+        char magic[4];
+        std::uint32_t version;
+        std::uint64_t key;          // The hash of the source file (the cache file name is derived from it)
+        std::uint32_t vertexFormat; // 0 for Vertex and 1 for CompactVertex
+        std::uint32_t vertexSize;   // The size of the vertex format when the file was written
+        std::uint32_t vertexCount;
+        std::uint32_t vertexOffset; // The offsets are aligned to 16 bytes
+        std::uint32_t colorOffset;  // 0 if there is no color stream (the float vertices never have one)
+        std::uint32_t elementCount;
+        std::uint32_t elementOffset;
+        glm::vec3 min, max;         // The bounding box of the mesh
+    };
+
+    namespace mesh_utils
+    {
+        struct MeshData;
+    }
+
+    // This class maps a mesh cache file and gives access to its buffers
+    class CachedMesh
+    {
+        MappedFile file;
+        const MeshCacheHeader *header = nullptr;
+
+    public:
+        // Maps the cache file at the given path and checks that it was written for the given key by this version of the engine
+        // Returns false if the file does not exist, is stale or is corrupted
+        bool open(const std::string &path, std::uint64_t key);
+        void close();
+        bool isOpen() const { return header != nullptr; }
+
+        bool isCompact() const { return header->vertexFormat == 1; }
+        // Returns nullptr if the vertices are in the other format
+        const Vertex *getVertices() const { return isCompact() ? nullptr : reinterpret_cast<const Vertex *>(file.data() + header->vertexOffset); }
+        const CompactVertex *getCompactVertices() const { return isCompact() ? reinterpret_cast<const CompactVertex *>(file.data() + header->vertexOffset) : nullptr; }
+        // Returns nullptr if there is no color stream
+        const Color *getColors() const { return header->colorOffset ? reinterpret_cast<const Color *>(file.data() + header->colorOffset) : nullptr; }
+        size_t getVertexCount() const { return header->vertexCount; }
+        const GLuint *getElements() const { return reinterpret_cast<const GLuint *>(file.data() + header->elementOffset); }
+        size_t getElementCount() const { return header->elementCount; }
+        glm::vec3 getMin() const { return header->min; }
+        glm::vec3 getMax() const { return header->max; }
+    };
+
+    // Returns the seed of the keys of the mesh cache files (the cache version & the options that change the buffers)
+    std::uint64_t getMeshCacheSeed();
+    // Returns the key of the cache file of a mesh file (or false if the mesh file could not be read)
+    bool getMeshCacheKey(const std::string &sourcePath, std::uint64_t &key);
+    // Returns the key of the cache file of a mesh file that was already read (e.g. by the "AsyncFileReader")
+    std::uint64_t getMeshCacheKey(const AssetFile &source);
+    // Returns the path of the cache file with the given key
+    std::string getMeshCachePath(std::uint64_t key);
+    // Writes the mesh data into a cache file
+    bool saveMeshCache(const mesh_utils::MeshData &data, std::uint64_t key, const std::string &path);
+
+}
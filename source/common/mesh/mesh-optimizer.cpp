@@ -0,0 +1,289 @@
+#include "mesh-optimizer.hpp"
+#include "mesh-utils.hpp"
+#include "../trace/trace.hpp"
+
+#include <atomic>
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+    std::atomic<bool> meshOptimizationEnabled{false};
+
+    constexpr GLuint NO_VERTEX = std::numeric_limits<GLuint>::max();
+
+    // Simulates a FIFO vertex cache: a vertex is in the cache if fewer than "size" vertices were transformed since it was transformed
+    class VertexCache
+    {
+        std::vector<size_t> times; // The time at which each vertex was last transformed
+        size_t size, time;
+    public:
+        VertexCache(size_t vertexCount, size_t size) : times(vertexCount, 0), size(size), time(size + 1) {}
+
+        // Returns true (and transforms the vertex) if the vertex is not in the cache
+        bool miss(GLuint vertex)
+        {
+            if (time - times[vertex] <= size)
+                return false;
+            times[vertex] = time++;
+            return true;
+        }
+        // Returns the number of vertices of the triangle that are not in the cache
+        size_t missTriangle(const GLuint *triangle) { return miss(triangle[0]) + miss(triangle[1]) + miss(triangle[2]); }
+        // Empties the cache
+        void clear() { time += size + 1; }
+    };
+
+    // Returns the number of vertices that are transformed to draw the triangles
+    size_t countTransformedVertices(const GLuint *elements, size_t elementCount, size_t vertexCount, size_t cacheSize)
+    {
+        VertexCache cache(vertexCount, cacheSize);
+        size_t misses = 0;
+        for (size_t element = 0; element + 2 < elementCount; element += 3)
+            misses += cache.missTriangle(elements + element);
+        return misses;
+    }
+}
+
+float our::mesh_utils::computeACMR(const GLuint *elements, size_t elementCount, size_t vertexCount, size_t cacheSize)
+{
+    size_t triangleCount = elementCount / 3;
+    if (triangleCount == 0)
+        return 0.0f;
+    return float(countTransformedVertices(elements, elementCount, vertexCount, cacheSize)) / float(triangleCount);
+}
+
+float our::mesh_utils::computeATVR(const GLuint *elements, size_t elementCount, size_t vertexCount, size_t cacheSize)
+{
+    std::vector<bool> used(vertexCount, false);
+    size_t usedCount = 0;
+    for (size_t element = 0; element < elementCount; ++element)
+    {
+        if (!used[elements[element]])
+        {
+            used[elements[element]] = true;
+            ++usedCount;
+        }
+    }
+    if (usedCount == 0)
+        return 0.0f;
+    return float(countTransformedVertices(elements, elementCount, vertexCount, cacheSize)) / float(usedCount);
+}
+
+void our::mesh_utils::optimizeVertexCache(std::vector<GLuint> &elements, size_t vertexCount, size_t cacheSize)
+{
+    OUR_TRACE_SCOPE("optimize vertex cache");
+    size_t triangleCount = elements.size() / 3;
+    if (triangleCount == 0)
+        return;
+
+    // "live" is the number of triangles that use each vertex and are not emitted yet
+    // The triangles of each vertex are stored in "adjacency" from "offsets[vertex]" to "offsets[vertex + 1]"
+    std::vector<GLuint> live(vertexCount, 0), offsets(vertexCount + 1, 0), adjacency(triangleCount * 3);
+    for (size_t element = 0; element < triangleCount * 3; ++element)
+        ++live[elements[element]];
+    for (size_t vertex = 0; vertex < vertexCount; ++vertex)
+        offsets[vertex + 1] = offsets[vertex] + live[vertex];
+    {
+        std::vector<GLuint> filled(offsets.begin(), offsets.end() - 1);
+        for (size_t element = 0; element < triangleCount * 3; ++element)
+            adjacency[filled[elements[element]]++] = GLuint(element / 3);
+    }
+
+    std::vector<size_t> cacheTimes(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<GLuint> deadEnds, candidates, result;
+    result.reserve(triangleCount * 3);
+    size_t time = cacheSize + 1;
+    size_t cursor = 0; // The vertices before the cursor have no triangles left
+
+    // Returns the next vertex that still has triangles when the optimizer reaches a dead end
+    // It prefers the most recently used vertices (which may still be in the cache), then it takes the next vertex in the input order.
+    auto skipDeadEnd = [&]() -> GLuint
+    {
+        while (!deadEnds.empty())
+        {
+            GLuint vertex = deadEnds.back();
+            deadEnds.pop_back();
+            if (live[vertex] > 0)
+                return vertex;
+        }
+        while (cursor < vertexCount && live[cursor] == 0)
+            ++cursor;
+        return cursor < vertexCount ? GLuint(cursor) : NO_VERTEX;
+    };
+
+    GLuint fanning = skipDeadEnd();
+    while (fanning != NO_VERTEX)
+    {
+        // Every remaining triangle around the fanning vertex is emitted
+        candidates.clear();
+        for (GLuint adjacent = offsets[fanning]; adjacent < offsets[fanning + 1]; ++adjacent)
+        {
+            GLuint triangle = adjacency[adjacent];
+            if (emitted[triangle])
+                continue;
+            emitted[triangle] = true;
+            for (int corner = 0; corner < 3; ++corner)
+            {
+                GLuint vertex = elements[3 * triangle + corner];
+                result.push_back(vertex);
+                deadEnds.push_back(vertex);
+                candidates.push_back(vertex);
+                --live[vertex];
+                if (time - cacheTimes[vertex] > cacheSize)
+                    cacheTimes[vertex] = time++;
+            }
+        }
+        // The next fanning vertex is the oldest candidate that would still be in the cache after emitting its remaining triangles
+        // (each triangle may add up to 2 vertices to the cache). If none would, any candidate that still has triangles is taken.
+        GLuint best = NO_VERTEX;
+        long bestPriority = -1;
+        for (GLuint vertex : candidates)
+        {
+            if (live[vertex] == 0)
+                continue;
+            long priority = 0;
+            if (time - cacheTimes[vertex] + 2 * live[vertex] <= cacheSize)
+                priority = long(time - cacheTimes[vertex]);
+            if (priority > bestPriority)
+            {
+                best = vertex;
+                bestPriority = priority;
+            }
+        }
+        fanning = best != NO_VERTEX ? best : skipDeadEnd();
+    }
+    elements.swap(result);
+}
+
+void our::mesh_utils::optimizeOverdraw(std::vector<GLuint> &elements, const std::vector<Vertex> &vertices, float threshold, size_t cacheSize)
+{
+    OUR_TRACE_SCOPE("optimize overdraw");
+    size_t triangleCount = elements.size() / 3;
+    if (triangleCount == 0)
+        return;
+
+    // The mesh is split into clusters wherever none of the vertices of a triangle is in the cache, since the cache locality is already lost there
+    // (which is where the vertex cache optimization jumped to another part of the mesh)
+    std::vector<size_t> clusters;
+    VertexCache cache(vertices.size(), cacheSize);
+    for (size_t triangle = 0; triangle < triangleCount; ++triangle)
+        if (cache.missTriangle(&elements[3 * triangle]) == 3 || triangle == 0)
+            clusters.push_back(triangle);
+
+    // Then, the clusters are split wherever the ACMR of the triangles since the last split is already within the threshold of the ACMR of the whole cluster
+    // (the cache is emptied at every split, since the next triangles may be drawn after any other cluster)
+    std::vector<size_t> starts;
+    for (size_t cluster = 0; cluster < clusters.size(); ++cluster)
+    {
+        size_t begin = clusters[cluster];
+        size_t end = cluster + 1 < clusters.size() ? clusters[cluster + 1] : triangleCount;
+        cache.clear();
+        size_t misses = 0;
+        for (size_t triangle = begin; triangle < end; ++triangle)
+            misses += cache.missTriangle(&elements[3 * triangle]);
+        float limit = float(misses) / float(end - begin) * threshold;
+
+        starts.push_back(begin);
+        cache.clear();
+        misses = 0;
+        size_t start = begin;
+        for (size_t triangle = begin; triangle + 1 < end; ++triangle)
+        {
+            misses += cache.missTriangle(&elements[3 * triangle]);
+            if (float(misses) <= limit * float(triangle + 1 - start))
+            {
+                start = triangle + 1;
+                starts.push_back(start);
+                cache.clear();
+                misses = 0;
+            }
+        }
+    }
+
+    // The center and the average normal (from the normals of the vertices) of every cluster, weighted by the areas of the triangles
+    struct Cluster
+    {
+        size_t begin, end;
+        glm::vec3 center = glm::vec3(0), normal = glm::vec3(0);
+        float area = 0, sortKey = 0;
+    };
+    std::vector<Cluster> sorted(starts.size());
+    glm::vec3 meshCenter = glm::vec3(0);
+    float meshArea = 0;
+    for (size_t index = 0; index < starts.size(); ++index)
+    {
+        Cluster &cluster = sorted[index];
+        cluster.begin = starts[index];
+        cluster.end = index + 1 < starts.size() ? starts[index + 1] : triangleCount;
+        glm::vec3 unweightedCenter = glm::vec3(0);
+        for (size_t triangle = cluster.begin; triangle < cluster.end; ++triangle)
+        {
+            const Vertex &v0 = vertices[elements[3 * triangle]];
+            const Vertex &v1 = vertices[elements[3 * triangle + 1]];
+            const Vertex &v2 = vertices[elements[3 * triangle + 2]];
+            glm::vec3 center = (v0.position + v1.position + v2.position) / 3.0f;
+            float area = 0.5f * glm::length(glm::cross(v1.position - v0.position, v2.position - v0.position));
+            cluster.center += center * area;
+            cluster.normal += (v0.normal + v1.normal + v2.normal) * area;
+            cluster.area += area;
+            unweightedCenter += center;
+        }
+        meshCenter += cluster.center;
+        meshArea += cluster.area;
+        // A cluster of degenerate triangles gets the plain average of their centers
+        cluster.center = cluster.area > 0 ? cluster.center / cluster.area : unweightedCenter / float(cluster.end - cluster.begin);
+        float length = glm::length(cluster.normal);
+        cluster.normal = length > 0 ? cluster.normal / length : glm::vec3(0);
+    }
+    if (meshArea > 0)
+        meshCenter /= meshArea;
+
+    // The clusters that face away from the center are drawn first since they are more likely to occlude the other clusters
+    for (Cluster &cluster : sorted)
+        cluster.sortKey = glm::dot(cluster.center - meshCenter, cluster.normal);
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster &first, const Cluster &second) { return first.sortKey > second.sortKey; });
+
+    std::vector<GLuint> result;
+    result.reserve(elements.size());
+    for (const Cluster &cluster : sorted)
+        result.insert(result.end(), elements.begin() + 3 * cluster.begin, elements.begin() + 3 * cluster.end);
+    elements.swap(result);
+}
+
+void our::mesh_utils::optimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<GLuint> &elements)
+{
+    OUR_TRACE_SCOPE("optimize vertex fetch");
+    std::vector<GLuint> remap(vertices.size(), NO_VERTEX);
+    std::vector<Vertex> result;
+    result.reserve(vertices.size());
+    for (GLuint &element : elements)
+    {
+        if (remap[element] == NO_VERTEX)
+        {
+            remap[element] = GLuint(result.size());
+            result.push_back(vertices[element]);
+        }
+        element = remap[element];
+    }
+    vertices.swap(result);
+}
+
+void our::mesh_utils::optimizeMesh(MeshData &data)
+{
+    OUR_TRACE_SCOPE("optimize mesh");
+    optimizeVertexCache(data.elements, data.vertices.size());
+    optimizeOverdraw(data.elements, data.vertices);
+    optimizeVertexFetch(data.vertices, data.elements);
+}
+
+void our::mesh_utils::setMeshOptimization(bool enabled)
+{
+    meshOptimizationEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool our::mesh_utils::isMeshOptimizationEnabled()
+{
+    return meshOptimizationEnabled.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <glad/gl.h>
+#include <vector>
+#include <cstddef>
+
+#include "vertex.hpp"
+
+namespace our::mesh_utils {
+    struct MeshData;
+
+    // The mesh optimizer reorders the buffers of a mesh so that the GPU draws it faster (the drawn triangles stay the same):
+    // 1- "optimizeVertexCache" reorders the triangles so that the vertices they share are still in the post-transform vertex cache
+    //    (so every vertex is transformed by the vertex shader fewer times).
+    // 2- "optimizeOverdraw" reorders groups of those triangles so that the triangles that face outward are drawn first
+    //    (so more of the hidden pixels are rejected by the depth test), while keeping most of the vertex cache locality.
+    // 3- "optimizeVertexFetch" reorders the vertices in the order the triangles use them (so the vertex fetches read the memory in order).
+    // The quality of the vertex cache order is measured by simulating a FIFO cache:
+    // - ACMR (average cache miss ratio): the transformed vertices per triangle (between 0.5 and 3, lower is better)
+    // - ATVR (average transformed vertex ratio): the transformed vertices per vertex (1 is the best)
+
+    // The size of the simulated vertex cache (the post-transform caches of the GPUs keep at least this many vertices)
+    constexpr size_t VERTEX_CACHE_SIZE = 16;
+    // How much the ACMR of a cluster may worsen when the overdraw optimization splits it into smaller clusters
+    // (the mesh loses a bit more, since every cluster starts with the cache of another cluster)
+    constexpr float OVERDRAW_THRESHOLD = 1.05f;
+
+    // Returns the ACMR of the triangles ("elements" has 3 elements per triangle)
+    float computeACMR(const GLuint* elements, size_t elementCount, size_t vertexCount, size_t cacheSize = VERTEX_CACHE_SIZE);
+    // Returns the ATVR of the triangles (relative to the number of vertices they use)
+    float computeATVR(const GLuint* elements, size_t elementCount, size_t vertexCount, size_t cacheSize = VERTEX_CACHE_SIZE);
+
+    // Reorders the triangles for the vertex cache (using the Tipsify algorithm by Sander et al.)
+    void optimizeVertexCache(std::vector<GLuint>& elements, size_t vertexCount, size_t cacheSize = VERTEX_CACHE_SIZE);
+    // Reorders clusters of triangles to reduce the overdraw (the triangles should already be in the order given by "optimizeVertexCache")
+    // The mesh is split into clusters where the vertex cache locality is lost anyway, and the clusters are split further while the locality
+    // stays within the threshold. Then they are sorted by how much they face outward (the dot product of their average normal
+    // and their offset from the center of the mesh), so the outer triangles are drawn first.
+    void optimizeOverdraw(std::vector<GLuint>& elements, const std::vector<Vertex>& vertices,
+                          float threshold = OVERDRAW_THRESHOLD, size_t cacheSize = VERTEX_CACHE_SIZE);
+    // Reorders the vertices in the order they are first used by the triangles (the elements are remapped and the unused vertices are removed)
+    void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<GLuint>& elements);
+
+    // Runs the three optimizations on the mesh data (which must be in its vectors, not in the mesh cache)
+    void optimizeMesh(MeshData& data);
+
+    // Enables or disables the optimization of the loaded meshes (it is disabled by default)
+    // If it is enabled, "loadMeshData" optimizes every mesh after parsing it, so the optimized mesh is stored in the mesh cache
+    // (the optimized and the unoptimized meshes are cached under different keys).
+    void setMeshOptimization(bool enabled);
+    bool isMeshOptimizationEnabled();
+}
@@ -1,111 +1,225 @@
 #include "mesh-utils.hpp"
-
-// We will use "Tiny OBJ Loader" to read and process '.obj" files
-#define TINYOBJLOADER_IMPLEMENTATION
-#include <tinyobj/tiny_obj_loader.h>
+#include "../io/asset-pack.hpp"
+#include "obj-parser.hpp"
+#include "vertex-welder.hpp"
+#include "mesh-optimizer.hpp"
+#include "compact-vertex.hpp"
+#include "../io/file-cache.hpp"
+#include "../trace/trace.hpp"
 
 #include <iostream>
 #include <vector>
-#include <unordered_map>
 
-our::Mesh *our::mesh_utils::loadOBJ(const char *filename)
+bool our::mesh_utils::parseOBJ(const char *filename, MeshData &data)
 {
+    // The file is read from the asset pack if it has the file (see "io/asset-pack.hpp")
+    our::AssetFile file;
+    file.open(filename);
+    return parseOBJ(file, filename, data);
+}
 
-    // The data that we will use to initialize our mesh
-    std::vector<our::Vertex> vertices;
-    std::vector<GLuint> elements;
-
-    // Since the OBJ can have duplicated vertices, we make them unique using this map
-    // The key is the vertex, the value is its index in the vector "vertices".
-    // That index will be used to populate the "elements" vector.
-    std::unordered_map<our::Vertex, GLuint> vertex_map;
+bool our::mesh_utils::parseOBJ(const AssetFile &file, const char *filename, MeshData &data)
+{
+    OUR_TRACE_SCOPE_DETAIL("parse obj", filename);
 
-    // The data loaded by Tiny OBJ Loader
-    tinyobj::attrib_t attrib;
-    std::vector<tinyobj::shape_t> shapes;
-    std::vector<tinyobj::material_t> materials;
-    std::string warn, err;
+    // The data that we will use to initialize our mesh
+    std::vector<our::Vertex> &vertices = data.vertices;
+    std::vector<GLuint> &elements = data.elements;
+    vertices.clear();
+    elements.clear();
+    data.cache.close();
 
-    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filename))
+    if (!file.isOpen())
     {
-        std::cerr << "Failed to load obj file \"" << filename << "\" due to error: " << err << std::endl;
-        return nullptr; // was false and now nullptr
+        std::cerr << "Failed to load obj file \"" << filename << "\" since it could not be opened" << std::endl;
+        return false;
     }
-    if (!warn.empty())
+    // The file is parsed in parallel by the OBJ parser (see "obj-parser.hpp")
+    ObjData obj;
+    std::string error;
+    if (!parseObj(reinterpret_cast<const char *>(file.data()), file.size(), obj, error))
     {
-        std::cout << "WARN while loading obj file \"" << filename << "\": " << warn << std::endl;
+        std::cerr << "Failed to load obj file \"" << filename << "\" due to error: " << error << std::endl;
+        return false;
     }
 
     // An obj file can have multiple shapes where each shape can have its own material
     // Ideally, we would load each shape into a separate mesh or store the start and end of it in the element buffer to be able to draw each shape separately
     // But we ignored this fact since we don't plan to use multiple materials in the examples
 
+    // Since the OBJ can have duplicated vertices, we make them unique using the vertex welder (see "vertex-welder.hpp")
+    // It gives every corner the index of its vertex in the vector "vertices".
+    // That index will be used to populate the "elements" vector.
+    OUR_TRACE_SCOPE("weld vertices");
+    VertexWelder welder(vertices, obj.corners.size());
+    elements.reserve(obj.corners.size());
+
     // for getting the bounding box
     glm::vec3 min = {INT16_MAX, INT16_MAX, INT16_MAX};
     glm::vec3 max = {INT16_MIN, INT16_MIN, INT16_MIN};
 
-    for (const auto &shape : shapes)
+    for (size_t triangle = 0; triangle < obj.corners.size(); triangle += 3)
     {
-        for (const auto &index : shape.mesh.indices)
+        const ObjCorner *corners = &obj.corners[triangle];
+        // The corners without a normal get the normal of their triangle (so a file without normals is shaded flat)
+        glm::vec3 faceNormal = glm::cross(obj.positions[corners[1].position] - obj.positions[corners[0].position],
+                                          obj.positions[corners[2].position] - obj.positions[corners[0].position]);
+        float length = glm::length(faceNormal);
+        faceNormal = length > 0 ? faceNormal / length : glm::vec3(0, 1, 0);
+
+        for (int corner = 0; corner < 3; ++corner)
         {
-
+            const ObjCorner &index = corners[corner];
             Vertex vertex = {};
-
-            // Read the data for a vertex from the "attrib" object
-            vertex.position = {
-                attrib.vertices[3 * index.vertex_index + 0],
-                attrib.vertices[3 * index.vertex_index + 1],
-                attrib.vertices[3 * index.vertex_index + 2]};
+            vertex.position = obj.positions[index.position];
+            vertex.color = obj.colors[index.position];
+            // The corners without a texture coordinate get (0, 0)
+            if (index.texcoord != OBJ_MISSING_INDEX)
+                vertex.tex_coord = obj.texcoords[index.texcoord];
+            vertex.normal = index.normal != OBJ_MISSING_INDEX ? obj.normals[index.normal] : faceNormal;
 
             // for getting the bounding box (min,max)
-            if (vertex.position.x > max.x)
-                max.x = vertex.position.x;
-            if (vertex.position.y > max.y)
-                max.y = vertex.position.y;
-            if (vertex.position.z > max.z)
-                max.z = vertex.position.z;
-            if (vertex.position.x < min.x)
-                min.x = vertex.position.x;
-            if (vertex.position.y < min.y)
-                min.y = vertex.position.y;
-            if (vertex.position.z < min.z)
-                min.z = vertex.position.z;
-
-            vertex.normal = {
-                attrib.normals[3 * index.normal_index + 0],
-                attrib.normals[3 * index.normal_index + 1],
-                attrib.normals[3 * index.normal_index + 2]};
-
-            vertex.tex_coord = {
-                attrib.texcoords[2 * index.texcoord_index + 0],
-                attrib.texcoords[2 * index.texcoord_index + 1]};
-
-            vertex.color = {
-                attrib.colors[3 * index.vertex_index + 0] * 255,
-                attrib.colors[3 * index.vertex_index + 1] * 255,
-                attrib.colors[3 * index.vertex_index + 2] * 255,
-                255};
-
-            // See if we already stored a similar vertex
-            auto it = vertex_map.find(vertex);
-            if (it == vertex_map.end())
-            {
-                // if no, add it to the vertices and record its index
-                auto new_vertex_index = static_cast<GLuint>(vertices.size());
-                vertex_map[vertex] = new_vertex_index;
-                elements.push_back(new_vertex_index);
-                vertices.push_back(vertex);
-            }
-            else
-            {
-                // if yes, just add its index in the elements vector
-                elements.push_back(it->second);
-            }
+            min = glm::min(min, vertex.position);
+            max = glm::max(max, vertex.position);
+
+            // The welder adds the vertex to the vertices only if we did not already store an equal vertex
+            elements.push_back(welder.add(vertex));
         }
     }
 
-    Mesh *mesh = new our::Mesh(vertices, elements);
-    mesh->setBoundingBox(min, max);
+    data.min = min;
+    data.max = max;
+    return true;
+}
+
+namespace
+{
+    constexpr const char *MESH_CACHE_CATEGORY = "meshes";
 
+    // Opens the cache file with the given key into the mesh data (the buffers are read from the mapped cache file as they are)
+    bool openMeshCache(std::uint64_t key, our::mesh_utils::MeshData &data)
+    {
+        if (!data.cache.open(our::getMeshCachePath(key), key))
+            return false;
+        data.vertices.clear();
+        data.elements.clear();
+        data.min = data.cache.getMin();
+        data.max = data.cache.getMax();
+        return true;
+    }
+
+    // Loads the mesh data from the content of the file once the index of the cache (see "findIndexedCacheKey") did not know the file
+    // "stamp" is the stamp of the file (or nullptr if it is unknown)
+    bool loadMeshDataFromFile(const our::AssetFile &file, const char *filename, const our::SourceStamp *stamp, our::mesh_utils::MeshData &data)
+    {
+        if (!file.isOpen())
+        {
+            std::cerr << "Failed to open mesh file \"" << filename << "\"" << std::endl;
+            return false;
+        }
+        std::uint64_t key = our::getMeshCacheKey(file);
+        // The stamp is not recorded if the file was obviously modified after it was stamped
+        if (stamp && stamp->size == file.size())
+            our::storeIndexedCacheKey(MESH_CACHE_CATEGORY, filename, *stamp, our::getMeshCacheSeed(), key);
+        // The content may have been cached under another path or before the file was touched
+        if (openMeshCache(key, data))
+            return true;
+        // Cold start: the file is parsed (then optimized & compacted if they are enabled, see "mesh-optimizer.hpp" & "compact-vertex.hpp")
+        // then cached for the next time
+        if (!our::mesh_utils::parseOBJ(file, filename, data))
+            return false;
+        if (our::mesh_utils::isMeshOptimizationEnabled())
+            our::mesh_utils::optimizeMesh(data);
+        if (our::mesh_utils::isCompactVertexEnabled())
+            our::mesh_utils::compactMesh(data);
+        std::string cachePath = our::getMeshCachePath(key);
+        if (!our::saveMeshCache(data, key, cachePath))
+            std::cerr << "WARN: Failed to write the mesh cache \"" << cachePath << "\"" << std::endl;
+        return true;
+    }
+}
+
+bool our::mesh_utils::loadMeshData(const char *filename, MeshData &data)
+{
+    OUR_TRACE_SCOPE_DETAIL("load mesh", filename);
+    // Warm start: if the file did not change since it was hashed, its cache file is opened without reading or hashing the file
+    SourceStamp stamp;
+    bool stamped = getSourceStamp(filename, stamp);
+    std::uint64_t key;
+    if (stamped && findIndexedCacheKey(MESH_CACHE_CATEGORY, filename, stamp, getMeshCacheSeed(), key) && openMeshCache(key, data))
+        return true;
+    // Otherwise, the file is read once, then it is both hashed and parsed (if the cache does not have it) from memory
+    our::AssetFile file;
+    file.open(filename);
+    return loadMeshDataFromFile(file, filename, stamped ? &stamp : nullptr, data);
+}
+
+bool our::mesh_utils::loadMeshData(const AssetFile &file, const char *filename, MeshData &data)
+{
+    OUR_TRACE_SCOPE_DETAIL("load mesh", filename);
+    // The file is already read, but hashing it can still be skipped if it did not change since it was hashed
+    SourceStamp stamp;
+    bool stamped = getSourceStamp(filename, stamp);
+    std::uint64_t key;
+    if (file.isOpen() && stamped && findIndexedCacheKey(MESH_CACHE_CATEGORY, filename, stamp, getMeshCacheSeed(), key) && openMeshCache(key, data))
+        return true;
+    return loadMeshDataFromFile(file, filename, stamped ? &stamp : nullptr, data);
+}
+
+void our::mesh_utils::compactMesh(MeshData &data)
+{
+    OUR_TRACE_SCOPE("compact mesh");
+    if (data.vertices.empty())
+        return;
+    compactVertices(data.vertices.data(), data.vertices.size(), data.min, data.max, data.compactVertices, data.colors);
+    // The float vertices are not needed anymore
+    std::vector<Vertex>().swap(data.vertices);
+}
+
+our::Mesh *our::mesh_utils::createMesh(const MeshData &data)
+{
+    OUR_TRACE_SCOPE("upload mesh");
+    Mesh *mesh;
+    if (data.isCompact())
+        mesh = new our::Mesh(data.getCompactVertices(), data.getColors(), data.getVertexCount(), data.getElements(), data.getElementCount(), data.min, data.max);
+    else
+        mesh = new our::Mesh(data.getVertices(), data.getVertexCount(), data.getElements(), data.getElementCount());
+    mesh->setBoundingBox(data.min, data.max);
     return mesh;
+}
+
+our::Mesh *our::mesh_utils::loadOBJ(const char *filename)
+{
+    MeshData data;
+    if (!loadMeshData(filename, data))
+        return nullptr;
+    return createMesh(data);
+}
+
+our::mesh_utils::MeshData our::mesh_utils::makeUnitCube()
+{
+    MeshData data;
+    // Each face has its own 4 vertices so that every face gets its own normal and texture coordinates
+    const glm::vec3 normals[6] = {{1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}};
+    for (const glm::vec3 &normal : normals)
+    {
+        // Two axes perpendicular to the normal such that (u, v, normal) is right-handed (so the faces are counter clockwise from outside)
+        glm::vec3 u = glm::vec3(normal.y, normal.z, normal.x);
+        glm::vec3 v = glm::cross(normal, u);
+        GLuint first = static_cast<GLuint>(data.vertices.size());
+        const glm::vec2 corners[4] = {{0, 0}, {1, 0}, {1, 1}, {0, 1}};
+        for (const glm::vec2 &corner : corners)
+        {
+            Vertex vertex;
+            vertex.position = 0.5f * normal + (corner.x - 0.5f) * u + (corner.y - 0.5f) * v;
+            vertex.color = {255, 255, 255, 255};
+            vertex.tex_coord = corner;
+            vertex.normal = normal;
+            data.vertices.push_back(vertex);
+        }
+        data.elements.insert(data.elements.end(), {first, first + 1, first + 2, first + 2, first + 3, first});
+    }
+    data.min = glm::vec3(-0.5f);
+    data.max = glm::vec3(0.5f);
+    return data;
 }
\ No newline at end of file
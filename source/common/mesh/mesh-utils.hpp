@@ -1,8 +1,61 @@
 #pragma once
 
 #include "mesh.hpp"
+#include "mesh-cache.hpp"
+
+#include <vector>
 
 namespace our::mesh_utils {
-    // Load an ".obj" file into the mesh
+    // The data of a mesh after it is read from a file and before it is sent to the GPU
+    // Reading a mesh does not use OpenGL, so it can be done on any thread
+    // If the data was read from the mesh cache, the vectors are empty and the buffers are read directly from the mapped cache file
+    // so use "getVertices" & "getElements" (instead of the vectors) when reading the buffers
+    // If the mesh was compacted (see "compactMesh"), its vertices are in "compactVertices" (and its colors are in "colors" unless they are all white)
+    // instead of "vertices", so use "getCompactVertices" & "getColors" instead of "getVertices"
+    struct MeshData {
+        std::vector<Vertex> vertices;
+        std::vector<GLuint> elements;
+        std::vector<CompactVertex> compactVertices;
+        std::vector<Color> colors;
+        glm::vec3 min, max; // The bounding box of the mesh
+        CachedMesh cache;
+
+        bool isCompact() const { return cache.isOpen() ? cache.isCompact() : !compactVertices.empty(); }
+        const Vertex* getVertices() const { return cache.isOpen() ? cache.getVertices() : vertices.data(); }
+        const CompactVertex* getCompactVertices() const { return cache.isOpen() ? cache.getCompactVertices() : compactVertices.data(); }
+        // Returns nullptr if the mesh has no color stream
+        const Color* getColors() const { return cache.isOpen() ? cache.getColors() : (colors.empty() ? nullptr : colors.data()); }
+        size_t getVertexCount() const { return cache.isOpen() ? cache.getVertexCount() : (isCompact() ? compactVertices.size() : vertices.size()); }
+        const GLuint* getElements() const { return cache.isOpen() ? cache.getElements() : elements.data(); }
+        size_t getElementCount() const { return cache.isOpen() ? cache.getElementCount() : elements.size(); }
+        // Returns the number of bytes that the buffers of the mesh will use in the VRAM
+        // (the elements of the meshes with more than 65536 vertices are counted as 32-bit, although most of them are 16-bit, see "element-buffer.hpp")
+        size_t getByteCount() const {
+            size_t vertexSize = isCompact() ? sizeof(CompactVertex) + (getColors() ? sizeof(Color) : 0) : sizeof(Vertex);
+            size_t elementSize = getVertexCount() <= SHORT_ELEMENT_VERTICES ? sizeof(GLushort) : sizeof(GLuint);
+            return getVertexCount() * vertexSize + getElementCount() * elementSize;
+        }
+    };
+
+    // Read an ".obj" file into the mesh data (it is thread safe and does not need an OpenGL context)
+    // Returns false if the file could not be loaded
+    bool parseOBJ(const char* filename, MeshData& data);
+    // Like "parseOBJ" but the file was already read (e.g. by the "AsyncFileReader"), the filename is only used in the messages
+    bool parseOBJ(const AssetFile& file, const char* filename, MeshData& data);
+    // Read a mesh file into the mesh data using the mesh cache (see "mesh-cache.hpp")
+    // If the cache has the mesh, it is mapped without parsing the file. Otherwise, the file is parsed and the result is added to the cache.
+    // Like "parseOBJ", it is thread safe and does not need an OpenGL context
+    bool loadMeshData(const char* filename, MeshData& data);
+    // Like "loadMeshData" but the file was already read (so it is hashed and parsed without reading it again)
+    bool loadMeshData(const AssetFile& file, const char* filename, MeshData& data);
+    // Converts the vertices of the mesh data to compact vertices (see "compact-vertex.hpp"), the data must be in its vectors (not in the mesh cache)
+    void compactMesh(MeshData& data);
+    // Create a mesh from the mesh data (it must be called on the thread that owns the OpenGL context)
+    Mesh* createMesh(const MeshData& data);
+
+    // Returns the data of a unit cube (centered at the origin with a side length of 1)
+    MeshData makeUnitCube();
+
+    // Load an ".obj" file into the mesh (through the mesh cache)
     Mesh* loadOBJ(const char* filename);
 }
\ No newline at end of file
@@ -2,6 +2,11 @@
 
 #include <glad/gl.h>
 #include "vertex.hpp"
+#include "compact-vertex.hpp"
+#include "element-buffer.hpp"
+#include "../shader/shader.hpp"
+#include <vector>
+#include <utility>
 
 namespace our
 {
@@ -17,12 +22,45 @@ namespace our
         // A vertex array object, A vertex buffer and an element buffer
         unsigned int VBO, EBO;
         unsigned int VAO;
-        // We need to remember the number of elements that will be draw by glDrawElements
+        // A compact mesh stores its colors in a separate vertex buffer (0 if all of its vertices are white)
+        unsigned int colorVBO = 0;
+        // We need to remember the number of elements that will be draw (the draw calls read them from "elementRanges")
         GLsizei elementCount;
+        // The ranges of the element buffer that are drawn with their element types & base vertices (see "element-buffer.hpp")
+        std::vector<ElementRange> elementRanges;
+        // The number of bytes that the vertex & element buffers use in the VRAM (used by the asset budgets)
+        size_t byteCount;
 
         // add bounding box for the mesh (AABB)
         glm::vec3 boundingBox[2]; // 0-->min, 1-->max
 
+        // The uniforms that the vertex shader uses to turn the vertex attributes back into floats (see "setDequantization")
+        // The positions are "positionOffset + position * positionScale" & the normals are octahedral if "octahedralNormal" is true
+        glm::vec3 positionScale = glm::vec3(1.0f), positionOffset = glm::vec3(0.0f);
+        bool octahedralNormal = false;
+
+        // Creates the element buffer (the vertex array must be bound) with the smallest element types for the vertices of the mesh
+        // and returns its size in bytes
+        size_t createElementBuffer(const unsigned int *elements, size_t elementCount, size_t vertexCount)
+        {
+            PackedElements packed;
+            packElements(elements, elementCount, vertexCount, packed);
+            this->elementCount = GLsizei(elementCount);
+            this->elementRanges = std::move(packed.ranges);
+            size_t size = packed.getByteCount();
+
+            glGenBuffers(1, &this->EBO);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->EBO);
+            // The 16-bit elements are followed by the 32-bit elements (if any)
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, packed.integers.empty() ? packed.shorts.data() : nullptr, GL_STATIC_DRAW);
+            if (!packed.integers.empty())
+            {
+                glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, packed.shorts.size() * sizeof(std::uint16_t), packed.shorts.data());
+                glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, packed.getIntegerOffset(), packed.integers.size() * sizeof(GLuint), packed.integers.data());
+            }
+            return size;
+        }
+
     public:
         // Set the bounding box for the mesh accourding to AABB method
         void setBoundingBox(const glm::vec3 &min, const glm::vec3 &max)
@@ -52,13 +90,18 @@ namespace our
         // an element buffer to store the element data on the VRAM,
         // a vertex array object to define how to read the vertex & element buffer during rendering
         Mesh(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &elements)
+            : Mesh(vertices.data(), vertices.size(), elements.data(), elements.size())
+        {
+        }
+
+        // This constructor reads the vertex & element data from raw arrays (e.g. from a memory mapped file)
+        Mesh(const Vertex *vertices, size_t vertexCount, const unsigned int *elements, size_t elementCount)
         {
             // TODO: Write this function
             //  remember to store the number of elements in "elementCount" since you will need it for drawing
             //  For the attribute locations, use the constants defined above: ATTRIB_LOC_POSITION, ATTRIB_LOC_COLOR, etc
 
-            this->elementCount = elements.size();
-            GLsizei verticesCount = vertices.size();
+            GLsizei verticesCount = GLsizei(vertexCount);
 
             // Vertex Array
             // The first parameter is the number of vertex array need to be generated
@@ -66,16 +109,13 @@ namespace our
             glGenVertexArrays(1, &this->VAO); // get an id for the vertix array object
             glBindVertexArray(this->VAO);     // bind the vertex array object
 
-            // Element buffer (EBO)
-            glGenBuffers(1, &this->EBO);                      // get an id for the elements buffer
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->EBO); // bind the elements buffer
-            glBufferData(GL_ELEMENT_ARRAY_BUFFER, this->elementCount * sizeof(unsigned int), elements.data(), GL_STATIC_DRAW);
-            //-----------------------------------size of elements array in bytes, reference to the elements array, Static:The data store contents will be modified once and used many times.
+            // Element buffer (EBO): its elements are 16-bit if possible (see "createElementBuffer")
+            this->byteCount = vertexCount * sizeof(Vertex) + createElementBuffer(elements, elementCount, vertexCount);
 
             // Vertex Buffer
             glGenBuffers(1, &this->VBO);              // get an id for the vertices buffer
             glBindBuffer(GL_ARRAY_BUFFER, this->VBO); // bind the vertices buffer
-            glBufferData(GL_ARRAY_BUFFER, verticesCount * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+            glBufferData(GL_ARRAY_BUFFER, verticesCount * sizeof(Vertex), vertices, GL_STATIC_DRAW);
             //-----------------------------------size of vertices array in bytes, reference to the vertices array, Static:The data store contents will be modified once and used many times.
 
             // Attributes (Define the attributes for the vertex array object)
@@ -111,15 +151,76 @@ namespace our
             glEnableVertexAttribArray(ATTRIB_LOC_NORMAL);
             glVertexAttribPointer(ATTRIB_LOC_NORMAL, 3, GL_FLOAT, false, sizeof(Vertex), (void *)offsetof(Vertex, normal));
         }
+
+        // This constructor reads compact vertices (see "compact-vertex.hpp") whose positions are quantized in the bounding box [min, max]
+        // "colors" has a color for every vertex, or is nullptr if all of the vertices are white
+        Mesh(const CompactVertex *vertices, const Color *colors, size_t vertexCount, const unsigned int *elements, size_t elementCount,
+             glm::vec3 min, glm::vec3 max)
+        {
+            this->positionScale = max - min;
+            this->positionOffset = min;
+            this->octahedralNormal = true;
+
+            glGenVertexArrays(1, &this->VAO);
+            glBindVertexArray(this->VAO);
+
+            this->byteCount = vertexCount * (sizeof(CompactVertex) + (colors ? sizeof(Color) : 0)) + createElementBuffer(elements, elementCount, vertexCount);
+
+            glGenBuffers(1, &this->VBO);
+            glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
+            glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(CompactVertex), vertices, GL_STATIC_DRAW);
+
+            // 1) Position Attribute: 3 unsigned shorts that are normalized to [0, 1] (the shader maps them to the bounding box)
+            glEnableVertexAttribArray(ATTRIB_LOC_POSITION);
+            glVertexAttribPointer(ATTRIB_LOC_POSITION, 3, GL_UNSIGNED_SHORT, true, sizeof(CompactVertex), (void *)offsetof(CompactVertex, position));
+
+            // 2) Texture Attribute: 2 half floats
+            glEnableVertexAttribArray(ATTRIB_LOC_TEXCOORD);
+            glVertexAttribPointer(ATTRIB_LOC_TEXCOORD, 2, GL_HALF_FLOAT, false, sizeof(CompactVertex), (void *)offsetof(CompactVertex, tex_coord));
+
+            // 3) Normal Attribute: 2 shorts that are normalized to [-1, 1] (the shader decodes the octahedral normal)
+            glEnableVertexAttribArray(ATTRIB_LOC_NORMAL);
+            glVertexAttribPointer(ATTRIB_LOC_NORMAL, 2, GL_SHORT, true, sizeof(CompactVertex), (void *)offsetof(CompactVertex, normal));
+
+            // 4) Color Attribute: read from its own buffer if the mesh has one, otherwise "draw" sets it to white
+            if (colors)
+            {
+                glGenBuffers(1, &this->colorVBO);
+                glBindBuffer(GL_ARRAY_BUFFER, this->colorVBO);
+                glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(Color), colors, GL_STATIC_DRAW);
+                glEnableVertexAttribArray(ATTRIB_LOC_COLOR);
+                glVertexAttribPointer(ATTRIB_LOC_COLOR, 4, GL_UNSIGNED_BYTE, true, sizeof(Color), (void *)0);
+            }
+        }
+        // Returns the number of bytes used by the vertex & element buffers
+        size_t getByteCount() const
+        {
+            return this->byteCount;
+        }
+
+        // Sends the uniforms that the vertex shader needs to read the vertices of this mesh ("position_scale", "position_offset" & "octahedral_normal")
+        // It must be called after the shader is used and before "draw", since a shader may draw compact and float meshes
+        void setDequantization(ShaderProgram *shader) const
+        {
+            shader->set("position_scale", this->positionScale);
+            shader->set("position_offset", this->positionOffset);
+            shader->set("octahedral_normal", GLint(this->octahedralNormal));
+        }
+
         // this function should render the mesh
         void draw()
         {
 
             // TODO: Write this function
             glBindVertexArray(this->VAO); // bind
-            // what to draw, how many elements, type of each element, offset of the first index in the array=0
-            glDrawElements(GL_TRIANGLES, this->elementCount, GL_UNSIGNED_INT, (void *)0); // Draw
-            glBindVertexArray(0);                                                         // unbind
+            // A disabled attribute reads the current generic value, so a compact mesh without colors is drawn in white
+            if (this->octahedralNormal && this->colorVBO == 0)
+                glVertexAttrib4f(ATTRIB_LOC_COLOR, 1.0f, 1.0f, 1.0f, 1.0f);
+            // Every range is drawn with: what to draw, how many elements, type of each element, offset of the first element in the buffer,
+            // the value added to every element (a mesh with more than 65536 vertices has a range for every window of 65536 vertices)
+            for (const ElementRange &range : this->elementRanges)
+                glDrawElementsBaseVertex(GL_TRIANGLES, range.count, range.type, (void *)range.offset, range.baseVertex); // Draw
+            glBindVertexArray(0); // unbind
         }
         // this function should delete the vertex & element buffers and the vertex array object
         ~Mesh()
@@ -128,6 +229,25 @@ namespace our
             glDeleteVertexArrays(1, &this->VAO);
             glDeleteBuffers(1, &this->VBO);
             glDeleteBuffers(1, &this->EBO);
+            if (this->colorVBO != 0)
+                glDeleteBuffers(1, &this->colorVBO);
+        }
+
+        // this function exchanges the OpenGL objects (and the bounding boxes) of the two meshes
+        // It is used to replace a placeholder by the real mesh without changing the pointers that refer to the mesh object
+        void swap(Mesh &other)
+        {
+            std::swap(this->VAO, other.VAO);
+            std::swap(this->VBO, other.VBO);
+            std::swap(this->EBO, other.EBO);
+            std::swap(this->colorVBO, other.colorVBO);
+            std::swap(this->elementCount, other.elementCount);
+            std::swap(this->elementRanges, other.elementRanges);
+            std::swap(this->byteCount, other.byteCount);
+            std::swap(this->boundingBox, other.boundingBox);
+            std::swap(this->positionScale, other.positionScale);
+            std::swap(this->positionOffset, other.positionOffset);
+            std::swap(this->octahedralNormal, other.octahedralNormal);
         }
 
         Mesh(Mesh const &) = delete;
@@ -0,0 +1,512 @@
+#include "obj-parser.hpp"
+#include "../jobs/job-system.hpp"
+#include "../trace/trace.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+
+namespace our
+{
+
+    namespace
+    {
+        // The size of the chunks that are parsed in parallel (they are extended to the end of their last line)
+        constexpr size_t CHUNK_SIZE = 256 * 1024;
+
+        // The powers of 10 that are exactly representable as doubles
+        constexpr double EXACT_POWERS_OF_10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                                 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+        bool isDigit(char character) { return static_cast<unsigned>(character - '0') < 10; }
+        bool isSpace(char character) { return character == ' ' || character == '\t'; }
+
+        const char *skipSpaces(const char *text, const char *end)
+        {
+            while (text < end && isSpace(*text))
+                ++text;
+            return text;
+        }
+
+        const char *skipLine(const char *text, const char *end)
+        {
+            const void *newline = std::memchr(text, '\n', size_t(end - text));
+            return newline ? static_cast<const char *>(newline) + 1 : end;
+        }
+
+        // The statements that the parser reads
+        enum class Statement
+        {
+            POSITION,
+            TEXCOORD,
+            NORMAL,
+            FACE,
+            OTHER,
+        };
+
+        // Returns the statement of the line (the text must point to its first non-space character) and moves the text after its keyword
+        Statement readStatement(const char *&text, const char *end)
+        {
+            size_t remaining = size_t(end - text);
+            if (remaining >= 2 && text[0] == 'v')
+            {
+                if (isSpace(text[1]))
+                {
+                    text += 1;
+                    return Statement::POSITION;
+                }
+                if (remaining >= 3 && isSpace(text[2]))
+                {
+                    if (text[1] == 't')
+                    {
+                        text += 2;
+                        return Statement::TEXCOORD;
+                    }
+                    if (text[1] == 'n')
+                    {
+                        text += 2;
+                        return Statement::NORMAL;
+                    }
+                }
+            }
+            else if (remaining >= 2 && text[0] == 'f' && isSpace(text[1]))
+            {
+                text += 1;
+                return Statement::FACE;
+            }
+            return Statement::OTHER;
+        }
+
+        // Parses a face index (which may be negative)
+        const char *parseIndex(const char *text, const char *end, std::int64_t &value)
+        {
+            bool negative = false;
+            if (text < end && (*text == '-' || *text == '+'))
+                negative = *text++ == '-';
+            if (text >= end || !isDigit(*text))
+                return nullptr;
+            std::int64_t result = 0;
+            while (text < end && isDigit(*text) && result < (std::int64_t(1) << 40))
+                result = result * 10 + (*text++ - '0');
+            value = negative ? -result : result;
+            return text;
+        }
+
+        // Converts an OBJ index (1 is the first attribute and -1 is the last attribute defined so far) to a 0 based index
+        // Returns false if the index refers to an attribute that does not exist
+        bool resolveIndex(std::int64_t index, size_t definedSoFar, size_t total, GLuint &resolved)
+        {
+            std::int64_t absolute = index > 0 ? index - 1 : std::int64_t(definedSoFar) + index;
+            if (index == 0 || absolute < 0 || size_t(absolute) >= total)
+                return false;
+            resolved = GLuint(absolute);
+            return true;
+        }
+
+        // A face with more than 3 corners, which is triangulated once all the positions are parsed
+        struct Polygon
+        {
+            size_t triangles;   // The offset of its triangles in the corners of the chunk
+            size_t corners;     // The offset of its corners in the polygon corners of the chunk
+            size_t cornerCount;
+        };
+
+        // The part of the file parsed by one job
+        struct Chunk
+        {
+            const char *begin, *end;
+            size_t positionCount = 0, texcoordCount = 0, normalCount = 0; // Counted in the first pass
+            size_t positionOffset = 0, texcoordOffset = 0, normalOffset = 0;
+            std::vector<ObjCorner> corners;
+            std::vector<Polygon> polygons;
+            std::vector<ObjCorner> polygonCorners;
+            size_t cornerOffset = 0; // The offset of the corners of the chunk in the corners of the whole file
+            std::string error;
+
+            Chunk(const char *begin, const char *end) : begin(begin), end(end) {}
+        };
+
+        // Counts the attributes of the chunk (the first pass)
+        void countChunk(Chunk &chunk)
+        {
+            for (const char *line = chunk.begin; line < chunk.end; line = skipLine(line, chunk.end))
+            {
+                const char *text = skipSpaces(line, chunk.end);
+                switch (readStatement(text, chunk.end))
+                {
+                case Statement::POSITION:
+                    ++chunk.positionCount;
+                    break;
+                case Statement::TEXCOORD:
+                    ++chunk.texcoordCount;
+                    break;
+                case Statement::NORMAL:
+                    ++chunk.normalCount;
+                    break;
+                default:
+                    break;
+                }
+            }
+        }
+
+        // Parses up to "count" floats separated by spaces (at least "required" of them must be present)
+        // Returns the number of parsed floats or -1 if a number is malformed
+        int parseFloats(const char *&text, const char *end, float *values, int required, int count)
+        {
+            int parsed = 0;
+            for (; parsed < count; ++parsed)
+            {
+                text = skipSpaces(text, end);
+                if (text >= end || *text == '\n' || *text == '\r' || *text == '#')
+                    break;
+                const char *next = parseObjFloat(text, end, values[parsed]);
+                if (next == nullptr)
+                    return -1;
+                text = next;
+            }
+            return parsed >= required ? parsed : -1;
+        }
+
+        // Parses the chunk (the second pass)
+        void parseChunk(Chunk &chunk, ObjData &data)
+        {
+            size_t positionIndex = chunk.positionOffset, texcoordIndex = chunk.texcoordOffset, normalIndex = chunk.normalOffset;
+            std::vector<ObjCorner> polygon;
+            // A face line has 3 or 4 corners in most files
+            chunk.corners.reserve(size_t(chunk.end - chunk.begin) / 12);
+            for (const char *line = chunk.begin; line < chunk.end; line = skipLine(line, chunk.end))
+            {
+                const char *text = skipSpaces(line, chunk.end);
+                Statement statement = readStatement(text, chunk.end);
+                if (statement == Statement::OTHER)
+                    continue;
+                float values[6];
+                switch (statement)
+                {
+                case Statement::POSITION:
+                {
+                    // A position may be followed by a vertex color (which some tools write)
+                    int count = parseFloats(text, chunk.end, values, 3, 6);
+                    if (count < 0)
+                    {
+                        chunk.error = "malformed vertex position";
+                        return;
+                    }
+                    data.positions[positionIndex] = {values[0], values[1], values[2]};
+                    if (count == 6)
+                        data.colors[positionIndex] = Color(glm::clamp(glm::vec3(values[3], values[4], values[5]), 0.0f, 1.0f) * 255.0f, 255);
+                    ++positionIndex;
+                    break;
+                }
+                case Statement::TEXCOORD:
+                    // The third coordinate (if any) is ignored
+                    if (parseFloats(text, chunk.end, values, 1, 3) < 0)
+                    {
+                        chunk.error = "malformed texture coordinate";
+                        return;
+                    }
+                    data.texcoords[texcoordIndex++] = {values[0], values[1]};
+                    break;
+                case Statement::NORMAL:
+                    if (parseFloats(text, chunk.end, values, 3, 3) < 0)
+                    {
+                        chunk.error = "malformed normal";
+                        return;
+                    }
+                    data.normals[normalIndex++] = {values[0], values[1], values[2]};
+                    break;
+                case Statement::FACE:
+                {
+                    // Every corner is "v", "v/vt", "v//vn" or "v/vt/vn"
+                    polygon.clear();
+                    while (true)
+                    {
+                        text = skipSpaces(text, chunk.end);
+                        if (text >= chunk.end || *text == '\n' || *text == '\r' || *text == '#')
+                            break;
+                        std::int64_t index;
+                        ObjCorner corner = {0, OBJ_MISSING_INDEX, OBJ_MISSING_INDEX};
+                        text = parseIndex(text, chunk.end, index);
+                        if (text == nullptr || !resolveIndex(index, positionIndex, data.positions.size(), corner.position))
+                        {
+                            chunk.error = "a face refers to a vertex position that does not exist";
+                            return;
+                        }
+                        if (text < chunk.end && *text == '/')
+                        {
+                            ++text;
+                            if (text < chunk.end && *text != '/')
+                            {
+                                text = parseIndex(text, chunk.end, index);
+                                if (text == nullptr || !resolveIndex(index, texcoordIndex, data.texcoords.size(), corner.texcoord))
+                                {
+                                    chunk.error = "a face refers to a texture coordinate that does not exist";
+                                    return;
+                                }
+                            }
+                            if (text < chunk.end && *text == '/')
+                            {
+                                ++text;
+                                text = parseIndex(text, chunk.end, index);
+                                if (text == nullptr || !resolveIndex(index, normalIndex, data.normals.size(), corner.normal))
+                                {
+                                    chunk.error = "a face refers to a normal that does not exist";
+                                    return;
+                                }
+                            }
+                        }
+                        polygon.push_back(corner);
+                    }
+                    // Faces with less than 3 corners are skipped
+                    if (polygon.size() == 3)
+                        chunk.corners.insert(chunk.corners.end(), polygon.begin(), polygon.end());
+                    else if (polygon.size() > 3)
+                    {
+                        // A polygon may refer to positions of later chunks, so a place is kept for its triangles until they are all parsed
+                        chunk.polygons.push_back({chunk.corners.size(), chunk.polygonCorners.size(), polygon.size()});
+                        chunk.polygonCorners.insert(chunk.polygonCorners.end(), polygon.begin(), polygon.end());
+                        chunk.corners.resize(chunk.corners.size() + 3 * (polygon.size() - 2));
+                    }
+                    break;
+                }
+                default:
+                    break;
+                }
+            }
+        }
+
+        // Returns true if the point is inside the triangle (by counting the edges that a ray from the point crosses)
+        bool isInsideTriangle(const glm::vec2 triangle[3], glm::vec2 point)
+        {
+            bool inside = false;
+            for (int current = 0, previous = 2; current < 3; previous = current++)
+                if ((triangle[current].y > point.y) != (triangle[previous].y > point.y) &&
+                    point.x < (triangle[previous].x - triangle[current].x) * (point.y - triangle[current].y) / (triangle[previous].y - triangle[current].y) + triangle[current].x)
+                    inside = !inside;
+            return inside;
+        }
+
+        // Triangulates a polygon by clipping its ears (so concave polygons are triangulated correctly) and writes its (count - 2) triangles
+        // This is the same algorithm as the one of Tiny OBJ Loader (which the engine used before), so the meshes are triangulated the same way.
+        // If no ear can be found (e.g. the polygon intersects itself), the rest of the polygon is triangulated as a fan around its first corner.
+        void triangulatePolygon(const ObjCorner *polygon, size_t count, const std::vector<glm::vec3> &positions, ObjCorner *triangles, std::vector<ObjCorner> &remaining)
+        {
+            // The polygon is projected onto the plane of the two axes that are the closest to its plane (found from its first non degenerate corner)
+            int axes[2] = {1, 2};
+            for (size_t corner = 0; corner < count; ++corner)
+            {
+                const glm::vec3 &p0 = positions[polygon[corner].position];
+                const glm::vec3 &p1 = positions[polygon[(corner + 1) % count].position];
+                const glm::vec3 &p2 = positions[polygon[(corner + 2) % count].position];
+                glm::vec3 normal = glm::abs(glm::cross(p1 - p0, p2 - p1));
+                constexpr float epsilon = std::numeric_limits<float>::epsilon();
+                if (normal.x > epsilon || normal.y > epsilon || normal.z > epsilon)
+                {
+                    if (!(normal.x > normal.y && normal.x > normal.z))
+                    {
+                        axes[0] = 0;
+                        if (normal.z > normal.x && normal.z > normal.y)
+                            axes[1] = 1;
+                    }
+                    break;
+                }
+            }
+            auto project = [&](const ObjCorner &corner)
+            {
+                const glm::vec3 &position = positions[corner.position];
+                return glm::vec2(position[axes[0]], position[axes[1]]);
+            };
+            // The sign of the area gives the winding of the polygon
+            float area = 0;
+            for (size_t corner = 0; corner < count; ++corner)
+            {
+                glm::vec2 v0 = project(polygon[corner]), v1 = project(polygon[(corner + 1) % count]);
+                area += (v0.x * v1.y - v0.y * v1.x) * 0.5f;
+            }
+
+            remaining.assign(polygon, polygon + count);
+            // The number of corners that can still be tried before giving up (it is reset whenever an ear is clipped)
+            size_t guess = 0, attempts = count, previousCount = count;
+            while (remaining.size() > 3 && attempts > 0)
+            {
+                size_t remainingCount = remaining.size();
+                if (guess >= remainingCount)
+                    guess -= remainingCount;
+                if (previousCount != remainingCount)
+                {
+                    previousCount = remainingCount;
+                    attempts = remainingCount;
+                }
+                else
+                    --attempts;
+
+                glm::vec2 triangle[3];
+                for (size_t corner = 0; corner < 3; ++corner)
+                    triangle[corner] = project(remaining[(guess + corner) % remainingCount]);
+                glm::vec2 e0 = triangle[1] - triangle[0], e1 = triangle[2] - triangle[1];
+                // A corner whose winding is opposite to the polygon is not an ear
+                if ((e0.x * e1.y - e0.y * e1.x) * area < 0.0f)
+                {
+                    ++guess;
+                    continue;
+                }
+                // Neither is a corner whose triangle contains another corner of the polygon
+                bool overlap = false;
+                for (size_t other = 3; other < remainingCount && !overlap; ++other)
+                    overlap = isInsideTriangle(triangle, project(remaining[(guess + other) % remainingCount]));
+                if (overlap)
+                {
+                    ++guess;
+                    continue;
+                }
+                for (size_t corner = 0; corner < 3; ++corner)
+                    *triangles++ = remaining[(guess + corner) % remainingCount];
+                remaining.erase(remaining.begin() + std::ptrdiff_t((guess + 1) % remainingCount));
+            }
+            for (size_t corner = 2; corner < remaining.size(); ++corner)
+            {
+                *triangles++ = remaining[0];
+                *triangles++ = remaining[corner - 1];
+                *triangles++ = remaining[corner];
+            }
+        }
+    }
+
+    const char *parseObjFloat(const char *text, const char *end, float &value)
+    {
+        bool negative = false;
+        if (text < end && (*text == '-' || *text == '+'))
+            negative = *text++ == '-';
+        // The significant digits are accumulated into an integer (the digits after the 19th only change the exponent)
+        std::uint64_t mantissa = 0;
+        int exponent = 0, significantDigits = 0;
+        bool hasDigits = false;
+        for (; text < end && isDigit(*text); ++text, hasDigits = true)
+        {
+            if (significantDigits < 19)
+            {
+                mantissa = mantissa * 10 + std::uint64_t(*text - '0');
+                significantDigits += mantissa != 0;
+            }
+            else
+                ++exponent;
+        }
+        if (text < end && *text == '.')
+        {
+            for (++text; text < end && isDigit(*text); ++text, hasDigits = true)
+            {
+                if (significantDigits < 19)
+                {
+                    mantissa = mantissa * 10 + std::uint64_t(*text - '0');
+                    significantDigits += mantissa != 0;
+                    --exponent;
+                }
+            }
+        }
+        if (!hasDigits)
+            return nullptr;
+        if (text < end && (*text == 'e' || *text == 'E'))
+        {
+            const char *exponentText = text + 1;
+            bool negativeExponent = false;
+            if (exponentText < end && (*exponentText == '-' || *exponentText == '+'))
+                negativeExponent = *exponentText++ == '-';
+            if (exponentText < end && isDigit(*exponentText))
+            {
+                int written = 0;
+                for (; exponentText < end && isDigit(*exponentText); ++exponentText)
+                    written = std::min(written * 10 + (*exponentText - '0'), 10000);
+                exponent += negativeExponent ? -written : written;
+                text = exponentText;
+            }
+        }
+        double result;
+        if (mantissa == 0)
+            result = 0.0;
+        else if (mantissa < (std::uint64_t(1) << 53) && exponent >= -22 && exponent <= 22)
+            // Both the mantissa and the power are exact, so a single division or multiplication gives the correctly rounded result
+            result = exponent < 0 ? double(mantissa) / EXACT_POWERS_OF_10[-exponent] : double(mantissa) * EXACT_POWERS_OF_10[exponent];
+        else
+            result = double(mantissa) * std::pow(10.0, double(exponent));
+        value = float(negative ? -result : result);
+        return text;
+    }
+
+    bool parseObj(const char *text, size_t size, ObjData &data, std::string &error)
+    {
+        // The file is split into chunks that end at the end of a line
+        std::vector<Chunk> chunks;
+        const char *end = text + size;
+        for (const char *begin = text; begin < end;)
+        {
+            const char *chunkEnd = size_t(end - begin) > CHUNK_SIZE ? skipLine(begin + CHUNK_SIZE, end) : end;
+            chunks.emplace_back(begin, chunkEnd);
+            begin = chunkEnd;
+        }
+        JobSystem &jobs = JobSystem::get();
+
+        {
+            OUR_TRACE_SCOPE("count obj attributes");
+            jobs.parallelFor(0, chunks.size(), 1, [&](size_t begin, size_t end)
+                             {
+                for (size_t index = begin; index < end; ++index)
+                    countChunk(chunks[index]); });
+        }
+        size_t positionCount = 0, texcoordCount = 0, normalCount = 0;
+        for (Chunk &chunk : chunks)
+        {
+            chunk.positionOffset = positionCount;
+            chunk.texcoordOffset = texcoordCount;
+            chunk.normalOffset = normalCount;
+            positionCount += chunk.positionCount;
+            texcoordCount += chunk.texcoordCount;
+            normalCount += chunk.normalCount;
+        }
+        data.positions.assign(positionCount, glm::vec3(0));
+        data.colors.assign(positionCount, Color(255));
+        data.texcoords.assign(texcoordCount, glm::vec2(0));
+        data.normals.assign(normalCount, glm::vec3(0));
+
+        {
+            OUR_TRACE_SCOPE("parse obj chunks");
+            jobs.parallelFor(0, chunks.size(), 1, [&](size_t begin, size_t end)
+                             {
+                for (size_t index = begin; index < end; ++index)
+                    parseChunk(chunks[index], data); });
+        }
+
+        // The corners of the chunks are concatenated in the order of the file
+        size_t cornerCount = 0;
+        for (Chunk &chunk : chunks)
+        {
+            if (!chunk.error.empty())
+            {
+                error = chunk.error;
+                return false;
+            }
+            chunk.cornerOffset = cornerCount;
+            cornerCount += chunk.corners.size();
+        }
+        data.corners.resize(cornerCount);
+
+        {
+            // Now that all the positions are known, the polygons are triangulated into their places
+            OUR_TRACE_SCOPE("triangulate obj faces");
+            jobs.parallelFor(0, chunks.size(), 1, [&](size_t begin, size_t end)
+                             {
+                std::vector<ObjCorner> remaining;
+                for (size_t index = begin; index < end; ++index)
+                {
+                    const Chunk &chunk = chunks[index];
+                    ObjCorner *corners = data.corners.data() + chunk.cornerOffset;
+                    std::copy(chunk.corners.begin(), chunk.corners.end(), corners);
+                    for (const Polygon &polygon : chunk.polygons)
+                        triangulatePolygon(chunk.polygonCorners.data() + polygon.corners, polygon.cornerCount, data.positions, corners + polygon.triangles, remaining);
+                } });
+        }
+        return true;
+    }
+
+}
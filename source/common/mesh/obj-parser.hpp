@@ -0,0 +1,50 @@
+#pragma once
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <limits>
+
+#include "vertex.hpp"
+
+namespace our
+{
+
+    // The OBJ parser reads the geometry of a Wavefront ".obj" file that is already in memory (e.g. a mapped file, see "io/asset-pack.hpp").
+    // The file is split into chunks of whole lines which are parsed in parallel on the job system in two passes:
+    // 1- Every chunk counts its "v", "vt" & "vn" lines, so the offset of each chunk in the attribute arrays is known
+    //    (and the relative indices of the faces can be resolved while the faces are parsed).
+    // 2- Every chunk parses its lines. The attributes are written directly at their final place in the arrays
+    //    and the faces are added to the corners of the chunk, which are concatenated in file order at the end.
+    //    The faces with more than 3 corners are triangulated (by ear clipping) during the concatenation, since it needs all the positions.
+    // The numbers are parsed by a small parser that does not depend on the locale.
+    // Only the geometry is read: "v" (with an optional vertex color), "vt", "vn" and "f". Every other statement (e.g. "usemtl", "o", "g", "s", "l") is ignored.
+    constexpr GLuint OBJ_MISSING_INDEX = std::numeric_limits<GLuint>::max();
+
+    // A corner of a triangle (the indices of its attributes, starting from 0)
+    // The texture coordinate & normal indices are OBJ_MISSING_INDEX if the face does not have them
+    struct ObjCorner
+    {
+        GLuint position, texcoord, normal;
+    };
+
+    struct ObjData
+    {
+        std::vector<glm::vec3> positions;
+        std::vector<Color> colors; // One per position (white unless the file has vertex colors)
+        std::vector<glm::vec2> texcoords;
+        std::vector<glm::vec3> normals;
+        std::vector<ObjCorner> corners; // 3 corners per triangle
+    };
+
+    // Parses the OBJ text into the data
+    // Returns false (and sets the error) if a statement is malformed or a face refers to an attribute that does not exist
+    bool parseObj(const char *text, size_t size, ObjData &data, std::string &error);
+
+    // Parses a floating point number that starts at "text" (it does not skip spaces and it does not depend on the locale)
+    // Returns the end of the number or a nullptr if there is no number at "text"
+    const char *parseObjFloat(const char *text, const char *end, float &value);
+
+}
@@ -0,0 +1,72 @@
+#include "vertex-welder.hpp"
+
+#include <cmath>
+
+namespace our
+{
+
+    VertexWelder::VertexWelder(std::vector<Vertex> &vertices, size_t expectedCount, float epsilon)
+        : vertices(vertices), epsilon(epsilon), inverseEpsilon(epsilon > 0.0f ? 1.0f / epsilon : 0.0f)
+    {
+        // The table gets a slot for every added vertex (rounded up to a power of 2). Since the vertices of a mesh are shared by a few corners,
+        // the unique vertices fill a fraction of it. It is still kept at most 3/4 full (see "add"), since the probe sequences of linear probing
+        // get long when the table gets fuller.
+        size_t capacity = 16;
+        while (capacity < expectedCount)
+            capacity *= 2;
+        slots.assign(capacity, {0, EMPTY});
+        mask = capacity - 1;
+    }
+
+    Vertex VertexWelder::getKey(const Vertex &vertex) const
+    {
+        if (epsilon <= 0.0f)
+            return vertex;
+        Vertex key = vertex;
+        key.position = glm::round(vertex.position * inverseEpsilon);
+        key.tex_coord = glm::round(vertex.tex_coord * inverseEpsilon);
+        key.normal = glm::round(vertex.normal * inverseEpsilon);
+        return key;
+    }
+
+    GLuint VertexWelder::add(const Vertex &vertex)
+    {
+        Vertex key = getKey(vertex);
+        std::uint64_t hash = hashVertex(key);
+        std::uint32_t tag = std::uint32_t(hash >> 32);
+        for (size_t slotIndex = size_t(hash) & mask;; slotIndex = (slotIndex + 1) & mask)
+        {
+            Slot &slot = slots[slotIndex];
+            if (slot.index == EMPTY)
+            {
+                // The vertex is new, so it is appended
+                GLuint index = static_cast<GLuint>(vertices.size());
+                vertices.push_back(vertex);
+                slot = {tag, index};
+                if (++count * 4 > slots.size() * 3)
+                    grow();
+                return index;
+            }
+            if (slot.hash == tag && getKey(vertices[slot.index]) == key)
+                return slot.index;
+        }
+    }
+
+    void VertexWelder::grow()
+    {
+        std::vector<Slot> old(slots.size() * 2, {0, EMPTY});
+        old.swap(slots);
+        mask = slots.size() - 1;
+        // The slot only keeps the upper half of the hash, so the vertices are hashed again to find their new slots
+        for (const Slot &slot : old)
+        {
+            if (slot.index == EMPTY)
+                continue;
+            size_t slotIndex = size_t(hashVertex(getKey(vertices[slot.index]))) & mask;
+            while (slots[slotIndex].index != EMPTY)
+                slotIndex = (slotIndex + 1) & mask;
+            slots[slotIndex] = slot;
+        }
+    }
+
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <glad/gl.h>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "vertex.hpp"
+
+namespace our
+{
+
+    // The vertex welder removes the duplicated vertices of a mesh: every added vertex gets the index of the first equal vertex that was added before it
+    // (so the unique vertices keep the order in which they were first added).
+    // It is a flat hash table with open addressing (linear probing) over the indices of the unique vertices, so unlike std::unordered_map,
+    // it does not allocate a node per vertex. Every slot keeps 32 bits of the vertex hash (see "hashVertex"), so most probes never read a vertex.
+    // The table is sized when the welder is created for the number of vertices that will be added (e.g. the number of elements of the mesh),
+    // so it only grows if most of the added vertices are unique.
+    // If an epsilon is given, the positions, texture coordinates & normals are snapped to multiples of the epsilon before they are compared,
+    // so the vertices whose attributes snap to the same values are welded (e.g. the seams that an exporter wrote with slightly different numbers).
+    // The welded vertex keeps the attributes of the first vertex that was added.
+    class VertexWelder
+    {
+        struct Slot
+        {
+            std::uint32_t hash; // The upper 32 bits of the vertex hash
+            GLuint index;       // The index of the vertex (or EMPTY)
+        };
+        static constexpr GLuint EMPTY = ~GLuint(0);
+
+        std::vector<Vertex> &vertices;
+        std::vector<Slot> slots;
+        size_t mask;
+        size_t count = 0; // The number of vertices added by the welder
+        float epsilon, inverseEpsilon;
+
+        // Returns the vertex that is hashed and compared (the vertex itself, or its snapped attributes if there is an epsilon)
+        Vertex getKey(const Vertex &vertex) const;
+        // Doubles the size of the table (only if more vertices than expected were added)
+        void grow();
+
+    public:
+        // The unique vertices are appended to the given vector (which must outlive the welder and must not be changed by anything else while welding)
+        // "expectedCount" is the number of vertices that will be added
+        VertexWelder(std::vector<Vertex> &vertices, size_t expectedCount, float epsilon = 0.0f);
+
+        // Returns the index of the vertex in the vector (the vertex is appended if it has no equal vertex yet)
+        GLuint add(const Vertex &vertex);
+
+        // Returns the number of bytes allocated by the table (without the vertices)
+        size_t getMemoryUsage() const { return slots.capacity() * sizeof(Slot); }
+    };
+
+}
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <glm/glm.hpp>
-#include <glm/gtx/hash.hpp>
+#include <cstdint>
+#include <cstring>
+#include <functional>
 
 namespace our {
 
@@ -24,21 +26,47 @@ namespace our {
         }
     };
 
+    // The vertex has no padding, so its bytes are hashed and stored (e.g. in the mesh cache) as they are
+    static_assert(sizeof(Vertex) == 36, "The vertex must not have padding");
+
+    // Mixes the bits of a 64-bit value so that every input bit affects every output bit (this is the finalizer of SplitMix64)
+    inline std::uint64_t mixHash(std::uint64_t value) {
+        value ^= value >> 30;
+        value *= 0xBF58476D1CE4E5B9ull;
+        value ^= value >> 27;
+        value *= 0x94D049BB133111EBull;
+        value ^= value >> 31;
+        return value;
+    }
+
+    // Returns a 64-bit hash of the bytes of the vertex
+    // Every 64-bit word of the vertex goes through the mixer, so the symmetric vertices of a model (e.g. (x, y) and (y, x)) do not collide.
+    // A negative zero is hashed as a positive zero since they are equal.
+    inline std::uint64_t hashVertex(const Vertex& vertex) {
+        // Adding a positive zero turns a negative zero into a positive zero and keeps every other value
+        const float floats[8] = {
+            vertex.position.x + 0.0f, vertex.position.y + 0.0f, vertex.position.z + 0.0f,
+            vertex.tex_coord.x + 0.0f, vertex.tex_coord.y + 0.0f,
+            vertex.normal.x + 0.0f, vertex.normal.y + 0.0f, vertex.normal.z + 0.0f
+        };
+        std::uint64_t words[4];
+        std::memcpy(words, floats, sizeof(words));
+        std::uint32_t color;
+        std::memcpy(&color, &vertex.color, sizeof(color));
+        std::uint64_t hash = mixHash(color);
+        for (std::uint64_t word : words)
+            hash = mixHash(hash ^ word);
+        return hash;
+    }
+
 }
 
 // We plan to use struct Vertex as a key for a map so we need to define a hash function for it
+// (The mesh loader uses the vertex welder instead of a map, see "vertex-welder.hpp")
 namespace std {
-    //A Simple method to combine two hash values
-    inline size_t hash_combine(size_t h1, size_t h2){ return h1 ^ (h2 << 1); }
-
-    //A Hash function for struct Vertex
     template<> struct hash<our::Vertex> {
         size_t operator()(our::Vertex const& vertex) const {
-            size_t combined = hash<glm::vec3>()(vertex.position);
-            combined = hash_combine(combined, hash<our::Color>()(vertex.color));
-            combined = hash_combine(combined, hash<glm::vec2>()(vertex.tex_coord));
-            combined = hash_combine(combined, hash<glm::vec3>()(vertex.normal));
-            return combined;
+            return static_cast<size_t>(our::hashVertex(vertex));
         }
     };
 }
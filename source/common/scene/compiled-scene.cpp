@@ -0,0 +1,461 @@
+#include "compiled-scene.hpp"
+
+#include "../asset-loader.hpp"
+#include "../asset-batch.hpp"
+#include "../ecs/world.hpp"
+#include "../components/component-deserializer.hpp"
+#include "../shader/shader.hpp"
+#include "../texture/texture2d.hpp"
+#include "../texture/texture-utils.hpp"
+#include "../texture/sampler.hpp"
+#include "../mesh/mesh.hpp"
+#include "../mesh/mesh-utils.hpp"
+#include "../material/material.hpp"
+#include "../io/file-cache.hpp"
+#include "../trace/trace.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+#include <memory>
+#include <iostream>
+
+namespace our
+{
+
+    // The keys of the asset types in the "assets" object of the json scene (in the order of "SceneAssetType")
+    static const char *ASSET_TYPE_KEYS[SCENE_ASSET_TYPE_COUNT] = {"shaders", "textures", "samplers", "meshes", "materials"};
+
+    // Writes the data of an asset record. The json description of each asset type is documented in "asset-loader.cpp"
+    static void compileAsset(SceneAssetType type, const nlohmann::json &description, SceneWriter &writer)
+    {
+        static const nlohmann::json empty = nlohmann::json::object();
+        const nlohmann::json &data = description.is_object() ? description : empty;
+        switch (type)
+        {
+        case SCENE_SHADER:
+            writer.writeString(data.value("vs", ""));
+            writer.writeString(data.value("fs", ""));
+            break;
+        case SCENE_TEXTURE:
+        {
+            std::string path;
+            texture_utils::ColorSpace colorSpace = texture_utils::ColorSpace::SRGB;
+            texture_utils::readTextureDescription(description, path, colorSpace);
+            writer.writeString(path);
+            writer.write(static_cast<std::uint8_t>(colorSpace));
+            break;
+        }
+        case SCENE_MESH:
+            writer.writeString(description.is_string() ? description.get<std::string>() : std::string());
+            break;
+        case SCENE_SAMPLER:
+            Sampler::compile(data, writer);
+            break;
+        case SCENE_MATERIAL:
+        {
+            std::string materialType = data.value("type", "");
+            writer.writeString(materialType);
+            std::unique_ptr<Material> material(createMaterialFromType(materialType));
+            material->compile(data, writer);
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    // Creates an asset from its record and adds it to the asset loader of its type
+    // Shaders, textures and meshes are queued in the batch, and their slot in the table is filled once they are created
+    static void loadAsset(SceneAssetType type, const std::string &name, SceneReader &reader, AssetBatch &batch, void *&slot)
+    {
+        switch (type)
+        {
+        case SCENE_SHADER:
+        {
+            std::string vsPath(reader.readString());
+            std::string fsPath(reader.readString());
+            batch.addShader(name, vsPath, fsPath, [&slot](ShaderProgram *shader)
+                            { slot = shader; });
+            break;
+        }
+        case SCENE_TEXTURE:
+        {
+            std::string path(reader.readString());
+            auto colorSpace = static_cast<texture_utils::ColorSpace>(reader.read<std::uint8_t>());
+            batch.addTexture(name, path, colorSpace, [&slot](Texture2D *texture)
+                             { slot = texture; });
+            break;
+        }
+        case SCENE_MESH:
+            batch.addMesh(name, std::string(reader.readString()), [&slot](Mesh *mesh)
+                          { slot = mesh; });
+            break;
+        case SCENE_SAMPLER:
+        {
+            auto sampler = new Sampler();
+            sampler->deserialize(reader);
+            AssetLoader<Sampler>::add(name, sampler);
+            slot = sampler;
+            break;
+        }
+        case SCENE_MATERIAL:
+        {
+            auto material = createMaterialFromType(std::string(reader.readString()));
+            material->deserialize(reader);
+            AssetLoader<Material>::add(name, material);
+            slot = material;
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    namespace
+    {
+        // This holds the state of the compiler while the records are written
+        struct SceneCompiler
+        {
+            SceneStringTable strings;
+            SceneAssetIndices assetIndices;
+            std::vector<SceneAssetRecord> assets[SCENE_ASSET_TYPE_COUNT];
+            std::vector<SceneString> componentTypes;
+            std::unordered_map<std::string, std::uint32_t> componentTypeIndices;
+            std::vector<SceneEntityRecord> entities;
+            std::vector<SceneComponentRecord> components;
+            std::vector<std::byte> data;
+            SceneWriter writer{data, strings, assetIndices};
+
+            void compileAssets(const nlohmann::json &assetData)
+            {
+                if (!assetData.is_object())
+                    return;
+                // First, every asset gets its index, so the records can refer to any asset in the scene
+                for (std::uint32_t type = 0; type < SCENE_ASSET_TYPE_COUNT; ++type)
+                {
+                    if (auto it = assetData.find(ASSET_TYPE_KEYS[type]); it != assetData.end() && it->is_object())
+                    {
+                        for (auto &[name, description] : it->items())
+                            assetIndices.names[type].emplace(name, std::uint32_t(assetIndices.names[type].size()));
+                    }
+                }
+                // Then the records are written in the same order
+                for (std::uint32_t type = 0; type < SCENE_ASSET_TYPE_COUNT; ++type)
+                {
+                    if (auto it = assetData.find(ASSET_TYPE_KEYS[type]); it != assetData.end() && it->is_object())
+                    {
+                        for (auto &[name, description] : it->items())
+                        {
+                            SceneAssetRecord record = {strings.add(name), std::uint32_t(data.size()), 0};
+                            compileAsset(SceneAssetType(type), description, writer);
+                            record.dataSize = std::uint32_t(data.size() - record.dataOffset);
+                            assets[type].push_back(record);
+                        }
+                    }
+                }
+            }
+
+            // Like "World::deserialize", this walks the entities depth-first, so every subtree is stored contiguously after its root
+            void compileEntities(const nlohmann::json &entityArray, std::uint32_t parent)
+            {
+                if (!entityArray.is_array())
+                    return;
+                const auto &registry = getComponentTypeRegistry();
+                for (const auto &entityData : entityArray)
+                {
+                    Transform transform;
+                    SceneEntityRecord record = {};
+                    record.parent = parent;
+                    record.firstComponent = std::uint32_t(components.size());
+                    if (entityData.is_object())
+                    {
+                        record.name = strings.add(entityData.value("name", ""));
+                        transform.deserialize(entityData);
+                        if (auto it = entityData.find("components"); it != entityData.end() && it->is_array())
+                        {
+                            for (const auto &componentData : *it)
+                            {
+                                // Components with an unknown type are skipped (as they are when the json is deserialized)
+                                std::string type = componentData.value("type", "");
+                                auto info = registry.find(type);
+                                if (info == registry.end())
+                                    continue;
+                                auto [typeIndex, inserted] = componentTypeIndices.emplace(type, std::uint32_t(componentTypes.size()));
+                                if (inserted)
+                                    componentTypes.push_back(strings.add(type));
+                                SceneComponentRecord component = {typeIndex->second, std::uint32_t(data.size()), 0};
+                                info->second.compile(componentData, writer);
+                                component.dataSize = std::uint32_t(data.size() - component.dataOffset);
+                                components.push_back(component);
+                            }
+                        }
+                    }
+                    else
+                    {
+                        record.name = strings.add("");
+                    }
+                    record.position = transform.position;
+                    record.rotation = transform.rotation;
+                    record.scale = transform.scale;
+                    record.componentCount = std::uint32_t(components.size()) - record.firstComponent;
+                    std::uint32_t index = std::uint32_t(entities.size());
+                    entities.push_back(record);
+                    if (entityData.is_object() && entityData.contains("children"))
+                        compileEntities(entityData["children"], index);
+                }
+            }
+
+            // Appends the given bytes to the file (at an offset aligned to 8 bytes) and returns the section
+            static CompiledSceneSection append(std::vector<std::byte> &file, const void *bytes, size_t size, size_t count)
+            {
+                file.resize((file.size() + 7) & ~size_t(7));
+                CompiledSceneSection section = {std::uint32_t(file.size()), std::uint32_t(count)};
+                const std::byte *begin = static_cast<const std::byte *>(bytes);
+                file.insert(file.end(), begin, begin + size);
+                return section;
+            }
+
+            template <typename T>
+            static CompiledSceneSection append(std::vector<std::byte> &file, const std::vector<T> &records)
+            {
+                return append(file, records.data(), records.size() * sizeof(T), records.size());
+            }
+
+            std::vector<std::byte> build() const
+            {
+                std::vector<std::byte> file(sizeof(CompiledSceneHeader));
+                CompiledSceneHeader header = {};
+                std::memcpy(header.magic, COMPILED_SCENE_MAGIC, sizeof(header.magic));
+                header.version = COMPILED_SCENE_VERSION;
+                header.strings = append(file, strings.getCharacters());
+                for (std::uint32_t type = 0; type < SCENE_ASSET_TYPE_COUNT; ++type)
+                    header.assets[type] = append(file, assets[type]);
+                header.componentTypes = append(file, componentTypes);
+                header.entities = append(file, entities);
+                header.components = append(file, components);
+                header.data = append(file, data);
+                std::memcpy(file.data(), &header, sizeof(header));
+                return file;
+            }
+        };
+    }
+
+    std::vector<std::byte> compileScene(const nlohmann::json &scene)
+    {
+        SceneCompiler compiler;
+        if (scene.is_object())
+        {
+            if (scene.contains("assets"))
+                compiler.compileAssets(scene["assets"]);
+            if (scene.contains("world"))
+                compiler.compileEntities(scene["world"], INVALID_SCENE_INDEX);
+        }
+        return compiler.build();
+    }
+
+    bool saveCompiledScene(const std::vector<std::byte> &bytes, const std::string &path)
+    {
+        return writeFileAtomically(path, bytes.data(), bytes.size());
+    }
+
+    std::string getCompiledScenePath(const std::string &configPath)
+    {
+        return std::filesystem::path(configPath).replace_extension(COMPILED_SCENE_EXTENSION).string();
+    }
+
+    bool CompiledScene::open(const std::string &path)
+    {
+        close();
+        if (!file.open(path))
+            return false;
+        if (file.size() < sizeof(CompiledSceneHeader))
+        {
+            file.close();
+            return false;
+        }
+        header = reinterpret_cast<const CompiledSceneHeader *>(file.data());
+        if (!validate())
+            close();
+        return isOpen();
+    }
+
+    void CompiledScene::close()
+    {
+        header = nullptr;
+        file.close();
+    }
+
+    bool CompiledScene::validate() const
+    {
+        if (std::memcmp(header->magic, COMPILED_SCENE_MAGIC, sizeof(header->magic)) != 0 || header->version != COMPILED_SCENE_VERSION)
+            return false;
+        size_t fileSize = file.size();
+        auto inside = [fileSize](const CompiledSceneSection &section, size_t recordSize)
+        {
+            return section.offset % 8 == 0 && section.offset <= fileSize && section.count <= (fileSize - section.offset) / recordSize;
+        };
+        auto insideData = [this](std::uint32_t offset, std::uint32_t size)
+        {
+            return offset <= header->data.count && size <= header->data.count - offset;
+        };
+        if (!inside(header->strings, 1) || !inside(header->data, 1) || !inside(header->componentTypes, sizeof(SceneString)) ||
+            !inside(header->entities, sizeof(SceneEntityRecord)) || !inside(header->components, sizeof(SceneComponentRecord)))
+            return false;
+        // The string table must end with a null character so that every string in it is terminated
+        if (header->strings.count > 0 && getSection<char>(header->strings)[header->strings.count - 1] != '\0')
+            return false;
+        for (std::uint32_t type = 0; type < SCENE_ASSET_TYPE_COUNT; ++type)
+        {
+            if (!inside(header->assets[type], sizeof(SceneAssetRecord)))
+                return false;
+            const SceneAssetRecord *assets = getSection<SceneAssetRecord>(header->assets[type]);
+            for (std::uint32_t index = 0; index < header->assets[type].count; ++index)
+            {
+                if (!insideData(assets[index].dataOffset, assets[index].dataSize))
+                    return false;
+            }
+        }
+        const SceneEntityRecord *entities = getSection<SceneEntityRecord>(header->entities);
+        for (std::uint32_t index = 0; index < header->entities.count; ++index)
+        {
+            const SceneEntityRecord &entity = entities[index];
+            // A parent is always stored before its children
+            if (entity.parent != INVALID_SCENE_INDEX && entity.parent >= index)
+                return false;
+            if (entity.firstComponent > header->components.count || entity.componentCount > header->components.count - entity.firstComponent)
+                return false;
+        }
+        const SceneComponentRecord *components = getSection<SceneComponentRecord>(header->components);
+        for (std::uint32_t index = 0; index < header->components.count; ++index)
+        {
+            if (components[index].type >= header->componentTypes.count || !insideData(components[index].dataOffset, components[index].dataSize))
+                return false;
+        }
+        return true;
+    }
+
+    std::string_view CompiledScene::getString(SceneString reference) const
+    {
+        if (reference.offset > header->strings.count || reference.length >= header->strings.count - reference.offset)
+            return {};
+        return std::string_view(getSection<char>(header->strings) + reference.offset, reference.length);
+    }
+
+    SceneAssets CompiledScene::loadAssets(bool streaming) const
+    {
+        SceneAssets sceneAssets;
+        if (!isOpen())
+            return sceneAssets;
+        const char *strings = getSection<char>(header->strings);
+        const std::byte *data = getSection<std::byte>(header->data);
+        // The tables are sized first since the batch fills their slots later
+        for (std::uint32_t type = 0; type < SCENE_ASSET_TYPE_COUNT; ++type)
+            sceneAssets.tables[type].assign(header->assets[type].count, nullptr);
+        // The materials are loaded after the batch is done, so the shaders, textures and samplers exist before the materials refer to them
+        AssetBatch batch(streaming);
+        for (std::uint32_t type = 0; type < SCENE_ASSET_TYPE_COUNT; ++type)
+        {
+            if (type == SCENE_MATERIAL)
+            {
+                batch.finish();
+                batch.printReport(std::cout);
+            }
+            const SceneAssetRecord *records = getSection<SceneAssetRecord>(header->assets[type]);
+            for (std::uint32_t index = 0; index < header->assets[type].count; ++index)
+            {
+                const SceneAssetRecord &record = records[index];
+                SceneReader reader(data + record.dataOffset, record.dataSize, strings, header->strings.count, sceneAssets);
+                loadAsset(SceneAssetType(type), std::string(getString(record.name)), reader, batch, sceneAssets.tables[type][index]);
+            }
+        }
+        return sceneAssets;
+    }
+
+    void CompiledScene::instantiate(World *world, const SceneAssets &assets) const
+    {
+        if (!isOpen())
+            return;
+        const char *strings = getSection<char>(header->strings);
+        const std::byte *data = getSection<std::byte>(header->data);
+
+        // The component types are looked up once per scene (instead of once per component)
+        const auto &registry = getComponentTypeRegistry();
+        const SceneString *typeNames = getSection<SceneString>(header->componentTypes);
+        std::vector<const ComponentTypeInfo *> types(header->componentTypes.count, nullptr);
+        for (std::uint32_t index = 0; index < header->componentTypes.count; ++index)
+        {
+            if (auto it = registry.find(std::string(getString(typeNames[index]))); it != registry.end())
+                types[index] = &it->second;
+        }
+
+        const SceneEntityRecord *entities = getSection<SceneEntityRecord>(header->entities);
+        const SceneComponentRecord *components = getSection<SceneComponentRecord>(header->components);
+        std::vector<Entity *> created(header->entities.count);
+        for (std::uint32_t index = 0; index < header->entities.count; ++index)
+        {
+            const SceneEntityRecord &record = entities[index];
+            Entity *entity = world->add();
+            // Since the entities are stored depth-first, this never moves any entity in the hierarchy order
+            if (record.parent != INVALID_SCENE_INDEX)
+                world->setParent(entity, created[record.parent]);
+            created[index] = entity;
+            entity->name = getString(record.name);
+            Transform &transform = entity->modifyLocalTransform();
+            transform.position = record.position;
+            transform.rotation = record.rotation;
+            transform.scale = record.scale;
+            for (std::uint32_t componentIndex = record.firstComponent; componentIndex < record.firstComponent + record.componentCount; ++componentIndex)
+            {
+                const SceneComponentRecord &component = components[componentIndex];
+                if (const ComponentTypeInfo *type = types[component.type]; type)
+                {
+                    SceneReader reader(data + component.dataOffset, component.dataSize, strings, header->strings.count, assets);
+                    type->create(entity)->deserialize(reader);
+                }
+            }
+        }
+    }
+
+    // Returns true if the file at "path" exists and was modified after the file at "sourcePath"
+    static bool isNewerThan(const std::string &path, const std::string &sourcePath)
+    {
+        std::error_code error;
+        auto time = std::filesystem::last_write_time(path, error);
+        if (error)
+            return false;
+        auto sourceTime = std::filesystem::last_write_time(sourcePath, error);
+        return !error && time > sourceTime;
+    }
+
+    void loadScene(const nlohmann::json &scene, const std::string &configPath, World *world, bool streaming)
+    {
+        OUR_TRACE_SCOPE_DETAIL("load scene", configPath);
+        if (!configPath.empty())
+        {
+            std::string compiledPath = getCompiledScenePath(configPath);
+            CompiledScene compiled;
+            // If the compiled scene is stale (or can not be opened, e.g. it was written by an older version), we compile it again
+            bool opened = isNewerThan(compiledPath, configPath) && compiled.open(compiledPath);
+            if (!opened)
+            {
+                OUR_TRACE_SCOPE("compile scene");
+                if (saveCompiledScene(compileScene(scene), compiledPath))
+                    opened = compiled.open(compiledPath);
+            }
+            if (opened)
+            {
+                SceneAssets assets = compiled.loadAssets(streaming);
+                OUR_TRACE_SCOPE("instantiate scene");
+                compiled.instantiate(world, assets);
+                return;
+            }
+        }
+        // Otherwise, we fall back to the json
+        if (scene.contains("assets"))
+            deserializeAllAssets(scene["assets"], streaming);
+        if (scene.contains("world"))
+            world->deserialize(scene["world"]);
+    }
+
+}
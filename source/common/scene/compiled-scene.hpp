@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include <json/json.hpp>
+
+#include "scene-stream.hpp"
+#include "../io/mapped-file.hpp"
+
+namespace our
+{
+
+    class World;
+
+    // A compiled scene is a binary version of a json scene config ({"assets": ..., "world": ...}).
+    // The json stays the authoring format, while the compiled scene is what the engine loads at runtime:
+    // - All the strings (names, paths, component types) are stored once in a string table.
+    // - References between assets (e.g. a material's shader) and from components to assets (e.g. a mesh renderer's mesh)
+    //   are stored as indices into the asset tables, so they are resolved without looking up any name.
+    // - The entities are stored as flat records in depth-first order (so a parent always comes before its children)
+    //   and the components of each entity are stored as consecutive records whose data is written by "Component::compile".
+    // The file is memory mapped, and the world is created directly from the records.
+    // All the values are stored in the native byte order, so a compiled scene is not meant to be moved between machines.
+
+    // The layout of a compiled scene file:
+    //      CompiledSceneHeader
+    //      The sections listed in the header (each section starts at an offset aligned to 8 bytes)
+    constexpr char COMPILED_SCENE_MAGIC[4] = {'O', 'S', 'C', 'N'};
+    // Increment this whenever the layout of the file or of any record changes, so that old files are compiled again
+    constexpr std::uint32_t COMPILED_SCENE_VERSION = 2;
+    // The extension of the compiled scene files
+    constexpr const char *COMPILED_SCENE_EXTENSION = ".ourscene";
+
+    // A range in the file. "count" is the number of records in the section (or the number of bytes for the strings & data sections)
+    struct CompiledSceneSection
+    {
+        std::uint32_t offset;
+        std::uint32_t count;
+    };
+
+    struct CompiledSceneHeader
+    {
+        char magic[4];
+        std::uint32_t version;
+        CompiledSceneSection strings;                        // The string table (a sequence of null-terminated strings)
+        CompiledSceneSection assets[SCENE_ASSET_TYPE_COUNT]; // A table of "SceneAssetRecord" for every asset type
+        CompiledSceneSection componentTypes;                 // The ID strings of the component types used in the scene ("SceneString")
+        CompiledSceneSection entities;                       // The entities ("SceneEntityRecord")
+        CompiledSceneSection components;                     // The components ("SceneComponentRecord")
+        CompiledSceneSection data;                           // The data of the asset & component records
+    };
+
+    struct SceneAssetRecord
+    {
+        SceneString name;
+        std::uint32_t dataOffset; // The data range of the record relative to the start of the data section
+        std::uint32_t dataSize;
+    };
+
+    struct SceneEntityRecord
+    {
+        SceneString name;
+        std::uint32_t parent; // The index of the parent entity (or INVALID_SCENE_INDEX for a root entity)
+        glm::vec3 position;
+        glm::vec3 rotation; // In radians
+        glm::vec3 scale;
+        std::uint32_t firstComponent; // The components of the entity are the records [firstComponent, firstComponent + componentCount)
+        std::uint32_t componentCount;
+    };
+
+    struct SceneComponentRecord
+    {
+        std::uint32_t type; // The index of the component type in the component types section
+        std::uint32_t dataOffset;
+        std::uint32_t dataSize;
+    };
+
+    // Compiles a json scene config into the bytes of a compiled scene file
+    std::vector<std::byte> compileScene(const nlohmann::json &scene);
+    // Writes the compiled scene to the given path
+    // The file is written to a temporary file first then renamed, so a reader never sees a partially written file.
+    bool saveCompiledScene(const std::vector<std::byte> &bytes, const std::string &path);
+    // Returns the path of the compiled scene of a config file, which is stored next to it (e.g. "config/app.jsonc" -> "config/app.ourscene")
+    std::string getCompiledScenePath(const std::string &configPath);
+
+    // This class maps a compiled scene file and creates its assets and entities
+    class CompiledScene
+    {
+        MappedFile file;
+        const CompiledSceneHeader *header = nullptr;
+
+        // Returns a pointer to the first record of the given section
+        template <typename T>
+        const T *getSection(const CompiledSceneSection &section) const
+        {
+            return reinterpret_cast<const T *>(file.data() + section.offset);
+        }
+        // Returns a view of a string in the string table (or an empty view if the reference is out of range)
+        std::string_view getString(SceneString reference) const;
+        // Checks that the header, the sections and all the records point inside the file
+        bool validate() const;
+
+    public:
+        // Maps the compiled scene at the given path
+        // Returns false if the file could not be mapped, was written by another version or is corrupted
+        bool open(const std::string &path);
+        void close();
+        bool isOpen() const { return header != nullptr; }
+
+        // Creates the assets stored in the scene and adds them to the asset loaders (so they can still be found by their names)
+        // The returned tables are used to resolve the asset references of the components
+        // If "streaming" is true, the textures and meshes are streamed in the background (see "asset-streamer.hpp")
+        SceneAssets loadAssets(bool streaming = false) const;
+        // Creates the entities stored in the scene (and their components) in the given world
+        void instantiate(World *world, const SceneAssets &assets) const;
+    };
+
+    // Loads the assets and the world of a json scene config (the "scene" section of the app config) into the given world.
+    // If the compiled scene of the config file is newer than the config file, it is loaded instead of walking the json.
+    // Otherwise, the scene is compiled first (so the next startup can use it).
+    // If no config path is given or the compiled scene can not be written, the scene is loaded from the json.
+    // If "streaming" is true, the textures and meshes are streamed in the background instead of being waited for.
+    void loadScene(const nlohmann::json &scene, const std::string &configPath, World *world, bool streaming = false);
+
+}
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <type_traits>
+
+namespace our
+{
+
+    class ShaderProgram;
+    class Texture2D;
+    class Sampler;
+    class Mesh;
+    class Material;
+
+    // The types of the assets stored in a compiled scene (see "compiled-scene.hpp")
+    // They are listed in the order they are loaded, since materials refer to shaders, textures and samplers
+    enum SceneAssetType : std::uint32_t
+    {
+        SCENE_SHADER = 0,
+        SCENE_TEXTURE = 1,
+        SCENE_SAMPLER = 2,
+        SCENE_MESH = 3,
+        SCENE_MATERIAL = 4,
+        SCENE_ASSET_TYPE_COUNT = 5
+    };
+
+    // Maps an asset class to its type in the compiled scene
+    template <typename T>
+    struct SceneAssetTypeOf;
+    template <>
+    struct SceneAssetTypeOf<ShaderProgram> { static constexpr SceneAssetType value = SCENE_SHADER; };
+    template <>
+    struct SceneAssetTypeOf<Texture2D> { static constexpr SceneAssetType value = SCENE_TEXTURE; };
+    template <>
+    struct SceneAssetTypeOf<Sampler> { static constexpr SceneAssetType value = SCENE_SAMPLER; };
+    template <>
+    struct SceneAssetTypeOf<Mesh> { static constexpr SceneAssetType value = SCENE_MESH; };
+    template <>
+    struct SceneAssetTypeOf<Material> { static constexpr SceneAssetType value = SCENE_MATERIAL; };
+
+    // The index used in a compiled scene when a reference does not point to anything (e.g. an unknown asset name or a root entity's parent)
+    constexpr std::uint32_t INVALID_SCENE_INDEX = 0xFFFFFFFFu;
+
+    // A reference to a string in the string table of a compiled scene
+    // Every string in the table is followed by a null character, so it can also be used as a C string
+    struct SceneString
+    {
+        std::uint32_t offset;
+        std::uint32_t length;
+    };
+
+    // The string table of a scene while it is being compiled
+    // Equal strings are only stored once
+    class SceneStringTable
+    {
+        std::vector<char> characters;
+        std::unordered_map<std::string, SceneString> lookup;
+
+    public:
+        // Adds the string to the table (if it is not already there) and returns a reference to it
+        SceneString add(const std::string &value)
+        {
+            if (auto it = lookup.find(value); it != lookup.end())
+                return it->second;
+            SceneString reference = {static_cast<std::uint32_t>(characters.size()), static_cast<std::uint32_t>(value.size())};
+            characters.insert(characters.end(), value.begin(), value.end());
+            characters.push_back('\0');
+            lookup.emplace(value, reference);
+            return reference;
+        }
+        const std::vector<char> &getCharacters() const { return characters; }
+    };
+
+    // While a scene is compiled, this maps the name of each asset to its index in the table of its type
+    struct SceneAssetIndices
+    {
+        std::unordered_map<std::string, std::uint32_t> names[SCENE_ASSET_TYPE_COUNT];
+    };
+
+    // This class is used to write the binary record of an asset or a component while a scene is compiled
+    // Values are written as raw bytes (in the native byte order) and must be read back in the same order by "SceneReader"
+    class SceneWriter
+    {
+        std::vector<std::byte> &bytes;
+        SceneStringTable &strings;
+        const SceneAssetIndices &assets;
+
+    public:
+        SceneWriter(std::vector<std::byte> &bytes, SceneStringTable &strings, const SceneAssetIndices &assets)
+            : bytes(bytes), strings(strings), assets(assets) {}
+
+        // Writes a plain value (a number, an enum, a glm vector, ...)
+        template <typename T>
+        void write(const T &value)
+        {
+            static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be written to a scene record");
+            const std::byte *begin = reinterpret_cast<const std::byte *>(&value);
+            bytes.insert(bytes.end(), begin, begin + sizeof(T));
+        }
+
+        // Adds the string to the string table and writes a reference to it
+        void writeString(const std::string &value) { write(strings.add(value)); }
+
+        // Writes the index of the asset of type T with the given name (or INVALID_SCENE_INDEX if there is no such asset)
+        template <typename T>
+        void writeAsset(const std::string &name)
+        {
+            const auto &names = assets.names[SceneAssetTypeOf<T>::value];
+            auto it = names.find(name);
+            write<std::uint32_t>(it != names.end() ? it->second : INVALID_SCENE_INDEX);
+        }
+    };
+
+    // The assets created from a compiled scene, indexed in the same order they are stored in the scene
+    struct SceneAssets
+    {
+        std::vector<void *> tables[SCENE_ASSET_TYPE_COUNT];
+
+        // Returns the asset of type T at the given index (or nullptr if the index is invalid)
+        template <typename T>
+        T *get(std::uint32_t index) const
+        {
+            const auto &table = tables[SceneAssetTypeOf<T>::value];
+            return index < table.size() ? static_cast<T *>(table[index]) : nullptr;
+        }
+    };
+
+    // This class reads the binary record of an asset or a component from a compiled scene
+    // Reading past the end of the record returns value-initialized values and marks the reader as invalid
+    class SceneReader
+    {
+        const std::byte *cursor;
+        const std::byte *end;
+        const char *strings;
+        size_t stringsSize;
+        const SceneAssets &assets;
+        bool valid = true;
+
+    public:
+        SceneReader(const std::byte *data, size_t size, const char *strings, size_t stringsSize, const SceneAssets &assets)
+            : cursor(data), end(data + size), strings(strings), stringsSize(stringsSize), assets(assets) {}
+
+        // Reads a plain value (a number, an enum, a glm vector, ...)
+        template <typename T>
+        T read()
+        {
+            static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be read from a scene record");
+            T value{};
+            if (size_t(end - cursor) < sizeof(T))
+            {
+                valid = false;
+                cursor = end;
+                return value;
+            }
+            std::memcpy(&value, cursor, sizeof(T));
+            cursor += sizeof(T);
+            return value;
+        }
+
+        // Reads a string reference and returns a view of the string in the string table
+        // The view stays valid as long as the compiled scene is open
+        std::string_view readString()
+        {
+            SceneString reference = read<SceneString>();
+            if (reference.offset > stringsSize || reference.length >= stringsSize - reference.offset)
+            {
+                valid = false;
+                return {};
+            }
+            return std::string_view(strings + reference.offset, reference.length);
+        }
+
+        // Reads an asset index and returns the corresponding asset (or nullptr if the index is invalid)
+        template <typename T>
+        T *readAsset() { return assets.get<T>(read<std::uint32_t>()); }
+
+        // Returns false if the reader tried to read past the end of the record or found an invalid string
+        bool isValid() const { return valid; }
+    };
+
+}
@@ -1,24 +1,41 @@
 #include "shader.hpp"
+#include "../io/asset-pack.hpp"
+#include "../trace/trace.hpp"
 
 #include <cassert>
 #include <iostream>
-#include <fstream>
 #include <string>
 
 //Forward definition for error checking functions
 std::string checkForShaderCompilationErrors(GLuint shader);
 std::string checkForLinkingErrors(GLuint program);
 
-bool our::ShaderProgram::attach(const std::string &filename, GLenum type) const {
+bool our::ShaderProgram::readSource(const std::string &filename, std::string &source) {
     // Here, we open the file and read a string from it containing the GLSL code of our shader
-    std::ifstream file(filename);
-    if(!file){
+    // The file is read from the asset pack if it has the file (see "io/asset-pack.hpp")
+    our::AssetFile file;
+    file.open(filename);
+    return readSource(file, filename, source);
+}
+
+bool our::ShaderProgram::readSource(const AssetFile &file, const std::string &filename, std::string &source) {
+    if(!file.isOpen()){
         std::cerr << "ERROR: Couldn't open shader file: " << filename << std::endl;
         return false;
     }
-    std::string sourceString = std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
-    const char* sourceCStr = sourceString.c_str();
-    file.close();
+    source.assign(reinterpret_cast<const char*>(file.data()), file.size());
+    return true;
+}
+
+bool our::ShaderProgram::attach(const std::string &filename, GLenum type) const {
+    std::string sourceString;
+    if(!readSource(filename, sourceString)) return false;
+    return attachSource(sourceString, type, filename);
+}
+
+bool our::ShaderProgram::attachSource(const std::string &source, GLenum type, const std::string &label) const {
+    OUR_TRACE_SCOPE_DETAIL("compile shader", label);
+    const char* sourceCStr = source.c_str();
 
     GLuint shaderID = glCreateShader(type);
 
@@ -27,7 +44,7 @@ bool our::ShaderProgram::attach(const std::string &filename, GLenum type) const
     glCompileShader(shaderID);
     
     if(std::string error = checkForShaderCompilationErrors(shaderID); error.size() != 0){
-        std::cerr << "ERROR IN " << filename << std::endl;
+        std::cerr << "ERROR IN " << label << std::endl;
         std::cerr << error << std::endl;
         glDeleteShader(shaderID);
         return false;
@@ -45,6 +62,7 @@ bool our::ShaderProgram::attach(const std::string &filename, GLenum type) const
 
 
 bool our::ShaderProgram::link() const {
+    OUR_TRACE_SCOPE("link program");
     // call opengl to link the program identified by this->program 
     glLinkProgram(program);
 
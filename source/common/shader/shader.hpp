@@ -9,6 +9,8 @@
 
 namespace our {
 
+    class AssetFile;
+
     class ShaderProgram {
 
     private:
@@ -20,6 +22,13 @@ namespace our {
         ~ShaderProgram(){ if(program != 0) glDeleteProgram(program); }
 
         bool attach(const std::string &filename, GLenum type) const;
+        // Compiles the given GLSL source code and attaches it to the program
+        // The label is only used to identify the shader in the error messages (e.g. the file name)
+        bool attachSource(const std::string &source, GLenum type, const std::string &label = "") const;
+        // Reads the whole file into the given string (it does not need an OpenGL context so it can be called on any thread)
+        static bool readSource(const std::string &filename, std::string &source);
+        // Like "readSource" but the file was already read (e.g. by the "AsyncFileReader"), the filename is only used in the error message
+        static bool readSource(const AssetFile &file, const std::string &filename, std::string &source);
 
         bool link() const;
 
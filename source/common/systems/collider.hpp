@@ -5,6 +5,8 @@
 #include "../components/free-camera-controller.hpp"
 #include "../components/camera.hpp"
 #include "../game/Game.hpp"
+#include "../ecs/scheduler.hpp"
+#include "../asset-streamer.hpp"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
@@ -27,14 +29,34 @@ namespace our
     class ColliderSystem
     {
 
-        Entity *cameraEntity = nullptr;
-        Entity *mainCharacterEntity = nullptr;
+        // We store handles (instead of pointers) to the entities we found since they can be deleted (e.g. when the world is cleared)
+        EntityHandle cameraHandle;
+        EntityHandle mainCharacterHandle;
+        Entity *cameraEntity = nullptr;        // Resolved from "cameraHandle" every frame
+        Entity *mainCharacterEntity = nullptr; // Resolved from "mainCharacterHandle" every frame
         time_t currentTime;
         time_t collisionTime;
-        std::vector<MeshRendererComponent *> heartComponents;
-        std::vector<MeshRendererComponent *> presentComponents;
+        std::vector<EntityHandle> heartEntities;
+        std::vector<EntityHandle> presentEntities;
+
+        // Returns the mesh renderer of the entity referred to by the given handle (or nullptr if the entity no longer exists)
+        static MeshRendererComponent *getMeshRenderer(World *world, EntityHandle handle)
+        {
+            Entity *entity = world->get(handle);
+            return entity ? entity->getComponent<MeshRendererComponent>() : nullptr;
+        }
 
     public:
+        // The collider hides the collected mesh renderers and moves the camera back when it hits a boundary
+        // It reads the world matrices of any entity (which may update their caches), so it is declared as modifying every transform
+        static SystemAccess getAccess()
+        {
+            return SystemAccess()
+                .read<CameraComponent, FreeCameraControllerComponent>()
+                .write<MeshRendererComponent>()
+                .writeTransforms<>();
+        }
+
         // this is called each frame to detect any collision happening between the main character
         // and other mesh renderer components in the scene
         void
@@ -42,76 +64,75 @@ namespace our
         {
             currentTime = time(NULL);
 
-            CameraComponent *camera = nullptr;
-            FreeCameraControllerComponent *controller = nullptr;
-
             // fisrt I need to get
             // 1) Camera
             // 2) Main character
             // 3) presents
             // 4) hearts
-            if (!cameraEntity)
+            cameraEntity = world->get(cameraHandle);
+            mainCharacterEntity = world->get(mainCharacterHandle);
+            // If the entities we found before are gone (or we never looked for them), we search for them again
+            if (!cameraEntity || !mainCharacterEntity)
             {
-                for (auto entity : world->getEntities())
+                heartEntities.clear();
+                presentEntities.clear();
+                // The main character, the hearts and the presents are the children of the controlled camera
+                // so we only visit the children of the camera (instead of every mesh renderer in the world)
+                Entity *controlledCamera = world->single<CameraComponent, FreeCameraControllerComponent>();
+                for (Entity *entity = controlledCamera ? controlledCamera->getFirstChild() : nullptr; entity; entity = entity->getNextSibling())
                 {
-                    // If I have a parent
-                    if (entity->parent)
+                    // Only entities with a mesh renderer can be the main character, a heart or a present
+                    MeshRendererComponent *hasMeshRenderer = entity->getComponent<MeshRendererComponent>();
+                    if (!hasMeshRenderer)
+                        continue;
+                    // If I am the main character
+                    if (hasMeshRenderer->kind == MAIN)
                     {
-                        camera = entity->parent->getComponent<CameraComponent>();
-                        controller = entity->parent->getComponent<FreeCameraControllerComponent>();
-
-                        // And my parent is the camera, then I am either the main character, a heart, or a present
-                        if (camera && controller)
-                        {
-                            MeshRendererComponent *hasMeshRenderer = entity->getComponent<MeshRendererComponent>();
-                            // If I am the main character
-                            if (hasMeshRenderer && hasMeshRenderer->kind == MAIN)
-                            {
-                                // Set the main charcter and camera
-                                cameraEntity = entity->parent;
-                                mainCharacterEntity = entity;
-                            }
-                            // If I am a heart
-                            else if (hasMeshRenderer && hasMeshRenderer->kind == HEART)
-                            {
-                                // append to the list of hearts
-                                heartComponents.push_back(hasMeshRenderer);
-                            }
-                            // If I am a present
-                            else if (hasMeshRenderer && hasMeshRenderer->kind == PRESENT)
-                            {
-                                // append to the list of presents
-                                presentComponents.push_back(hasMeshRenderer);
-                            }
-                        }
+                        // Set the main charcter and camera
+                        cameraEntity = controlledCamera;
+                        mainCharacterEntity = entity;
+                        cameraHandle = cameraEntity->getHandle();
+                        mainCharacterHandle = mainCharacterEntity->getHandle();
+                    }
+                    // If I am a heart
+                    else if (hasMeshRenderer->kind == HEART)
+                    {
+                        // append to the list of hearts
+                        heartEntities.push_back(entity->getHandle());
+                    }
+                    // If I am a present
+                    else if (hasMeshRenderer->kind == PRESENT)
+                    {
+                        // append to the list of presents
+                        presentEntities.push_back(entity->getHandle());
                     }
                 }
+                // If there is no main character in this world, there is nothing to collide with
+                if (!cameraEntity || !mainCharacterEntity)
+                    return;
             }
-            //  For each entity in the world
-            for (auto entity : world->getEntities())
+            //  For each mesh renderer in the world (the components are stored contiguously in the world's pool)
+            for (auto &component : world->getComponents<MeshRendererComponent>())
             {
-                // Get the MeshRenderer component if it exists
-                MeshRendererComponent *collider = entity->getComponent<MeshRendererComponent>();
+                MeshRendererComponent *collider = &component;
+                Entity *entity = collider->getOwner();
 
-                // if there is a mesh renderer then chack its colliding type
-                if (collider)
+                // chack its colliding type
+                switch (collider->collidingType)
                 {
-                    switch (collider->collidingType)
-                    {
-                    case BOUNDARY:
-                        handleBoundaryCollision(collider, entity);
-                        break;
-                    case COLLECTABLE:
-                        handleCollectableCollision(collider, entity, game);
-                        break;
-                    case AVOIDABLE:
-                        handleAvoidableCollision(collider, entity, game);
-                        break;
-                    case IGNORE:
-                        break;
-                    default:
-                        break;
-                    }
+                case BOUNDARY:
+                    handleBoundaryCollision(collider, entity);
+                    break;
+                case COLLECTABLE:
+                    handleCollectableCollision(world, collider, entity, game);
+                    break;
+                case AVOIDABLE:
+                    handleAvoidableCollision(world, collider, entity, game);
+                    break;
+                case IGNORE:
+                    break;
+                default:
+                    break;
                 }
             }
         }
@@ -120,7 +141,7 @@ namespace our
         {
 
             if (isCollided(collider, entity))
-                cameraEntity->localTransform = entity->lastNonCollidedLocalTransform;
+                cameraEntity->setLocalTransform(entity->lastNonCollidedLocalTransform);
 
             else
             { // As long as I am moving and I haven't collided
@@ -128,16 +149,16 @@ namespace our
                 // but shifted a little based on the direction
                 // here the shift is done to create a ripple effect when the character collides
                 // to make the character step back a little based on the ammount of shift
-                Transform shiftedNonCollided = cameraEntity->localTransform;
-                if (!entity->localTransform.position.x == 0)
+                Transform shiftedNonCollided = cameraEntity->getLocalTransform();
+                if (!entity->getLocalTransform().position.x == 0)
                     shiftedNonCollided.position.x += shiftedNonCollided.position.x < 0 ? 1 : -1;
-                if (!entity->localTransform.position.z == 0)
+                if (!entity->getLocalTransform().position.z == 0)
                     shiftedNonCollided.position.z += shiftedNonCollided.position.z < 0 ? 1 : -1;
                 entity->lastNonCollidedLocalTransform = shiftedNonCollided;
             }
         }
 
-        void handleCollectableCollision(MeshRendererComponent *collider, Entity *entity, Game *game)
+        void handleCollectableCollision(World *world, MeshRendererComponent *collider, Entity *entity, Game *game)
         {
             // If I have collided with a collectable item and its not hidden yet
             if (isCollided(collider, entity) && !collider->hidden)
@@ -147,15 +168,16 @@ namespace our
                 // and increase the amount of collected presents
                 // this function also changes the game state if the presents collected equal to the presents goal
                 game->incrementPresents();
-                if (presentComponents.size())
+                if (presentEntities.size())
                 { // to add the collected presents at the top of the screen
-                    presentComponents[presentComponents.size() - 1]->hidden = false;
-                    presentComponents.pop_back();
+                    if (auto present = getMeshRenderer(world, presentEntities.back()))
+                        present->hidden = false;
+                    presentEntities.pop_back();
                 }
             }
         }
 
-        void handleAvoidableCollision(MeshRendererComponent *collider, Entity *entity, Game *game)
+        void handleAvoidableCollision(World *world, MeshRendererComponent *collider, Entity *entity, Game *game)
         {
             // If I have collided with an avoidable item and the recovery time has passed from the last time I collided
             if (isCollided(collider, entity) && currentTime - collisionTime > RECOVERY_SECONDS) //  Recovery time is defined as 5 seconds here
@@ -165,10 +187,11 @@ namespace our
                 // and decrease the hearts the character has
                 // this function also changes the game state if player has lost all its hearts
                 game->decrementHearts();
-                if (heartComponents.size())
+                if (heartEntities.size())
                 { // remove a heart from the top screen
-                    heartComponents[heartComponents.size() - 1]->hidden = true;
-                    heartComponents.pop_back();
+                    if (auto heart = getMeshRenderer(world, heartEntities.back()))
+                        heart->hidden = true;
+                    heartEntities.pop_back();
                 }
             }
         }
@@ -190,6 +213,10 @@ namespace our
         // as their bounding boxes change as long as they are moving
         bool isCollided(MeshRendererComponent *collider, Entity *entity)
         {
+            // A mesh that is still streaming has the bounding box of its placeholder (a unit cube), so it can not collide until it is loaded
+            AssetStreamer &streamer = AssetStreamer::get();
+            if (streamer.isStreaming(collider->mesh) || streamer.isStreaming(mainCharacterEntity->getComponent<MeshRendererComponent>()->mesh))
+                return false;
             // First get the non transformed bounding box of the main character and the entity I want to chack my collison with in the object space
             // 1) Non transformed main character bounding box
             glm::vec3 boundingBoxOfTheMainCharacterMin = mainCharacterEntity->getComponent<MeshRendererComponent>()->mesh->getBoundingBoxMin();
@@ -4,6 +4,7 @@
 #include "../components/camera.hpp"
 #include "../components/mesh-renderer.hpp"
 #include "../components/light.hpp"
+#include "../jobs/job-system.hpp"
 
 #include <glad/gl.h>
 #include <vector>
@@ -36,8 +37,18 @@ namespace our
         std::vector<RenderCommand> transparentCommands;
         std::vector<RenderCommand> gameScreenItemsCommands;             //This extra vector is to hold the items in the gamescreen itself
                                                                         //Example: Lives
+        // The commands built by each job (see "render"). They are kept here for the same reason as the vectors above.
+        struct CommandLists
+        {
+            std::vector<RenderCommand> opaque, transparent, gameScreenItems;
+        };
+        std::vector<CommandLists> chunkCommands;
+
 
     public:
+        // The number of mesh renderers that each job turns into render commands
+        static constexpr size_t COMMAND_GRAIN = 1024;
+
         // This function should be called every frame to draw the given world
         // Both viewportStart and viewportSize are using to define the area on the screen where we will draw the scene
         // viewportStart is the lower left corner of the viewport (in pixels)
@@ -49,27 +60,41 @@ namespace our
 
             std::vector<LightComponent> lights;
 
+            // We make sure that all the cached local to world matrices are up to date
+            // so the rest of this function only reads them
+            world->updateLocalToWorldMatrices();
+
             opaqueCommands.clear();
             transparentCommands.clear();
             gameScreenItemsCommands.clear();
-            for (auto entity : world->getEntities())
-            {
-                // If we hadn't found a camera yet, we look for a camera in this entity
-                if (!camera)
-                    camera = entity->getComponent<CameraComponent>();
-
+            // We pick the first camera in the world (the world keeps the list of cameras cached)
+            if (Entity *cameraEntity = world->single<CameraComponent>(); cameraEntity)
+                camera = cameraEntity->getComponent<CameraComponent>();
 
-                //This vector is to hold all our light components
-                LightComponent *possibleLight = entity->getComponent<LightComponent>();
-                if (possibleLight)
-                {
-                    lights.push_back(*possibleLight);
-                }
+            //This vector is to hold all our light components
+            for (auto &light : world->getComponents<LightComponent>())
+            {
+                lights.push_back(light);
+            }
 
-                // If this entity has a mesh renderer component
-                if (auto meshRenderer = entity->getComponent<MeshRendererComponent>(); meshRenderer)
+            // Then we visit every mesh renderer component (they are stored contiguously in the world's pool)
+            // The components are split into chunks that are turned into commands in parallel by the job system,
+            // then the commands of the chunks are appended in order (so the commands are in the same order as the components)
+            auto &meshRenderers = world->getComponents<MeshRendererComponent>();
+            size_t chunkCount = (meshRenderers.size() + COMMAND_GRAIN - 1) / COMMAND_GRAIN;
+            if (chunkCommands.size() < chunkCount)
+                chunkCommands.resize(chunkCount);
+            JobSystem::get().parallelFor(0, meshRenderers.size(), COMMAND_GRAIN, [&](size_t begin, size_t end)
+                                         {
+                CommandLists &lists = chunkCommands[begin / COMMAND_GRAIN];
+                lists.opaque.clear();
+                lists.transparent.clear();
+                lists.gameScreenItems.clear();
+                for (size_t index = begin; index < end; ++index)
                 {
+                    MeshRendererComponent *meshRenderer = &meshRenderers[index];
                     // We construct a command from it
+                    // (the matrices are already up to date, so getLocalToWorldMatrix only reads them and is safe to call from any thread)
                     RenderCommand command;
                     command.localToWorld = meshRenderer->getOwner()->getLocalToWorldMatrix();
                     command.center = glm::vec3(command.localToWorld * glm::vec4(0, 0, 0, 1));
@@ -79,18 +104,24 @@ namespace our
                     // if it is transparent, we add it to the transparent commands list
                     if (command.material->transparent)
                     {
-                        transparentCommands.push_back(command);
+                        lists.transparent.push_back(command);
                     }
                     else if (!command.material->gameScreenItem)
                     {
                         // Otherwise, we add it to the opaque command list
-                        opaqueCommands.push_back(command);
+                        lists.opaque.push_back(command);
                     }
                     else
                     {
-                        gameScreenItemsCommands.push_back(command);
+                        lists.gameScreenItems.push_back(command);
                     }
-                }
+                } });
+            for (size_t chunk = 0; chunk < chunkCount; ++chunk)
+            {
+                CommandLists &lists = chunkCommands[chunk];
+                opaqueCommands.insert(opaqueCommands.end(), lists.opaque.begin(), lists.opaque.end());
+                transparentCommands.insert(transparentCommands.end(), lists.transparent.begin(), lists.transparent.end());
+                gameScreenItemsCommands.insert(gameScreenItemsCommands.end(), lists.gameScreenItems.begin(), lists.gameScreenItems.end());
             }
 
             // If there is no camera, we return (we cannot render without a camera)
@@ -100,7 +131,9 @@ namespace our
             // TODO: Modify the following line such that "cameraForward" contains a vector pointing the camera forward direction
             // HINT: See how you wrote the CameraComponent::getViewMatrix, it should help you solve this one
             // glm::vec3 cameraForward = glm::vec3(0.0f);
-            glm::vec3 cameraForward = camera->getOwner()->getLocalToWorldMatrix() * glm::vec4(0, 0, -1, 0);
+            const glm::mat4 &cameraLocalToWorld = camera->getOwner()->getLocalToWorldMatrix();
+            glm::vec3 cameraForward = cameraLocalToWorld * glm::vec4(0, 0, -1, 0);
+            glm::vec3 eye = glm::vec3(cameraLocalToWorld * glm::vec4(0, 0, 0, 1));
 
             std::sort(transparentCommands.begin(), transparentCommands.end(), [cameraForward](const RenderCommand &first, const RenderCommand &second)
                       {
@@ -141,7 +174,7 @@ namespace our
                 command.material->shader->set("M", command.localToWorld);
                 command.material->shader->set("M_IT", glm::transpose(glm::inverse(command.localToWorld)));
                 command.material->shader->set("vp", VP);
-                command.material->shader->set("eye", glm::vec3(camera->getOwner()->getLocalToWorldMatrix() * glm::vec4(0, 0, 0, 1)));
+                command.material->shader->set("eye", eye);
                 
                 command.material->shader->set("light_count", (int)lights.size());       //Sending the lights count to the shader
                 
@@ -159,7 +192,10 @@ namespace our
                     command.material->shader->set("lights[" + std::to_string(i) + "].direction", glm::vec3(lights[i].getOwner()->getLocalToWorldMatrix() * glm::vec4(0, 0, 1, 0)));
                 }
                 if (!command.hidden)
+                {
+                    command.mesh->setDequantization(command.material->shader);
                     command.mesh->draw();
+                }
             }
             for (auto command : transparentCommands)
             {
@@ -171,7 +207,7 @@ namespace our
                 command.material->shader->set("M", command.localToWorld);
                 command.material->shader->set("M_IT", glm::transpose(glm::inverse(command.localToWorld)));
                 command.material->shader->set("vp", VP);
-                command.material->shader->set("eye", glm::vec3(camera->getOwner()->getLocalToWorldMatrix() * glm::vec4(0, 0, 0, 1)));
+                command.material->shader->set("eye", eye);
                 command.material->shader->set("light_count", (int)lights.size());    //Sending the lights count to the shader
 
                 //Sending the light data to the shader
@@ -187,7 +223,10 @@ namespace our
                 }
 
                 if (!command.hidden)
+                {
+                    command.mesh->setDequantization(command.material->shader);
                     command.mesh->draw();
+                }
             }
             for (auto command : gameScreenItemsCommands)
             {
@@ -199,7 +238,7 @@ namespace our
                 command.material->shader->set("M", command.localToWorld);
                 command.material->shader->set("M_IT", glm::transpose(glm::inverse(command.localToWorld)));
                 command.material->shader->set("vp", VP);
-                command.material->shader->set("eye", glm::vec3(camera->getOwner()->getLocalToWorldMatrix() * glm::vec4(0, 0, 0, 1)));
+                command.material->shader->set("eye", eye);
                 command.material->shader->set("light_count", (int)lights.size());  //Sending the lights count to the shader
 
                 //Sending the light data to the shader
@@ -215,7 +254,10 @@ namespace our
                 }
 
                 if (!command.hidden)
+                {
+                    command.mesh->setDequantization(command.material->shader);
                     command.mesh->draw();
+                }
             }
         };
     };
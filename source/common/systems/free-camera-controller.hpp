@@ -3,6 +3,7 @@
 #include "../ecs/world.hpp"
 #include "../components/camera.hpp"
 #include "../components/free-camera-controller.hpp"
+#include "../ecs/scheduler.hpp"
 
 #include "../application.hpp"
 
@@ -29,25 +30,28 @@ namespace our
             this->app = app;
         }
 
+        // The camera controller modifies the camera (its field of view) and its transform using the controller settings
+        // It runs on the main thread since it reads the input and locks the mouse through the window
+        static SystemAccess getAccess()
+        {
+            return SystemAccess()
+                .read<FreeCameraControllerComponent>()
+                .write<CameraComponent>()
+                .writeTransforms<CameraComponent, FreeCameraControllerComponent>()
+                .onMainThread();
+        }
+
         // This should be called every frame to update all entities containing a FreeCameraControllerComponent
         void update(World *world, float deltaTime)
         {
-            // First of all, we search for an entity containing both a CameraComponent and a FreeCameraControllerComponent
-            // As soon as we find one, we break
-            CameraComponent *camera = nullptr;
-            FreeCameraControllerComponent *controller = nullptr;
-            for (auto entity : world->getEntities())
-            {
-                camera = entity->getComponent<CameraComponent>();
-                controller = entity->getComponent<FreeCameraControllerComponent>();
-                if (camera && controller)
-                    break;
-            }
+            // First of all, we get the entity containing both a CameraComponent and a FreeCameraControllerComponent
+            // The world keeps the list of such entities cached, so this lookup is O(1)
+            Entity *entity = world->single<CameraComponent, FreeCameraControllerComponent>();
             // If there is no entity with both a CameraComponent and a FreeCameraControllerComponent, we can do nothing so we return
-            if (!(camera && controller))
+            if (!entity)
                 return;
-            // Get the entity that we found via getOwner of camera (we could use controller->getOwner())
-            Entity *entity = camera->getOwner();
+            CameraComponent *camera = entity->getComponent<CameraComponent>();
+            FreeCameraControllerComponent *controller = entity->getComponent<FreeCameraControllerComponent>();
 
             // If the left mouse button is pressed, we lock and hide the mouse. This common in First Person Games.
             // if (app->getMouse().isPressed(GLFW_MOUSE_BUTTON_1) && !mouse_locked)
@@ -66,8 +70,9 @@ namespace our
             app->getMouse().lockMouse(app->getWindow());
 
             // We get a reference to the entity's position and rotation
-            glm::vec3 &position = entity->localTransform.position;
-            glm::vec3 &rotation = entity->localTransform.rotation;
+            Transform &transform = entity->modifyLocalTransform();
+            glm::vec3 &position = transform.position;
+            glm::vec3 &rotation = transform.rotation;
 
             // If the left mouse button is pressed, we get the change in the mouse location
             // and use it to update the camera rotation
@@ -93,7 +98,7 @@ namespace our
             camera->fovY = fov;
 
             // We get the camera model matrix (relative to its parent) to compute the front, up and right directions
-            glm::mat4 matrix = entity->localTransform.toMat4();
+            glm::mat4 matrix = transform.toMat4();
 
             glm::vec3 front = glm::vec3(matrix * glm::vec4(0, 0, -1, 0)),
                       up = glm::vec3(matrix * glm::vec4(0, 1, 0, 0)),
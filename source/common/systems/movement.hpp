@@ -2,6 +2,8 @@
 
 #include "../ecs/world.hpp"
 #include "../components/movement.hpp"
+#include "../ecs/scheduler.hpp"
+#include "../jobs/job-system.hpp"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
@@ -16,20 +18,28 @@ namespace our
     // For more information, see "common/components/movement.hpp"
     class MovementSystem {
     public:
+        // The movement system only reads the movement components and modifies the transforms of their owners
+        static SystemAccess getAccess() {
+            return SystemAccess().read<MovementComponent>().writeTransforms<MovementComponent>();
+        }
 
-        // This should be called every frame to update all entities containing a MovementComponent. 
-        void update(World* world, float deltaTime) {
-            // For each entity in the world
-            for(auto entity : world->getEntities()){
-                // Get the movement component if it exists
-                MovementComponent* movement = entity->getComponent<MovementComponent>();
-                // If the movement component exists
-                if(movement){
+        // This should be called every frame to update all entities containing a MovementComponent.
+        // If a job system is given, the components are split into chunks that are updated in parallel
+        // (this is safe since each component only modifies the transform of its own entity)
+        void update(World* world, float deltaTime, JobSystem* jobs = nullptr) {
+            // The components are stored contiguously in the world's pool
+            auto& movements = world->getComponents<MovementComponent>();
+            auto updateRange = [&](size_t begin, size_t end){
+                for(size_t index = begin; index < end; ++index){
+                    MovementComponent& movement = movements[index];
+                    Transform& transform = movement.getOwner()->modifyLocalTransform();
                     // Change the position and rotation based on the linear & angular velocity and delta time.
-                    entity->localTransform.position += deltaTime * movement->linearVelocity;
-                    entity->localTransform.rotation += deltaTime * movement->angularVelocity;
+                    transform.position += deltaTime * movement.linearVelocity;
+                    transform.rotation += deltaTime * movement.angularVelocity;
                 }
-            }
+            };
+            if(jobs) jobs->parallelFor(0, movements.size(), updateRange);
+            else updateRange(0, movements.size());
         }
 
     };
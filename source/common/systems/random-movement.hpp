@@ -2,6 +2,8 @@
 
 #include "../ecs/world.hpp"
 #include "../components/random-movement.hpp"
+#include "../ecs/scheduler.hpp"
+#include "../jobs/job-system.hpp"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
@@ -9,6 +11,8 @@
 #include <glm/gtx/fast_trigonometry.hpp>
 #include <stdlib.h>
 #include <time.h>
+#include <vector>
+#include <algorithm>
 
 namespace our
 {
@@ -26,34 +30,66 @@ namespace our
         {
             srand(time(NULL));
         }
+        // The number of components that each job updates
+        static constexpr size_t GRAIN = 4096;
+
+        // The random movement system modifies the random movement components and the transforms of their owners
+        static SystemAccess getAccess()
+        {
+            return SystemAccess().write<RandomMovementComponent>().writeTransforms<RandomMovementComponent>();
+        }
+
         // This should be called every frame to update all entities containing a RandomMovementComponent.
-        void update(World *world, float deltaTime)
+        // If a job system is given, the positions are updated in parallel chunks.
+        // Since "changeDirection" uses rand() and alternates between x & z for the whole system,
+        // each chunk only records the entities that reached a boundary and the direction changes are applied afterwards in order.
+        void update(World *world, float deltaTime, JobSystem *jobs = nullptr)
         {
-            // For each entity in the world
-            for (auto entity : world->getEntities())
+            // The components are stored contiguously in the world's pool
+            auto &movements = world->getComponents<RandomMovementComponent>();
+            size_t chunkCount = (movements.size() + GRAIN - 1) / GRAIN;
+            // For each chunk, the indices of the components that hit a boundary (x and z hits are stored as separate entries)
+            struct BoundaryHit
+            {
+                size_t index;
+                bool xAxis;
+            };
+            std::vector<std::vector<BoundaryHit>> hits(chunkCount);
+            auto updateRange = [&](size_t begin, size_t end)
             {
-                // Get the movement component if it exists
-                RandomMovementComponent *movement = entity->getComponent<RandomMovementComponent>();
-                // If the random movement component exists
-                if (movement)
+                std::vector<BoundaryHit> &chunkHits = hits[begin / GRAIN];
+                for (size_t index = begin; index < end; ++index)
                 {
+                    RandomMovementComponent *movement = &movements[index];
                     // Then keep changing its location based on its linear velocity in the x and z direction
-                    entity->localTransform.position += deltaTime * movement->linearVelocity * movement->direction;
+                    glm::vec3 &position = movement->getOwner()->modifyLocalTransform().position;
+                    position += deltaTime * movement->linearVelocity * movement->direction;
 
                     // If I reached my min or max boundary in the x direction
-                    if (entity->localTransform.position.x >= movement->maxBoundary.x || entity->localTransform.position.x <= movement->minBoundary.x)
-                    {
-                        // Then change my x direction to the opposite side
+                    if (position.x >= movement->maxBoundary.x || position.x <= movement->minBoundary.x)
+                        chunkHits.push_back({index, true});
+                    // If I reached my min or max boundary in the z direction
+                    if (position.z >= movement->maxBoundary.z || position.z <= movement->minBoundary.z)
+                        chunkHits.push_back({index, false});
+                }
+            };
+            if (jobs)
+                jobs->parallelFor(0, movements.size(), GRAIN, updateRange);
+            else
+                for (size_t begin = 0; begin < movements.size(); begin += GRAIN)
+                    updateRange(begin, std::min(begin + GRAIN, movements.size()));
+
+            for (auto &chunkHits : hits)
+            {
+                for (auto &hit : chunkHits)
+                {
+                    RandomMovementComponent *movement = &movements[hit.index];
+                    // Change my direction on the axis I hit to the opposite side
+                    if (hit.xAxis)
                         movement->direction.x = -movement->direction.x;
-                        changeDirection(entity, movement);
-                    }
-                    // If I reached my min or max boundary in the x direction
-                    if (entity->localTransform.position.z >= movement->maxBoundary.z || entity->localTransform.position.z <= movement->minBoundary.z)
-                    {
-                        // Then change my z direction to the opposite side
+                    else
                         movement->direction.z = -movement->direction.z;
-                        changeDirection(entity, movement);
-                    }
+                    changeDirection(movement->getOwner(), movement);
                 }
             }
         }
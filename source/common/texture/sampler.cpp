@@ -15,4 +15,22 @@ namespace our {
         set(GL_TEXTURE_BORDER_COLOR, data.value("BORDER_COLOR", glm::vec4(0, 0, 0, 0)));
     }
 
+    void Sampler::compile(const nlohmann::json& data, SceneWriter& writer){
+        writer.write((GLint)gl_enum_deserialize::texture_magnification_filters.at(data.value("MAG_FILTER", "GL_LINEAR")));
+        writer.write((GLint)gl_enum_deserialize::texture_minification_filters.at(data.value("MIN_FILTER", "GL_LINEAR_MIPMAP_LINEAR")));
+        writer.write((GLint)gl_enum_deserialize::texture_wrapping_modes.at(data.value("WRAP_S", "GL_REPEAT")));
+        writer.write((GLint)gl_enum_deserialize::texture_wrapping_modes.at(data.value("WRAP_T", "GL_REPEAT")));
+        writer.write(data.value("MAX_ANISOTROPY", 1.0f));
+        writer.write(data.value("BORDER_COLOR", glm::vec4(0, 0, 0, 0)));
+    }
+
+    void Sampler::deserialize(SceneReader& reader){
+        set(GL_TEXTURE_MAG_FILTER, reader.read<GLint>());
+        set(GL_TEXTURE_MIN_FILTER, reader.read<GLint>());
+        set(GL_TEXTURE_WRAP_S, reader.read<GLint>());
+        set(GL_TEXTURE_WRAP_T, reader.read<GLint>());
+        set(GL_TEXTURE_MAX_ANISOTROPY_EXT, reader.read<GLfloat>());
+        set(GL_TEXTURE_BORDER_COLOR, reader.read<glm::vec4>());
+    }
+
 }
\ No newline at end of file
@@ -4,6 +4,8 @@
 #include <json/json.hpp>
 #include <glm/vec4.hpp>
 
+#include "../scene/scene-stream.hpp"
+
 namespace our
 {
 
@@ -69,6 +71,10 @@ namespace our
 
         // Given a json object, this function deserializes the sampler state
         void deserialize(const nlohmann::json &data);
+        // These functions write & read the binary record of a sampler in a compiled scene (see "scene/compiled-scene.hpp")
+        // The record holds the parameter values after the enum names are converted to GLenums
+        static void compile(const nlohmann::json &data, SceneWriter &writer);
+        void deserialize(SceneReader &reader);
 
         Sampler(const Sampler &) = delete;
         Sampler &operator=(const Sampler &) = delete;
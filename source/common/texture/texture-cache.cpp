@@ -0,0 +1,105 @@
+#include "texture-cache.hpp"
+#include "texture-utils.hpp"
+#include "../io/file-cache.hpp"
+#include "../io/asset-pack.hpp"
+
+#include <cstring>
+#include <vector>
+
+namespace our
+{
+
+    namespace
+    {
+        constexpr std::uint32_t alignTo16(std::uint32_t offset)
+        {
+            return (offset + 15u) & ~15u;
+        }
+    }
+
+    bool CachedTexture::open(const std::string &path, std::uint64_t key)
+    {
+        close();
+        if (!file.open(path))
+            return false;
+        auto candidate = reinterpret_cast<const TextureCacheHeader *>(file.data());
+        bool valid = file.size() >= sizeof(TextureCacheHeader) &&
+                     std::memcmp(candidate->magic, TEXTURE_CACHE_MAGIC, sizeof(TEXTURE_CACHE_MAGIC)) == 0 &&
+                     candidate->version == TEXTURE_CACHE_VERSION &&
+                     candidate->key == key &&
+                     candidate->levelCount >= 1 && candidate->levelCount <= MAX_TEXTURE_LEVELS;
+        // Every range is checked in 64-bit, so corrupted sizes can not overflow the checks
+        for (std::uint32_t level = 0; valid && level < candidate->levelCount; ++level)
+        {
+            const TextureCacheLevel &range = candidate->levels[level];
+            valid = range.width >= 1 && range.height >= 1 && range.offset % 16 == 0 &&
+                    std::uint64_t(range.offset) + std::uint64_t(range.width) * range.height * 4 <= file.size();
+        }
+        if (!valid)
+        {
+            file.close();
+            return false;
+        }
+        header = candidate;
+        return true;
+    }
+
+    void CachedTexture::close()
+    {
+        header = nullptr;
+        file.close();
+    }
+
+    bool getTextureCacheKey(const std::string &sourcePath, texture_utils::ColorSpace colorSpace, std::uint64_t &key)
+    {
+        AssetFile source;
+        if (!source.open(sourcePath))
+            return false;
+        key = getTextureCacheKey(source, colorSpace);
+        return true;
+    }
+
+    std::uint64_t getTextureCacheSeed(texture_utils::ColorSpace colorSpace)
+    {
+        return (std::uint64_t(TEXTURE_CACHE_VERSION) << 8) | std::uint64_t(colorSpace);
+    }
+
+    std::uint64_t getTextureCacheKey(const AssetFile &source, texture_utils::ColorSpace colorSpace)
+    {
+        return hashBytes(source.data(), source.size(), getTextureCacheSeed(colorSpace));
+    }
+
+    std::string getTextureCachePath(std::uint64_t key)
+    {
+        return getCachePath("textures", key, TEXTURE_CACHE_EXTENSION);
+    }
+
+    bool saveTextureCache(const texture_utils::Image &image, std::uint64_t key, const std::string &path)
+    {
+        if (image.mipmaps.size() + 1 > MAX_TEXTURE_LEVELS)
+            return false;
+        TextureCacheHeader header = {};
+        std::memcpy(header.magic, TEXTURE_CACHE_MAGIC, sizeof(TEXTURE_CACHE_MAGIC));
+        header.version = TEXTURE_CACHE_VERSION;
+        header.key = key;
+        header.levelCount = std::uint32_t(image.mipmaps.size() + 1);
+
+        std::vector<texture_utils::ImageLevel> levels;
+        levels.push_back({image.size, image.pixels});
+        levels.insert(levels.end(), image.mipmaps.begin(), image.mipmaps.end());
+
+        std::uint32_t offset = alignTo16(sizeof(TextureCacheHeader));
+        for (size_t level = 0; level < levels.size(); ++level)
+        {
+            header.levels[level] = {std::uint32_t(levels[level].size.x), std::uint32_t(levels[level].size.y), offset};
+            offset = alignTo16(offset + std::uint32_t(levels[level].size.x * levels[level].size.y * 4));
+        }
+
+        std::vector<std::byte> bytes(offset);
+        std::memcpy(bytes.data(), &header, sizeof(header));
+        for (size_t level = 0; level < levels.size(); ++level)
+            std::memcpy(bytes.data() + header.levels[level].offset, levels[level].pixels, size_t(levels[level].size.x) * levels[level].size.y * 4);
+        return writeFileAtomically(path, bytes.data(), bytes.size());
+    }
+
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <glm/vec2.hpp>
+
+#include "../io/mapped-file.hpp"
+
+namespace our
+{
+
+    class AssetFile;
+
+    // The texture cache stores the decoded pixels of every loaded image file together with its full mip chain
+    // in ".cache/textures/<hash>.ourtex" where the hash is computed from the content of the image file, its color space and the cache version.
+    // On the next startup, the cache file is memory mapped and its levels are sent to the GPU as they are
+    // (no PNG inflate, no JPEG IDCT and no mipmap generation by the driver).
+    // Like the mesh cache (see "mesh/mesh-cache.hpp"), a cache file is never updated, a changed image simply gets a different file.
+
+    // The layout of a texture cache file:
+    //      TextureCacheHeader
+    //      The RGBA8 pixels of every level (levels[i].offset is aligned to 16 bytes)
+    constexpr char TEXTURE_CACHE_MAGIC[4] = {'O', 'T', 'E', 'X'};
+    // Increment this whenever the layout of the file or the output of the image loader (e.g. the mipmap filter) changes
+    constexpr std::uint32_t TEXTURE_CACHE_VERSION = 1;
+    // The extension of the texture cache files
+    constexpr const char *TEXTURE_CACHE_EXTENSION = ".ourtex";
+    // A 2D texture can not have more levels than this (it would need a side longer than 2^32 texels)
+    constexpr std::uint32_t MAX_TEXTURE_LEVELS = 32;
+
+    struct TextureCacheLevel
+    {
+        std::uint32_t width, height;
+        std::uint32_t offset; // The offset of the pixels of the level from the start of the file
+    };
+
+    struct TextureCacheHeader
+    {
+        char magic[4];
+        std::uint32_t version;
+        std::uint64_t key; // The hash of the source file (the cache file name is derived from it)
+        std::uint32_t levelCount;
+        TextureCacheLevel levels[MAX_TEXTURE_LEVELS];
+    };
+
+    namespace texture_utils
+    {
+        struct Image;
+        enum class ColorSpace;
+    }
+
+    // This class maps a texture cache file and gives access to its levels
+    class CachedTexture
+    {
+        MappedFile file;
+        const TextureCacheHeader *header = nullptr;
+
+    public:
+        // Maps the cache file at the given path and checks that it was written for the given key by this version of the engine
+        // Returns false if the file does not exist, is stale or is corrupted
+        bool open(const std::string &path, std::uint64_t key);
+        void close();
+        bool isOpen() const { return header != nullptr; }
+
+        size_t getLevelCount() const { return header->levelCount; }
+        glm::ivec2 getLevelSize(size_t level) const { return {header->levels[level].width, header->levels[level].height}; }
+        const unsigned char *getLevelPixels(size_t level) const { return reinterpret_cast<const unsigned char *>(file.data() + header->levels[level].offset); }
+    };
+
+    // Returns the seed of the keys of the texture cache files (the cache version & the color space)
+    std::uint64_t getTextureCacheSeed(texture_utils::ColorSpace colorSpace);
+    // Returns the key of the cache file of an image file (or false if the image file could not be read)
+    // The color space is part of the key since it changes how the mip levels are computed
+    bool getTextureCacheKey(const std::string &sourcePath, texture_utils::ColorSpace colorSpace, std::uint64_t &key);
+    // Returns the key of the cache file of an image file that was already read (e.g. by the "AsyncFileReader")
+    std::uint64_t getTextureCacheKey(const AssetFile &source, texture_utils::ColorSpace colorSpace);
+    // Returns the path of the cache file with the given key
+    std::string getTextureCachePath(std::uint64_t key);
+    // Writes the image (and its mip chain) into a cache file
+    bool saveTextureCache(const texture_utils::Image &image, std::uint64_t key, const std::string &path);
+
+}
@@ -1,17 +1,84 @@
 #include "texture-utils.hpp"
+#include "../jobs/job-system.hpp"
+#include "../io/asset-pack.hpp"
+#include "../io/file-cache.hpp"
+#include "../trace/trace.hpp"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb/stb_image.h>
 
 #include <iostream>
+#include <utility>
+#include <algorithm>
+#include <cmath>
+#include <glm/glm.hpp>
 
-glm::ivec2 our::texture_utils::loadImage(Texture2D &texture, const char *filename, bool generate_mipmap)
+our::texture_utils::Image::~Image()
 {
-    glm::ivec2 size;
+    if (decoded)
+        stbi_image_free(decoded);
+}
+
+our::texture_utils::Image::Image(Image &&other) noexcept
+    : size(other.size), pixels(std::exchange(other.pixels, nullptr)), mipmaps(std::move(other.mipmaps)),
+      decoded(std::exchange(other.decoded, nullptr)), mipmapStorage(std::move(other.mipmapStorage)), cache(std::move(other.cache)) {}
+
+our::texture_utils::Image &our::texture_utils::Image::operator=(Image &&other) noexcept
+{
+    if (this != &other)
+    {
+        if (decoded)
+            stbi_image_free(decoded);
+        size = other.size;
+        pixels = std::exchange(other.pixels, nullptr);
+        mipmaps = std::move(other.mipmaps);
+        decoded = std::exchange(other.decoded, nullptr);
+        mipmapStorage = std::move(other.mipmapStorage);
+        cache = std::move(other.cache);
+    }
+    return *this;
+}
+
+size_t our::texture_utils::Image::getByteCount() const
+{
+    size_t bytes = size_t(size.x) * size_t(size.y) * 4;
+    for (const ImageLevel &level : mipmaps)
+        bytes += size_t(level.size.x) * size_t(level.size.y) * 4;
+    return bytes;
+}
+
+bool our::texture_utils::readTextureDescription(const nlohmann::json &description, std::string &path, ColorSpace &colorSpace)
+{
+    colorSpace = ColorSpace::SRGB;
+    if (description.is_string())
+    {
+        path = description.get<std::string>();
+        return true;
+    }
+    if (!description.is_object() || !description.contains("path") || !description["path"].is_string())
+        return false;
+    path = description["path"].get<std::string>();
+    if (description.value("color-space", "srgb") == "linear")
+        colorSpace = ColorSpace::LINEAR;
+    return true;
+}
+
+bool our::texture_utils::decodeImage(Image &image, const char *filename)
+{
+    // The file is read from the asset pack if it has the file, then decoded from memory
+    AssetFile file;
+    file.open(filename);
+    return decodeImage(image, file, filename);
+}
+
+bool our::texture_utils::decodeImage(Image &image, const AssetFile &file, const char *filename)
+{
+    OUR_TRACE_SCOPE_DETAIL("decode image", filename);
     int channels;
     // Since OpenGL puts the texture origin at the bottom left while images typically has the origin at the top left,
     // We need to till stb to flip images vertically after loading them
-    stbi_set_flip_vertically_on_load(true);
+    // (We use the thread local version of the flag since images can be decoded on several threads at the same time)
+    stbi_set_flip_vertically_on_load_thread(true);
     // Load image data and retrieve width, height and number of channels in the image
     // The last argument is the number of channels we want and it can have the following values:
     //- 0: Keep number of channels the same as in the image file
@@ -20,17 +87,289 @@ glm::ivec2 our::texture_utils::loadImage(Texture2D &texture, const char *filenam
     //- 3: RGB
     //- 4: RGB and Alpha (RGBA)
     // Note: channels (the 4th argument) always returns the original number of channels in the file
-    unsigned char *data = stbi_load(filename, &size.x, &size.y, &channels, 4);
+    glm::ivec2 size;
+    unsigned char *data = nullptr;
+    if (file.isOpen())
+        data = stbi_load_from_memory(reinterpret_cast<const stbi_uc *>(file.data()), int(file.size()), &size.x, &size.y, &channels, 4);
     if (data == nullptr)
     {
         std::cerr << "Failed to load image: " << filename << std::endl;
-        return {0, 0};
+        return false;
+    }
+    image = Image();
+    image.size = size;
+    image.pixels = image.decoded = data;
+    return true;
+}
+
+namespace
+{
+    // The conversions between the 8-bit sRGB encoding and linear values
+    struct SRGBTables
+    {
+        static constexpr int BINS = 4096;
+
+        float decode[256];     // decode[b] is the linear value of the sRGB byte b
+        float thresholds[256]; // thresholds[b] is the linear value halfway between the sRGB bytes b and b+1 (thresholds[255] is above 1)
+        unsigned char bins[BINS]; // bins[i] is the sRGB byte of the linear value i / BINS
+
+        SRGBTables()
+        {
+            auto toLinear = [](double value)
+            { return value <= 0.04045 ? value / 12.92 : std::pow((value + 0.055) / 1.055, 2.4); };
+            for (int byte = 0; byte < 256; ++byte)
+                decode[byte] = float(toLinear(byte / 255.0));
+            for (int byte = 0; byte < 256; ++byte)
+                thresholds[byte] = float(toLinear((byte + 0.5) / 255.0));
+            for (int bin = 0; bin < BINS; ++bin)
+                bins[bin] = static_cast<unsigned char>(std::upper_bound(thresholds, thresholds + 255, float(bin) / BINS) - thresholds);
+        }
+
+        // Returns the sRGB byte nearest to the given linear value (exactly rounded without calling "pow")
+        // The thresholds are always more than 1/BINS apart, so the byte is either the byte of the value's bin or the next one
+        unsigned char encode(float value) const
+        {
+            value = std::clamp(value, 0.0f, 1.0f);
+            int byte = bins[std::min(int(value * BINS), BINS - 1)];
+            return static_cast<unsigned char>(value >= thresholds[byte] ? byte + 1 : byte);
+        }
+    };
+
+    const SRGBTables &getSRGBTables()
+    {
+        static const SRGBTables tables;
+        return tables;
+    }
+
+    // The source texels that contribute to an output texel along one axis (and their weights)
+    struct FilterTaps
+    {
+        int first;      // The first source texel (it may be outside the image)
+        int count;
+        int indices[4]; // The source texels clamped to the image (the edge texels are repeated for the taps that fall outside the image)
+        float weights[4];
+    };
+
+    // Computes the filter taps that reduce an axis of "source" texels to "destination" texels
+    // - An even axis is halved with a [1 3 3 1]/8 tent filter, which is a smoother low-pass filter than a 2x2 box (less aliasing in the small levels).
+    // - An odd axis (2n+1 -> n) uses 3 taps weighted by how much of each source texel the output texel covers (so no texel is skipped or counted twice).
+    // - An axis that is already 1 texel long is copied.
+    std::vector<FilterTaps> computeFilterTaps(int source, int destination)
+    {
+        std::vector<FilterTaps> taps(destination);
+        for (int index = 0; index < destination; ++index)
+        {
+            FilterTaps &tap = taps[index];
+            if (source == destination)
+                tap = {index, 1, {}, {1.0f, 0.0f, 0.0f, 0.0f}};
+            else if (source == 2 * destination)
+                tap = {2 * index - 1, 4, {}, {1.0f / 8, 3.0f / 8, 3.0f / 8, 1.0f / 8}};
+            else
+            {
+                float total = float(2 * destination + 1);
+                tap = {2 * index, 3, {}, {(destination - index) / total, destination / total, (index + 1) / total, 0.0f}};
+            }
+            for (int t = 0; t < 4; ++t)
+                tap.indices[t] = std::clamp(tap.first + t, 0, source - 1);
+        }
+        return taps;
+    }
+
+    // Filters the texels of a level into the next level (as linear RGBA floats)
+    // "loadRow(y, scratch)" returns the source row y as linear RGBA floats (it may convert the row into "scratch" or return a row it already has)
+    // The output rows are computed in parallel chunks. Each chunk filters the source rows it needs horizontally (once per row),
+    // then sums them vertically, so the whole image is never stored in an intermediate buffer.
+    template <typename LoadRow>
+    std::vector<glm::vec4> downsample(LoadRow loadRow, glm::ivec2 sourceSize, glm::ivec2 destinationSize)
+    {
+        std::vector<FilterTaps> horizontal = computeFilterTaps(sourceSize.x, destinationSize.x);
+        std::vector<FilterTaps> vertical = computeFilterTaps(sourceSize.y, destinationSize.y);
+        size_t width = size_t(destinationSize.x);
+
+        std::vector<glm::vec4> destination(width * destinationSize.y);
+        our::JobSystem::get().parallelFor(0, size_t(destinationSize.y), [&](size_t begin, size_t end)
+                                          {
+            int firstRow = vertical[begin].first;
+            int lastRow = vertical[end - 1].first + vertical[end - 1].count - 1;
+            std::vector<glm::vec4> scratch(sourceSize.x);
+            std::vector<glm::vec4> filtered(size_t(lastRow - firstRow + 1) * width);
+            for (int row = firstRow; row <= lastRow; ++row)
+            {
+                const glm::vec4 *input = loadRow(std::clamp(row, 0, sourceSize.y - 1), scratch.data());
+                glm::vec4 *output = filtered.data() + size_t(row - firstRow) * width;
+                for (size_t x = 0; x < width; ++x)
+                {
+                    const FilterTaps &tap = horizontal[x];
+                    glm::vec4 sum(0.0f);
+                    for (int t = 0; t < tap.count; ++t)
+                        sum += tap.weights[t] * input[tap.indices[t]];
+                    output[x] = sum;
+                }
+            }
+            for (size_t y = begin; y < end; ++y)
+            {
+                const FilterTaps &tap = vertical[y];
+                glm::vec4 *output = destination.data() + y * width;
+                for (int t = 0; t < tap.count; ++t)
+                {
+                    const glm::vec4 *input = filtered.data() + size_t(tap.first + t - firstRow) * width;
+                    for (size_t x = 0; x < width; ++x)
+                        output[x] += tap.weights[t] * input[x];
+                }
+            } }, 4);
+        return destination;
+    }
+}
+
+void our::texture_utils::buildMipmaps(Image &image, ColorSpace colorSpace)
+{
+    OUR_TRACE_SCOPE("build mipmaps");
+    image.mipmaps.clear();
+    image.mipmapStorage.clear();
+    if (!image.pixels)
+        return;
+
+    // First, we find the size of every level (each level halves the previous one, rounding down, until it reaches 1x1)
+    std::vector<glm::ivec2> sizes;
+    size_t totalBytes = 0;
+    for (glm::ivec2 size = image.size; size.x > 1 || size.y > 1;)
+    {
+        size = glm::max(size / 2, glm::ivec2(1));
+        sizes.push_back(size);
+        totalBytes += size_t(size.x) * size_t(size.y) * 4;
+    }
+    image.mipmapStorage.resize(totalBytes);
+
+    const SRGBTables &srgb = getSRGBTables();
+    bool isSRGB = colorSpace == ColorSpace::SRGB;
+    JobSystem &jobs = JobSystem::get();
+
+    // The filtering is done on linear floats, and each level is computed from the float version of the previous level
+    // (not from its 8-bit version), so the rounding errors do not accumulate along the chain.
+    // The first level is computed from the 8-bit pixels of the image directly, one row at a time.
+    auto loadImageRow = [&](int y, glm::vec4 *scratch) -> const glm::vec4 *
+    {
+        const unsigned char *input = image.pixels + size_t(y) * image.size.x * 4;
+        for (int x = 0; x < image.size.x; ++x, input += 4)
+        {
+            if (isSRGB)
+                scratch[x] = glm::vec4(srgb.decode[input[0]], srgb.decode[input[1]], srgb.decode[input[2]], input[3] / 255.0f); // Alpha is always linear
+            else
+                scratch[x] = glm::vec4(input[0], input[1], input[2], input[3]) / 255.0f;
+        }
+        return scratch;
+    };
+    std::vector<glm::vec4> current;
+    glm::ivec2 currentSize = image.size;
+    unsigned char *levelPixels = image.mipmapStorage.data();
+    for (glm::ivec2 size : sizes)
+    {
+        if (current.empty())
+            current = downsample(loadImageRow, currentSize, size);
+        else
+        {
+            auto loadLevelRow = [&current, width = currentSize.x](int y, glm::vec4 *) -> const glm::vec4 *
+            { return current.data() + size_t(y) * width; };
+            current = downsample(loadLevelRow, currentSize, size);
+        }
+        currentSize = size;
+        jobs.parallelFor(0, current.size(), [&](size_t begin, size_t end)
+                         {
+            for (size_t texel = begin; texel < end; ++texel)
+            {
+                const glm::vec4 &input = current[texel];
+                unsigned char *output = levelPixels + texel * 4;
+                for (int c = 0; c < 3; ++c)
+                    output[c] = isSRGB ? srgb.encode(input[c]) : static_cast<unsigned char>(std::clamp(input[c], 0.0f, 1.0f) * 255.0f + 0.5f);
+                output[3] = static_cast<unsigned char>(std::clamp(input[3], 0.0f, 1.0f) * 255.0f + 0.5f);
+            } }, 4096);
+        image.mipmaps.push_back({size, levelPixels});
+        levelPixels += size_t(size.x) * size_t(size.y) * 4;
+    }
+}
+
+namespace
+{
+    constexpr const char *TEXTURE_CACHE_CATEGORY = "textures";
+
+    // Opens the cache file with the given key into the image (the levels are read from the mapped cache file as they are)
+    bool openTextureCache(std::uint64_t key, our::texture_utils::Image &image)
+    {
+        our::texture_utils::Image cached;
+        if (!cached.cache.open(our::getTextureCachePath(key), key))
+            return false;
+        cached.size = cached.cache.getLevelSize(0);
+        cached.pixels = cached.cache.getLevelPixels(0);
+        for (size_t level = 1; level < cached.cache.getLevelCount(); ++level)
+            cached.mipmaps.push_back({cached.cache.getLevelSize(level), cached.cache.getLevelPixels(level)});
+        image = std::move(cached);
+        return true;
     }
+
+    // Loads the image from the content of the file once the index of the cache (see "findIndexedCacheKey") did not know the file
+    // "stamp" is the stamp of the file (or nullptr if it is unknown)
+    bool loadImageDataFromFile(our::texture_utils::Image &image, const our::AssetFile &file, const char *filename,
+                               our::texture_utils::ColorSpace colorSpace, const our::SourceStamp *stamp)
+    {
+        if (!file.isOpen())
+        {
+            std::cerr << "Failed to load image: " << filename << std::endl;
+            return false;
+        }
+        std::uint64_t key = our::getTextureCacheKey(file, colorSpace);
+        // The stamp is not recorded if the file was obviously modified after it was stamped
+        if (stamp && stamp->size == file.size())
+            our::storeIndexedCacheKey(TEXTURE_CACHE_CATEGORY, filename, *stamp, our::getTextureCacheSeed(colorSpace), key);
+        // The content may have been cached under another path or before the file was touched
+        if (openTextureCache(key, image))
+            return true;
+        // Cold start: the file is decoded and its mip chain is computed, then they are cached for the next time
+        if (!our::texture_utils::decodeImage(image, file, filename))
+            return false;
+        our::texture_utils::buildMipmaps(image, colorSpace);
+        std::string cachePath = our::getTextureCachePath(key);
+        if (!our::saveTextureCache(image, key, cachePath))
+            std::cerr << "WARN: Failed to write the texture cache \"" << cachePath << "\"" << std::endl;
+        return true;
+    }
+}
+
+bool our::texture_utils::loadImageData(Image &image, const char *filename, ColorSpace colorSpace)
+{
+    OUR_TRACE_SCOPE_DETAIL("load image", filename);
+    // Warm start: if the file did not change since it was hashed, its cache file is opened without reading or hashing the file
+    SourceStamp stamp;
+    bool stamped = getSourceStamp(filename, stamp);
+    std::uint64_t key;
+    if (stamped && findIndexedCacheKey(TEXTURE_CACHE_CATEGORY, filename, stamp, getTextureCacheSeed(colorSpace), key) && openTextureCache(key, image))
+        return true;
+    // Otherwise, the file is read once, then it is both hashed and decoded (if the cache does not have it) from memory
+    AssetFile file;
+    file.open(filename);
+    return loadImageDataFromFile(image, file, filename, colorSpace, stamped ? &stamp : nullptr);
+}
+
+bool our::texture_utils::loadImageData(Image &image, const AssetFile &file, const char *filename, ColorSpace colorSpace)
+{
+    OUR_TRACE_SCOPE_DETAIL("load image", filename);
+    // The file is already read, but hashing it can still be skipped if it did not change since it was hashed
+    SourceStamp stamp;
+    bool stamped = getSourceStamp(filename, stamp);
+    std::uint64_t key;
+    if (file.isOpen() && stamped && findIndexedCacheKey(TEXTURE_CACHE_CATEGORY, filename, stamp, getTextureCacheSeed(colorSpace), key) &&
+        openTextureCache(key, image))
+        return true;
+    return loadImageDataFromFile(image, file, filename, colorSpace, stamped ? &stamp : nullptr);
+}
+
+void our::texture_utils::uploadImage(Texture2D &texture, const Image &image, bool generate_mipmap)
+{
+    OUR_TRACE_SCOPE("upload image");
     // Bind the texture such that we upload the image data to its storage
     // TODO: Finish this function
     // HINT: The steps should be as follows: bind the texture, send the pixel data to the GPU, then generate the mipmap (if requested).
     texture.bind();
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size.x, size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, (void *)data);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, image.size.x, image.size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, (void *)image.pixels);
     /*
     (GL_TEXTURE_2D)--> talks to the texture bound to the GL_TEXTURE_2D
     (0)--> level (if 0 takes the image as it is, 1 creates small size of image of 1/2 W and 1/2 H)
@@ -45,9 +384,27 @@ glm::ivec2 our::texture_utils::loadImage(Texture2D &texture, const char *filenam
     ((void*)data) --> an array of unsigned char of size width*height*4
     where 4 is the number of channels
     */
-    if (generate_mipmap)
+    // If the mip chain was computed on the CPU, we upload its levels instead of asking the driver to generate them
+    for (size_t level = 0; level < image.mipmaps.size(); ++level)
+    {
+        const ImageLevel &mipmap = image.mipmaps[level];
+        glTexImage2D(GL_TEXTURE_2D, GLint(level + 1), GL_RGBA8, mipmap.size.x, mipmap.size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, (void *)mipmap.pixels);
+    }
+    size_t bytes = image.getByteCount();
+    if (generate_mipmap && image.mipmaps.empty())
+    {
         glGenerateMipmap(GL_TEXTURE_2D);
+        bytes += bytes / 3; // The generated levels add a third of level 0
+    }
+    texture.setByteCount(bytes);
+}
 
-    stbi_image_free(data); // Free image data after uploading to GPU
-    return size;
-}
\ No newline at end of file
+glm::ivec2 our::texture_utils::loadImage(Texture2D &texture, const char *filename, bool generate_mipmap)
+{
+    Image image;
+    // The mip chain comes from the texture cache, so only the images without a mipmap are decoded directly
+    if (!(generate_mipmap ? loadImageData(image, filename) : decodeImage(image, filename)))
+        return {0, 0};
+    uploadImage(texture, image, generate_mipmap);
+    return image.size; // The image data is freed after uploading to GPU
+}
\ No newline at end of file
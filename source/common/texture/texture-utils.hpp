@@ -1,11 +1,75 @@
 #pragma once
 
 #include "texture2d.hpp"
+#include "texture-cache.hpp"
 
 #include <glad/gl.h>
 #include <glm/vec2.hpp>
+#include <json/json.hpp>
+#include <string>
+#include <vector>
 
 namespace our::texture_utils {
-    // This function loads an image and sends its data to the given Texture2D 
+    // The color space of the texels of an image, which decides how the texels are averaged when the mip levels are computed
+    // - SRGB: The texels are colors encoded in sRGB (e.g. albedo & emission). They are averaged in linear space then encoded again,
+    //   otherwise the dark texels would win and the smaller levels would look darker than the original image.
+    // - LINEAR: The texels are linear values (e.g. roughness, specular & ambient occlusion) which are averaged as they are.
+    enum class ColorSpace { SRGB, LINEAR };
+
+    // Reads the path & the color space of a texture from its description in the asset config, which is either:
+    // - "path/to/image" (the texture holds colors, so its color space is SRGB)
+    // - { "path": "path/to/image", "color-space": "srgb" or "linear" }
+    // Returns false if the description is not in one of these forms
+    bool readTextureDescription(const nlohmann::json& description, std::string& path, ColorSpace& colorSpace);
+
+    // A mip level of an image
+    struct ImageLevel {
+        glm::ivec2 size;
+        const unsigned char* pixels;
+    };
+
+    // The pixels of a decoded image (RGBA8, flipped vertically since OpenGL puts the texture origin at the bottom left)
+    // and optionally its mip chain down to 1x1 (computed on the CPU by "buildMipmaps" or read from the texture cache)
+    // Decoding an image does not use OpenGL, so it can be done on any thread
+    struct Image {
+        glm::ivec2 size = {0, 0};
+        const unsigned char* pixels = nullptr; // The pixels of level 0
+        std::vector<ImageLevel> mipmaps;       // The levels 1, 2, ... (empty if the mip chain was not computed)
+
+        // The pixels are stored in one of these depending on where they came from
+        unsigned char* decoded = nullptr;      // Allocated by the image decoder (and released by the destructor)
+        std::vector<unsigned char> mipmapStorage; // The mip levels computed by "buildMipmaps"
+        CachedTexture cache;                   // The texture cache file (when the image was read from the cache)
+
+        // Returns the number of bytes of all the levels
+        size_t getByteCount() const;
+
+        Image() = default;
+        ~Image();
+        Image(Image&& other) noexcept;
+        Image& operator=(Image&& other) noexcept;
+        Image(const Image&) = delete;
+        Image& operator=(const Image&) = delete;
+    };
+
+    // This function reads and decodes an image file (it is thread safe and does not need an OpenGL context)
+    // Returns false if the image could not be loaded
+    bool decodeImage(Image& image, const char* filename);
+    // Like "decodeImage" but the image file was already read (e.g. by the "AsyncFileReader"), the filename is only used in the error messages
+    bool decodeImage(Image& image, const AssetFile& file, const char* filename);
+    // This function computes the mip chain of the image on the CPU (down to 1x1) using a separable tent filter
+    // The rows of each level are filtered in parallel on the job system
+    void buildMipmaps(Image& image, ColorSpace colorSpace);
+    // This function reads an image and its mip chain using the texture cache (see "texture-cache.hpp")
+    // If the cache has the image, it is mapped without decoding the file. Otherwise, the file is decoded, its mip chain is computed and the result is added to the cache.
+    // Like "decodeImage", it is thread safe and does not need an OpenGL context
+    bool loadImageData(Image& image, const char* filename, ColorSpace colorSpace = ColorSpace::SRGB);
+    // Like "loadImageData" but the image file was already read (so it is hashed and decoded without reading it again)
+    bool loadImageData(Image& image, const AssetFile& file, const char* filename, ColorSpace colorSpace = ColorSpace::SRGB);
+    // This function sends the pixels of a decoded image to the given Texture2D (it must be called on the thread that owns the OpenGL context)
+    // If the image has a mip chain, all of its levels are uploaded. Otherwise, the driver generates the mipmap (if requested).
+    void uploadImage(Texture2D& texture, const Image& image, bool generate_mipmap = true);
+
+    // This function loads an image and sends its data to the given Texture2D
     glm::ivec2 loadImage(Texture2D& texture, const char* filename, bool generate_mipmap = true);
 }
\ No newline at end of file
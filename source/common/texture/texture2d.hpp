@@ -1,6 +1,8 @@
 #pragma once
 
 #include <glad/gl.h>
+#include <utility>
+#include <cstddef>
 
 namespace our
 {
@@ -10,6 +12,8 @@ namespace our
     {
         // The OpenGL object name of this texture
         GLuint name = 0;
+        // The number of bytes that the levels of this texture use in the VRAM (used by the asset budgets)
+        size_t byteCount = 0;
 
     public:
         // This constructor creates an OpenGL texture and saves its object name in the member variable "name"
@@ -40,6 +44,18 @@ namespace our
             glBindTexture(GL_TEXTURE_2D, 0); // set name to 0 to unbind
         }
 
+        // This method exchanges the OpenGL textures of the two objects
+        // It is used to replace a placeholder by the real texture without changing the pointers that refer to the texture object
+        void swap(Texture2D &other)
+        {
+            std::swap(name, other.name);
+            std::swap(byteCount, other.byteCount);
+        }
+
+        // The number of bytes used by the texture in the VRAM (it is set by whoever uploads the texture data)
+        size_t getByteCount() const { return byteCount; }
+        void setByteCount(size_t bytes) { byteCount = bytes; }
+
         Texture2D(const Texture2D &) = delete;
         Texture2D &operator=(const Texture2D &) = delete;
     };
@@ -0,0 +1,260 @@
+#include "trace.hpp"
+
+#include <chrono>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+
+namespace our::trace
+{
+
+    namespace
+    {
+        // A recorded scope (the times are in nanoseconds since the tracer was started)
+        struct Event
+        {
+            const char *name;
+            std::uint64_t start;
+            std::uint64_t duration;
+            char detail[MAX_DETAIL_LENGTH + 1];
+        };
+
+        // The ring buffer of a thread
+        // Only its thread writes the events. "written" is the total number of events recorded since the last start.
+        struct ThreadBuffer
+        {
+            std::uint32_t id;
+            std::string name;
+            std::vector<Event> events;
+            std::atomic<std::uint64_t> written{0};
+            std::size_t generation = 0; // The recording the events belong to (the buffer is cleared lazily when a new recording starts)
+        };
+
+        // The buffers are owned by the tracer instead of their threads, so the events of the threads that exited are still written
+        // When a thread exits, its buffer is put in "freeBuffers" and given to the next new thread (which keeps appending to it),
+        // so short-lived threads (e.g. the I/O threads of every batch) do not add a buffer each.
+        struct Registry
+        {
+            std::mutex mutex;
+            std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+            std::vector<ThreadBuffer *> freeBuffers; // The buffers of the threads that exited
+            std::size_t eventsPerThread = DEFAULT_EVENTS_PER_THREAD;
+            std::atomic<std::size_t> generation{0};
+            std::atomic<std::int64_t> origin{0}; // The time at which the recording started (in nanoseconds of the steady clock)
+        };
+
+        // Returns the current time in nanoseconds of the steady clock
+        std::int64_t steadyNanoseconds()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        // The registry is never destroyed, since threads that outlive the static objects (e.g. the workers of the job system) may still exit after it
+        Registry &getRegistry()
+        {
+            static Registry *registry = new Registry();
+            return *registry;
+        }
+
+        thread_local ThreadBuffer *currentBuffer = nullptr;
+        thread_local std::string currentThreadName;
+
+        // Returns the buffer of the thread to the free buffers when the thread exits
+        struct BufferRelease
+        {
+            ~BufferRelease()
+            {
+                if (currentBuffer == nullptr)
+                    return;
+                Registry &registry = getRegistry();
+                std::lock_guard<std::mutex> lock(registry.mutex);
+                registry.freeBuffers.push_back(currentBuffer);
+                currentBuffer = nullptr;
+            }
+        };
+        thread_local BufferRelease bufferRelease;
+
+        // Returns the buffer of the calling thread (which is created the first time the thread records an event)
+        ThreadBuffer &getThreadBuffer()
+        {
+            Registry &registry = getRegistry();
+            std::size_t generation = registry.generation.load(std::memory_order_acquire);
+            if (currentBuffer == nullptr)
+            {
+                (void)&bufferRelease; // Using the release object makes sure that it is constructed (so it is destroyed when the thread exits)
+                std::lock_guard<std::mutex> lock(registry.mutex);
+                if (!registry.freeBuffers.empty())
+                {
+                    // A buffer that was used by a thread with the same name is preferred, so the events of its row in the trace keep a matching name
+                    auto reused = std::find_if(registry.freeBuffers.begin(), registry.freeBuffers.end(), [](const ThreadBuffer *buffer)
+                                               { return buffer->name == currentThreadName; });
+                    if (reused == registry.freeBuffers.end())
+                        reused = registry.freeBuffers.begin();
+                    currentBuffer = *reused;
+                    registry.freeBuffers.erase(reused);
+                    if (!currentThreadName.empty())
+                        currentBuffer->name = currentThreadName;
+                }
+                else
+                {
+                    auto buffer = std::make_unique<ThreadBuffer>();
+                    buffer->id = std::uint32_t(registry.buffers.size());
+                    buffer->name = currentThreadName.empty() ? "thread " + std::to_string(buffer->id) : currentThreadName;
+                    buffer->events.resize(registry.eventsPerThread);
+                    buffer->generation = generation;
+                    currentBuffer = buffer.get();
+                    registry.buffers.push_back(std::move(buffer));
+                }
+            }
+            if (currentBuffer->generation != generation)
+            {
+                std::lock_guard<std::mutex> lock(registry.mutex);
+                currentBuffer->events.resize(registry.eventsPerThread);
+                currentBuffer->written.store(0, std::memory_order_relaxed);
+                currentBuffer->generation = generation;
+            }
+            return *currentBuffer;
+        }
+
+        // Writes a string as a JSON string (the names and the details may contain quotes or backslashes, e.g. in paths)
+        void writeJSONString(std::ostream &stream, const char *text)
+        {
+            stream << '"';
+            for (; *text; ++text)
+            {
+                char character = *text;
+                if (character == '"' || character == '\\')
+                    stream << '\\' << character;
+                else if (static_cast<unsigned char>(character) < 0x20)
+                {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", unsigned(character));
+                    stream << escaped;
+                }
+                else
+                    stream << character;
+            }
+            stream << '"';
+        }
+    }
+
+    namespace internal
+    {
+        std::atomic<bool> enabled{false};
+
+        std::uint64_t now()
+        {
+            return std::uint64_t(steadyNanoseconds() - getRegistry().origin.load(std::memory_order_relaxed));
+        }
+
+        void record(const char *name, const char *detail, std::size_t detailLength, std::uint64_t start, std::uint64_t end)
+        {
+            ThreadBuffer &buffer = getThreadBuffer();
+            std::uint64_t index = buffer.written.load(std::memory_order_relaxed);
+            Event &event = buffer.events[index % buffer.events.size()];
+            event.name = name;
+            event.start = start;
+            event.duration = end - start;
+            detailLength = std::min(detailLength, MAX_DETAIL_LENGTH);
+            if (detailLength > 0)
+                std::memcpy(event.detail, detail, detailLength);
+            event.detail[detailLength] = '\0';
+            buffer.written.store(index + 1, std::memory_order_release);
+        }
+    }
+
+    void start(std::size_t eventsPerThread)
+    {
+        Registry &registry = getRegistry();
+        {
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            registry.eventsPerThread = std::max<std::size_t>(eventsPerThread, 1);
+            registry.origin.store(steadyNanoseconds(), std::memory_order_relaxed);
+        }
+        registry.generation.fetch_add(1, std::memory_order_acq_rel);
+        internal::enabled.store(true, std::memory_order_release);
+    }
+
+    void stop()
+    {
+        internal::enabled.store(false, std::memory_order_release);
+    }
+
+    bool writeChromeTrace(const std::string &path)
+    {
+        stop();
+        std::ofstream file(path, std::ios::binary);
+        if (!file)
+        {
+            std::cerr << "Couldn't open the trace file: " << path << std::endl;
+            return false;
+        }
+        Registry &registry = getRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        std::size_t generation = registry.generation.load(std::memory_order_acquire);
+
+        // The times are written in microseconds (the unit of the format) with a nanosecond precision
+        std::size_t eventCount = 0, droppedCount = 0;
+        char number[64];
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        bool first = true;
+        for (const auto &buffer : registry.buffers)
+        {
+            if (buffer->generation != generation)
+                continue;
+            // The name of the thread is written as a metadata event
+            file << (first ? "\n" : ",\n") << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << buffer->id << ",\"args\":{\"name\":";
+            writeJSONString(file, buffer->name.c_str());
+            file << "}}";
+            first = false;
+
+            std::uint64_t written = buffer->written.load(std::memory_order_acquire);
+            std::uint64_t capacity = buffer->events.size();
+            std::uint64_t begin = written > capacity ? written - capacity : 0;
+            droppedCount += std::size_t(begin);
+            for (std::uint64_t index = begin; index < written; ++index)
+            {
+                const Event &event = buffer->events[index % capacity];
+                file << ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->id << ",\"name\":";
+                writeJSONString(file, event.name);
+                std::snprintf(number, sizeof(number), ",\"ts\":%.3f,\"dur\":%.3f", double(event.start) / 1000.0, double(event.duration) / 1000.0);
+                file << number;
+                if (event.detail[0] != '\0')
+                {
+                    file << ",\"args\":{\"detail\":";
+                    writeJSONString(file, event.detail);
+                    file << '}';
+                }
+                file << '}';
+                ++eventCount;
+            }
+        }
+        file << "\n]}\n";
+        if (!file)
+        {
+            std::cerr << "Failed to write the trace file: " << path << std::endl;
+            return false;
+        }
+        std::cout << "Wrote " << eventCount << " trace events to \"" << path << "\"";
+        if (droppedCount > 0)
+            std::cout << " (the " << droppedCount << " oldest events were overwritten)";
+        std::cout << std::endl;
+        return true;
+    }
+
+    void setThreadName(const std::string &name)
+    {
+        currentThreadName = name;
+        if (currentBuffer)
+        {
+            std::lock_guard<std::mutex> lock(getRegistry().mutex);
+            currentBuffer->name = name;
+        }
+    }
+
+}
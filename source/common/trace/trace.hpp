@@ -0,0 +1,104 @@
+#pragma once
+
+#include <string>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+namespace our::trace
+{
+
+    // The tracer records how long the scopes of the engine take (e.g. initializing GLFW, decoding an image or compiling a shader)
+    // on every thread, so the time of a phase like the startup can be broken down and viewed on a timeline.
+    // - Every thread records its events into its own ring buffer, so recording never takes a lock or touches the buffers of other threads.
+    //   If a buffer is full, its oldest events are overwritten.
+    // - The trace is written in the JSON format of the Chrome trace viewer (chrome://tracing), which Perfetto (ui.perfetto.dev) opens too.
+    // While the tracer is disabled (which is the default), a scope only checks a flag, so the instrumentation can stay in the code.
+    // A scope is recorded as a single "complete" event when it ends, so the nesting of the scopes is kept even if the buffer wraps around.
+
+    // The number of events each thread keeps by default
+    constexpr std::size_t DEFAULT_EVENTS_PER_THREAD = 32768;
+    // The longest detail that is kept with an event (longer details are truncated)
+    constexpr std::size_t MAX_DETAIL_LENGTH = 47;
+
+    namespace internal
+    {
+        extern std::atomic<bool> enabled;
+        // Returns the nanoseconds since the tracer was started
+        std::uint64_t now();
+        // Adds an event to the buffer of the calling thread
+        void record(const char *name, const char *detail, std::size_t detailLength, std::uint64_t start, std::uint64_t end);
+    }
+
+    // Returns true if the scopes are currently recorded
+    inline bool isEnabled() { return internal::enabled.load(std::memory_order_relaxed); }
+
+    // Starts recording (the events of an earlier recording are discarded)
+    void start(std::size_t eventsPerThread = DEFAULT_EVENTS_PER_THREAD);
+    // Stops recording (the recorded events are kept until the next start)
+    void stop();
+    // Stops recording then writes the recorded events to a Chrome trace file
+    // It should be called once the threads stopped running scopes (e.g. before the application exits)
+    // Returns false if the file could not be written
+    bool writeChromeTrace(const std::string &path);
+
+    // Sets the name of the calling thread in the trace (e.g. "main" or "worker 1")
+    // It can be called before the tracer is started
+    void setThreadName(const std::string &name);
+
+    // Records the time between its construction and its destruction as an event with the given name
+    // The name must be a string literal (or outlive the trace) since only its pointer is kept.
+    // The detail (e.g. the name of the loaded asset) is copied, but only if the tracer is enabled.
+    // A scope with a nullptr name is not recorded (which allows tracing a scope conditionally).
+    class Scope
+    {
+        const char *name;
+        const char *detail = nullptr;
+        std::size_t detailLength = 0;
+        std::uint64_t start = 0;
+
+    public:
+        explicit Scope(const char *name) : name(name != nullptr && isEnabled() ? name : nullptr)
+        {
+            if (this->name)
+                start = internal::now();
+        }
+        // The detail must outlive the scope
+        Scope(const char *name, const char *detail) : Scope(name)
+        {
+            if (this->name && detail)
+            {
+                this->detail = detail;
+                detailLength = std::strlen(detail);
+            }
+        }
+        Scope(const char *name, const std::string &detail) : Scope(name)
+        {
+            if (this->name)
+            {
+                this->detail = detail.c_str();
+                detailLength = detail.size();
+            }
+        }
+        ~Scope() { end(); }
+
+        // Ends the scope early (e.g. when a phase ends in the middle of a function)
+        void end()
+        {
+            if (name)
+                internal::record(name, detail, detailLength, start, internal::now());
+            name = nullptr;
+        }
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+    };
+
+}
+
+// These macros trace the rest of the enclosing block
+#define OUR_TRACE_CONCAT_INNER(a, b) a##b
+#define OUR_TRACE_CONCAT(a, b) OUR_TRACE_CONCAT_INNER(a, b)
+#define OUR_TRACE_SCOPE(name) our::trace::Scope OUR_TRACE_CONCAT(traceScope, __LINE__)(name)
+#define OUR_TRACE_SCOPE_DETAIL(name, detail) our::trace::Scope OUR_TRACE_CONCAT(traceScope, __LINE__)(name, detail)
@@ -4,6 +4,7 @@
 #include <json/json.hpp>
 
 #include <application.hpp>
+#include <trace/trace.hpp>
 
 #include "states/play-state.hpp"
 #include "states/mesh-test-state.hpp"
@@ -29,6 +30,13 @@ int main(int argc, char **argv)
     // This is useful for testing multiple configurations in a batch
     // Default: 0 where the application runs indefinitely until manually closed
     int run_for_frames = args.get<int>("f", 0);
+    // trace_path is the path of a Chrome trace file (see "trace/trace.hpp") to which the time spent in the engine's scopes is written on exit
+    // It can be opened in chrome://tracing or ui.perfetto.dev to see where the startup time goes
+    // Default: "" where nothing is traced
+    std::string trace_path = args.get<std::string>("trace", "");
+    if (!trace_path.empty())
+        our::trace::start();
+    our::trace::setThreadName("main");
 
     // Open the config file and exit if failed
     std::ifstream file_in(config_path);
@@ -38,11 +46,13 @@ int main(int argc, char **argv)
         return -1;
     }
     // Read the file into a json object then close the file
+    our::trace::Scope parseScope("parse config", config_path);
     nlohmann::json app_config = nlohmann::json::parse(file_in, nullptr, true, true);
     file_in.close();
+    parseScope.end();
 
     // Create the application
-    our::Application app(app_config);
+    our::Application app(app_config, config_path);
 
     // Register all the states of the project in the application
     app.registerState<Playstate>("main");
@@ -64,5 +74,8 @@ int main(int argc, char **argv)
     }
     // Finally run the application
     // Here, the application loop will run till the terminatio condition is statisfied
-    return app.run(run_for_frames);
+    int result = app.run(run_for_frames);
+    if (!trace_path.empty())
+        our::trace::writeChromeTrace(trace_path);
+    return result;
 }
\ No newline at end of file
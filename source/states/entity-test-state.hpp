@@ -10,12 +10,9 @@
 template <typename T>
 T *find(our::World *world)
 {
-    for (auto &entity : world->getEntities())
-    {
-        T *component = entity->getComponent<T>();
-        if (component)
-            return component;
-    }
+    auto &components = world->getComponents<T>();
+    if (components.size() > 0)
+        return &components[0];
     return nullptr;
 }
 
@@ -65,6 +62,7 @@ class EntityTestState : public our::State
             // TODO: Complete the loop body to draw the current entity
             meshRenderer->material->setup();
             meshRenderer->material->shader->set("transform", VP * camera->getViewMatrix() * entity->getLocalToWorldMatrix());
+            meshRenderer->mesh->setDequantization(meshRenderer->material->shader);
             meshRenderer->mesh->draw();
             //  Then we setup the material, send the transform matrix to the shader then draw the mesh
         }
@@ -75,6 +75,5 @@ class LostState : public our::State
         delete shader;
         delete mesh;
         delete texture;
-        our::clearAllAssets();
     }
 };
\ No newline at end of file
@@ -12,8 +12,9 @@
 // It also shows how to use the AssetLoader to load assets
 class MaterialTestState: public our::State {
 
-    our::Material* material;
-    our::Mesh* mesh;
+    // The handles keep the mesh & material from being evicted while this state uses them
+    our::AssetHandle<our::Material> material;
+    our::AssetHandle<our::Mesh> mesh;
     std::vector<our::Transform> transforms;
     glm::mat4 VP;
     
@@ -25,8 +26,8 @@ class MaterialTestState: public our::State {
             our::deserializeAllAssets(config["assets"]);
         }
         // We get the mesh and the material from AssetLoader 
-        mesh = our::AssetLoader<our::Mesh>::get("mesh");
-        material = our::AssetLoader<our::Material>::get("material");
+        mesh = our::AssetLoader<our::Mesh>::acquire("mesh");
+        material = our::AssetLoader<our::Material>::acquire("material");
 
         // Then we read a list of transform objects from the shader
         // In draw, we will render a mesh for each of the transforms
@@ -71,11 +72,15 @@ class MaterialTestState: public our::State {
             // For each transform, we compute the MVP matrix and send it to the "transform" uniform
             material->shader->set("transform", VP * transform.toMat4());
             // Then we draw a mesh instance
+            mesh->setDequantization(material->shader);
             mesh->draw();
         }
     }
 
     void onDestroy() override {
+        // The handles must be released before the assets are cleared
+        mesh.reset();
+        material.reset();
         our::clearAllAssets();
     }
 };
\ No newline at end of file
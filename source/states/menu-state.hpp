@@ -78,6 +78,5 @@ class MenuState : public our::State
         delete shader;
         delete mesh;
         delete texture;
-        our::clearAllAssets();
     }
 };
\ No newline at end of file
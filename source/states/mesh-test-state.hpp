@@ -56,6 +56,7 @@ class MeshTestState: public our::State {
         glClear(GL_COLOR_BUFFER_BIT);
         // Use the shader then draw the mesh
         shader->use();
+        mesh->setDequantization(shader);
         mesh->draw();
     }
 
@@ -84,6 +84,7 @@ class PipelineTestState: public our::State {
         // Then we draw the objects
         for(auto& transform : transforms){
             shader->set("transform", VP * transform.toMat4());
+            mesh->setDequantization(shader);
             mesh->draw();
         }
     }
@@ -3,12 +3,15 @@
 #include <application.hpp>
 
 #include <ecs/world.hpp>
+#include <ecs/scheduler.hpp>
+#include <jobs/job-system.hpp>
 #include <systems/forward-renderer.hpp>
 #include <systems/free-camera-controller.hpp>
 #include <systems/movement.hpp>
 #include <systems/random-movement.hpp>
 #include <systems/collider.hpp>
 #include <asset-loader.hpp>
+#include <scene/compiled-scene.hpp>
 #include "../game/Game.hpp"
 
 // This state shows how to use the ECS framework and deserialization.
@@ -22,24 +25,33 @@ class Playstate : public our::State
     our::RandomMovementSystem randomMovementSystem;
     our::ColliderSystem colliderSystem;
     our::Game game;
+    // The systems (except the renderer) are run by the scheduler on the engine's job system
+    our::SystemScheduler scheduler;
 
     void onInitialize() override
     {
         // First of all, we get the scene configuration from the app config
         auto &config = getApp()->getConfig()["scene"];
-        // If we have assets in the scene config, we deserialize them
-        if (config.contains("assets"))
-        {
-            our::deserializeAllAssets(config["assets"]);
-        }
-        // If we have a world in the scene config, we use it to populate our world
-        if (config.contains("world"))
-        {
-            world.deserialize(config["world"]);
-        }
+        // Then we load the assets and populate our world from it
+        // The scene is loaded from its compiled version (which is compiled again whenever the config file changes)
+        // The textures and meshes are streamed, so the state starts with placeholders instead of freezing until they are loaded
+        our::loadScene(config, getApp()->getConfigPath(), &world, true);
 
         // We initialize the camera controller system since it needs a pointer to the app
         cameraController.enter(getApp());
+
+        // Then we add the systems to the scheduler
+        // Systems that conflict run in the order they are added here, while the others can run at the same time.
+        // The movement and random movement systems touch different entities so they run concurrently.
+        scheduler.clear();
+        scheduler.add("movement", our::MovementSystem::getAccess(), [this](float deltaTime)
+                      { movementSystem.update(&world, deltaTime, &our::JobSystem::get()); });
+        scheduler.add("random movement", our::RandomMovementSystem::getAccess(), [this](float deltaTime)
+                      { randomMovementSystem.update(&world, deltaTime, &our::JobSystem::get()); });
+        scheduler.add("camera controller", our::FreeCameraControllerSystem::getAccess(), [this](float deltaTime)
+                      { cameraController.update(&world, deltaTime); });
+        scheduler.add("collider", our::ColliderSystem::getAccess(), [this](float deltaTime)
+                      { colliderSystem.update(&world, deltaTime, &game); });
     }
 
     void onDraw(double deltaTime) override
@@ -57,11 +69,8 @@ class Playstate : public our::State
 
             getApp()->changeState("congrats-test");
         }
-        // Here, we just run a bunch of systems to control the world logic
-        movementSystem.update(&world, (float)deltaTime);
-        cameraController.update(&world, (float)deltaTime);
-        colliderSystem.update(&world, (float)deltaTime, &game);
-        randomMovementSystem.update(&world, (float)deltaTime);
+        // Here, we run the systems that control the world logic
+        scheduler.run(&world, (float)deltaTime);
         // And finally we use the renderer system to draw the scene
         auto size = getApp()->getFrameBufferSize();
         renderer.render(&world, glm::ivec2(0, 0), size);
@@ -73,7 +82,7 @@ class Playstate : public our::State
         cameraController.exit();
         world.clear();
         game.resetGame();
-        // and we delete all the loaded assets to free memory on the RAM and the VRAM
-        our::clearAllAssets();
+        // The assets stay resident, so restarting the game reuses them instead of loading them again
+        // (the unused ones are evicted when their types exceed their budgets, and the application clears them all before it exits)
     }
 };
\ No newline at end of file
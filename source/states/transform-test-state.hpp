@@ -69,6 +69,7 @@ class TransformTestState: public our::State {
             // For each transform, we compute the MVP matrix and send it to the "transform" uniform
             shader->set("transform", VP * transform.toMat4());
             // Then we draw a mesh instance
+            mesh->setDequantization(shader);
             mesh->draw();
         }
     }
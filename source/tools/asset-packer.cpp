@@ -0,0 +1,76 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <algorithm>
+#include <chrono>
+#include <flags/flags.h>
+#include <json/json.hpp>
+
+#include <io/asset-pack.hpp>
+
+// This tool bundles the assets into a single asset pack (see "io/asset-pack.hpp") which the application mounts at startup
+// Usage: ASSET_PACKER [-o assets.pack] [config files or directories...]
+// - For a config file, every string value in it that names an existing file is added (e.g. the textures, meshes & shaders of the scene).
+// - For a directory, all the files under it are added (e.g. "assets/shaders" for the shaders that are loaded by the code).
+// If no input is given, the assets of "config/app.jsonc" are packed.
+// The paths are stored as they are written in the config (relative to the working directory), so the tool must run from the same directory as the application.
+
+// Adds every string in the json value that is the path of an existing file
+static void collectPaths(const nlohmann::json &value, std::vector<std::string> &paths)
+{
+    if (value.is_string())
+    {
+        std::error_code error;
+        const std::string &path = value.get_ref<const std::string &>();
+        if (std::filesystem::is_regular_file(path, error))
+            paths.push_back(path);
+    }
+    else if (value.is_structured())
+    {
+        for (auto &item : value)
+            collectPaths(item, paths);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    flags::args args(argc, argv);
+    std::string output = args.get<std::string>("o", "assets.pack");
+    std::vector<std::string> inputs(args.positional().begin(), args.positional().end());
+    if (inputs.empty())
+        inputs.push_back("config/app.jsonc");
+
+    std::vector<std::string> paths;
+    for (const std::string &input : inputs)
+    {
+        std::error_code error;
+        if (std::filesystem::is_directory(input, error))
+        {
+            for (auto &entry : std::filesystem::recursive_directory_iterator(input))
+                if (entry.is_regular_file())
+                    paths.push_back(entry.path().generic_string());
+            continue;
+        }
+        std::ifstream file(input);
+        if (!file)
+        {
+            std::cerr << "Couldn't open file: " << input << std::endl;
+            return -1;
+        }
+        collectPaths(nlohmann::json::parse(file, nullptr, true, true), paths);
+    }
+    // The files are sorted so they are stored in the order of their folders (the files of a folder are usually loaded together)
+    std::sort(paths.begin(), paths.end());
+
+    auto start = std::chrono::high_resolution_clock::now();
+    if (!our::buildAssetPack(paths, output, &std::cout))
+    {
+        std::cerr << "Failed to build the asset pack: " << output << std::endl;
+        return -1;
+    }
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    std::cout << "Wrote " << output << " in " << milliseconds << " ms" << std::endl;
+    return 0;
+}